@@ -42,6 +42,9 @@ bool benchmark_run_crba = true;
 bool benchmark_run_nle = true;
 bool benchmark_run_calc_minv_times_tau = true;
 bool benchmark_run_contacts = false;
+bool benchmark_run_multidof_joints = true;
+bool benchmark_run_model_construction = true;
+bool benchmark_run_urdf_loading = true;
 
 string model_file = "";
 
@@ -464,6 +467,192 @@ double contacts_benchmark (int sample_count, ContactsMethod contacts_method) {
   return duration;
 }
 
+void multidof_joints_benchmark (int sample_count) {
+  const char *variant_names[2] = { "emulated", "native" };
+
+  for (int variant = 0; variant < 2; variant++) {
+    Model *model = new Model();
+    model->mNativeMultiDofJoints = (variant == 1);
+
+    generate_human36model (model);
+
+    cout << "Human36 (" << variant_names[variant] << " multi-DoF joints, "
+      << model->mBodies.size() - 1 << " bodies)" << endl;
+
+    if (benchmark_run_fd_aba) {
+      cout << "  ABA:  ";
+      run_forward_dynamics_ABA_benchmark (model, sample_count);
+    }
+
+    if (benchmark_run_id_rnea) {
+      cout << "  RNEA: ";
+      run_inverse_dynamics_RNEA_benchmark (model, sample_count);
+    }
+
+    if (benchmark_run_crba) {
+      cout << "  CRBA: ";
+      run_CRBA_benchmark (model, sample_count);
+    }
+
+    delete model;
+  }
+}
+
+void model_construction_benchmark () {
+  const char *variant_names[2] = { "AddBody  ", "AddBodies" };
+  const char *model_names[2] = { "chain", "swarm" };
+
+  Body body (1., Vector3d (0., 0., -0.05), Vector3d (0.01, 0.01, 0.001));
+  Joint joint_rot_y (JointTypeRevoluteY);
+  Joint joint_rot_z (JointTypeRevoluteZ);
+  Joint joint_floating_base (JointTypeFloatingBase);
+
+  for (int model_type = 0; model_type < 2; model_type++) {
+    for (int body_count = 1000; body_count <= 5000; body_count *= 5) {
+      // a cable of alternating revolute joints or a swarm of free bodies
+      std::vector<Model::BodyDescription> bodies (body_count);
+      for (int i = 0; i < body_count; i++) {
+        if (model_type == 0) {
+          bodies[i] = Model::BodyDescription (0,
+              Xtrans (Vector3d (0., 0., i == 0 ? 0. : -0.1)),
+              i % 2 == 0 ? joint_rot_y : joint_rot_z,
+              body);
+          bodies[i].parent_index = i - 1;
+        } else {
+          bodies[i] = Model::BodyDescription (0,
+              Xtrans (Vector3d (0.1 * i, 0., 0.)),
+              joint_floating_base,
+              body);
+        }
+      }
+
+      cout << model_names[model_type] << " #bodies: " << setw(5)
+        << body_count << endl;
+
+      for (int variant = 0; variant < 2; variant++) {
+        TimerInfo tinfo;
+        timer_start (&tinfo);
+
+        Model *model = new Model();
+
+        if (variant == 0) {
+          std::vector<unsigned int> body_ids (body_count);
+          for (int i = 0; i < body_count; i++) {
+            unsigned int parent_id = bodies[i].parent_index >= 0 ?
+              body_ids[bodies[i].parent_index] : bodies[i].parent_id;
+            body_ids[i] = model->AddBody (parent_id,
+                bodies[i].joint_frame,
+                bodies[i].joint,
+                bodies[i].body);
+          }
+        } else {
+          model->AddBodies (bodies);
+        }
+
+        double duration = timer_stop (&tinfo);
+
+        cout << "  " << variant_names[variant]
+          << " duration = " << setw(10) << duration << "(s)"
+          << " #dof: " << model->dof_count << endl;
+
+        delete model;
+      }
+    }
+  }
+}
+
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+string generate_urdf_tree (int link_count) {
+  const char *joint_types[4] = { "revolute", "continuous", "prismatic", "fixed" };
+  const char *joint_axes[3] = { "1 0 0", "0 1 0", "0 0 1" };
+  stringstream urdf;
+
+  urdf << "<?xml version=\"1.0\"?>" << endl;
+  urdf << "<robot name=\"generated_tree\">" << endl;
+
+  for (int i = 0; i < link_count; i++) {
+    urdf << "  <link name=\"link_" << i << "\">" << endl
+      << "    <inertial>" << endl
+      << "      <origin xyz=\"0 0 " << -0.05 - 0.001 * (i % 7) << "\" rpy=\"0 0 0\"/>" << endl
+      << "      <mass value=\"" << 1. + 0.01 * (i % 13) << "\"/>" << endl
+      << "      <inertia ixx=\"0.01\" ixy=\"0\" ixz=\"0\" iyy=\"0.02\" iyz=\"0\" izz=\"0.005\"/>" << endl
+      << "    </inertial>" << endl
+      << "    <visual>" << endl
+      << "      <origin xyz=\"0 0 -0.05\" rpy=\"0 0 0\"/>" << endl
+      << "      <geometry><box size=\"0.02 0.02 0.1\"/></geometry>" << endl
+      << "    </visual>" << endl
+      << "    <collision>" << endl
+      << "      <geometry><cylinder radius=\"0.01\" length=\"0.1\"/></geometry>" << endl
+      << "    </collision>" << endl
+      << "  </link>" << endl;
+  }
+
+  // a binary tree of links
+  for (int i = 1; i < link_count; i++) {
+    urdf << "  <joint name=\"joint_" << i << "\" type=\"" << joint_types[i % 4] << "\">" << endl
+      << "    <parent link=\"link_" << (i - 1) / 2 << "\"/>" << endl
+      << "    <child link=\"link_" << i << "\"/>" << endl
+      << "    <origin xyz=\"0.01 0 -0.1\" rpy=\"" << 0.1 * (i % 5) << " 0 " << 0.05 * (i % 3) << "\"/>" << endl
+      << "    <axis xyz=\"" << joint_axes[i % 3] << "\"/>" << endl
+      << "    <limit lower=\"-1\" upper=\"1\" effort=\"10\" velocity=\"1\"/>" << endl
+      << "  </joint>" << endl;
+  }
+
+  urdf << "</robot>" << endl;
+
+  return urdf.str();
+}
+
+bool models_identical (const Model &model_a, const Model &model_b) {
+  if (model_a.mBodies.size() != model_b.mBodies.size()
+      || model_a.mFixedBodies.size() != model_b.mFixedBodies.size()
+      || model_a.q_size != model_b.q_size
+      || model_a.lambda != model_b.lambda
+      || model_a.mBodyNameMap != model_b.mBodyNameMap) {
+    return false;
+  }
+
+  for (unsigned int i = 1; i < model_a.mBodies.size(); i++) {
+    if (model_a.mJoints[i].mJointType != model_b.mJoints[i].mJointType
+        || model_a.X_T[i].E != model_b.X_T[i].E
+        || model_a.X_T[i].r != model_b.X_T[i].r
+        || model_a.mBodies[i].mMass != model_b.mBodies[i].mMass
+        || model_a.mBodies[i].mCenterOfMass != model_b.mBodies[i].mCenterOfMass
+        || model_a.mBodies[i].mInertia != model_b.mBodies[i].mInertia) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void urdf_loading_benchmark () {
+  for (int link_count = 100; link_count <= 10000; link_count *= 10) {
+    string urdf = generate_urdf_tree (link_count);
+
+    TimerInfo tinfo;
+    timer_start (&tinfo);
+    Model *dom_model = new Model();
+    RigidBodyDynamics::Addons::URDFReadFromString (urdf.c_str(), dom_model, false);
+    double dom_duration = timer_stop (&tinfo);
+
+    timer_start (&tinfo);
+    Model *stream_model = new Model();
+    RigidBodyDynamics::Addons::URDFStreamReadFromString (urdf.c_str(), stream_model, false);
+    double stream_duration = timer_stop (&tinfo);
+
+    cout << "#links: " << setw(5) << link_count
+      << " (" << urdf.size() / 1024 << " kB)" << endl;
+    cout << "  URDFReadFromString       duration = " << setw(10) << dom_duration << "(s)" << endl;
+    cout << "  URDFStreamReadFromString duration = " << setw(10) << stream_duration << "(s)"
+      << " identical models: " << (models_identical (*dom_model, *stream_model) ? "yes" : "NO") << endl;
+
+    delete dom_model;
+    delete stream_model;
+  }
+}
+#endif
+
 void print_usage () {
 #if defined (RBDL_BUILD_ADDON_LUAMODEL) || defined (RBDL_BUILD_ADDON_URDFREADER)
   cout << "Usage: benchmark [--count|-c <sample_count>] [--depth|-d <depth>] <model.lua>" << endl;
@@ -490,6 +679,13 @@ void print_usage () {
   cout << "                                body algorithm." << endl;
   cout << "  --no-nle                    : disables benchmark for the nonlinear effects." << endl;
   cout << "  --no-calc-minv              : disables benchmark M^-1 * tau benchmark." << endl;
+  cout << "  --no-multidof               : disables the comparison of emulated and native" << endl;
+  cout << "                                multi-DoF joints on a floating base model." << endl;
+  cout << "  --no-model-construction     : disables the comparison of adding bodies one" << endl;
+  cout << "                                by one and with Model::AddBodies()." << endl;
+#if defined RBDL_BUILD_ADDON_URDFREADER
+  cout << "  --no-urdf-loading           : disables the comparison of the URDF readers." << endl;
+#endif
   cout << "  --only-contacts | -C        : only runs contact model benchmarks." << endl;
   cout << "  --only-ik                   : only runs inverse kinematics benchmarks." << endl;
   cout << "  --help | -h                 : prints this help." << endl;
@@ -503,6 +699,9 @@ void disable_all_benchmarks () {
   benchmark_run_nle = false;
   benchmark_run_calc_minv_times_tau = false;
   benchmark_run_contacts = false;
+  benchmark_run_multidof_joints = false;
+  benchmark_run_model_construction = false;
+  benchmark_run_urdf_loading = false;
 }
 
 void parse_args (int argc, char* argv[]) {
@@ -557,6 +756,14 @@ void parse_args (int argc, char* argv[]) {
       benchmark_run_nle = false;
     } else if (arg == "--no-calc-minv" ) {
       benchmark_run_calc_minv_times_tau = false;
+    } else if (arg == "--no-multidof" ) {
+      benchmark_run_multidof_joints = false;
+    } else if (arg == "--no-model-construction" ) {
+      benchmark_run_model_construction = false;
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+    } else if (arg == "--no-urdf-loading" ) {
+      benchmark_run_urdf_loading = false;
+#endif
     } else if (arg == "--only-contacts" || arg == "-C") {
       disable_all_benchmarks();
       benchmark_run_contacts = true;
@@ -721,6 +928,26 @@ int main (int argc, char *argv[]) {
     cout << endl;
   }
 
+  if (benchmark_run_multidof_joints) {
+    cout << "= Floating Base: Emulated vs. Native Multi-DoF Joints =" << endl;
+    multidof_joints_benchmark (benchmark_sample_count);
+    cout << endl;
+  }
+
+  if (benchmark_run_model_construction) {
+    cout << "= Model Construction: AddBody vs. AddBodies =" << endl;
+    model_construction_benchmark ();
+    cout << endl;
+  }
+
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+  if (benchmark_run_urdf_loading) {
+    cout << "= URDF Loading: URDFReadFromString vs. URDFStreamReadFromString =" << endl;
+    urdf_loading_benchmark ();
+    cout << endl;
+  }
+#endif
+
   if (benchmark_run_contacts) {
     cout << "= Contacts: ForwardDynamicsConstraintsLagrangian" << endl;
     contacts_benchmark (benchmark_sample_count, ContactsMethodLagrangian);
@@ -2,7 +2,12 @@
 #include "luamodel.h"
 
 #include <iostream>
+#include <fstream>
 #include <map>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <sys/stat.h>
 
 #include "luatables.h"
 
@@ -280,6 +285,187 @@ bool LuaModelReadFromFile (const char* filename, Model* model, bool verbose) {
   return LuaModelReadFromTable (model_table, model, verbose);
 }
 
+//
+// Cache of parsed Lua models
+//
+// A cache file consists of a LuaModelCacheHeader followed by the model in
+// the compiled model format (see rbdl/CompiledModel.h). The header
+// identifies the Lua file from which the model was read.
+//
+
+static const char LuaModelCacheMagic[8] = {
+  'R', 'B', 'D', 'L', 'L', 'U', 'A', 'C'
+};
+
+static const uint32_t LuaModelCacheVersion = 1;
+
+struct LuaModelCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t source_hash;
+};
+
+/// \brief 64 bit FNV-1a hash of the given data.
+static uint64_t LuaModelCacheHash (const std::vector<char> &data) {
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < data.size(); i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+static bool LuaModelCacheReadFile (const char *filename,
+    std::vector<char> &data) {
+  ifstream file (filename, ios::in | ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  file.seekg (0, ios::end);
+  streamoff size = file.tellg();
+  file.seekg (0, ios::beg);
+  if (size <= 0) {
+    data.clear();
+    return size == 0;
+  }
+
+  data.resize (static_cast<size_t>(size));
+  file.read (&data[0], data.size());
+
+  return static_cast<bool>(file);
+}
+
+/** \brief Creates the header for the Lua file filename.
+ *
+ * \returns false if the file cannot be read.
+ */
+static bool LuaModelCacheCreateHeader (const char *filename,
+    LuaModelCacheHeader &header) {
+  struct stat file_stat;
+  std::vector<char> source;
+
+  if (stat (filename, &file_stat) != 0
+      || !LuaModelCacheReadFile (filename, source)) {
+    return false;
+  }
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, LuaModelCacheMagic, sizeof (header.magic));
+  header.version = LuaModelCacheVersion;
+  header.source_size = source.size();
+  header.source_mtime = static_cast<int64_t>(file_stat.st_mtime);
+  header.source_hash = LuaModelCacheHash (source);
+
+  return true;
+}
+
+static bool LuaModelCacheRead (const char *cache_filename,
+    const LuaModelCacheHeader &source_header, Model *model, bool verbose) {
+  std::vector<char> data;
+  if (!LuaModelCacheReadFile (cache_filename, data)
+      || data.size() <= sizeof (LuaModelCacheHeader)) {
+    return false;
+  }
+
+  LuaModelCacheHeader header;
+  memcpy (&header, &data[0], sizeof (header));
+
+  if (memcmp (header.magic, LuaModelCacheMagic, sizeof (header.magic)) != 0
+      || header.version != source_header.version
+      || header.source_size != source_header.source_size
+      || header.source_mtime != source_header.source_mtime
+      || header.source_hash != source_header.source_hash) {
+    return false;
+  }
+
+  return CompiledModelReadFromMemory (&data[sizeof (header)],
+      data.size() - sizeof (header), model, verbose);
+}
+
+static bool LuaModelCacheWrite (const char *cache_filename,
+    const LuaModelCacheHeader &header, const Model &model, bool verbose) {
+  std::vector<char> buffer;
+  if (!CompiledModelWriteToBuffer (model, buffer, verbose)) {
+    return false;
+  }
+
+  // write to a temporary file first such that other processes never read
+  // a partially written cache
+  string temp_filename = string (cache_filename) + ".tmp";
+  ofstream file (temp_filename.c_str(), ios::out | ios::binary);
+  if (!file) {
+    cerr << "Error opening file '" << temp_filename << "' for writing!"
+      << endl;
+    return false;
+  }
+
+  file.write (reinterpret_cast<const char*>(&header), sizeof (header));
+  file.write (&buffer[0], buffer.size());
+  file.close();
+
+  if (!file) {
+    cerr << "Error writing file '" << temp_filename << "'!" << endl;
+    remove (temp_filename.c_str());
+    return false;
+  }
+
+  if (rename (temp_filename.c_str(), cache_filename) != 0) {
+    // rename() does not replace existing files on all platforms
+    remove (cache_filename);
+    if (rename (temp_filename.c_str(), cache_filename) != 0) {
+      cerr << "Error writing file '" << cache_filename << "'!" << endl;
+      remove (temp_filename.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+RBDL_DLLAPI
+bool LuaModelReadFromFileCached (
+  const char* filename,
+  const char* cache_filename,
+  Model* model,
+  bool verbose) {
+  if(!model) {
+    std::cerr << "Model not provided." << std::endl;
+    assert(false);
+    abort();
+  }
+
+  LuaModelCacheHeader header;
+  bool have_header = LuaModelCacheCreateHeader (filename, header);
+
+  if (have_header
+      && LuaModelCacheRead (cache_filename, header, model, verbose)) {
+    if (verbose) {
+      cout << "Read model '" << filename << "' from cache '"
+        << cache_filename << "'" << endl;
+    }
+    return true;
+  }
+
+  if (!LuaModelReadFromFile (filename, model, verbose)) {
+    return false;
+  }
+
+  // failing to update the cache only affects the next call
+  if (have_header
+      && LuaModelCacheWrite (cache_filename, header, *model, verbose)
+      && verbose) {
+    cout << "Wrote model cache '" << cache_filename << "'" << endl;
+  }
+
+  return true;
+}
+
 
 RBDL_DLLAPI
 std::vector<std::string> LuaModelGetConstraintSetNames(const char* filename) {
@@ -341,38 +527,297 @@ bool LuaModelReadFromFileWithConstraints (
 }
 
 
+//
+// Single pass reader of the frames table
+//
+// The LuaTableNode accessors resolve the full key path from the model
+// table for every value that is read. For models with many frames this
+// dominates the loading time. The functions below instead operate on
+// values that are already on the Lua stack such that every frame, joint
+// and body table is only looked up once.
+//
+
+/// \brief Returns the length of the table at index.
+static int LuaTableLength (lua_State *L, int index) {
+#if LUA_VERSION_NUM == 501
+  return static_cast<int>(lua_objlen (L, index));
+#elif LUA_VERSION_NUM >= 502
+  return static_cast<int>(lua_rawlen (L, index));
+#endif
+}
+
+/// \brief Pushes table[key] of the table at index and returns its index.
+static int LuaPushField (lua_State *L, int index, const char *key) {
+  lua_getfield (L, index, key);
+  return lua_gettop (L);
+}
+
+/** \brief Reads count numbers of the array at index into values.
+ *
+ * \returns false if the value is not a table with count entries.
+ */
+static bool LuaReadNumbers (lua_State *L, int index, double *values,
+    int count) {
+  if (!lua_istable (L, index) || LuaTableLength (L, index) != count) {
+    return false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    lua_rawgeti (L, index, i + 1);
+    values[i] = lua_tonumber (L, -1);
+    lua_pop (L, 1);
+  }
+
+  return true;
+}
+
+static string LuaReadString (lua_State *L, int index,
+    const string &default_value) {
+  if (lua_isnil (L, index) || !lua_isstring (L, index)) {
+    return default_value;
+  }
+
+  return lua_tostring (L, index);
+}
+
+static Vector3d LuaReadVector3d (lua_State *L, int index,
+    const Vector3d &default_value) {
+  if (lua_isnil (L, index)) {
+    return default_value;
+  }
+
+  double values[3];
+  if (!LuaReadNumbers (L, index, values, 3)) {
+    cerr << "LuaModel Error: invalid 3d vector!" << endl;
+    abort();
+  }
+
+  return Vector3d (values[0], values[1], values[2]);
+}
+
+static Matrix3d LuaReadMatrix3d (lua_State *L, int index,
+    const Matrix3d &default_value) {
+  if (lua_isnil (L, index)) {
+    return default_value;
+  }
+
+  if (!lua_istable (L, index) || LuaTableLength (L, index) != 3) {
+    cerr << "LuaModel Error: invalid 3d matrix!" << endl;
+    abort();
+  }
+
+  Matrix3d result;
+  for (int i = 0; i < 3; i++) {
+    double values[3];
+
+    lua_rawgeti (L, index, i + 1);
+    if (!LuaReadNumbers (L, lua_gettop (L), values, 3)) {
+      cerr << "LuaModel Error: invalid 3d matrix!" << endl;
+      abort();
+    }
+    lua_pop (L, 1);
+
+    result(i,0) = values[0];
+    result(i,1) = values[1];
+    result(i,2) = values[2];
+  }
+
+  return result;
+}
+
+static SpatialTransform LuaReadSpatialTransform (lua_State *L, int index) {
+  SpatialTransform result;
+
+  if (lua_isnil (L, index)) {
+    return result;
+  }
+
+  result.r = LuaReadVector3d (L, LuaPushField (L, index, "r"),
+      Vector3d::Zero(3));
+  lua_pop (L, 1);
+  result.E = LuaReadMatrix3d (L, LuaPushField (L, index, "E"),
+      Matrix3d::Identity (3,3));
+  lua_pop (L, 1);
+
+  return result;
+}
+
+static Joint LuaReadJoint (lua_State *L, int index, int frame_index) {
+  if (lua_isnil (L, index)) {
+    return Joint (JointTypeFixed);
+  }
+
+  if (!lua_istable (L, index)) {
+    cerr << "LuaModel Error: invalid joint description at [\"frames\"]["
+      << frame_index << "][\"joint\"]" << endl;
+    abort();
+  }
+
+  int joint_dofs = LuaTableLength (L, index);
+
+  if (joint_dofs == 1) {
+    lua_rawgeti (L, index, 1);
+    string dof_string = LuaReadString (L, lua_gettop (L), "");
+    lua_pop (L, 1);
+
+    if (dof_string == "JointTypeSpherical") {
+      return Joint (JointTypeSpherical);
+    } else if (dof_string == "JointTypeEulerZYX") {
+      return Joint (JointTypeEulerZYX);
+    } else if (dof_string == "JointTypeEulerXYZ") {
+      return Joint (JointTypeEulerXYZ);
+    } else if (dof_string == "JointTypeEulerYXZ") {
+      return Joint (JointTypeEulerYXZ);
+    } else if (dof_string == "JointTypeTranslationXYZ") {
+      return Joint (JointTypeTranslationXYZ);
+    }
+  }
+
+  if (joint_dofs > 6) {
+    cerr << "Invalid number of DOFs for joint." << endl;
+    abort();
+  }
+
+  SpatialVector axes[6];
+  for (int i = 0; i < joint_dofs; i++) {
+    double values[6];
+
+    lua_rawgeti (L, index, i + 1);
+    if (!LuaReadNumbers (L, lua_gettop (L), values, 6)) {
+      cerr << "LuaModel Error: invalid joint motion subspace description at "
+        << "[\"frames\"][" << frame_index << "][\"joint\"][" << i + 1 << "]"
+        << endl;
+      abort();
+    }
+    lua_pop (L, 1);
+
+    axes[i] = SpatialVector (values[0], values[1], values[2],
+        values[3], values[4], values[5]);
+  }
+
+  switch (joint_dofs) {
+    case 0: return Joint (JointTypeFixed);
+    case 1: return Joint (axes[0]);
+    case 2: return Joint (axes[0], axes[1]);
+    case 3: return Joint (axes[0], axes[1], axes[2]);
+    case 4: return Joint (axes[0], axes[1], axes[2], axes[3]);
+    case 5: return Joint (axes[0], axes[1], axes[2], axes[3], axes[4]);
+    default: break;
+  }
+
+  return Joint (axes[0], axes[1], axes[2], axes[3], axes[4], axes[5]);
+}
+
+static Body LuaReadBody (lua_State *L, int index, int frame_index) {
+  if (lua_isnil (L, index)) {
+    return Body();
+  }
+
+  if (!lua_istable (L, index)) {
+    cerr << "LuaModel Error: invalid body description at [\"frames\"]["
+      << frame_index << "][\"body\"]" << endl;
+    abort();
+  }
+
+  lua_getfield (L, index, "mass");
+  if (lua_isnil (L, -1)) {
+    cerr << "Error: could not find value [\"frames\"][" << frame_index
+      << "][\"body\"][\"mass\"]." << endl;
+    abort();
+  }
+  double mass = lua_tonumber (L, -1);
+  lua_pop (L, 1);
+
+  Vector3d com = LuaReadVector3d (L, LuaPushField (L, index, "com"),
+      Vector3d::Zero(3));
+  lua_pop (L, 1);
+  Matrix3d inertia = LuaReadMatrix3d (L, LuaPushField (L, index, "inertia"),
+      Matrix3d::Identity(3,3));
+  lua_pop (L, 1);
+
+  return Body (mass, com, inertia);
+}
+
 bool LuaModelReadFromTable (LuaTable &model_table, Model* model, bool verbose) {
-  if (model_table["gravity"].exists()) {
-    model->gravity = model_table["gravity"].get<Vector3d>();
+  assert (!model_table.referencesGlobal);
+
+  model_table.pushRef();
+  lua_State *L = model_table.L;
+  int model_index = lua_gettop (L);
+
+  if (!lua_istable (L, model_index)) {
+    cerr << "LuaModel Error: the model file must return a table!" << endl;
+    model_table.popRef();
+    return false;
+  }
+
+  if (!lua_checkstack (L, 16)) {
+    cerr << "LuaModel Error: cannot grow the Lua stack!" << endl;
+    model_table.popRef();
+    return false;
+  }
+
+  int gravity_index = LuaPushField (L, model_index, "gravity");
+  if (!lua_isnil (L, gravity_index)) {
+    model->gravity = LuaReadVector3d (L, gravity_index, model->gravity);
 
     if (verbose)
       cout << "gravity = " << model->gravity.transpose() << endl;
   }
+  lua_pop (L, 1);
 
-  int frame_count = model_table["frames"].length();
+  int frames_index = LuaPushField (L, model_index, "frames");
+  int frame_count = 0;
+  if (lua_istable (L, frames_index)) {
+    frame_count = LuaTableLength (L, frames_index);
+  }
 
   body_table_id_map["ROOT"] = 0;
 
+  bool nested_bulk_construction = model->mBulkConstruction;
+  if (!nested_bulk_construction) {
+    model->BeginBulkConstruction (frame_count);
+  }
+
   for (int i = 1; i <= frame_count; i++) {
-    if (!model_table["frames"][i]["parent"].exists()) {
+    lua_rawgeti (L, frames_index, i);
+    int frame_index = lua_gettop (L);
+
+    if (!lua_istable (L, frame_index)) {
+      cerr << "LuaModel Error: invalid frame description for frame " << i
+        << "." << endl;
+      abort();
+    }
+
+    int parent_index = LuaPushField (L, frame_index, "parent");
+    if (lua_isnil (L, parent_index)) {
       cerr << "Parent not defined for frame " << i << "." << endl;
       abort();
     }
 
-    string body_name = model_table["frames"][i]["name"].getDefault<string>("");
-    string parent_name = model_table["frames"][i]["parent"].get<string>();
+    string parent_name = LuaReadString (L, parent_index, "");
+    string body_name = LuaReadString (L,
+        LuaPushField (L, frame_index, "name"), "");
+    string joint_name = LuaReadString (L,
+        LuaPushField (L, frame_index, "joint_name"), body_name);
     unsigned int parent_id = body_table_id_map[parent_name];
 
-    SpatialTransform joint_frame 
-      = model_table["frames"][i]["joint_frame"].getDefault(SpatialTransform());
-    Joint joint 
-      = model_table["frames"][i]["joint"].getDefault(Joint(JointTypeFixed));
-    Body body = model_table["frames"][i]["body"].getDefault<Body>(Body());
+    SpatialTransform joint_frame = LuaReadSpatialTransform (L,
+        LuaPushField (L, frame_index, "joint_frame"));
+    Joint joint = LuaReadJoint (L, LuaPushField (L, frame_index, "joint"), i);
+    Body body = LuaReadBody (L, LuaPushField (L, frame_index, "body"), i);
+
+    // pops the frame and all of its fields
+    lua_settop (L, frame_index - 1);
 
     unsigned int body_id 
       = model->AddBody (parent_id, joint_frame, joint, body, body_name);
     body_table_id_map[body_name] = body_id;
 
+    if (joint_name.size() != 0) {
+      model->SetJointName (body_id, joint_name);
+    }
+
     if (verbose) {
       cout << "==== Added Body ====" << endl;
       cout << "  body_name  : " << body_name << endl;
@@ -386,6 +831,13 @@ bool LuaModelReadFromTable (LuaTable &model_table, Model* model, bool verbose) {
     }
   }
 
+  if (!nested_bulk_construction) {
+    model->EndBulkConstruction();
+  }
+
+  lua_settop (L, model_index);
+  model_table.popRef();
+
   return true;
 }
 
@@ -179,6 +179,11 @@ namespace Addons {
 *   \endcode
 * \par
 *    for which r is the translation and E the rotation of the joint frame
+*
+* \par joint_name (optional, type: string)
+*     Name of the joint and its degrees of freedom (see
+*     RigidBodyDynamics::Model::SetJointName()). Defaults to the name of the
+*     body.
 *    
 * \section luamodel_constraint_table Constraint Information Table
 * The Constraint Information Table is searched for values needed to call
@@ -250,8 +255,8 @@ namespace Addons {
  *
  * \param filename the name of the Lua file.
  * \param model a pointer to the output Model structure.
- * \param verbose specifies wether information on the model should be printed
- * (default: true).
+ * \param verbose specifies whether information on the model should be printed
+ * (default: false).
  *
  * \returns true if the model was read successfully.
  *
@@ -264,6 +269,36 @@ bool LuaModelReadFromFile (
   Model* model,
   bool verbose = false);
 
+/** \brief Reads a model from a Lua file and caches the result.
+ *
+ * Executing the Lua script and reading all frames is the dominant cost
+ * when loading large models. This function stores the loaded model in
+ * the compiled model format (see \ref compiled_model_page) in the file
+ * cache_filename. Later calls read the model from this file instead of
+ * running the script as long as size, modification time and the hash of
+ * the contents of the Lua file are unchanged.
+ *
+ * \param filename the name of the Lua file.
+ * \param cache_filename the name of the cache file. It is created if it
+ * does not exist or outdated.
+ * \param model a pointer to an empty output Model structure.
+ * \param verbose specifies whether information on the model should be printed
+ * (default: false).
+ *
+ * \returns true if the model was read successfully. Failing to write the
+ * cache file does not cause an error.
+ *
+ * \note Only the file filename is checked for changes. Modifications of
+ * files that are loaded by the script (e.g. via require) are not detected.
+ * Constraint sets are not cached.
+ */
+RBDL_DLLAPI
+bool LuaModelReadFromFileCached (
+  const char* filename,
+  const char* cache_filename,
+  Model* model,
+  bool verbose = false);
+
 /** \brief Reads a model file and returns the names of all constraint sets.
  */
 RBDL_DLLAPI
@@ -277,8 +312,8 @@ std::vector<std::string> LuaModelGetConstraintSetNames(const char* filename);
  * in which to save the information read from the file.
  * \param constraint_set_names reference to a std::vector of std::string
  * specifying the names of the constraint sets to be read from the Lua file.
- * \param verbose specifies wether information on the model should be printed
- * (default: true).
+ * \param verbose specifies whether information on the model should be printed
+ * (default: false).
  *
  * \returns true if the model and constraint sets were read successfully.
  *
@@ -298,8 +333,8 @@ bool LuaModelReadFromFileWithConstraints (
  *
  * \param L a pointer to the lua_State.
  * \param model a pointer to the output Model structure.
- * \param verbose specifies wether information on the model should be printed
- * (default: true).
+ * \param verbose specifies whether information on the model should be printed
+ * (default: false).
  *
  * \returns true if the model was read successfully.
  */
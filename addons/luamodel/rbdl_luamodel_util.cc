@@ -18,6 +18,7 @@ void usage (const char* argv_0) {
   cerr << "  -o | --body-origins       print the origins of all bodies that have names" << endl;
   cerr << "  -c | --center_of_mass     print center of mass for bodies and full model" << endl;
   cerr << "  -s | --constraint_sets    print all constraint sets defined in the model file" << endl;
+  cerr << "  --cache <file>            read the model from / store it in the cache file" << endl;
   cerr << "  -h | --help               print this help" << endl;
   exit (1);
 }
@@ -35,6 +36,7 @@ int main (int argc, char *argv[]) {
   bool body_origins = false;
   bool center_of_mass = false;
   bool constraint_sets = false;
+  string cache_filename = "";
 
   string filename = argv[1];
 
@@ -51,7 +53,13 @@ int main (int argc, char *argv[]) {
       center_of_mass = true;
     else if (string(argv[i]) == "-s" || string (argv[i]) == "--constraint-sets")
       constraint_sets = true;
-    else if (string(argv[i]) == "-h" || string (argv[i]) == "--help")
+    else if (string(argv[i]) == "--cache") {
+      if (i + 1 >= argc) {
+        cerr << "Error: missing cache file name!" << endl;
+        usage(argv[0]);
+      }
+      cache_filename = argv[++i];
+    } else if (string(argv[i]) == "-h" || string (argv[i]) == "--help")
       usage(argv[0]);
     else
       filename = argv[i];
@@ -72,6 +80,9 @@ int main (int argc, char *argv[]) {
         constraint_set_names,
         verbose
         );
+  } else if (cache_filename != "") {
+    result = RigidBodyDynamics::Addons::LuaModelReadFromFileCached(
+        filename.c_str(), cache_filename.c_str(), &model, verbose);
   } else {
     result = RigidBodyDynamics::Addons::LuaModelReadFromFile(
         filename.c_str(), &model, verbose);
@@ -0,0 +1,244 @@
+#include <UnitTest++.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <rbdl/rbdl.h>
+
+#include "../luamodel.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons;
+
+const double TEST_PREC = 1.0e-12;
+
+static const char *LuaModelFilename = "testLuaModel.lua";
+static const char *LuaModelCacheFilename = "testLuaModel.lua.cache";
+
+/// \brief Writes a small leg model with the given mass of the thigh.
+static void WriteLuaModel (const char *filename, double thigh_mass) {
+  ofstream file (filename);
+
+  file << "inertia = {" << endl
+    << "  {1.1, 0.1, 0.2}," << endl
+    << "  {0.1, 1.2, 0.4}," << endl
+    << "  {0.2, 0.4, 1.3}" << endl
+    << "}" << endl
+    << "return {" << endl
+    << "  gravity = { 0., 0., -9.81 }," << endl
+    << "  frames = {" << endl
+    << "    {" << endl
+    << "      name = \"pelvis\"," << endl
+    << "      parent = \"ROOT\"," << endl
+    << "      body = { mass = 9.3, com = { 0.1, 0.2, 0.3 }, inertia = inertia }," << endl
+    << "      joint = {" << endl
+    << "        { 0., 0., 0., 1., 0., 0. }," << endl
+    << "        { 0., 0., 0., 0., 1., 0. }," << endl
+    << "        { 0., 0., 0., 0., 0., 1. }," << endl
+    << "        { 0., 0., 1., 0., 0., 0. }," << endl
+    << "        { 0., 1., 0., 0., 0., 0. }," << endl
+    << "        { 1., 0., 0., 0., 0., 0. }" << endl
+    << "      }," << endl
+    << "      joint_name = \"floating_base\"," << endl
+    << "    }," << endl
+    << "    {" << endl
+    << "      name = \"thigh\"," << endl
+    << "      parent = \"pelvis\"," << endl
+    << "      body = { mass = " << thigh_mass
+    << ", com = { 0., 0., -0.2 }, inertia = inertia }," << endl
+    << "      joint = { \"JointTypeSpherical\" }," << endl
+    << "      joint_frame = {" << endl
+    << "        r = { 0., 0.1, -0.1 }," << endl
+    << "        E = { { 0., 1., 0. }, { -1., 0., 0. }, { 0., 0., 1. } }" << endl
+    << "      }," << endl
+    << "    }," << endl
+    << "    {" << endl
+    << "      name = \"shank\"," << endl
+    << "      parent = \"thigh\"," << endl
+    << "      body = { mass = 2.1, com = { 0., 0., -0.25 } }," << endl
+    << "      joint = { { 0., 1., 0., 0., 0., 0. } }," << endl
+    << "      joint_frame = { r = { 0., 0., -0.45 } }," << endl
+    << "    }," << endl
+    << "    {" << endl
+    << "      name = \"foot\"," << endl
+    << "      parent = \"shank\"," << endl
+    << "      body = { mass = 0.8, com = { 0.05, 0., -0.02 } }," << endl
+    << "      joint_frame = { r = { 0., 0., -0.4 } }," << endl
+    << "    }" << endl
+    << "  }" << endl
+    << "}" << endl;
+}
+
+/// \brief Builds the model of WriteLuaModel() with AddBody().
+static void BuildReferenceModel (Model &model, double thigh_mass) {
+  Matrix3d inertia (
+      1.1, 0.1, 0.2,
+      0.1, 1.2, 0.4,
+      0.2, 0.4, 1.3);
+
+  model.gravity = Vector3d (0., 0., -9.81);
+
+  Joint floating_base (
+      SpatialVector (0., 0., 0., 1., 0., 0.),
+      SpatialVector (0., 0., 0., 0., 1., 0.),
+      SpatialVector (0., 0., 0., 0., 0., 1.),
+      SpatialVector (0., 0., 1., 0., 0., 0.),
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.));
+
+  unsigned int pelvis_id = model.AddBody (0, SpatialTransform(),
+      floating_base, Body (9.3, Vector3d (0.1, 0.2, 0.3), inertia),
+      "pelvis");
+  model.SetJointName (pelvis_id, "floating_base");
+
+  Matrix3d E (
+      0., 1., 0.,
+      -1., 0., 0.,
+      0., 0., 1.);
+  unsigned int thigh_id = model.AddBody (pelvis_id,
+      SpatialTransform (E, Vector3d (0., 0.1, -0.1)),
+      Joint (JointTypeSpherical),
+      Body (thigh_mass, Vector3d (0., 0., -0.2), inertia), "thigh");
+  model.SetJointName (thigh_id, "thigh");
+
+  unsigned int shank_id = model.AddBody (thigh_id,
+      Xtrans (Vector3d (0., 0., -0.45)),
+      Joint (SpatialVector (0., 1., 0., 0., 0., 0.)),
+      Body (2.1, Vector3d (0., 0., -0.25), Matrix3d (Matrix3d::Identity())),
+      "shank");
+  model.SetJointName (shank_id, "shank");
+
+  unsigned int foot_id = model.AddBody (shank_id,
+      Xtrans (Vector3d (0., 0., -0.4)), Joint (JointTypeFixed),
+      Body (0.8, Vector3d (0.05, 0., -0.02),
+        Matrix3d (Matrix3d::Identity())), "foot");
+  model.SetJointName (foot_id, "foot");
+}
+
+/// \brief Checks that both models have the same structure and dynamics.
+static void CheckModelsEqual (Model &reference, Model &model) {
+  CHECK_EQUAL (reference.mBodies.size(), model.mBodies.size());
+  CHECK_EQUAL (reference.mFixedBodies.size(), model.mFixedBodies.size());
+  CHECK_EQUAL (reference.dof_count, model.dof_count);
+  CHECK_EQUAL (reference.q_size, model.q_size);
+  CHECK_ARRAY_CLOSE (reference.gravity.data(), model.gravity.data(), 3,
+      TEST_PREC);
+
+  if (reference.mBodies.size() != model.mBodies.size()
+      || reference.q_size != model.q_size) {
+    return;
+  }
+
+  const char *body_names[] = { "pelvis", "thigh", "shank", "foot" };
+  for (unsigned int i = 0; i < 4; i++) {
+    CHECK_EQUAL (reference.GetBodyId (body_names[i]),
+        model.GetBodyId (body_names[i]));
+  }
+  CHECK_EQUAL (reference.GetJointId ("floating_base"),
+      model.GetJointId ("floating_base"));
+
+  for (unsigned int i = 1; i < reference.mBodies.size(); i++) {
+    CHECK_EQUAL (reference.lambda[i], model.lambda[i]);
+    CHECK_EQUAL (reference.mJoints[i].mJointType,
+        model.mJoints[i].mJointType);
+    CHECK_EQUAL (reference.mBodies[i].mIsVirtual,
+        model.mBodies[i].mIsVirtual);
+    CHECK_CLOSE (reference.mBodies[i].mMass, model.mBodies[i].mMass,
+        TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference.X_T[i].E.data(), model.X_T[i].E.data(),
+        9, TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference.X_T[i].r.data(), model.X_T[i].r.data(),
+        3, TEST_PREC);
+  }
+
+  VectorNd q (VectorNd::Zero (model.q_size));
+  VectorNd qdot (VectorNd::Zero (model.qdot_size));
+  VectorNd tau (VectorNd::Zero (model.qdot_size));
+  for (unsigned int i = 0; i < model.qdot_size; i++) {
+    q[i] = 0.1 * i - 0.3;
+    qdot[i] = 0.2 - 0.05 * i;
+    tau[i] = 0.3 * i;
+  }
+  reference.SetQuaternion (reference.GetBodyId ("thigh"),
+      Quaternion::fromZYXAngles (Vector3d (0.1, -0.2, 0.3)), q);
+
+  VectorNd qddot_reference (VectorNd::Zero (model.qdot_size));
+  VectorNd qddot (VectorNd::Zero (model.qdot_size));
+  ForwardDynamics (reference, q, qdot, tau, qddot_reference);
+  ForwardDynamics (model, q, qdot, tau, qddot);
+
+  CHECK_ARRAY_CLOSE (qddot_reference.data(), qddot.data(), qddot.size(),
+      TEST_PREC);
+}
+
+TEST ( LuaModelReadFromFile ) {
+  WriteLuaModel (LuaModelFilename, 4.2);
+
+  Model reference;
+  BuildReferenceModel (reference, 4.2);
+
+  Model model;
+  CHECK (LuaModelReadFromFile (LuaModelFilename, &model));
+  CheckModelsEqual (reference, model);
+
+  remove (LuaModelFilename);
+}
+
+TEST ( LuaModelReadFromFileCached ) {
+  WriteLuaModel (LuaModelFilename, 4.2);
+  remove (LuaModelCacheFilename);
+
+  Model reference;
+  BuildReferenceModel (reference, 4.2);
+
+  // the first call runs the script and writes the cache
+  Model model;
+  CHECK (LuaModelReadFromFileCached (LuaModelFilename, LuaModelCacheFilename,
+        &model));
+  CheckModelsEqual (reference, model);
+  CHECK (ifstream (LuaModelCacheFilename).good());
+
+  // the second call reads the model from the cache
+  Model cached_model;
+  CHECK (LuaModelReadFromFileCached (LuaModelFilename, LuaModelCacheFilename,
+        &cached_model));
+  CheckModelsEqual (reference, cached_model);
+
+  // changes of the script invalidate the cache
+  WriteLuaModel (LuaModelFilename, 5.7);
+
+  Model changed_reference;
+  BuildReferenceModel (changed_reference, 5.7);
+
+  Model changed_model;
+  CHECK (LuaModelReadFromFileCached (LuaModelFilename, LuaModelCacheFilename,
+        &changed_model));
+  CheckModelsEqual (changed_reference, changed_model);
+
+  // a corrupted cache is ignored and rewritten
+  {
+    ofstream cache_file (LuaModelCacheFilename);
+    cache_file << "not a model cache";
+  }
+
+  Model rewritten_model;
+  CHECK (LuaModelReadFromFileCached (LuaModelFilename, LuaModelCacheFilename,
+        &rewritten_model));
+  CheckModelsEqual (changed_reference, rewritten_model);
+
+  Model recached_model;
+  CHECK (LuaModelReadFromFileCached (LuaModelFilename, LuaModelCacheFilename,
+        &recached_model));
+  CheckModelsEqual (changed_reference, recached_model);
+
+  remove (LuaModelFilename);
+  remove (LuaModelCacheFilename);
+}
+
+int main (int argc, char *argv[])
+{
+  return UnitTest::RunAllTests ();
+}
@@ -0,0 +1,136 @@
+#include <rbdl/rbdl.h>
+#include <rbdl/rbdl_utils.h>
+
+#ifdef RBDL_BUILD_ADDON_LUAMODEL
+#include "../luamodel/luamodel.h"
+#endif
+
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+#include "../urdfreader/urdfreader.h"
+#endif
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+
+void usage (const char* argv_0) {
+  cerr << "Usage: " << argv_0 << " [-v] [-f] [-s] <model.urdf|model.lua> <output>" << endl;
+  cerr << "Converts a model into the compiled model format that can be loaded" << endl;
+  cerr << "with RigidBodyDynamics::CompiledModelReadFromFile()." << endl;
+  cerr << "  -v | --verbose            enable additional output" << endl;
+  cerr << "  -s | --shared             write a block for" << endl;
+  cerr << "                            RigidBodyDynamics::SharedModelData instead" << endl;
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+  cerr << "  -f | --floatbase          set the first mobile body of a URDF model as" << endl;
+  cerr << "                            floating base" << endl;
+#endif
+  cerr << "  -h | --help               print this help" << endl;
+#ifndef RBDL_BUILD_ADDON_URDFREADER
+  cerr << "Note: URDF support was disabled at compile time." << endl;
+#endif
+#ifndef RBDL_BUILD_ADDON_LUAMODEL
+  cerr << "Note: Lua model support was disabled at compile time." << endl;
+#endif
+  exit (1);
+}
+
+bool has_extension (const string &filename, const string &extension) {
+  return filename.size() >= extension.size()
+    && filename.compare (filename.size() - extension.size(),
+        extension.size(), extension) == 0;
+}
+
+int main (int argc, char *argv[]) {
+  bool verbose = false;
+  bool shared = false;
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+  bool floatbase = false;
+#endif
+  string input_filename = "";
+  string output_filename = "";
+
+  for (int i = 1; i < argc; i++) {
+    if (string(argv[i]) == "-v" || string (argv[i]) == "--verbose")
+      verbose = true;
+    else if (string(argv[i]) == "-s" || string (argv[i]) == "--shared")
+      shared = true;
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+    else if (string(argv[i]) == "-f" || string (argv[i]) == "--floatbase")
+      floatbase = true;
+#endif
+    else if (string(argv[i]) == "-h" || string (argv[i]) == "--help")
+      usage(argv[0]);
+    else if (input_filename == "")
+      input_filename = argv[i];
+    else if (output_filename == "")
+      output_filename = argv[i];
+    else {
+      cerr << "Error: too many arguments!" << endl;
+      usage(argv[0]);
+    }
+  }
+
+  if (output_filename == "") {
+    cerr << "Error: not enough arguments!" << endl;
+    usage(argv[0]);
+  }
+
+  RigidBodyDynamics::Model model;
+  bool model_loaded = false;
+
+  if (has_extension (input_filename, ".urdf")) {
+#ifdef RBDL_BUILD_ADDON_URDFREADER
+    model_loaded = RigidBodyDynamics::Addons::URDFReadFromFile (
+        input_filename.c_str(), &model, floatbase, verbose);
+#else
+    cerr << "Error: cannot load URDF models as the urdfreader addon was "
+      << "disabled at compile time!" << endl;
+    return -1;
+#endif
+  } else if (has_extension (input_filename, ".lua")) {
+#ifdef RBDL_BUILD_ADDON_LUAMODEL
+    model_loaded = RigidBodyDynamics::Addons::LuaModelReadFromFile (
+        input_filename.c_str(), &model, verbose);
+#else
+    cerr << "Error: cannot load Lua models as the luamodel addon was "
+      << "disabled at compile time!" << endl;
+    return -1;
+#endif
+  } else {
+    cerr << "Error: unknown model format of file '" << input_filename
+      << "' (expected .urdf or .lua)!" << endl;
+    return -1;
+  }
+
+  if (!model_loaded) {
+    cerr << "Loading of model '" << input_filename << "' failed!" << endl;
+    return -1;
+  }
+
+  if (verbose) {
+    cout << "Model Hierarchy:" << endl;
+    cout << RigidBodyDynamics::Utils::GetModelHierarchy (model);
+  }
+
+  if (shared) {
+    if (!RigidBodyDynamics::SharedModelData::WriteToFile (model,
+          output_filename.c_str(), verbose)) {
+      cerr << "Writing of shared model data '" << output_filename
+        << "' failed!" << endl;
+      return -1;
+    }
+
+    return 0;
+  }
+
+  if (!RigidBodyDynamics::CompiledModelWriteToFile (model,
+        output_filename.c_str(), verbose)) {
+    cerr << "Writing of compiled model '" << output_filename << "' failed!"
+      << endl;
+    return -1;
+  }
+
+  return 0;
+}
@@ -24,6 +24,7 @@ void usage (const char* argv_0) {
   cerr << "  -m | --model-hierarchy    print the hierarchy of the model" << endl;
   cerr << "  -o | --body-origins       print the origins of all bodies that have names" << endl;
   cerr << "  -c | --center_of_mass     print center of mass for bodies and full model" << endl;
+  cerr << "  -s | --streaming          load the model with the streaming reader" << endl;
   cerr << "  -h | --help               print this help" << endl;
   exit (1);
 }
@@ -39,6 +40,7 @@ int main (int argc, char *argv[]) {
   bool model_hierarchy = false;
   bool body_origins = false;
   bool center_of_mass = false;
+  bool streaming = false;
 
   string filename = argv[1];
 
@@ -55,6 +57,8 @@ int main (int argc, char *argv[]) {
       body_origins = true;
     else if (string(argv[i]) == "-c" || string (argv[i]) == "--center-of-mass")
       center_of_mass = true;
+    else if (string(argv[i]) == "-s" || string (argv[i]) == "--streaming")
+      streaming = true;
     else if (string(argv[i]) == "-h" || string (argv[i]) == "--help")
       usage(argv[0]);
     else
@@ -63,7 +67,14 @@ int main (int argc, char *argv[]) {
 
   RigidBodyDynamics::Model model;
 
-  if (!RigidBodyDynamics::Addons::URDFReadFromFile(filename.c_str(), &model, floatbase, verbose)) {
+  bool model_loaded = false;
+  if (streaming) {
+    model_loaded = RigidBodyDynamics::Addons::URDFStreamReadFromFile(filename.c_str(), &model, floatbase, verbose);
+  } else {
+    model_loaded = RigidBodyDynamics::Addons::URDFReadFromFile(filename.c_str(), &model, floatbase, verbose);
+  }
+
+  if (!model_loaded) {
     cerr << "Loading of urdf model failed!" << endl;
     return -1;
   }
@@ -0,0 +1,383 @@
+#include <UnitTest++.h>
+
+#include <limits>
+#include <string>
+
+#include <rbdl/rbdl.h>
+
+#include "../urdfreader.h"
+
+using namespace std;
+using namespace RigidBodyDynamics;
+using namespace RigidBodyDynamics::Math;
+using namespace RigidBodyDynamics::Addons;
+
+const double TEST_PREC = 1.0e-12;
+
+/// \brief Inertial element used by most links of the test models.
+static const char *URDFInertial =
+"    <inertial>\n"
+"      <origin xyz=\"0.01 -0.02 0.1\" rpy=\"0 0 0\"/>\n"
+"      <mass value=\"1.5\"/>\n"
+"      <inertia ixx=\"0.03\" ixy=\"0.001\" ixz=\"0.002\" iyy=\"0.04\""
+" iyz=\"0.003\" izz=\"0.05\"/>\n"
+"    </inertial>\n";
+
+static string URDFLink (const string &name, bool with_inertial = true) {
+  return string ("  <link name=\"") + name + "\">\n"
+    + (with_inertial ? URDFInertial : "")
+    + "  </link>\n";
+}
+
+static string URDFJoint (const string &name, const string &type,
+    const string &parent, const string &child,
+    const string &origin = "xyz=\"0 0 0.3\" rpy=\"0 0 0\"",
+    const string &axis = "0 1 0") {
+  string limit;
+  if (type == "revolute" || type == "prismatic") {
+    limit = "    <limit lower=\"-1\" upper=\"1\" effort=\"10\""
+      " velocity=\"2\"/>\n";
+  }
+
+  return string ("  <joint name=\"") + name + "\" type=\"" + type + "\">\n"
+    + "    <parent link=\"" + parent + "\"/>\n"
+    + "    <child link=\"" + child + "\"/>\n"
+    + "    <origin " + origin + "/>\n"
+    + "    <axis xyz=\"" + axis + "\"/>\n"
+    + limit
+    + "  </joint>\n";
+}
+
+static string URDFRobot (const string &elements) {
+  return string ("<?xml version=\"1.0\"?>\n<robot name=\"test\">\n")
+    + elements + "</robot>\n";
+}
+
+/** \brief Reads the document with both readers and checks that the
+ * resulting models have the same structure, names, and dynamics.
+ */
+static void CheckStreamReaderMatches (const string &urdf,
+    bool floating_base) {
+  Model reference;
+  Model model;
+
+  CHECK (URDFReadFromString (urdf.c_str(), &reference, floating_base));
+  CHECK (URDFStreamReadFromString (urdf.c_str(), &model, floating_base));
+
+  CHECK_EQUAL (reference.mBodies.size(), model.mBodies.size());
+  CHECK_EQUAL (reference.mFixedBodies.size(), model.mFixedBodies.size());
+  CHECK_EQUAL (reference.dof_count, model.dof_count);
+  CHECK_EQUAL (reference.q_size, model.q_size);
+
+  if (reference.mBodies.size() != model.mBodies.size()
+      || reference.mFixedBodies.size() != model.mFixedBodies.size()
+      || reference.q_size != model.q_size) {
+    return;
+  }
+
+  CHECK (reference.mBodyNameMap == model.mBodyNameMap);
+
+  for (unsigned int i = 1; i < reference.mBodies.size(); i++) {
+    CHECK_EQUAL (reference.lambda[i], model.lambda[i]);
+    CHECK_EQUAL (reference.GetJointName (i), model.GetJointName (i));
+    CHECK_EQUAL (reference.mJoints[i].mJointType,
+        model.mJoints[i].mJointType);
+    CHECK_EQUAL (reference.mJoints[i].mDoFCount, model.mJoints[i].mDoFCount);
+    CHECK_ARRAY_CLOSE (reference.S[i].data(), model.S[i].data(), 6,
+        TEST_PREC);
+    CHECK_EQUAL (reference.mBodies[i].mIsVirtual,
+        model.mBodies[i].mIsVirtual);
+    CHECK_CLOSE (reference.mBodies[i].mMass, model.mBodies[i].mMass,
+        TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference.mBodies[i].mCenterOfMass.data(),
+        model.mBodies[i].mCenterOfMass.data(), 3, TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference.mBodies[i].mInertia.data(),
+        model.mBodies[i].mInertia.data(), 9, TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference.X_T[i].E.data(), model.X_T[i].E.data(),
+        9, TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference.X_T[i].r.data(), model.X_T[i].r.data(),
+        3, TEST_PREC);
+  }
+
+  for (unsigned int i = 0; i < reference.mFixedBodies.size(); i++) {
+    CHECK_EQUAL (reference.mFixedBodies[i].mMovableParent,
+        model.mFixedBodies[i].mMovableParent);
+    CHECK_ARRAY_CLOSE (reference.mFixedBodies[i].mParentTransform.r.data(),
+        model.mFixedBodies[i].mParentTransform.r.data(), 3, TEST_PREC);
+  }
+
+  VectorNd q (VectorNd::Zero (model.q_size));
+  VectorNd qdot (VectorNd::Zero (model.qdot_size));
+  VectorNd tau (VectorNd::Zero (model.qdot_size));
+  for (unsigned int i = 0; i < model.qdot_size; i++) {
+    q[i] = 0.1 * i - 0.3;
+    qdot[i] = 0.2 - 0.05 * i;
+    tau[i] = 0.3 * i;
+  }
+  for (unsigned int i = 1; i < reference.mBodies.size(); i++) {
+    if (reference.mJoints[i].mJointType == JointTypeSpherical) {
+      reference.SetQuaternion (i,
+          Quaternion::fromZYXAngles (Vector3d (0.1, -0.2, 0.3)), q);
+    }
+  }
+
+  VectorNd qddot_reference (VectorNd::Zero (model.qdot_size));
+  VectorNd qddot (VectorNd::Zero (model.qdot_size));
+  ForwardDynamics (reference, q, qdot, tau, qddot_reference);
+  ForwardDynamics (model, q, qdot, tau, qddot);
+
+  CHECK_ARRAY_CLOSE (qddot_reference.data(), qddot.data(), qddot.size(),
+      TEST_PREC);
+}
+
+/// \brief Checks that the stream reader rejects the document.
+static void CheckStreamReaderFails (const string &urdf) {
+  Model model;
+  CHECK (!URDFStreamReadFromString (urdf.c_str(), &model, false));
+}
+
+TEST ( URDFStreamReaderChain ) {
+  string urdf = URDFRobot (
+      URDFLink ("base_link")
+      + URDFLink ("upper")
+      + URDFLink ("lower")
+      + URDFLink ("slider")
+      + URDFLink ("tool")
+      + URDFJoint ("shoulder", "revolute", "base_link", "upper",
+        "xyz=\"0.1 0 0.2\" rpy=\"0.3 -0.2 0.1\"", "0 0 1")
+      + URDFJoint ("elbow", "continuous", "upper", "lower",
+        "xyz=\"0 0.1 0.4\" rpy=\"0 0.5 0\"", "1 0 0")
+      + URDFJoint ("slide", "prismatic", "lower", "slider",
+        "xyz=\"0 0 0.2\" rpy=\"0 0 0\"", "0 0.6 0.8")
+      + URDFJoint ("tool_mount", "fixed", "slider", "tool",
+        "xyz=\"0.05 0 0.1\" rpy=\"0 0 1.2\"")
+      );
+
+  CheckStreamReaderMatches (urdf, false);
+}
+
+TEST ( URDFStreamReaderFloatingBase ) {
+  string urdf = URDFRobot (
+      URDFLink ("pelvis")
+      + URDFLink ("thigh")
+      + URDFLink ("shank")
+      + URDFJoint ("hip", "revolute", "pelvis", "thigh")
+      + URDFJoint ("knee", "revolute", "thigh", "shank")
+      );
+
+  CheckStreamReaderMatches (urdf, true);
+  CheckStreamReaderMatches (urdf, false);
+
+  Model model;
+  CHECK (URDFStreamReadFromString (urdf.c_str(), &model, true));
+  CHECK_EQUAL (JointTypeSpherical, model.mJoints[2].mJointType);
+  CHECK_EQUAL (8u, model.dof_count);
+  CHECK_EQUAL (9u, model.q_size);
+}
+
+TEST ( URDFStreamReaderFixedJoints ) {
+  string urdf = URDFRobot (
+      URDFLink ("base_link")
+      + URDFLink ("torso")
+      + URDFLink ("sensor")
+      + URDFLink ("arm")
+      + URDFLink ("hand")
+      + URDFLink ("finger")
+      + URDFJoint ("torso_fixed", "fixed", "base_link", "torso")
+      + URDFJoint ("sensor_fixed", "fixed", "torso", "sensor",
+        "xyz=\"0.1 0.2 0.3\" rpy=\"0.1 0 0\"")
+      + URDFJoint ("shoulder", "revolute", "torso", "arm")
+      + URDFJoint ("wrist", "fixed", "arm", "hand",
+        "xyz=\"0 0 0.25\" rpy=\"0 0.4 0\"")
+      + URDFJoint ("finger", "revolute", "hand", "finger", "xyz=\"0 0 0.1\"",
+        "1 0 0")
+      );
+
+  CheckStreamReaderMatches (urdf, false);
+  CheckStreamReaderMatches (urdf, true);
+}
+
+TEST ( URDFStreamReaderBaseLinkParents ) {
+  // several joints attached to a root link that is called base_link and
+  // has no inertial
+  string urdf = URDFRobot (
+      URDFLink ("base_link", false)
+      + URDFLink ("left")
+      + URDFLink ("right")
+      + URDFLink ("center")
+      + URDFJoint ("left_joint", "revolute", "base_link", "left",
+        "xyz=\"0 0.2 0\" rpy=\"0 0 0\"")
+      + URDFJoint ("right_joint", "revolute", "base_link", "right",
+        "xyz=\"0 -0.2 0\" rpy=\"0 0 0\"")
+      + URDFJoint ("center_joint", "fixed", "base_link", "center",
+        "xyz=\"0.1 0 0\" rpy=\"0 0 0.2\"")
+      );
+
+  CheckStreamReaderMatches (urdf, false);
+  CheckStreamReaderMatches (urdf, true);
+}
+
+TEST ( URDFStreamReaderJointNameOrdering ) {
+  // the joints and links are declared in an order that differs from the
+  // alphabetical order of their names
+  string urdf = URDFRobot (
+      URDFJoint ("z_joint", "revolute", "root", "b_link")
+      + URDFLink ("root")
+      + URDFLink ("c_link")
+      + URDFJoint ("a_joint", "revolute", "root", "c_link",
+        "xyz=\"0 0.1 0\" rpy=\"0 0 0\"", "1 0 0")
+      + URDFLink ("b_link")
+      + URDFLink ("a_link")
+      + URDFJoint ("m_joint", "prismatic", "b_link", "a_link",
+        "xyz=\"0 0 0.1\" rpy=\"0 0 0\"", "0 0 1")
+      + URDFLink ("d_link")
+      + URDFJoint ("b_joint", "continuous", "root", "d_link",
+        "xyz=\"0.3 0 0\" rpy=\"0 0 0\"", "0 0 1")
+      );
+
+  CheckStreamReaderMatches (urdf, false);
+  CheckStreamReaderMatches (urdf, true);
+}
+
+TEST ( URDFStreamReaderDoFNameCollisions ) {
+  // the floating joint "arm" names its rotational degrees of freedom
+  // arm_0, arm_1 and arm_2, which collides with the joint "arm_1"
+  string urdf = URDFRobot (
+      URDFLink ("base_link")
+      + URDFLink ("upper")
+      + URDFLink ("lower")
+      + URDFJoint ("arm", "floating", "base_link", "upper")
+      + URDFJoint ("arm_1", "revolute", "upper", "lower")
+      );
+
+  CheckStreamReaderMatches (urdf, false);
+
+  Model model;
+  CHECK (URDFStreamReadFromString (urdf.c_str(), &model, false));
+  unsigned int upper_id = model.GetBodyId ("upper");
+  unsigned int lower_id = model.GetBodyId ("lower");
+  CHECK_EQUAL (upper_id, model.GetJointId ("arm"));
+  CHECK_EQUAL (lower_id, model.GetJointId ("arm_1"));
+  CHECK_EQUAL (model.mJoints[upper_id].q_index + 1,
+      model.GetDoFIndex ("arm_1"));
+  CHECK_EQUAL (string (""), model.GetDoFName (model.mJoints[lower_id].q_index));
+}
+
+TEST ( URDFStreamReaderMissingInertials ) {
+  string urdf = URDFRobot (
+      URDFLink ("base_link", false)
+      + URDFLink ("massless", false)
+      + URDFLink ("link")
+      + URDFLink ("massless_leaf", false)
+      + URDFJoint ("first", "revolute", "base_link", "massless")
+      + URDFJoint ("second", "revolute", "massless", "link")
+      + URDFJoint ("third", "fixed", "link", "massless_leaf")
+      );
+
+  CheckStreamReaderMatches (urdf, false);
+  CheckStreamReaderMatches (urdf, true);
+}
+
+TEST ( URDFStreamReaderEntitiesCommentsCDATA ) {
+  string urdf =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<!DOCTYPE robot>\n"
+    "<!-- a comment with <link name=\"ignored\"/> inside -->\n"
+    "<robot name=\"test &amp; entities\">\n"
+    "  <link name=\"base&#95;link\">\n"
+    "    <!-- <inertial> in a comment -->\n"
+    "    <inertial>\n"
+    "      <origin xyz=\"0.1 &#x30;.2 0\" rpy=\"0 0 0\"/>\n"
+    "      <mass value=\"2&#46;5\"/>\n"
+    "      <inertia ixx=\"0.1\" ixy=\"0\" ixz=\"0\" iyy=\"0.2\" iyz=\"0\""
+    " izz=\"0.3\"/>\n"
+    "    </inertial>\n"
+    "    <visual><geometry><box size=\"1 1 1\"/></geometry></visual>\n"
+    "  </link>\n"
+    "  <link name=\"arm &lt;1&gt;\">\n"
+    "    <![CDATA[ <inertial><mass value=\"100\"/></inertial> ]]>\n"
+    "    <inertial>\n"
+    "      <mass value=\"1.25\"/>\n"
+    "      <inertia ixx='0.01' ixy='0' ixz='0' iyy='0.02' iyz='0'"
+    " izz='0.03'/>\n"
+    "    </inertial>\n"
+    "  </link>\n"
+    "  <joint name=\"arm&apos;s &quot;joint&quot;\" type=\"revolute\">\n"
+    "    <parent link=\"base_link\"/>\n"
+    "    <child link=\"arm &lt;1&gt;\"/>\n"
+    "    <origin xyz=\"0 0 0.5\" rpy=\"0 0 0\"/>\n"
+    "    <axis xyz=\"0 1 0\"/>\n"
+    "    <limit lower=\"-1\" upper=\"1\" effort=\"1\" velocity=\"1\"/>\n"
+    "  </joint>\n"
+    "</robot>\n";
+
+  CheckStreamReaderMatches (urdf, false);
+
+  Model model;
+  CHECK (URDFStreamReadFromString (urdf.c_str(), &model, false));
+  CHECK (model.GetBodyId ("arm <1>") != std::numeric_limits<unsigned int>::max());
+  CHECK_EQUAL (model.GetBodyId ("arm <1>"),
+      model.GetJointId ("arm's \"joint\""));
+}
+
+TEST ( URDFStreamReaderTransmissionJoint ) {
+  // the joint element of a transmission only references a joint
+  string urdf = URDFRobot (
+      URDFLink ("base_link")
+      + URDFLink ("arm")
+      + URDFJoint ("shoulder", "revolute", "base_link", "arm")
+      + "  <transmission name=\"shoulder_transmission\">\n"
+      "    <type>transmission_interface/SimpleTransmission</type>\n"
+      "    <joint name=\"shoulder\">\n"
+      "      <hardwareInterface>EffortJointInterface</hardwareInterface>\n"
+      "    </joint>\n"
+      "    <actuator name=\"shoulder_motor\">\n"
+      "      <mechanicalReduction>50</mechanicalReduction>\n"
+      "    </actuator>\n"
+      "  </transmission>\n"
+      );
+
+  CheckStreamReaderMatches (urdf, false);
+}
+
+TEST ( URDFStreamReaderMalformedDocuments ) {
+  string links = URDFLink ("base_link") + URDFLink ("arm");
+
+  // unterminated tag
+  CheckStreamReaderFails (string ("<robot name=\"test\">\n")
+      + links + "  <joint name=\"shoulder\" type=\"revolute\"");
+
+  // unterminated document
+  CheckStreamReaderFails (string ("<robot name=\"test\">\n") + links);
+
+  // wrong end tag
+  CheckStreamReaderFails (URDFRobot (links
+        + "  <joint name=\"shoulder\" type=\"fixed\">\n"
+        "    <parent link=\"base_link\"/>\n"
+        "    <child link=\"arm\"/>\n"
+        "  </link>\n"));
+
+  // bad entities
+  CheckStreamReaderFails (URDFRobot (links
+        + URDFJoint ("shoulder&bogus;", "revolute", "base_link", "arm")));
+  CheckStreamReaderFails (URDFRobot (links
+        + URDFJoint ("shoulder&#xZZ;", "revolute", "base_link", "arm")));
+  CheckStreamReaderFails (URDFRobot (links
+        + URDFJoint ("shoulder&amp", "revolute", "base_link", "arm")));
+
+  // revolute joint without limits
+  CheckStreamReaderFails (URDFRobot (links
+        + "  <joint name=\"shoulder\" type=\"revolute\">\n"
+        "    <parent link=\"base_link\"/>\n"
+        "    <child link=\"arm\"/>\n"
+        "    <axis xyz=\"0 1 0\"/>\n"
+        "  </joint>\n"));
+
+  // empty document
+  CheckStreamReaderFails ("");
+}
+
+int main (int argc, char *argv[])
+{
+  return UnitTest::RunAllTests ();
+}
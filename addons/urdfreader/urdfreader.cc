@@ -268,12 +268,15 @@ bool construct_model (Model* rbdl_model, ModelPtr urdf_model, bool floating_base
       Body null_body (0., Vector3d::Zero(3), zero_matrix);
       Joint joint_txtytz(JointTypeTranslationXYZ);
       string trans_body_name = urdf_child->name + "_Translate";
-      rbdl_model->AddBody (rbdl_parent_id, rbdl_joint_frame, joint_txtytz, null_body, trans_body_name);
+      unsigned int trans_body_id = rbdl_model->AddBody (rbdl_parent_id, rbdl_joint_frame, joint_txtytz, null_body, trans_body_name);
+      rbdl_model->SetJointName (trans_body_id, urdf_joint->name + "_Translate");
 
       Joint joint_euler_zyx (JointTypeEulerXYZ);
-      rbdl_model->AppendBody (SpatialTransform(), joint_euler_zyx, rbdl_body, urdf_child->name);
+      unsigned int body_id = rbdl_model->AppendBody (SpatialTransform(), joint_euler_zyx, rbdl_body, urdf_child->name);
+      rbdl_model->SetJointName (body_id, urdf_joint->name);
     } else {
-      rbdl_model->AddBody (rbdl_parent_id, rbdl_joint_frame, rbdl_joint, rbdl_body, urdf_child->name);
+      unsigned int body_id = rbdl_model->AddBody (rbdl_parent_id, rbdl_joint_frame, rbdl_joint, rbdl_body, urdf_child->name);
+      rbdl_model->SetJointName (body_id, urdf_joint->name);
     }
   }
 
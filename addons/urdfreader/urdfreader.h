@@ -10,6 +10,18 @@ struct Model;
 namespace Addons {
   RBDL_DLLAPI bool URDFReadFromFile (const char* filename, Model* model, bool floating_base, bool verbose = false);
   RBDL_DLLAPI bool URDFReadFromString (const char* model_xml_string, Model* model, bool floating_base, bool verbose = false);
+
+  /** \brief Loads a URDF file without building a document tree.
+   *
+   * Creates the same model as URDFReadFromFile() but the links and joints
+   * are collected while the XML text is scanned and the bodies are then
+   * added directly to the model. Elements that are not used by RBDL
+   * (visuals, collisions, materials, ...) are skipped without being
+   * validated. Returns false if the file cannot be read or is invalid.
+   */
+  RBDL_DLLAPI bool URDFStreamReadFromFile (const char* filename, Model* model, bool floating_base, bool verbose = false);
+  /// \brief Loads a URDF model from a string, see URDFStreamReadFromFile().
+  RBDL_DLLAPI bool URDFStreamReadFromString (const char* model_xml_string, Model* model, bool floating_base, bool verbose = false);
 }
 
 }
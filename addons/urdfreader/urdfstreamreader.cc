@@ -0,0 +1,1026 @@
+#include <rbdl/rbdl.h>
+
+#include "urdfreader.h"
+
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef RBDL_USE_ROS_URDF_LIBRARY
+#include <urdf_model/pose.h>
+#else
+#include <urdf/urdfdom_headers/urdf_model/include/urdf_model/pose.h>
+#endif
+
+using namespace std;
+
+namespace RigidBodyDynamics {
+
+namespace Addons {
+
+using namespace Math;
+
+/*
+ * XML event parser
+ *
+ * The parser works in place on a null-terminated, writable buffer: names
+ * and attribute values are terminated and their entities are decoded
+ * inside the buffer such that the handler receives plain C strings without
+ * any allocations. Only the elements and their attributes are reported;
+ * text, comments, processing instructions, CDATA sections, and the
+ * document type declaration are skipped.
+ */
+
+struct XMLAttribute {
+  const char *name;
+  const char *value;
+};
+
+static inline bool IsXMLSpace (char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool IsXMLNameEnd (char c) {
+  return IsXMLSpace (c) || c == '/' || c == '>' || c == '=' || c == '\0';
+}
+
+static char* SkipXMLSpace (char *text) {
+  while (IsXMLSpace (*text)) {
+    text++;
+  }
+  return text;
+}
+
+/** \brief Returns a pointer to the first character after the next
+ * occurrence of delimiter or NULL if it is not found.
+ */
+static char* SkipPast (char *text, const char *delimiter) {
+  char *position = strstr (text, delimiter);
+  if (position == NULL) {
+    return NULL;
+  }
+  return position + strlen (delimiter);
+}
+
+static void AppendUTF8 (unsigned long code, char *&out) {
+  if (code < 0x80) {
+    *out++ = static_cast<char>(code);
+  } else if (code < 0x800) {
+    *out++ = static_cast<char>(0xC0 | (code >> 6));
+    *out++ = static_cast<char>(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    *out++ = static_cast<char>(0xE0 | (code >> 12));
+    *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (code & 0x3F));
+  } else {
+    *out++ = static_cast<char>(0xF0 | (code >> 18));
+    *out++ = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+    *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (code & 0x3F));
+  }
+}
+
+/** \brief Decodes the entities of the attribute value [begin, end) in
+ * place and terminates it.
+ */
+static bool DecodeXMLAttributeValue (char *begin, char *end) {
+  char *out = begin;
+
+  for (char *in = begin; in < end; ) {
+    if (*in != '&') {
+      *out++ = *in++;
+      continue;
+    }
+
+    char *semicolon = static_cast<char*>(memchr (in, ';', end - in));
+    if (semicolon == NULL) {
+      return false;
+    }
+
+    string entity (in + 1, semicolon);
+    if (entity == "lt") {
+      *out++ = '<';
+    } else if (entity == "gt") {
+      *out++ = '>';
+    } else if (entity == "amp") {
+      *out++ = '&';
+    } else if (entity == "quot") {
+      *out++ = '"';
+    } else if (entity == "apos") {
+      *out++ = '\'';
+    } else if (entity.size() > 1 && entity[0] == '#') {
+      char *number_end = NULL;
+      unsigned long code = 0;
+      if (entity[1] == 'x') {
+        code = strtoul (entity.c_str() + 2, &number_end, 16);
+      } else {
+        code = strtoul (entity.c_str() + 1, &number_end, 10);
+      }
+      if (*number_end != '\0' || code > 0x10FFFF) {
+        return false;
+      }
+      // a character reference is never longer than its UTF-8 encoding
+      AppendUTF8 (code, out);
+    } else {
+      return false;
+    }
+
+    in = semicolon + 1;
+  }
+
+  *out = '\0';
+  return true;
+}
+
+/** \brief Parses the XML document text and reports its elements to the
+ * handler.
+ *
+ * The handler has to provide
+ * \code
+ * bool StartElement (const char *name, const vector<XMLAttribute> &attributes);
+ * bool EndElement ();
+ * \endcode
+ * which return false to abort parsing.
+ */
+template <typename Handler>
+static bool ParseXMLEvents (char *text, Handler &handler, string &error) {
+  vector<char*> element_stack;
+  vector<XMLAttribute> attributes;
+  bool have_root = false;
+
+  // byte order mark
+  if (strncmp (text, "\xEF\xBB\xBF", 3) == 0) {
+    text += 3;
+  }
+
+  while (true) {
+    text = strchr (text, '<');
+    if (text == NULL) {
+      break;
+    }
+
+    if (strncmp (text, "<?", 2) == 0) {
+      text = SkipPast (text + 2, "?>");
+    } else if (strncmp (text, "<!--", 4) == 0) {
+      text = SkipPast (text + 4, "-->");
+    } else if (strncmp (text, "<![CDATA[", 9) == 0) {
+      text = SkipPast (text + 9, "]]>");
+    } else if (strncmp (text, "<!", 2) == 0) {
+      // document type declaration, possibly with an internal subset
+      int bracket_depth = 0;
+      text += 2;
+      while (*text != '\0' && (*text != '>' || bracket_depth > 0)) {
+        if (*text == '[') {
+          bracket_depth++;
+        } else if (*text == ']') {
+          bracket_depth--;
+        }
+        text++;
+      }
+      text = *text == '\0' ? NULL : text + 1;
+    } else if (text[1] == '/') {
+      char *name = text + 2;
+      char *name_end = name;
+      while (!IsXMLNameEnd (*name_end)) {
+        name_end++;
+      }
+      text = SkipXMLSpace (name_end);
+      if (*text != '>') {
+        error = "malformed end tag";
+        return false;
+      }
+      *name_end = '\0';
+
+      if (element_stack.size() == 0 || strcmp (element_stack.back(), name) != 0) {
+        error = string ("unexpected end tag '") + name + "'";
+        return false;
+      }
+      element_stack.pop_back();
+
+      if (!handler.EndElement()) {
+        return false;
+      }
+
+      text++;
+    } else {
+      if (element_stack.size() == 0 && have_root) {
+        error = "more than one root element";
+        return false;
+      }
+
+      char *name = text + 1;
+      char *name_end = name;
+      while (!IsXMLNameEnd (*name_end)) {
+        name_end++;
+      }
+      if (name_end == name) {
+        error = "malformed start tag";
+        return false;
+      }
+
+      attributes.clear();
+      text = name_end;
+      bool empty_element = false;
+
+      while (true) {
+        char *separator = text;
+        text = SkipXMLSpace (text);
+
+        if (*text == '>') {
+          text++;
+          break;
+        } else if (text[0] == '/' && text[1] == '>') {
+          empty_element = true;
+          text += 2;
+          break;
+        } else if (text == separator) {
+          error = string ("malformed start tag of element '")
+            + string (name, name_end) + "'";
+          return false;
+        }
+
+        XMLAttribute attribute;
+        char *attribute_name = text;
+        while (!IsXMLNameEnd (*text)) {
+          text++;
+        }
+        char *attribute_name_end = text;
+        text = SkipXMLSpace (text);
+
+        if (attribute_name_end == attribute_name || *text != '=') {
+          error = string ("malformed attribute in element '")
+            + string (name, name_end) + "'";
+          return false;
+        }
+        text = SkipXMLSpace (text + 1);
+
+        char quote = *text;
+        if (quote != '"' && quote != '\'') {
+          error = string ("unquoted attribute value in element '")
+            + string (name, name_end) + "'";
+          return false;
+        }
+
+        char *value = text + 1;
+        char *value_end = strchr (value, quote);
+        if (value_end == NULL) {
+          error = "unterminated attribute value";
+          return false;
+        }
+        text = value_end + 1;
+
+        *attribute_name_end = '\0';
+        if (!DecodeXMLAttributeValue (value, value_end)) {
+          error = string ("invalid entity in attribute '") + attribute_name
+            + "'";
+          return false;
+        }
+
+        attribute.name = attribute_name;
+        attribute.value = value;
+        attributes.push_back (attribute);
+      }
+
+      // the name is terminated after the attributes were parsed as its
+      // terminating character may be part of the tag
+      *name_end = '\0';
+      have_root = true;
+
+      if (!handler.StartElement (name, attributes)) {
+        return false;
+      }
+
+      if (empty_element) {
+        if (!handler.EndElement()) {
+          return false;
+        }
+      } else {
+        element_stack.push_back (name);
+      }
+    }
+
+    if (text == NULL) {
+      error = "unterminated markup";
+      return false;
+    }
+  }
+
+  if (element_stack.size() != 0) {
+    error = string ("missing end tag of element '") + element_stack.back()
+      + "'";
+    return false;
+  }
+
+  if (!have_root) {
+    error = "no root element";
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * URDF handler
+ */
+
+static const char* FindAttribute (const vector<XMLAttribute> &attributes,
+    const char *name) {
+  for (unsigned int i = 0; i < attributes.size(); i++) {
+    if (strcmp (attributes[i].name, name) == 0) {
+      return attributes[i].value;
+    }
+  }
+  return NULL;
+}
+
+static bool ParseDouble (const char *str, double &value) {
+  char *end = NULL;
+  value = strtod (str, &end);
+  if (end == str) {
+    return false;
+  }
+  end = SkipXMLSpace (end);
+  return *end == '\0';
+}
+
+/// \brief Parses three values separated by spaces like urdf::Vector3.
+static bool ParseVector3 (const char *str, double values[3]) {
+  unsigned int count = 0;
+
+  while (true) {
+    while (*str == ' ') {
+      str++;
+    }
+    if (*str == '\0') {
+      break;
+    }
+
+    char *end = NULL;
+    double value = strtod (str, &end);
+    if (end == str || (*end != ' ' && *end != '\0') || count == 3) {
+      return false;
+    }
+
+    values[count++] = value;
+    str = end;
+  }
+
+  return count == 3;
+}
+
+enum URDFJointType {
+  URDFJointUnknown = 0,
+  URDFJointRevolute,
+  URDFJointContinuous,
+  URDFJointPrismatic,
+  URDFJointFloating,
+  URDFJointPlanar,
+  URDFJointFixed
+};
+
+struct URDFStreamPose {
+  URDFStreamPose () {
+    xyz[0] = xyz[1] = xyz[2] = 0.;
+    rpy[0] = rpy[1] = rpy[2] = 0.;
+  }
+
+  double xyz[3];
+  double rpy[3];
+};
+
+struct URDFStreamLink {
+  URDFStreamLink () :
+    has_inertial (false),
+    mass (0.),
+    parent_joint (-1),
+    body_id (std::numeric_limits<unsigned int>::max()) {
+    for (unsigned int i = 0; i < 6; i++) {
+      inertia[i] = 0.;
+    }
+  }
+
+  string name;
+  bool has_inertial;
+  URDFStreamPose inertial_origin;
+  double mass;
+  /// \brief ixx, ixy, ixz, iyy, iyz, izz
+  double inertia[6];
+  int parent_joint;
+  vector<int> child_joints;
+  unsigned int body_id;
+};
+
+struct URDFStreamJoint {
+  URDFStreamJoint () :
+    type (URDFJointUnknown),
+    has_limit (false),
+    parent_link (-1),
+    child_link (-1) {
+    axis[0] = 1.;
+    axis[1] = 0.;
+    axis[2] = 0.;
+  }
+
+  string name;
+  URDFJointType type;
+  URDFStreamPose origin;
+  string parent_link_name;
+  string child_link_name;
+  double axis[3];
+  bool has_limit;
+  int parent_link;
+  int child_link;
+};
+
+/** \brief Collects the links and joints of a URDF document from the
+ * parse events.
+ *
+ * Like the urdfdom parser only the first child element of each kind is
+ * evaluated. Visuals, collisions, materials, and other elements that RBDL
+ * does not use are skipped.
+ */
+struct URDFStreamHandler {
+  enum Context {
+    ContextIgnored = 0,
+    ContextRobot,
+    ContextLink,
+    ContextInertial,
+    ContextJoint
+  };
+
+  URDFStreamHandler () :
+    have_robot (false),
+    have_inertial_origin (false),
+    have_mass (false),
+    have_inertia (false),
+    have_joint_origin (false),
+    have_parent (false),
+    have_child (false),
+    have_axis (false) {
+  }
+
+  bool Fail (const string &message) {
+    error = message;
+    return false;
+  }
+
+  bool ParsePose (const vector<XMLAttribute> &attributes,
+      URDFStreamPose &pose) {
+    const char *xyz = FindAttribute (attributes, "xyz");
+    const char *rpy = FindAttribute (attributes, "rpy");
+
+    if (xyz && !ParseVector3 (xyz, pose.xyz)) {
+      return Fail (string ("invalid xyz value '") + xyz + "'");
+    }
+    if (rpy && !ParseVector3 (rpy, pose.rpy)) {
+      return Fail (string ("invalid rpy value '") + rpy + "'");
+    }
+    return true;
+  }
+
+  bool StartElement (const char *name,
+      const vector<XMLAttribute> &attributes) {
+    Context parent = context_stack.size() > 0 ? context_stack.back()
+      : ContextIgnored;
+    Context context = ContextIgnored;
+
+    if (context_stack.size() == 0) {
+      if (strcmp (name, "robot") != 0) {
+        return Fail ("Could not find the 'robot' element in the xml file");
+      }
+      if (!FindAttribute (attributes, "name")) {
+        return Fail ("No name given for the robot.");
+      }
+      have_robot = true;
+      context = ContextRobot;
+    } else if (parent == ContextRobot) {
+      if (strcmp (name, "link") == 0) {
+        const char *link_name = FindAttribute (attributes, "name");
+        if (!link_name) {
+          return Fail ("No name given for the link.");
+        }
+        links.push_back (URDFStreamLink());
+        links.back().name = link_name;
+        context = ContextLink;
+      } else if (strcmp (name, "joint") == 0) {
+        const char *joint_name = FindAttribute (attributes, "name");
+        if (!joint_name) {
+          return Fail ("unnamed joint found");
+        }
+        const char *type = FindAttribute (attributes, "type");
+        if (!type) {
+          return Fail (string ("joint [") + joint_name + "] has no type");
+        }
+
+        joints.push_back (URDFStreamJoint());
+        URDFStreamJoint &joint = joints.back();
+        joint.name = joint_name;
+
+        if (strcmp (type, "revolute") == 0) {
+          joint.type = URDFJointRevolute;
+        } else if (strcmp (type, "continuous") == 0) {
+          joint.type = URDFJointContinuous;
+        } else if (strcmp (type, "prismatic") == 0) {
+          joint.type = URDFJointPrismatic;
+        } else if (strcmp (type, "floating") == 0) {
+          joint.type = URDFJointFloating;
+        } else if (strcmp (type, "planar") == 0) {
+          joint.type = URDFJointPlanar;
+        } else if (strcmp (type, "fixed") == 0) {
+          joint.type = URDFJointFixed;
+        } else {
+          return Fail (string ("Joint [") + joint_name
+              + "] has no known type [" + type + "]");
+        }
+
+        have_joint_origin = false;
+        have_parent = false;
+        have_child = false;
+        have_axis = false;
+        context = ContextJoint;
+      }
+    } else if (parent == ContextLink) {
+      if (strcmp (name, "inertial") == 0 && !links.back().has_inertial) {
+        links.back().has_inertial = true;
+        have_inertial_origin = false;
+        have_mass = false;
+        have_inertia = false;
+        context = ContextInertial;
+      }
+    } else if (parent == ContextInertial) {
+      URDFStreamLink &link = links.back();
+
+      if (strcmp (name, "origin") == 0 && !have_inertial_origin) {
+        have_inertial_origin = true;
+        if (!ParsePose (attributes, link.inertial_origin)) {
+          return false;
+        }
+      } else if (strcmp (name, "mass") == 0 && !have_mass) {
+        have_mass = true;
+        const char *value = FindAttribute (attributes, "value");
+        if (!value || !ParseDouble (value, link.mass)) {
+          return Fail ("Inertial: mass element must have a valid value "
+              "attribute");
+        }
+      } else if (strcmp (name, "inertia") == 0 && !have_inertia) {
+        have_inertia = true;
+        const char *names[6] = { "ixx", "ixy", "ixz", "iyy", "iyz", "izz" };
+        for (unsigned int i = 0; i < 6; i++) {
+          const char *value = FindAttribute (attributes, names[i]);
+          if (!value || !ParseDouble (value, link.inertia[i])) {
+            return Fail ("Inertial: inertia element must have valid ixx, "
+                "ixy, ixz, iyy, iyz, izz attributes");
+          }
+        }
+      }
+    } else if (parent == ContextJoint) {
+      URDFStreamJoint &joint = joints.back();
+
+      if (strcmp (name, "origin") == 0 && !have_joint_origin) {
+        have_joint_origin = true;
+        if (!ParsePose (attributes, joint.origin)) {
+          return false;
+        }
+      } else if (strcmp (name, "parent") == 0 && !have_parent) {
+        have_parent = true;
+        const char *link_name = FindAttribute (attributes, "link");
+        if (link_name) {
+          joint.parent_link_name = link_name;
+        }
+      } else if (strcmp (name, "child") == 0 && !have_child) {
+        have_child = true;
+        const char *link_name = FindAttribute (attributes, "link");
+        if (link_name) {
+          joint.child_link_name = link_name;
+        }
+      } else if (strcmp (name, "axis") == 0 && !have_axis) {
+        have_axis = true;
+        const char *xyz = FindAttribute (attributes, "xyz");
+        if (joint.type != URDFJointFloating && joint.type != URDFJointFixed) {
+          // an axis element without xyz attribute results in a zero axis
+          joint.axis[0] = 0.;
+          if (xyz && !ParseVector3 (xyz, joint.axis)) {
+            return Fail (string ("Malformed axis element for joint [")
+                + joint.name + "]");
+          }
+        }
+      } else if (strcmp (name, "limit") == 0 && !joint.has_limit) {
+        joint.has_limit = true;
+        const char *names[4] = { "lower", "upper", "effort", "velocity" };
+        for (unsigned int i = 0; i < 4; i++) {
+          const char *value = FindAttribute (attributes, names[i]);
+          double number = 0.;
+          if ((!value && i >= 2) || (value && !ParseDouble (value, number))) {
+            return Fail (string ("Could not parse limit element for joint [")
+                + joint.name + "]");
+          }
+        }
+      }
+    }
+
+    context_stack.push_back (context);
+    return true;
+  }
+
+  bool EndElement () {
+    Context context = context_stack.back();
+    context_stack.pop_back();
+
+    if (context == ContextInertial) {
+      if (!have_mass) {
+        return Fail ("Inertial element must have a mass element");
+      }
+      if (!have_inertia) {
+        return Fail ("Inertial element must have inertia element");
+      }
+    } else if (context == ContextJoint) {
+      URDFStreamJoint &joint = joints.back();
+      if (!joint.has_limit && (joint.type == URDFJointRevolute
+            || joint.type == URDFJointPrismatic)) {
+        return Fail (string ("Joint [") + joint.name
+            + "] of type revolute or prismatic does not specify limits");
+      }
+      if (joint.parent_link_name.empty() || joint.child_link_name.empty()) {
+        return Fail (string ("Joint [") + joint.name
+            + "] is missing a parent and/or child link specification.");
+      }
+    }
+
+    return true;
+  }
+
+  bool have_robot;
+  bool have_inertial_origin;
+  bool have_mass;
+  bool have_inertia;
+  bool have_joint_origin;
+  bool have_parent;
+  bool have_child;
+  bool have_axis;
+
+  vector<Context> context_stack;
+  vector<URDFStreamLink> links;
+  vector<URDFStreamJoint> joints;
+  string error;
+};
+
+struct JointNameLess {
+  JointNameLess (const vector<URDFStreamJoint> &joints) :
+    joints (joints) {
+  }
+
+  bool operator() (int a, int b) const {
+    return joints[a].name < joints[b].name;
+  }
+
+  const vector<URDFStreamJoint> &joints;
+};
+
+/// \brief Converts the roll, pitch, yaw angles like urdf::Rotation.
+static Vector3d NormalizeRPY (const double rpy[3]) {
+  urdf::Rotation rotation;
+  rotation.setFromRPY (rpy[0], rpy[1], rpy[2]);
+
+  Vector3d result;
+  rotation.getRPY (result[0], result[1], result[2]);
+  return result;
+}
+
+static Body CreateBody (const URDFStreamLink &link) {
+  Matrix3d inertia = Matrix3d::Zero();
+
+  if (!link.has_inertial) {
+    return Body (0., Vector3d (0., 0., 0.), inertia);
+  }
+
+  inertia(0,0) = link.inertia[0];
+  inertia(0,1) = link.inertia[1];
+  inertia(0,2) = link.inertia[2];
+
+  inertia(1,0) = link.inertia[1];
+  inertia(1,1) = link.inertia[3];
+  inertia(1,2) = link.inertia[4];
+
+  inertia(2,0) = link.inertia[2];
+  inertia(2,1) = link.inertia[4];
+  inertia(2,2) = link.inertia[5];
+
+  return Body (link.mass,
+      Vector3d (link.inertial_origin.xyz[0], link.inertial_origin.xyz[1],
+        link.inertial_origin.xyz[2]),
+      inertia);
+}
+
+static bool construct_model_from_stream (Model *rbdl_model,
+    URDFStreamHandler &urdf, bool floating_base, bool verbose) {
+  vector<URDFStreamLink> &links = urdf.links;
+  vector<URDFStreamJoint> &joints = urdf.joints;
+
+  if (links.size() == 0) {
+    cerr << "Error: No link elements found in urdf file" << endl;
+    return false;
+  }
+
+  map<string, int> link_indices;
+  for (unsigned int i = 0; i < links.size(); i++) {
+    if (!link_indices.insert (make_pair (links[i].name, i)).second) {
+      cerr << "Error: link '" << links[i].name << "' is not unique." << endl;
+      return false;
+    }
+  }
+
+  // the urdfdom parser stores the joints in a map and therefore visits the
+  // children of a link in the order of their joint names
+  vector<int> sorted_joints (joints.size());
+  for (unsigned int i = 0; i < joints.size(); i++) {
+    sorted_joints[i] = i;
+  }
+  sort (sorted_joints.begin(), sorted_joints.end(), JointNameLess (joints));
+
+  for (unsigned int i = 0; i < sorted_joints.size(); i++) {
+    URDFStreamJoint &joint = joints[sorted_joints[i]];
+
+    if (i > 0 && joint.name == joints[sorted_joints[i - 1]].name) {
+      cerr << "Error: joint '" << joint.name << "' is not unique." << endl;
+      return false;
+    }
+
+    map<string, int>::const_iterator parent_iter =
+      link_indices.find (joint.parent_link_name);
+    map<string, int>::const_iterator child_iter =
+      link_indices.find (joint.child_link_name);
+
+    if (parent_iter == link_indices.end()
+        || child_iter == link_indices.end()) {
+      cerr << "Error: parent link '" << joint.parent_link_name
+        << "' or child link '" << joint.child_link_name << "' of joint '"
+        << joint.name << "' not found." << endl;
+      return false;
+    }
+
+    joint.parent_link = parent_iter->second;
+    joint.child_link = child_iter->second;
+
+    links[joint.parent_link].child_joints.push_back (sorted_joints[i]);
+    links[joint.child_link].parent_joint = sorted_joints[i];
+  }
+
+  // the root link is the first link (by name) without a parent
+  int root_index = -1;
+  map<string, int>::const_iterator link_iter;
+  for (link_iter = link_indices.begin(); link_iter != link_indices.end();
+      ++link_iter) {
+    if (links[link_iter->second].parent_joint < 0) {
+      if (root_index >= 0) {
+        cerr << "Error: Two root links found: '" << links[root_index].name
+          << "' and '" << link_iter->first << "'" << endl;
+        return false;
+      }
+      root_index = link_iter->second;
+    }
+  }
+
+  if (root_index < 0) {
+    cerr << "Error: No root link found. The robot xml is not a valid tree."
+      << endl;
+    return false;
+  }
+
+  bool nested_bulk_construction = rbdl_model->mBulkConstruction;
+  if (!nested_bulk_construction) {
+    rbdl_model->BeginBulkConstruction (links.size());
+  }
+
+  // add the root body
+  URDFStreamLink &root = links[root_index];
+  if (root.has_inertial) {
+    Body root_link = CreateBody (root);
+
+    Joint root_joint (JointTypeFixed);
+    if (floating_base) {
+      root_joint = JointTypeFloatingBase;
+    }
+
+    SpatialTransform root_joint_frame = SpatialTransform ();
+
+    if (verbose) {
+      cout << "+ Adding Root Body " << endl;
+      cout << "  joint frame: " << root_joint_frame << endl;
+      if (floating_base) {
+        cout << "  joint type : floating" << endl;
+      } else {
+        cout << "  joint type : fixed" << endl;
+      }
+      cout << "  body inertia: " << endl << root_link.mInertia << endl;
+      cout << "  body mass   : " << root_link.mMass << endl;
+      cout << "  body name   : " << root.name << endl;
+    }
+
+    root.body_id = rbdl_model->AppendBody (root_joint_frame,
+        root_joint,
+        root_link,
+        root.name);
+  }
+
+  // depth first traversal that directly adds the child bodies
+  vector<pair<int, unsigned int> > link_stack;
+  link_stack.push_back (make_pair (root_index, 0u));
+  bool success = true;
+
+  while (success && link_stack.size() > 0) {
+    URDFStreamLink &cur_link = links[link_stack.back().first];
+    unsigned int joint_idx = link_stack.back().second;
+
+    if (joint_idx >= cur_link.child_joints.size()) {
+      link_stack.pop_back();
+      continue;
+    }
+
+    link_stack.back().second++;
+
+    URDFStreamJoint &urdf_joint = joints[cur_link.child_joints[joint_idx]];
+    URDFStreamLink &urdf_parent = links[urdf_joint.parent_link];
+    URDFStreamLink &urdf_child = links[urdf_joint.child_link];
+    link_stack.push_back (make_pair (urdf_joint.child_link, 0u));
+
+    // determine where to add the current joint and child body
+    unsigned int rbdl_parent_id = 0;
+
+    if (urdf_parent.name != "base_link") {
+      rbdl_parent_id = urdf_parent.body_id;
+    }
+
+    if (rbdl_parent_id == std::numeric_limits<unsigned int>::max()) {
+      cerr << "Error while processing joint '" << urdf_joint.name
+        << "': parent link '" << urdf_parent.name
+        << "' could not be found." << endl;
+      success = false;
+      break;
+    }
+
+    // create the joint
+    Joint rbdl_joint;
+    if (urdf_joint.type == URDFJointRevolute
+        || urdf_joint.type == URDFJointContinuous) {
+      rbdl_joint = Joint (SpatialVector (urdf_joint.axis[0],
+            urdf_joint.axis[1], urdf_joint.axis[2], 0., 0., 0.));
+    } else if (urdf_joint.type == URDFJointPrismatic) {
+      rbdl_joint = Joint (SpatialVector (0., 0., 0., urdf_joint.axis[0],
+            urdf_joint.axis[1], urdf_joint.axis[2]));
+    } else if (urdf_joint.type == URDFJointFixed) {
+      rbdl_joint = Joint (JointTypeFixed);
+    } else if (urdf_joint.type == URDFJointFloating) {
+      rbdl_joint = Joint (
+          SpatialVector (0., 0., 0., 1., 0., 0.),
+          SpatialVector (0., 0., 0., 0., 1., 0.),
+          SpatialVector (0., 0., 0., 0., 0., 1.),
+          SpatialVector (1., 0., 0., 0., 0., 0.),
+          SpatialVector (0., 1., 0., 0., 0., 0.),
+          SpatialVector (0., 0., 1., 0., 0., 0.));
+    } else if (urdf_joint.type == URDFJointPlanar) {
+      cerr << "Error while processing joint '" << urdf_joint.name
+        << "': planar joints not yet supported!" << endl;
+      success = false;
+      break;
+    }
+
+    // compute the joint transformation
+    Vector3d joint_rpy = NormalizeRPY (urdf_joint.origin.rpy);
+    Vector3d joint_translation (urdf_joint.origin.xyz[0],
+        urdf_joint.origin.xyz[1], urdf_joint.origin.xyz[2]);
+    SpatialTransform rbdl_joint_frame =
+          Xrot (joint_rpy[0], Vector3d (1., 0., 0.))
+        * Xrot (joint_rpy[1], Vector3d (0., 1., 0.))
+        * Xrot (joint_rpy[2], Vector3d (0., 0., 1.))
+        * Xtrans (Vector3d (
+              joint_translation
+              ));
+
+    if (urdf_child.has_inertial
+        && NormalizeRPY (urdf_child.inertial_origin.rpy)
+        != Vector3d (0., 0., 0.)) {
+      cerr << "Error while processing body '" << urdf_child.name
+        << "': rotation of body frames not yet supported. Please rotate the "
+        << "joint frame instead." << endl;
+      success = false;
+      break;
+    }
+
+    Body rbdl_body = CreateBody (urdf_child);
+
+    if (verbose) {
+      cout << "+ Adding Body: " << urdf_child.name << endl;
+      cout << "  parent_id  : " << rbdl_parent_id << endl;
+      cout << "  joint frame: " << rbdl_joint_frame << endl;
+      cout << "  joint dofs : " << rbdl_joint.mDoFCount << endl;
+      for (unsigned int j = 0; j < rbdl_joint.mDoFCount; j++) {
+        cout << "    " << j << ": " << rbdl_joint.mJointAxes[j].transpose()
+          << endl;
+      }
+      cout << "  body inertia: " << endl << rbdl_body.mInertia << endl;
+      cout << "  body mass   : " << rbdl_body.mMass << endl;
+      cout << "  body name   : " << urdf_child.name << endl;
+    }
+
+    if (urdf_joint.type == URDFJointFloating) {
+      Matrix3d zero_matrix = Matrix3d::Zero();
+      Body null_body (0., Vector3d::Zero(3), zero_matrix);
+      Joint joint_txtytz(JointTypeTranslationXYZ);
+      string trans_body_name = urdf_child.name + "_Translate";
+      unsigned int trans_body_id = rbdl_model->AddBody (rbdl_parent_id,
+          rbdl_joint_frame, joint_txtytz, null_body, trans_body_name);
+      rbdl_model->SetJointName (trans_body_id,
+          urdf_joint.name + "_Translate");
+
+      Joint joint_euler_zyx (JointTypeEulerXYZ);
+      urdf_child.body_id = rbdl_model->AppendBody (SpatialTransform(),
+          joint_euler_zyx, rbdl_body, urdf_child.name);
+    } else {
+      urdf_child.body_id = rbdl_model->AddBody (rbdl_parent_id,
+          rbdl_joint_frame, rbdl_joint, rbdl_body, urdf_child.name);
+    }
+    rbdl_model->SetJointName (urdf_child.body_id, urdf_joint.name);
+  }
+
+  if (!nested_bulk_construction) {
+    rbdl_model->EndBulkConstruction();
+  }
+
+  return success;
+}
+
+static bool URDFStreamReadFromBuffer (char* model_xml, Model* model,
+    bool floating_base, bool verbose) {
+  assert (model);
+
+  URDFStreamHandler handler;
+  string error;
+
+  if (!ParseXMLEvents (model_xml, handler, error)) {
+    if (handler.error != "") {
+      error = handler.error;
+    }
+    cerr << "Error parsing urdf: " << error << endl;
+    return false;
+  }
+
+  if (!construct_model_from_stream (model, handler, floating_base, verbose)) {
+    cerr << "Error constructing model from urdf file." << endl;
+    return false;
+  }
+
+  model->gravity.set (0., 0., -9.81);
+
+  return true;
+}
+
+RBDL_DLLAPI bool URDFStreamReadFromFile (const char* filename, Model* model,
+    bool floating_base, bool verbose) {
+  ifstream model_file (filename, ios::in | ios::binary);
+  if (!model_file) {
+    cerr << "Error opening file '" << filename << "'." << endl;
+    return false;
+  }
+
+  model_file.seekg (0, std::ios::end);
+  streamoff size = model_file.tellg();
+  model_file.seekg (0, std::ios::beg);
+
+  if (size < 0) {
+    cerr << "Error reading file '" << filename << "'." << endl;
+    return false;
+  }
+
+  vector<char> model_xml (static_cast<size_t>(size) + 1);
+  model_file.read (&model_xml[0], size);
+  if (!model_file) {
+    cerr << "Error reading file '" << filename << "'." << endl;
+    return false;
+  }
+  model_xml[size] = '\0';
+  model_file.close();
+
+  return URDFStreamReadFromBuffer (&model_xml[0], model, floating_base,
+      verbose);
+}
+
+RBDL_DLLAPI bool URDFStreamReadFromString (const char* model_xml_string,
+    Model* model, bool floating_base, bool verbose) {
+  // the parser decodes the document in place
+  vector<char> model_xml (model_xml_string,
+      model_xml_string + strlen (model_xml_string) + 1);
+
+  return URDFStreamReadFromBuffer (&model_xml[0], model, floating_base,
+      verbose);
+}
+
+}
+
+}
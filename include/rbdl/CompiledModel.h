@@ -0,0 +1,125 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_COMPILED_MODEL_H
+#define RBDL_COMPILED_MODEL_H
+
+#include <cstddef>
+#include <vector>
+
+#include "rbdl/rbdl_math.h"
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+/** \page compiled_model_page Compiled Models
+ *
+ * Loading a model from a URDF or Lua file requires parsing the file and
+ * evaluating the model description, which can take much longer than the
+ * dynamics computations the model is needed for. A model that has been
+ * built can therefore be stored in a binary format ("compiled model") and
+ * loaded again without parsing any text:
+ *
+ * \code
+ * // once, e.g. with the rbdl_model_compile tool
+ * CompiledModelWriteToFile (model, "robot.rbdlm");
+ *
+ * // at startup of every process
+ * Model model;
+ * CompiledModelReadFromFile ("robot.rbdlm", &model);
+ * \endcode
+ *
+ * The file consists of a fixed size header that is followed by an array
+ * of fixed size records for the movable bodies (including the root body),
+ * an array of fixed size records for the fixed bodies, and a table with
+ * the body and joint names. All values are stored in the byte order of the writing
+ * machine and all records are aligned to 8 bytes such that the records
+ * are read directly from the memory mapped file. The model is then built
+ * with Model::BeginBulkConstruction() and Model::AddBody().
+ *
+ * The stored bodies are the bodies of the built model, i.e. multi-DoF
+ * joints are stored as their emulated single DoF joints, and fixed bodies
+ * are stored merged into their movable parents as well as as separate
+ * fixed bodies. The loaded model therefore has the same body ids, q
+ * indices, body names, and joint names (see Model::SetJointName()) as the
+ * stored model.
+ *
+ * Models with custom joints cannot be stored.
+ */
+
+/// \brief Version of the compiled model format that is written.
+const unsigned int CompiledModelVersion = 2;
+
+/** \brief Stores a model in the compiled model format.
+ *
+ * \param model the model that should be stored
+ * \param buffer receives the contents of the compiled model
+ * \param verbose if true, additional information is printed
+ *
+ * \returns true on success, false if the model cannot be stored
+ */
+RBDL_DLLAPI
+bool CompiledModelWriteToBuffer (
+    const Model &model,
+    std::vector<char> &buffer,
+    bool verbose = false);
+
+/** \brief Stores a model in a file in the compiled model format.
+ *
+ * \param model the model that should be stored
+ * \param filename the name of the file that is created
+ * \param verbose if true, additional information is printed
+ *
+ * \returns true on success, false if the model or the file cannot be
+ * written
+ */
+RBDL_DLLAPI
+bool CompiledModelWriteToFile (
+    const Model &model,
+    const char *filename,
+    bool verbose = false);
+
+/** \brief Builds a model from a compiled model in memory.
+ *
+ * \param data pointer to the compiled model
+ * \param size size of the compiled model in bytes
+ * \param model an empty model that receives the bodies
+ * \param verbose if true, additional information is printed
+ *
+ * \returns true on success, false if the data is not a valid compiled
+ * model of a supported version
+ */
+RBDL_DLLAPI
+bool CompiledModelReadFromMemory (
+    const void *data,
+    size_t size,
+    Model *model,
+    bool verbose = false);
+
+/** \brief Builds a model from a compiled model file.
+ *
+ * On POSIX systems the file is mapped into memory, otherwise it is read
+ * with a single call.
+ *
+ * \param filename the name of the compiled model file
+ * \param model an empty model that receives the bodies
+ * \param verbose if true, additional information is printed
+ *
+ * \returns true on success, false if the file cannot be read or is not a
+ * valid compiled model of a supported version
+ */
+RBDL_DLLAPI
+bool CompiledModelReadFromFile (
+    const char *filename,
+    Model *model,
+    bool verbose = false);
+
+}
+
+/* RBDL_COMPILED_MODEL_H */
+#endif
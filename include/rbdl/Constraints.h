@@ -10,6 +10,7 @@
 
 #include <rbdl/rbdl_math.h>
 #include <rbdl/rbdl_mathutils.h>
+#include <rbdl/NameIndex.h>
 
 namespace RigidBodyDynamics {
 
@@ -119,7 +120,11 @@ namespace RigidBodyDynamics {
  * RBDL provides methods for all approaches. The implementation for the
  * range-space method also exploits sparsities in the joint space inertia
  * matrix using a sparse structure preserving \f$L^TL\f$ decomposition as
- * described in Chapter 8.5 of "Rigid Body Dynamics Algorithms".
+ * described in Chapter 8.5 of "Rigid Body Dynamics Algorithms". In
+ * addition it only operates on the structurally nonzero entries of the
+ * constraint Jacobian (see ConstraintSet::mGColumnIndices), i.e. a
+ * constraint on a foot does not cost anything for the degrees of freedom
+ * of the arms.
  *
  * None of the methods is generally superior to the others and each has
  * different trade-offs as factors such as model topology, number of
@@ -145,6 +150,13 @@ namespace RigidBodyDynamics {
  * - ComputeConstraintImpulsesRangeSpaceSparse()
  * - ComputeConstraintImpulsesNullSpace()
  *
+ * \subsection solving_constraints_inverse_dynamics Constrained Inverse
+ * Dynamics
+ *
+ * For systems with unactuated degrees of freedom such as floating-base
+ * robots in contact InverseDynamicsConstraints() computes the actuation
+ * and the constraint forces for desired accelerations.
+ *
  * \subsection assembly_q_qdot Computing generalized joint positions and velocities
  * satisfying the constraint equations.
  *
@@ -254,6 +266,45 @@ struct Model;
 
 struct RBDL_DLLAPI CustomConstraint;
 
+#ifndef RBDL_USE_SIMPLE_MATH
+/** \brief Preallocated decomposition of a square linear system.
+ *
+ * Holds the decomposition of the selected Math::LinearSolver. Once
+ * allocated, computing and solving systems of the allocated size does not
+ * allocate memory.
+ */
+struct RBDL_DLLAPI LinearSystemDecomposition {
+  LinearSystemDecomposition() :
+    solver (Math::LinearSolverUnknown)
+  {}
+
+  /// Allocates the decomposition of the given solver for n x n systems.
+  void Allocate (unsigned int n, Math::LinearSolver linear_solver);
+  /// Releases the memory of the decomposition.
+  void Release ();
+  /** \brief Decomposes the system matrix A.
+   *
+   * The decomposition is only reallocated if linear_solver differs from
+   * the allocated one.
+   */
+  void Compute (
+    const Eigen::Ref<const Math::MatrixNd> &A,
+    Math::LinearSolver linear_solver
+  );
+  /// Solves the decomposed system in place, x contains the right-hand side.
+  void SolveInPlace (Eigen::Ref<Math::VectorNd> x);
+  /// Returns the memory used by the decomposition in bytes.
+  size_t GetMemorySize () const;
+
+  Math::LinearSolver solver;
+  Eigen::PartialPivLU<Math::MatrixNd> lu;
+  Eigen::HouseholderQR<Math::MatrixNd> qr;
+  Eigen::ColPivHouseholderQR<Math::MatrixNd> colpiv_qr;
+  /// Workspace for the permutations of the solution.
+  Math::VectorNd workspace;
+};
+#endif
+
 /** \brief Structure that contains both constraint information and workspace memory.
  *
  * This structure is used to reduce the amount of memory allocations that
@@ -266,7 +317,15 @@ struct RBDL_DLLAPI CustomConstraint;
 struct RBDL_DLLAPI ConstraintSet {
   ConstraintSet() :
     linear_solver (Math::LinearSolverColPivHouseholderQR),
-    bound (false) {}
+    bound (false),
+    allocated_solvers (0) {
+#ifndef RBDL_USE_SIMPLE_MATH
+      // A default constructed LLT leaves its status uninitialized, which
+      // copies of the ConstraintSet would read.
+      ZHZ_llt.compute (Math::MatrixNd::Identity (1, 1));
+      K_llt.compute (Math::MatrixNd::Identity (1, 1));
+#endif
+    }
 
   // Enum to describe the type of a constraint.
   enum ConstraintType {
@@ -276,6 +335,28 @@ struct RBDL_DLLAPI ConstraintSet {
     ConstraintTypeLast,
   };
 
+  /** \brief Flags to select the solvers whose workspaces get allocated.
+   *
+   * The flags can be combined and are used by ConstraintSet::Bind() and
+   * ConstraintSet::GetWorkspaceSize().
+   */
+  enum SolverFlags {
+    /// ForwardDynamicsConstraintsDirect(), ComputeConstraintImpulsesDirect()
+    SolverDirect = 1 << 0,
+    /// ForwardDynamicsConstraintsRangeSpaceSparse(),
+    /// ComputeConstraintImpulsesRangeSpaceSparse()
+    SolverRangeSpaceSparse = 1 << 1,
+    /// ForwardDynamicsConstraintsNullSpace(),
+    /// ComputeConstraintImpulsesNullSpace()
+    SolverNullSpace = 1 << 2,
+    /// ForwardDynamicsContactsKokkevis()
+    SolverKokkevis = 1 << 3,
+    /// InverseDynamicsConstraints()
+    SolverInverseDynamics = 1 << 4,
+    SolverAll = SolverDirect | SolverRangeSpaceSparse | SolverNullSpace
+      | SolverKokkevis | SolverInverseDynamics
+  };
+
   /** \brief Adds a contact constraint to the constraint set.
    *
    * This type of constraints ensures that the velocity and acceleration of a specified
@@ -392,14 +473,94 @@ struct RBDL_DLLAPI ConstraintSet {
    * The values of ConstraintSet::acceleration may still be
    * modified after the set is bound to the model.
    *
+   * By default the workspaces of all solvers are allocated. If only some
+   * of the solvers are used, the memory of a bound set can be reduced
+   * by specifying them in solvers. The workspace of any other solver
+   * gets allocated on its first use.
+   *
+   * \param model the model the constraint set is used with
+   * \param solvers combination of ConstraintSet::SolverFlags whose
+   * workspaces should be allocated (default: SolverAll)
    */
-  bool Bind (const Model &model);
+  bool Bind (const Model &model, unsigned int solvers = SolverAll);
+
+  /** \brief Allocates the workspaces of the given solvers unless they
+   * already are.
+   *
+   * This is called by the solvers themselves and only needs to be called
+   * explicitly to avoid the allocation during the first call of a solver
+   * that was not specified in ConstraintSet::Bind().
+   *
+   * \param model the model the constraint set is bound to
+   * \param solvers combination of ConstraintSet::SolverFlags
+   */
+  void AllocateSolverWorkspace (const Model &model, unsigned int solvers);
+
+  /** \brief Returns the memory in bytes that is currently allocated for
+   * the workspaces of the given solvers.
+   *
+   * Workspaces that are shared between the given solvers are only counted
+   * once. The workspaces common to all solvers (e.g. ConstraintSet::H and
+   * ConstraintSet::G) are not included.
+   *
+   * \param solvers combination of ConstraintSet::SolverFlags
+   */
+  size_t GetWorkspaceSize (unsigned int solvers) const;
 
   /** \brief Returns the number of constraints. */
   size_t size() const {
     return acceleration.size();
   }
 
+  /** \brief Enables or disables a single constraint of a bound set.
+   *
+   * Inactive constraints are ignored by the constrained dynamics and
+   * impulse functions and their entries in ConstraintSet::force and
+   * ConstraintSet::impulse are set to zero. This allows to switch between
+   * contact modes (e.g. during gait) without having to rebuild and rebind
+   * the constraint set: the solvers move the rows of the active
+   * constraints to the top of the already allocated workspaces.
+   *
+   * \note When at least one constraint is inactive the first rows of
+   * ConstraintSet::G and ConstraintSet::gamma contain the compacted rows of
+   * the active constraints (in ascending order) after calling one of the
+   * solvers. The remaining rows are set to zero.
+   *
+   * \note Constraints of a CustomConstraint occupy one row each and have
+   * to be enabled or disabled individually.
+   *
+   * \param constraint_id the index of the constraint (as returned by e.g.
+   * ConstraintSet::AddContactConstraint())
+   * \param is_active whether the constraint should be enforced
+   */
+  void SetActive (unsigned int constraint_id, bool is_active);
+
+  /** \brief Returns whether the given constraint is currently enforced. */
+  bool IsActive (unsigned int constraint_id) const {
+    return active[constraint_id];
+  }
+
+  /** \brief Returns the id of the constraint with the given name.
+   *
+   * If several constraints have the same name the first one is returned.
+   *
+   * \returns the id or \c std::numeric_limits\<unsigned int\>::max() if
+   * no constraint has this name.
+   */
+  unsigned int GetConstraintId (const char *constraint_name) const {
+    return mNameIndex.Find (constraint_name);
+  }
+
+  /** \brief Returns the name of the constraint with the given id. */
+  const std::string& GetConstraintName (unsigned int constraint_id) const {
+    return name[constraint_id];
+  }
+
+  /** \brief Returns the number of currently enforced constraints. */
+  size_t GetActiveCount () const {
+    return mActiveConstraintIndices.size();
+  }
+
   /** \brief Clears all variables in the constraint set. */
   void clear ();
 
@@ -407,10 +568,19 @@ struct RBDL_DLLAPI ConstraintSet {
   Math::LinearSolver linear_solver;
   /// Whether the constraint set was bound to a model (mandatory!).
   bool bound;
+  /// Solvers whose workspaces are allocated (see ConstraintSet::SolverFlags).
+  unsigned int allocated_solvers;
 
   // Common constraints variables.
   std::vector<ConstraintType> constraintType;
   std::vector<std::string> name;
+  /// Hashed index of the non-empty names (see
+  /// ConstraintSet::GetConstraintId()).
+  NameIndex mNameIndex;
+  /// Whether the constraint is enforced (see ConstraintSet::SetActive()).
+  std::vector<bool> active;
+  /// Indices of all active constraints in ascending order.
+  std::vector<unsigned int> mActiveConstraintIndices;
   std::vector<unsigned int> mContactConstraintIndices;
   std::vector<unsigned int> mLoopConstraintIndices;
   std::vector<unsigned int> mCustomConstraintIndices;
@@ -453,6 +623,18 @@ struct RBDL_DLLAPI ConstraintSet {
   /// Workspace of the lower part of b.
   Math::VectorNd gamma;
   Math::MatrixNd G;
+  /** \brief Column indices of the structurally nonzero entries of the
+   * rows of G.
+   *
+   * The (sorted) indices of row i are stored in
+   * mGColumnIndices[mGRowOffsets[i]] ... mGColumnIndices[mGRowOffsets[i+1]-1].
+   * A contact or loop constraint row can only be nonzero on the degrees of
+   * freedom that move its bodies, which is exploited by the range-space
+   * solvers. The pattern is computed by ConstraintSet::Bind().
+   */
+  std::vector<unsigned int> mGColumnIndices;
+  /// Offsets of the rows of G into ConstraintSet::mGColumnIndices.
+  std::vector<unsigned int> mGRowOffsets;
   /// Workspace for the Lagrangian left-hand-side matrix.
   Math::MatrixNd A;
   /// Workspace for the Lagrangian right-hand-side.
@@ -482,6 +664,28 @@ struct RBDL_DLLAPI ConstraintSet {
   Math::VectorNd qddot_y;
   Math::VectorNd qddot_z;
 
+#ifndef RBDL_USE_SIMPLE_MATH
+  /** \brief Decomposition of the Lagrangian system of the direct method
+   * when constraints are inactive.
+   *
+   * The rows of inactive constraints are replaced by identity rows such
+   * that the system keeps the size of the full set and gets decomposed
+   * without allocating memory. The same holds for the other decompositions
+   * below.
+   */
+  LinearSystemDecomposition A_decomposition;
+  /// Decomposition of G Y of the null-space method.
+  LinearSystemDecomposition GY_decomposition;
+  /// Workspace for H Z of the null-space method.
+  Math::MatrixNd HZ;
+  /// Workspace for Z^T H Z of the null-space method.
+  Math::MatrixNd ZHZ;
+  /// Cholesky decomposition of ConstraintSet::ZHZ.
+  Eigen::LLT<Math::MatrixNd> ZHZ_llt;
+  /// Cholesky decomposition of ConstraintSet::K.
+  Eigen::LLT<Math::MatrixNd> K_llt;
+#endif
+
   // Variables used by the IABI methods
 
   /// Workspace for the Inverse Articulated-Body Inertia.
@@ -514,6 +718,30 @@ struct RBDL_DLLAPI ConstraintSet {
 
   std::vector<Math::Vector3d> d_multdof3_u;
 
+  // Variables used by InverseDynamicsConstraints()
+
+  /// Unactuated degrees of freedom.
+  std::vector<unsigned int> id_unactuated;
+  /// Pivot order of the Cholesky factorization of id_W.
+  std::vector<unsigned int> id_W_perm;
+  /// Pivot order of the Cholesky factorization of id_M.
+  std::vector<unsigned int> id_M_perm;
+  /// Workspace for Gu^T Gu of the columns Gu of G of the unactuated
+  /// degrees of freedom.
+  Math::MatrixNd id_W;
+  /// Workspace for a basis of the null space of Gu.
+  Math::MatrixNd id_V;
+  /// Workspace for the conditions on the accelerations.
+  Math::MatrixNd id_A;
+  /// Workspace for id_A id_A^T.
+  Math::MatrixNd id_M;
+  /// Workspace for right-hand sides.
+  Math::VectorNd id_b;
+  /// Workspace for solutions.
+  Math::VectorNd id_x;
+  /// Workspace for intermediate solutions.
+  Math::VectorNd id_y;
+
   //CustomConstraint variables.
 
   
@@ -897,6 +1125,62 @@ void ComputeConstraintImpulsesNullSpace (
   Math::VectorNd &QDotPlus
 );
 
+/** \brief Computes the generalized forces of the actuated degrees of
+ * freedom such that a constrained (e.g. floating-base) system follows
+ * desired accelerations.
+ *
+ * The equations of motion
+ * \f[ H \ddot{q} + C = S^T \tau + G^T \lambda \f]
+ * are split into the rows of the unactuated degrees of freedom
+ * \f$H_u \ddot{q} + C_u = G_u^T \lambda\f$, which are free of
+ * \f$\tau\f$, and the rows of the actuated ones. For a floating base
+ * \f$G_u^T\f$ only has six rows. The constraint forces with the smallest
+ * norm are solved from this small system and the actuation then directly
+ * follows from the actuated rows.
+ *
+ * Before that, the desired accelerations \f$\ddot{q}_d\f$ are changed by
+ * the smallest amount that makes them satisfy the constraints
+ * \f$G \ddot{q} = \gamma\f$. If \f$G_u^T\f$ does not have full row rank
+ * (e.g. the floating base of a robot in flight or with a single point
+ * contact) the accelerations are additionally changed such that the
+ * unactuated rows can be satisfied. The resulting accelerations are
+ * returned in QDDotOutput and are equal to QDDotDesired whenever
+ * QDDotDesired is consistent with the constraints and the actuation.
+ *
+ * All intermediate results are stored in the workspaces of the
+ * ConstraintSet such that repeated calls do not allocate memory.
+ *
+ * \note The constraint forces are stored in ConstraintSet::force and
+ * follow the sign convention above.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param QDDotDesired desired accelerations of the internal joints
+ * \param CS    the description of all acting constraints
+ * \param QDDotOutput accelerations of the internal joints (output)
+ * \param TauOutput generalized forces, zero for all unactuated degrees of
+ * freedom (output)
+ * \param actuated_dofs flags for each degree of freedom whether it is
+ * actuated. If NULL all degrees of freedom are actuated except those of
+ * joints with six degrees of freedom that attach a body to the base, i.e.
+ * floating bases (emulated by virtual bodies or native).
+ * \param f_ext External forces acting on the body in base coordinates
+ *        (optional, defaults to NULL)
+ */
+RBDL_DLLAPI
+void InverseDynamicsConstraints (
+  Model &model,
+  const Math::VectorNd &Q,
+  const Math::VectorNd &QDot,
+  const Math::VectorNd &QDDotDesired,
+  ConstraintSet &CS,
+  Math::VectorNd &QDDotOutput,
+  Math::VectorNd &TauOutput,
+  const std::vector<bool> *actuated_dofs = NULL,
+  std::vector<Math::SpatialVector> *f_ext = NULL
+);
+
 /** \brief Solves the full contact system directly, i.e. simultaneously for 
  *  contact forces and joint accelerations.
  *
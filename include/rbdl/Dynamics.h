@@ -29,6 +29,40 @@ struct Model;
  * @{
  */
 
+/** \brief External spatial force that acts on a single body.
+ *
+ * Used by the overloads of InverseDynamics(), NonlinearEffects() and
+ * ForwardDynamics() that only take the forces of the bodies that are
+ * actually loaded, e.g. by contacts.
+ *
+ * The force is either expressed in base coordinates, as the dense
+ * external forces of the other overloads, or in the coordinates of the
+ * body, i.e. acting at the body origin. body_id can also be the id of a
+ * fixed body.
+ */
+struct RBDL_DLLAPI ExternalForce {
+  ExternalForce () :
+    body_id (0),
+    force (Math::SpatialVector::Zero()),
+    in_body_coordinates (false)
+  {}
+  ExternalForce (
+      unsigned int body_id,
+      const Math::SpatialVector &force,
+      bool in_body_coordinates = false) :
+    body_id (body_id),
+    force (force),
+    in_body_coordinates (in_body_coordinates)
+  {}
+
+  /// \brief Id of the body the force acts on.
+  unsigned int body_id;
+  /// \brief Spatial force (torque, force).
+  Math::SpatialVector force;
+  /// \brief Whether force is given in body instead of base coordinates.
+  bool in_body_coordinates;
+};
+
 /** \brief Computes inverse dynamics with the Newton-Euler Algorithm
  *
  * This function computes the generalized forces from given generalized
@@ -51,6 +85,68 @@ RBDL_DLLAPI void InverseDynamics (
     std::vector<Math::SpatialVector> *f_ext = NULL
     );
 
+/** \brief Computes inverse dynamics with sparse external forces
+ *
+ * Same as InverseDynamics() but only takes the external forces of the
+ * bodies that are loaded. Each force is transformed directly into the
+ * body frame, without building the full \f$6 \times 6\f$ force
+ * transformations of all bodies.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param QDDot accelerations of the internals joints
+ * \param Tau   actuations of the internal joints (output)
+ * \param f_ext External forces acting on single bodies
+ */
+RBDL_DLLAPI void InverseDynamics (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &QDDot,
+    Math::VectorNd &Tau,
+    const std::vector<ExternalForce> &f_ext
+    );
+
+/** \brief Recomputes inverse dynamics after a subset of joints changed
+ *
+ * Same as InverseDynamics() but assumes that the model state and Tau have
+ * been computed by InverseDynamics() (or this function) for values that
+ * only differ in the joints of the bodies given in changed_body_ids. The
+ * joint of body i connects it with its parent Model::lambda[i].
+ *
+ * Only the velocities and accelerations of the bodies in the subtrees of
+ * the changed joints and the forces and generalized forces of these
+ * bodies and their ancestors are recomputed. All other entries of Tau are
+ * left untouched.
+ *
+ * \note The values of the previous evaluation are read from the model:
+ * Model::X_lambda, Model::v_J, Model::c_J, Model::S (or
+ * Model::multdof3_S), Model::v, Model::c, Model::a, Model::f and, if
+ * f_ext is given, Model::X_base. None of them may be modified between the
+ * calls, e.g. by any other algorithm evaluated on the same model for a
+ * different state.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param QDDot accelerations of the internals joints
+ * \param Tau   actuations of the internal joints (output)
+ * \param changed_body_ids ids of the bodies whose joint values changed
+ * \param f_ext External forces acting on the body in base coordinates
+ * (optional, defaults to NULL). They have to be the same as for the
+ * previous evaluation.
+ */
+RBDL_DLLAPI void InverseDynamicsIncremental (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &QDDot,
+    Math::VectorNd &Tau,
+    const std::vector<unsigned int> &changed_body_ids,
+    std::vector<Math::SpatialVector> *f_ext = NULL
+    );
+
 /** \brief Computes the coriolis forces
  *
  * This function computes the generalized forces from given generalized
@@ -71,6 +167,76 @@ RBDL_DLLAPI void NonlinearEffects (
     std::vector<Math::SpatialVector> *f_ext = NULL
     );
 
+/** \brief Computes the coriolis forces with sparse external forces
+ *
+ * Same as NonlinearEffects() but only takes the external forces of the
+ * bodies that are loaded, see ExternalForce.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param Tau   actuations of the internal joints (output)
+ * \param f_ext External forces acting on single bodies
+ */
+RBDL_DLLAPI void NonlinearEffects (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    Math::VectorNd &Tau,
+    const std::vector<ExternalForce> &f_ext
+    );
+
+/** \brief Computes the generalized forces due to gravity
+ *
+ * This function computes the gravity term \f$ G(q) \f$ of the equations
+ * of motion, i.e. the result of NonlinearEffects() for \f$\dot{q} = 0\f$
+ * and without external forces. It only needs the positions of the bodies
+ * and therefore skips all velocity dependent computations.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param Tau   generalized forces due to gravity (output)
+ * \param update_kinematics whether the kinematics should be updated. If
+ * false the transformations from the last evaluation of the positions are
+ * used.
+ */
+RBDL_DLLAPI void CalcGravityTorques (
+    Model &model,
+    const Math::VectorNd &Q,
+    Math::VectorNd &Tau,
+    bool update_kinematics = true
+    );
+
+/** \brief Computes the Coriolis matrix \f$ C(q, \dot{q}) \f$
+ *
+ * The matrix fulfills \f$ C(q, \dot{q}) \dot{q} = N(q, \dot{q}) -
+ * G(q) \f$, i.e. it contains the Coriolis and centrifugal effects of
+ * NonlinearEffects(). It is computed with a recursive algorithm in
+ * \f$O(n_{dof} d)\f$, \f$d\f$ being the depth of the tree, without
+ * evaluating the inverse dynamics per column.
+ *
+ * For joints with a constant motion subspace (all 1-DoF joints, spherical
+ * and translational joints) the matrix \f$ \dot{H} - 2 C \f$ is
+ * skew-symmetric, as needed by passivity-based controllers. For joints
+ * whose motion subspace depends on the joint position (e.g. Euler angle
+ * joints) only the product with \f$\dot{q}\f$ is exact.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param C     a \f$n_{dof} \times n_{dof}\f$ matrix where the result will
+ * be stored in
+ * \param update_kinematics whether the kinematics should be updated (safer,
+ * but at a higher computational cost!)
+ */
+RBDL_DLLAPI void CalcCoriolisMatrix (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    Math::MatrixNd &C,
+    bool update_kinematics = true
+    );
+
 /** \brief Computes the joint space inertia matrix by using the Composite Rigid Body Algorithm
  *
  * This function computes the joint space inertia matrix from a given model and
@@ -93,6 +259,33 @@ RBDL_DLLAPI void CompositeRigidBodyAlgorithm (
     bool update_kinematics = true
     );
 
+/** \brief Recomputes the joint space inertia matrix after a subset of
+ * joints changed
+ *
+ * Same as CompositeRigidBodyAlgorithm() but assumes that H and the
+ * composite inertias Model::Ic have been computed before for a state that
+ * only differs in the joints of the bodies given in changed_body_ids.
+ *
+ * Only the composite inertias of the changed bodies and their ancestors
+ * and the entries of H that couple the joints of the ancestors and of the
+ * subtrees of the changed joints are recomputed.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the model
+ * \param H     the previously computed joint space inertia matrix that
+ * gets updated
+ * \param changed_body_ids ids of the bodies whose joint values changed
+ * \param update_kinematics  whether the transformations of the changed
+ * joints should be updated
+ */
+RBDL_DLLAPI void CompositeRigidBodyAlgorithmIncremental (
+    Model& model,
+    const Math::VectorNd &Q,
+    Math::MatrixNd &H,
+    const std::vector<unsigned int> &changed_body_ids,
+    bool update_kinematics = true
+    );
+
 /** \brief Computes forward dynamics with the Articulated Body Algorithm
  *
  * This function computes the generalized accelerations from given
@@ -117,6 +310,63 @@ RBDL_DLLAPI void ForwardDynamics (
     std::vector<Math::SpatialVector> *f_ext = NULL
     );
 
+/** \brief Computes forward dynamics with sparse external forces
+ *
+ * Same as ForwardDynamics() but only takes the external forces of the
+ * bodies that are loaded, see ExternalForce.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param Tau   actuations of the internal joints
+ * \param QDDot accelerations of the internal joints (output)
+ * \param f_ext External forces acting on single bodies
+ */
+RBDL_DLLAPI void ForwardDynamics (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &Tau,
+    Math::VectorNd &QDDot,
+    const std::vector<ExternalForce> &f_ext
+    );
+
+/** \brief Computes hybrid dynamics with a single Articulated Body
+ * Algorithm sweep
+ *
+ * For every degree of freedom either the acceleration (prescribed motion)
+ * or the generalized force (torque-driven) is given and the respective
+ * other quantity is computed. Prescribed joints are treated as in the
+ * Recursive Newton-Euler Algorithm and torque-driven joints as in the
+ * Articulated Body Algorithm, which yields the solution in
+ * \f$O(n_{dof})\f$. It is equivalent to solving
+ * \f[ H \ddot{q} + C = \tau \f]
+ * for the unknown entries of \f$\ddot{q}\f$ and \f$\tau\f$.
+ *
+ * \note All degrees of freedom of a multi-DoF joint have to be either
+ * prescribed or torque-driven.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param QDDot accelerations of the internal joints: input for the
+ * prescribed degrees of freedom, output for all others
+ * \param Tau   actuations of the internal joints: input for the
+ * torque-driven degrees of freedom, output for all others
+ * \param qddot_known for each degree of freedom whether its acceleration
+ * is prescribed
+ * \param f_ext External forces acting on the body in base coordinates (optional, defaults to NULL)
+ */
+RBDL_DLLAPI void HybridDynamics (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    Math::VectorNd &QDDot,
+    Math::VectorNd &Tau,
+    const std::vector<bool> &qddot_known,
+    std::vector<Math::SpatialVector> *f_ext = NULL
+    );
+
 /** \brief Computes forward dynamics by building and solving the full Lagrangian equation
  *
  * This method builds and solves the linear system
@@ -176,6 +426,184 @@ RBDL_DLLAPI void CalcMInvTimesTau (
     bool update_kinematics=true
     );
 
+/** \brief Computes the product of the inverse of the joint space inertia
+ * matrix with a matrix in linear time.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the generalized positions
+ * \param B     \f$n_{\textit{dof}} \times k\f$ matrix that should be
+ *              multiplied with the inverse of the joint space inertia matrix
+ * \param X     \f$n_{\textit{dof}} \times k\f$ matrix where the result will
+ *              be stored
+ * \param update_kinematics whether the kinematics should be updated (safer, but at a higher computational cost)
+ *
+ * This is the multi right-hand-side variant of CalcMInvTimesTau() that
+ * computes
+ *
+ *   \f$ X = M(q)^{-1} B \f$
+ *
+ * e.g. for \f$ B = J^T \f$. The articulated body inertias are computed
+ * once and all columns are propagated together as \f$6 \times k\f$
+ * blocks instead of running one sweep per column. The blocks are kept in
+ * Model::pA_cols and Model::u_cols and only reallocated when k changes.
+ */
+RBDL_DLLAPI void CalcMInvTimesMatrix (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::MatrixNd &B,
+    Math::MatrixNd &X,
+    bool update_kinematics=true
+    );
+
+/** \brief Computes the inverse of the operational space inertia matrix
+ * for a set of task frames.
+ *
+ * For the stacked 6-D point Jacobians \f$J\f$ of the given points (see
+ * CalcPointJacobian6D()) this function computes
+ *
+ *   \f$ \Lambda^{-1} = J H^{-1} J^T \f$
+ *
+ * without forming \f$H\f$ or \f$J\f$. It uses the extended force
+ * propagators of the Articulated %Body Algorithm and runs in
+ * \f$O(n_{\textit{dof}} + m \cdot d + m^2)\f$ for \f$m\f$ task
+ * frames in a tree of depth \f$d\f$. Blocks of two frames only depend on
+ * the inverse apparent inertia of the deepest common ancestor of their
+ * bodies.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the generalized positions
+ * \param body_ids the bodies of the task frames
+ * \param body_points the origins of the task frames in body coordinates
+ * \param LambdaInv a 6m x 6m matrix where the result will be stored in.
+ *              Block (s,t) maps a spatial force (torque, force) acting at
+ *              frame t to the spatial acceleration (angular, linear) of
+ *              frame s. The frames are aligned with the base frame. For
+ *              position-only tasks use the lower right 3x3 blocks.
+ * \param update_kinematics whether the kinematics and articulated body
+ *              inertias should be updated. If false they have to be up to
+ *              date, e.g. from a previous call of ForwardDynamics() for
+ *              the same Q.
+ */
+RBDL_DLLAPI void CalcOperationalSpaceInertiaInverse (
+    Model &model,
+    const Math::VectorNd &Q,
+    const std::vector<unsigned int> &body_ids,
+    const std::vector<Math::Vector3d> &body_points,
+    Math::MatrixNd &LambdaInv,
+    bool update_kinematics=true
+    );
+
+/** \brief Computes the inverse dynamics regressor
+ *
+ * The generalized forces of the inverse dynamics are linear in the
+ * inertial parameters of the bodies:
+ *   \f$ \tau = Y(q, \dot{q}, \ddot{q}) \phi \f$
+ * where \f$\phi\f$ contains the 10 parameters
+ *   \f$ [m, h_x, h_y, h_z, I_{xx}, I_{xy}, I_{xz}, I_{yy}, I_{yz}, I_{zz}] \f$
+ * of each entry of Model::mBodies (except the root body) in the order of
+ * the body ids. \f$h = m c\f$ is the first moment of mass and the
+ * rotational inertia is expressed at the origin of the body frame, i.e.
+ * the values of SpatialRigidBodyInertia of Model::I. Parameters of fixed
+ * bodies are part of the parameters of their movable parent.
+ *
+ * The regressor is computed in a single pass of the Recursive
+ * Newton-Euler Algorithm. External forces are not considered.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param QDDot accelerations of the internal joints
+ * \param Y     a \f$n_{dof} \times 10 (n_{bodies} - 1)\f$ matrix where the
+ * result will be stored in
+ */
+RBDL_DLLAPI void CalcInverseDynamicsRegressor (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &QDDot,
+    Math::MatrixNd &Y
+    );
+
+/** \brief Computes the stacked inverse dynamics regressor of a trajectory
+ *
+ * The regressor of sample \f$s\f$ (see CalcInverseDynamicsRegressor()) is
+ * stored in the rows \f$s n_{dof}, \ldots, (s + 1) n_{dof} - 1\f$ of Y
+ * such that \f$ Y \phi \f$ yields the stacked generalized forces of all
+ * samples.
+ *
+ * \param model rigid body model
+ * \param Q     state vectors of the samples
+ * \param QDot  velocity vectors of the samples
+ * \param QDDot acceleration vectors of the samples
+ * \param Y     a \f$n_{samples} n_{dof} \times 10 (n_{bodies} - 1)\f$
+ * matrix where the result will be stored in
+ */
+RBDL_DLLAPI void CalcInverseDynamicsRegressorBatch (
+    Model &model,
+    const std::vector<Math::VectorNd> &Q,
+    const std::vector<Math::VectorNd> &QDot,
+    const std::vector<Math::VectorNd> &QDDot,
+    Math::MatrixNd &Y
+    );
+
+/** \brief Computes inverse dynamics for multiple sets of inertial
+ * parameters
+ *
+ * All variants share the topology and joint transformations of the model
+ * so that the kinematic quantities (joint transformations, velocities and
+ * accelerations of the bodies) are only computed once. The per-variant
+ * data consists only of the spatial inertias of the bodies.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param QDDot accelerations of the internal joints
+ * \param inertias for each variant the spatial inertias of all bodies in
+ * the same layout as Model::I
+ * \param Tau   a \f$n_{dof} \times n_{variants}\f$ matrix where column k
+ * holds the generalized forces of variant k (output)
+ * \param f_ext External forces acting on the body in base coordinates
+ * (optional, defaults to NULL)
+ */
+RBDL_DLLAPI void InverseDynamicsBatch (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &QDDot,
+    const std::vector<std::vector<Math::SpatialRigidBodyInertia> > &inertias,
+    Math::MatrixNd &Tau,
+    std::vector<Math::SpatialVector> *f_ext = NULL
+    );
+
+/** \brief Computes forward dynamics for multiple sets of inertial
+ * parameters
+ *
+ * Same as ForwardDynamics() for each entry of inertias. The joint
+ * transformations, velocities and velocity-product accelerations are
+ * computed once and shared by all variants, only the articulated body
+ * passes are evaluated per variant. Model::I is not modified.
+ *
+ * \param model rigid body model
+ * \param Q     state vector of the internal joints
+ * \param QDot  velocity vector of the internal joints
+ * \param Tau   actuations of the internal joints
+ * \param inertias for each variant the spatial inertias of all bodies in
+ * the same layout as Model::I
+ * \param QDDot a \f$n_{dof} \times n_{variants}\f$ matrix where column k
+ * holds the accelerations of variant k (output)
+ * \param f_ext External forces acting on the body in base coordinates
+ * (optional, defaults to NULL)
+ */
+RBDL_DLLAPI void ForwardDynamicsBatch (
+    Model &model,
+    const Math::VectorNd &Q,
+    const Math::VectorNd &QDot,
+    const Math::VectorNd &Tau,
+    const std::vector<std::vector<Math::SpatialRigidBodyInertia> > &inertias,
+    Math::MatrixNd &QDDot,
+    std::vector<Math::SpatialVector> *f_ext = NULL
+    );
+
 /** @} */
 
 }
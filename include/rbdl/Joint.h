@@ -11,6 +11,7 @@
 #include "rbdl/rbdl_math.h"
 #include <assert.h>
 #include <iostream>
+#include <vector>
 #include "rbdl/Logging.h"
 
 namespace RigidBodyDynamics {
@@ -35,7 +36,11 @@ struct Model;
  * simplifies the required algebra and also code branching in RBDL. A
  * special case are joints with three degrees of freedom for which specific
  * joints are available that should be used for performance reasons
- * whenever possible. See \ref joint_three_dof for details.
+ * whenever possible. See \ref joint_three_dof for details. Arbitrary
+ * multi degree of freedom joints can also be added as a single body with
+ * the MultiDofJoint custom joint, which avoids the virtual bodies of the
+ * emulation. Model::AddBody() does this itself if
+ * Model::mNativeMultiDofJoints is set.
  *
  * Joints are defined by their motion subspace. For each degree of freedom
  * a one dimensional motion subspace is specified as a Math::SpatialVector.
@@ -209,11 +214,13 @@ struct Model;
 struct RBDL_DLLAPI Joint {
   Joint() :
     mJointAxes (NULL),
+    mJointAxesMapped (false),
     mJointType (JointTypeUndefined),
     mDoFCount (0),
     q_index (0) {};
   Joint (JointType type) :
     mJointAxes (NULL),
+    mJointAxesMapped (false),
     mJointType (type),
     mDoFCount (0),
     q_index (0),
@@ -292,6 +299,7 @@ struct RBDL_DLLAPI Joint {
     }
     Joint (JointType type, int degreesOfFreedom) :
       mJointAxes (NULL),
+      mJointAxesMapped (false),
       mJointType (type),
       mDoFCount (0),
       q_index (0),
@@ -312,10 +320,16 @@ struct RBDL_DLLAPI Joint {
       }
     }  
   Joint (const Joint &joint) :
+    mJointAxesMapped (joint.mJointAxesMapped),
     mJointType (joint.mJointType),
     mDoFCount (joint.mDoFCount),
     q_index (joint.q_index),
     custom_joint_index(joint.custom_joint_index) {
+      if (mJointAxesMapped) {
+        mJointAxes = joint.mJointAxes;
+        return;
+      }
+
       mJointAxes = new Math::SpatialVector[mDoFCount];
 
       for (unsigned int i = 0; i < mDoFCount; i++)
@@ -323,17 +337,23 @@ struct RBDL_DLLAPI Joint {
     };
   Joint& operator= (const Joint &joint) {
     if (this != &joint) {
-      if (mDoFCount > 0) {
+      if (mDoFCount > 0 && !mJointAxesMapped) {
         assert (mJointAxes);
         delete[] mJointAxes;
       }
       mJointType = joint.mJointType;
       mDoFCount = joint.mDoFCount;
       custom_joint_index = joint.custom_joint_index;
-      mJointAxes = new Math::SpatialVector[mDoFCount];
+      mJointAxesMapped = joint.mJointAxesMapped;
 
-      for (unsigned int i = 0; i < mDoFCount; i++)
-        mJointAxes[i] = joint.mJointAxes[i];
+      if (mJointAxesMapped) {
+        mJointAxes = joint.mJointAxes;
+      } else {
+        mJointAxes = new Math::SpatialVector[mDoFCount];
+
+        for (unsigned int i = 0; i < mDoFCount; i++)
+          mJointAxes[i] = joint.mJointAxes[i];
+      }
 
       q_index = joint.q_index;
     }
@@ -342,13 +362,29 @@ struct RBDL_DLLAPI Joint {
   ~Joint() {
     if (mJointAxes) {
       assert (mJointAxes);
-      delete[] mJointAxes;
+      if (!mJointAxesMapped) {
+        delete[] mJointAxes;
+      }
       mJointAxes = NULL;
       mDoFCount = 0;
       custom_joint_index = -1;
     }
   }
 
+  /** \brief Uses the axes at axes instead of its own copy.
+   *
+   * The axes are used in place, e.g. from a read-only SharedModelData,
+   * and have to stay valid as long as the joint or any copy of it refers
+   * to them.
+   */
+  void MapJointAxes (const Math::SpatialVector *axes) {
+    if (mJointAxes && !mJointAxesMapped) {
+      delete[] mJointAxes;
+    }
+    mJointAxes = const_cast<Math::SpatialVector*>(axes);
+    mJointAxesMapped = true;
+  }
+
   /** \brief Constructs a joint from the given cartesian parameters.
    *
    * This constructor creates all the required spatial values for the given
@@ -362,6 +398,7 @@ struct RBDL_DLLAPI Joint {
       const Math::Vector3d &joint_axis
       ) {
     mDoFCount = 1;
+    mJointAxesMapped = false;
     mJointAxes = new Math::SpatialVector[mDoFCount];
 
     // Some assertions, as we concentrate on simple cases
@@ -404,6 +441,7 @@ struct RBDL_DLLAPI Joint {
       const Math::SpatialVector &axis_0
       ) {
     mDoFCount = 1;
+    mJointAxesMapped = false;
     mJointAxes = new Math::SpatialVector[mDoFCount];
     mJointAxes[0] = Math::SpatialVector (axis_0);
     if (axis_0 == Math::SpatialVector(1., 0., 0., 0., 0., 0.)) {
@@ -438,6 +476,7 @@ struct RBDL_DLLAPI Joint {
       ) {
     mJointType = JointType2DoF;
     mDoFCount = 2;
+    mJointAxesMapped = false;
 
     mJointAxes = new Math::SpatialVector[mDoFCount];
     mJointAxes[0] = axis_0;
@@ -465,6 +504,7 @@ struct RBDL_DLLAPI Joint {
       ) {
     mJointType = JointType3DoF;
     mDoFCount = 3;
+    mJointAxesMapped = false;
 
     mJointAxes = new Math::SpatialVector[mDoFCount];
 
@@ -497,6 +537,7 @@ struct RBDL_DLLAPI Joint {
       ) {
     mJointType = JointType4DoF;
     mDoFCount = 4;
+    mJointAxesMapped = false;
 
     mJointAxes = new Math::SpatialVector[mDoFCount];
 
@@ -533,6 +574,7 @@ struct RBDL_DLLAPI Joint {
       ) {
     mJointType = JointType5DoF;
     mDoFCount = 5;
+    mJointAxesMapped = false;
 
     mJointAxes = new Math::SpatialVector[mDoFCount];
 
@@ -573,6 +615,7 @@ struct RBDL_DLLAPI Joint {
       ) {
     mJointType = JointType6DoF;
     mDoFCount = 6;
+    mJointAxesMapped = false;
 
     mJointAxes = new Math::SpatialVector[mDoFCount];
 
@@ -623,6 +666,8 @@ struct RBDL_DLLAPI Joint {
 
   /// \brief The spatial axes of the joint
   Math::SpatialVector* mJointAxes;
+  /// \brief Whether mJointAxes is not owned by the joint, see MapJointAxes()
+  bool mJointAxesMapped;
   /// \brief Type of joint 
   JointType mJointType;
   /// \brief Number of degrees of freedom of the joint. Note: CustomJoints
@@ -642,25 +687,54 @@ struct RBDL_DLLAPI Joint {
  * \param joint_id the id of the joint we are interested in. This will be used to determine the type of joint and also the entries of \f[ q, \dot{q} \f].
  * \param q        joint state variables
  * \param qdot     joint velocity variables
+ * \param use_sincos_cache if true the sine and cosine of the joint angles
+ * are taken from Model::q_sin and Model::q_cos which must have been computed
+ * for q using jcalc_sincos() (default: false)
  */
 RBDL_DLLAPI
 void jcalc (
     Model &model,
     unsigned int joint_id,
     const Math::VectorNd &q,
-    const Math::VectorNd &qdot
+    const Math::VectorNd &qdot,
+    bool use_sincos_cache = false
     );
 
 RBDL_DLLAPI
 Math::SpatialTransform jcalc_XJ (
     Model &model,
     unsigned int joint_id,
-    const Math::VectorNd &q);
+    const Math::VectorNd &q,
+    bool use_sincos_cache = false);
 
 RBDL_DLLAPI
 void jcalc_X_lambda_S (
     Model &model,
     unsigned int joint_id,
+    const Math::VectorNd &q,
+    bool use_sincos_cache = false
+    );
+
+/** \brief Computes the sine and cosine of the generalized coordinates
+ *
+ * The joint angles of all revolute, helical and Euler joints are evaluated
+ * in a single pass over \f$q\f$ instead of calling sin() and cos() for
+ * each joint inside the recursion. The loop uses a branch-free polynomial
+ * approximation that the compiler can vectorize. Its error is within one
+ * unit in the last place of the results of std::sin() and std::cos().
+ * Coordinates with a magnitude of \f$10^6\f$ or above are evaluated with
+ * std::sin() and std::cos().
+ *
+ * The results are stored in Model::q_sin and Model::q_cos and are used by
+ * jcalc(), jcalc_XJ(), and jcalc_X_lambda_S() when they are called with
+ * use_sincos_cache = true.
+ *
+ * \param model the rigid body model
+ * \param q     joint state variables
+ */
+RBDL_DLLAPI
+void jcalc_sincos (
+    Model &model,
     const Math::VectorNd &q
     );
 
@@ -686,6 +760,199 @@ struct RBDL_DLLAPI CustomJoint {
   Math::MatrixNd Dinv;
   Math::VectorNd u;
   Math::VectorNd d_u;
+
+  protected:
+  /** \brief Returns the index of the first coordinate of the joint in q. */
+  static unsigned int GetJointQIndex (const Model &model,
+      unsigned int joint_id);
+
+  /** \brief Stores the joint transformation, velocity and
+   * velocity-product acceleration of the joint in the model. */
+  static void StoreJointKinematics (Model &model,
+      unsigned int joint_id,
+      const Math::SpatialTransform &X_J,
+      const Math::SpatialVector &v_J,
+      const Math::SpatialVector &c_J);
+
+  /** \brief Stores the joint transformation and the transformation from
+   * the parent body in the model. */
+  static void StoreJointTransform (Model &model,
+      unsigned int joint_id,
+      const Math::SpatialTransform &X_J);
+};
+
+/** \brief Multi DoF joint that is modeled by a single body.
+ *
+ * Describes the same kinematics and dynamics as the emulated joints
+ * JointType2DoF, ..., JointType6DoF, i.e. the axes are applied one after
+ * another and each axis is expressed in the frame that results from the
+ * previous axes. Instead of a chain of virtual bodies with one degree of
+ * freedom each it uses a single body with a \f$6 \times n\f$ motion
+ * subspace that is handled by the kernels for custom joints.
+ *
+ * If Model::mNativeMultiDofJoints is set, Model::AddBody() creates the
+ * joint for JointType2DoF, ..., JointType6DoF and the model owns it:
+ *
+ * \code
+ * Joint free_flyer (
+ *     SpatialVector (0., 0., 0., 1., 0., 0.),
+ *     SpatialVector (0., 0., 0., 0., 1., 0.),
+ *     SpatialVector (0., 0., 0., 0., 0., 1.),
+ *     SpatialVector (0., 0., 1., 0., 0., 0.),
+ *     SpatialVector (0., 1., 0., 0., 0., 0.),
+ *     SpatialVector (1., 0., 0., 0., 0., 0.));
+ *
+ * model.mNativeMultiDofJoints = true;
+ * unsigned int base_id = model.AddBody (0, SpatialTransform(), free_flyer,
+ *     body);
+ * \endcode
+ *
+ * It can also be added explicitly using Model::AddBodyCustomJoint() and,
+ * as any other CustomJoint, must then not be destroyed before the model:
+ *
+ * \code
+ * MultiDofJoint native_free_flyer (free_flyer);
+ *
+ * unsigned int base_id = model.AddBodyCustomJoint (0, SpatialTransform(),
+ *     &native_free_flyer, body);
+ * \endcode
+ *
+ * The generalized coordinates are the same as for the emulated joint.
+ *
+ * \note By default Model::AddBody() still emulates JointType2DoF, ...,
+ * JointType6DoF by virtual bodies as the native joints change the body
+ * ids and the number of bodies of existing models. The quaternion of
+ * JointTypeFloatingBase needs an additional
+ * entry in q which custom joints cannot describe, so floating bases with
+ * a quaternion remain a JointTypeTranslationXYZ joint followed by a
+ * JointTypeSpherical joint.
+ */
+struct RBDL_DLLAPI MultiDofJoint : public CustomJoint {
+  /** \brief Creates the joint from the axes of a joint of type
+   * JointType1DoF, ..., JointType6DoF.
+   *
+   * \note So far only pure rotations or pure translations are supported.
+   */
+  MultiDofJoint (const Joint &joint);
+
+  virtual void jcalc (Model &model,
+      unsigned int joint_id,
+      const Math::VectorNd &q,
+      const Math::VectorNd &qdot
+      );
+  virtual void jcalc_X_lambda_S (Model &model,
+      unsigned int joint_id,
+      const Math::VectorNd &q
+      );
+
+  /// \brief The spatial axes of the joint
+  std::vector<Math::SpatialVector> mJointAxes;
+
+  private:
+  /// \brief Computes the joint transformation and updates S.
+  Math::SpatialTransform CalcJointTransform (unsigned int q_index,
+      const Math::VectorNd &q);
+};
+
+/** \brief Custom joint with a number of degrees of freedom that is known
+ * at compile time.
+ *
+ * The joint model JointModel derives from this class and only implements
+ * the non-virtual function
+ *
+ * \code
+ * void jcalc_fixed (const JointVector &q, const JointVector &qdot,
+ *     Math::SpatialTransform &X_J, MotionSubspace &S_J,
+ *     Math::SpatialVector &c_J);
+ * \endcode
+ *
+ * which computes the joint transformation, the motion subspace and the
+ * velocity-product acceleration from the coordinates of the joint. All
+ * arguments are fixed-size such that the joint model can be inlined and
+ * does not need dynamically sized temporaries. The dynamics algorithms
+ * use fixed-size kernels for custom joints with up to 6 degrees of
+ * freedom.
+ *
+ * A rolling knee joint could be defined as:
+ *
+ * \code
+ * struct RollingKneeJoint
+ *   : public FixedSizeCustomJoint<RollingKneeJoint, 1> {
+ *   void jcalc_fixed (const JointVector &q, const JointVector &qdot,
+ *       Math::SpatialTransform &X_J, MotionSubspace &S_J,
+ *       Math::SpatialVector &c_J) {
+ *     ...
+ *   }
+ * };
+ * \endcode
+ *
+ * As any other CustomJoint it is added with Model::AddBodyCustomJoint().
+ */
+template <typename JointModel, unsigned int NDoF>
+struct FixedSizeCustomJoint : public CustomJoint {
+#ifdef RBDL_USE_SIMPLE_MATH
+  typedef SimpleMath::Fixed::Matrix<double, 6, NDoF> MotionSubspace;
+  typedef SimpleMath::Fixed::Matrix<double, NDoF, 1> JointVector;
+#else
+  typedef Eigen::Matrix<double, 6, NDoF> MotionSubspace;
+  typedef Eigen::Matrix<double, NDoF, 1> JointVector;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+#endif
+
+  FixedSizeCustomJoint () {
+    mDoFCount = NDoF;
+    S = Math::MatrixNd::Zero (6, NDoF);
+    U = Math::MatrixNd::Zero (6, NDoF);
+    Dinv = Math::MatrixNd::Zero (NDoF, NDoF);
+    u = Math::VectorNd::Zero (NDoF);
+    d_u = Math::VectorNd::Zero (NDoF);
+    mS = MotionSubspace::Zero();
+  }
+
+  virtual void jcalc (Model &model,
+      unsigned int joint_id,
+      const Math::VectorNd &q,
+      const Math::VectorNd &qdot
+      ) {
+    unsigned int q_index = GetJointQIndex (model, joint_id);
+
+    JointVector q_J, qdot_J;
+    for (unsigned int k = 0; k < NDoF; k++) {
+      q_J[k] = q[q_index + k];
+      qdot_J[k] = qdot[q_index + k];
+    }
+
+    Math::SpatialTransform X_J;
+    Math::SpatialVector c_J (Math::SpatialVector::Zero());
+    static_cast<JointModel*>(this)->jcalc_fixed (q_J, qdot_J, X_J, mS, c_J);
+
+    S = mS;
+    StoreJointKinematics (model, joint_id, X_J, mS * qdot_J, c_J);
+  }
+
+  virtual void jcalc_X_lambda_S (Model &model,
+      unsigned int joint_id,
+      const Math::VectorNd &q
+      ) {
+    unsigned int q_index = GetJointQIndex (model, joint_id);
+
+    JointVector q_J;
+    JointVector qdot_J (JointVector::Zero());
+    for (unsigned int k = 0; k < NDoF; k++) {
+      q_J[k] = q[q_index + k];
+    }
+
+    Math::SpatialTransform X_J;
+    Math::SpatialVector c_J (Math::SpatialVector::Zero());
+    static_cast<JointModel*>(this)->jcalc_fixed (q_J, qdot_J, X_J, mS, c_J);
+
+    S = mS;
+    StoreJointTransform (model, joint_id, X_J);
+  }
+
+  /// \brief Fixed-size motion subspace of the joint.
+  MotionSubspace mS;
 };
 
 }
@@ -65,6 +65,35 @@ RBDL_DLLAPI void UpdateKinematicsCustom (Model &model,
     const Math::VectorNd *QDDot
     );
 
+/** \brief Updates the kinematic variables of the bodies affected by a
+ * subset of joints.
+ *
+ * Same as UpdateKinematicsCustom() but assumes that the model state has
+ * been computed before for values that only differ in the joints of the
+ * bodies given in changed_body_ids (the joint of body i connects it with
+ * its parent Model::lambda[i]). Only the joint transformations of these
+ * joints and the quantities of the bodies in their subtrees are
+ * recomputed.
+ *
+ * This is useful for finite differences or coordinate descent where only
+ * a single coordinate is perturbed at a time.
+ *
+ * \param model the model
+ * \param Q     the positional variables of the model
+ * \param QDot  the generalized velocities of the joints
+ * \param QDDot the generalized accelerations of the joints
+ * \param changed_body_ids ids of the bodies whose joint values changed
+ *
+ * \note The same combination of Q, QDot and QDDot has to be passed as for
+ * the previous full update.
+ */
+RBDL_DLLAPI void UpdateKinematicsCustomIncremental (Model &model,
+    const Math::VectorNd *Q,
+    const Math::VectorNd *QDot,
+    const Math::VectorNd *QDDot,
+    const std::vector<unsigned int> &changed_body_ids
+    );
+
 /** \brief Returns the base coordinates of a point given in body coordinates.
  *
  * \param model the rigid body model
@@ -174,6 +203,64 @@ RBDL_DLLAPI void CalcPointJacobian6D (Model &model,
     bool update_kinematics = true
     );
 
+/** \brief Computes the product of the transposed 6-D point Jacobian with a
+ * wrench
+ *
+ * Computes \f$ \tau = G(q)^T w \f$ with \f$G(q)\f$ being the Jacobian of
+ * CalcPointJacobian6D(), i.e. the generalized forces that are equivalent
+ * to the wrench \f$w\f$ acting at the point. Instead of building
+ * \f$G(q)\f$ the wrench is transformed into the frame of the body and
+ * projected onto the joints while moving towards the root.
+ *
+ * \param model   rigid body model
+ * \param Q       state vector of the internal joints
+ * \param body_id the id of the body
+ * \param point_position the position of the point in body-local data
+ * \param wrench  the torque (first three entries) and the force (last
+ * three entries) at the point in base coordinates
+ * \param tau     a vector of size \#qdot_size to which the generalized
+ * forces are added
+ * \param update_kinematics whether UpdateKinematics() should be called or not (default: true)
+ *
+ * \note Only the entries of tau that belong to the joints that support
+ * the body are modified. One has to ensure that tau has been initialized,
+ * e.g. by calling tau.setZero().
+ */
+RBDL_DLLAPI void CalcPointJacobianTransposeTimes (Model &model,
+    const Math::VectorNd &Q,
+    unsigned int body_id,
+    const Math::Vector3d &point_position,
+    const Math::SpatialVector &wrench,
+    Math::VectorNd &tau,
+    bool update_kinematics = true
+    );
+
+/** \brief Computes the product of the transposed 6-D point Jacobians of
+ * multiple points with their wrenches
+ *
+ * Same as CalcPointJacobianTransposeTimes() for a single point but sums up
+ * the generalized forces of all points, e.g. of all contacts. The wrenches
+ * are first accumulated per body in Model::f_point and then propagated to the
+ * base in a single sweep.
+ *
+ * \param model   rigid body model
+ * \param Q       state vector of the internal joints
+ * \param body_ids the ids of the bodies
+ * \param point_positions the positions of the points in body-local data
+ * \param wrenches the wrenches at the points in base coordinates
+ * \param tau     a vector of size \#qdot_size to which the generalized
+ * forces are added
+ * \param update_kinematics whether UpdateKinematics() should be called or not (default: true)
+ */
+RBDL_DLLAPI void CalcPointJacobianTransposeTimes (Model &model,
+    const Math::VectorNd &Q,
+    const std::vector<unsigned int> &body_ids,
+    const std::vector<Math::Vector3d> &point_positions,
+    const std::vector<Math::SpatialVector> &wrenches,
+    Math::VectorNd &tau,
+    bool update_kinematics = true
+    );
+
 /** \brief Computes the spatial jacobian for a body
  *
  * The spatial velocity of a body at the origin of coordinate system of 
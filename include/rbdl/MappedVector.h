@@ -0,0 +1,162 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_MAPPED_VECTOR_H
+#define RBDL_MAPPED_VECTOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace RigidBodyDynamics {
+
+/** \brief Array that either owns its elements or refers to read-only
+ * elements in a mapped block of memory.
+ *
+ * It is used for the data of a Model that does not change during
+ * simulation (see SharedModelData). An owning MappedVector behaves like
+ * a std::vector. After MappedVector::Map() it refers to the given
+ * elements, which are neither copied nor freed. Copies of a mapped
+ * MappedVector refer to the same elements.
+ *
+ * Functions that change the size (push_back(), reserve(), resize(),
+ * assign()) first copy mapped elements into owned storage, see Detach().
+ * operator[] never copies the elements as it is used by all algorithms.
+ * The elements of a mapped MappedVector must therefore not be modified
+ * through operator[]. Memory that is mapped read-only raises a
+ * segmentation fault in this case.
+ */
+template <typename T>
+class MappedVector {
+  public:
+    typedef typename std::vector<T>::size_type size_type;
+
+    MappedVector() :
+      mBegin (NULL),
+      mSize (0),
+      mMapped (false) {
+    }
+    MappedVector (const MappedVector &other) :
+      mData (other.mData),
+      mBegin (NULL),
+      mSize (0),
+      mMapped (false) {
+        if (other.mMapped) {
+          Map (other.mBegin, other.mSize);
+        } else {
+          UpdateOwned();
+        }
+      }
+    MappedVector& operator= (const MappedVector &other) {
+      if (this != &other) {
+        if (other.mMapped) {
+          Map (other.mBegin, other.mSize);
+        } else {
+          mData = other.mData;
+          mMapped = false;
+          UpdateOwned();
+        }
+      }
+      return *this;
+    }
+
+    size_type size () const {
+      return mSize;
+    }
+    bool empty () const {
+      return mSize == 0;
+    }
+
+    T& operator[] (size_type i) {
+      assert (i < mSize);
+      return mBegin[i];
+    }
+    const T& operator[] (size_type i) const {
+      assert (i < mSize);
+      return mBegin[i];
+    }
+
+    /// \brief Returns a pointer to the first element or NULL if empty.
+    const T* data () const {
+      return mBegin;
+    }
+    const T* begin () const {
+      return mBegin;
+    }
+    const T* end () const {
+      return mBegin + mSize;
+    }
+
+    void push_back (const T &value) {
+      Detach();
+      mData.push_back (value);
+      UpdateOwned();
+    }
+    void reserve (size_type capacity) {
+      Detach();
+      mData.reserve (capacity);
+      UpdateOwned();
+    }
+    void resize (size_type size, const T &value = T()) {
+      Detach();
+      mData.resize (size, value);
+      UpdateOwned();
+    }
+    void assign (size_type size, const T &value) {
+      mMapped = false;
+      mData.assign (size, value);
+      UpdateOwned();
+    }
+    void clear () {
+      mMapped = false;
+      mData.clear();
+      UpdateOwned();
+    }
+
+    /** \brief Refers to size read-only elements at data.
+     *
+     * Owned elements are freed. The elements at data must stay valid as
+     * long as this MappedVector or any copy of it refers to them.
+     */
+    void Map (const T *data, size_type size) {
+      std::vector<T>().swap (mData);
+      mBegin = const_cast<T*>(data);
+      mSize = size;
+      mMapped = true;
+    }
+
+    /// \brief Copies mapped elements into owned storage.
+    void Detach () {
+      if (mMapped) {
+        mData.assign (mBegin, mBegin + mSize);
+        mMapped = false;
+        UpdateOwned();
+      }
+    }
+
+    /// \brief Returns whether the elements are mapped, see Map().
+    bool IsMapped () const {
+      return mMapped;
+    }
+
+  private:
+    void UpdateOwned () {
+      mSize = mData.size();
+      mBegin = mSize > 0 ? &mData[0] : NULL;
+    }
+
+    std::vector<T> mData;
+    /// \brief First element, either in mData or in the mapped memory.
+    T *mBegin;
+    size_type mSize;
+    bool mMapped;
+};
+
+}
+
+/* RBDL_MAPPED_VECTOR_H */
+#endif
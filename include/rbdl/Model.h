@@ -19,6 +19,8 @@
 #include "rbdl/Logging.h"
 #include "rbdl/Joint.h"
 #include "rbdl/Body.h"
+#include "rbdl/NameIndex.h"
+#include "rbdl/MappedVector.h"
 
 // std::vectors containing any objects that have Eigen matrices or vectors
 // as members need to have a special allocater. This can be achieved with
@@ -101,6 +103,35 @@ namespace RigidBodyDynamics {
  * RigidBodyDynamics::Addons::URDFReadFromFile \endlink.
  */
 
+/** \brief Reference counted list of custom joints that are owned by
+ * models.
+ *
+ * Copies of a model share their custom joints. The joints in the pool are
+ * destroyed together with the last copy of the pool.
+ */
+struct RBDL_DLLAPI CustomJointPool {
+  CustomJointPool();
+  CustomJointPool (const CustomJointPool &other);
+  CustomJointPool& operator= (const CustomJointPool &other);
+  ~CustomJointPool();
+
+  /// \brief Takes the ownership of the joint.
+  void Add (CustomJoint *custom_joint);
+
+  /// \brief Number of joints in the pool.
+  unsigned int size() const;
+
+  private:
+  struct SharedJoints {
+    std::vector<CustomJoint*> joints;
+    unsigned int ref_count;
+  };
+
+  void Release();
+
+  SharedJoints *mShared;
+};
+
 /** \brief Contains all information about the rigid body model
  *
  * This class contains all information required to perform the forward
@@ -180,12 +211,23 @@ struct RBDL_DLLAPI Model {
   std::vector<Math::SpatialTransform> X_J;
   std::vector<Math::SpatialVector> v_J;
   std::vector<Math::SpatialVector> c_J;
+  /** \brief Sine of the generalized coordinates as computed by
+   * jcalc_sincos() for the joints that depend on angles.
+   */
+  Math::VectorNd q_sin;
+  /** \brief Cosine of the generalized coordinates as computed by
+   * jcalc_sincos() for the joints that depend on angles.
+   */
+  Math::VectorNd q_cos;
 
   std::vector<unsigned int> mJointUpdateOrder;
 
-  /// \brief Transformations from the parent body to the frame of the joint.
-  // It is expressed in the coordinate frame of the parent.
-  std::vector<Math::SpatialTransform> X_T;
+  /** \brief Transformations from the parent body to the frame of the joint.
+   *
+   * It is expressed in the coordinate frame of the parent. It can refer
+   * to a read-only SharedModelData, see MappedVector.
+   */
+  MappedVector<Math::SpatialTransform> X_T;
   /// \brief The number of fixed joints that have been declared before 
   ///  each joint.
   std::vector<unsigned int> mFixedJointCount;
@@ -200,14 +242,18 @@ struct RBDL_DLLAPI Model {
   std::vector<unsigned int> multdof3_w_index;
 
   std::vector<CustomJoint*> mCustomJoints;
+  /** \brief Custom joints that were created by the model itself (see
+   * Model::mNativeMultiDofJoints).
+   */
+  CustomJointPool mOwnedCustomJoints;
 
   ////////////////////////////////////
   // Dynamics variables
 
   /// \brief The velocity dependent spatial acceleration
   std::vector<Math::SpatialVector> c;
-  /// \brief The spatial inertia of the bodies 
-  std::vector<Math::SpatialMatrix> IA;
+  /// \brief The articulated body inertia of the bodies
+  std::vector<Math::SpatialArticulatedBodyInertia> IA;
   /// \brief The spatial bias force
   std::vector<Math::SpatialVector> pA;
   /// \brief Temporary variable U_i (RBDA p. 130)
@@ -216,14 +262,51 @@ struct RBDL_DLLAPI Model {
   Math::VectorNd d;
   /// \brief Temporary variable u (RBDA p. 130)
   Math::VectorNd u;
-  /// \brief Internal forces on the body (used only InverseDynamics())
+  /// \brief Internal forces on the body (used by InverseDynamics())
   std::vector<Math::SpatialVector> f;
-  /// \brief The spatial inertia of body i (used only in 
-  ///  CompositeRigidBodyAlgorithm())
-  std::vector<Math::SpatialRigidBodyInertia> I;
+  /** \brief Accumulated point wrenches of the subtree of body i (used by
+   * CalcPointJacobianTransposeTimes())
+   */
+  std::vector<Math::SpatialVector> f_point;
+  /** \brief The spatial inertia of body i
+   *
+   * It can refer to a read-only SharedModelData, see MappedVector.
+   */
+  MappedVector<Math::SpatialRigidBodyInertia> I;
   std::vector<Math::SpatialRigidBodyInertia> Ic;
   std::vector<Math::SpatialVector> hc;
   std::vector<Math::SpatialVector> hdotc;
+  /// \brief Composite Coriolis matrices (used by CalcCoriolisMatrix())
+  std::vector<Math::SpatialMatrix> Bc;
+  /** \brief Motion subspace of every degree of freedom in the coordinates
+   * of its body (used by CalcCoriolisMatrix())
+   */
+  std::vector<Math::SpatialVector> S_dof;
+  /// \brief Time derivative of S_dof (used by CalcCoriolisMatrix())
+  std::vector<Math::SpatialVector> S_dot_dof;
+  /** \brief Articulated bias forces and accelerations of all columns
+   * (6 x k blocks, used by CalcMInvTimesMatrix() and sized on first use)
+   */
+  std::vector<Math::SpatialMatrixN> pA_cols;
+  /** \brief Joint space bias forces of all columns (used by
+   * CalcMInvTimesMatrix() and sized on first use)
+   */
+  std::vector<Math::MatrixNd> u_cols;
+  /** \brief Inverse apparent inertias of the bodies (used by
+   * CalcOperationalSpaceInertiaInverse() and sized on first use)
+   */
+  std::vector<Math::SpatialMatrix> Omega;
+  /** \brief Extended force propagators of the task frames along the paths
+   * of their bodies to the root (used by
+   * CalcOperationalSpaceInertiaInverse() and sized on first use)
+   */
+  std::vector<Math::SpatialMatrix> task_Phi;
+  /// \brief Bodies of the entries of task_Phi
+  std::vector<unsigned int> task_path_ids;
+  /// \brief Index of the first entry in task_Phi of each task frame
+  std::vector<unsigned int> task_path_offsets;
+  /// \brief Marks the bodies on the paths of the task frames to the root
+  std::vector<bool> task_path_mask;
 
   ////////////////////////////////////
   // Bodies
@@ -265,6 +348,44 @@ struct RBDL_DLLAPI Model {
   /// \brief Human readable names for the bodies
   std::map<std::string, unsigned int> mBodyNameMap;
 
+  /** \brief Hashed index of the body names and ids in mBodyNameMap
+   *
+   * It is updated by Model::AddBody(). If mBodyNameMap is modified
+   * directly, Model::UpdateNameIndices() has to be called afterwards.
+   */
+  NameIndex mBodyNameIndex;
+
+  /** \brief Names of the joints (see Model::SetJointName())
+   *
+   * The handle of a joint is the id of the body that the joint connects
+   * to its parent.
+   */
+  NameIndex mJointNameIndex;
+
+  /** \brief Names of the degrees of freedom (see Model::SetJointName())
+   *
+   * The handle of a degree of freedom is its index in qdot. This is also
+   * the index in q except for the w components of quaternions, which have
+   * no name.
+   */
+  NameIndex mDoFNameIndex;
+
+  /// \brief True between BeginBulkConstruction() and EndBulkConstruction()
+  bool mBulkConstruction;
+
+  /** \brief Whether AddBody() adds multi-DoF joints as a single body
+   * (default: false).
+   *
+   * If true, Model::AddBody() adds joints of type JointType2DoF, ...,
+   * JointType6DoF whose axes are pure rotations or pure translations as a
+   * single body with a MultiDofJoint instead of a chain of virtual bodies.
+   * The MultiDofJoint is created and owned by the model. The generalized
+   * coordinates are the same but the model has fewer bodies, i.e. the body
+   * ids differ from the emulated model. JointTypeFloatingBase is always
+   * added as a JointTypeTranslationXYZ and a JointTypeSpherical joint.
+   */
+  bool mNativeMultiDofJoints;
+
   /** \brief Connects a given body to the model
    *
    * When adding a body there are basically informations required:
@@ -332,6 +453,86 @@ struct RBDL_DLLAPI Model {
       std::string body_name = "" 
       );
 
+  /** \brief Description of a body that is added with Model::AddBodies().
+   *
+   * The members correspond to the parameters of Model::AddBody(). The
+   * parent can either be a body that is already part of the model
+   * (parent_id) or a body that is added earlier in the same call to
+   * Model::AddBodies() (parent_index).
+   */
+  struct BodyDescription {
+    BodyDescription() :
+      parent_id (0),
+      parent_index (-1),
+      custom_joint (NULL)
+    {}
+    BodyDescription (
+        const unsigned int parent_id,
+        const Math::SpatialTransform &joint_frame,
+        const Joint &joint,
+        const Body &body,
+        std::string body_name = ""
+        ) :
+      parent_id (parent_id),
+      parent_index (-1),
+      joint_frame (joint_frame),
+      joint (joint),
+      custom_joint (NULL),
+      body (body),
+      body_name (body_name)
+    {}
+
+    /// \brief Id of the parent body (used if parent_index is negative).
+    unsigned int parent_id;
+    /** \brief Index of the parent body in the vector passed to
+     * Model::AddBodies() or -1 to use parent_id.
+     */
+    int parent_index;
+    Math::SpatialTransform joint_frame;
+    Joint joint;
+    /// \brief If not NULL the body is added with AddBodyCustomJoint().
+    CustomJoint *custom_joint;
+    Body body;
+    std::string body_name;
+  };
+
+  /** \brief Adds many bodies at once.
+   *
+   * This is the same as calling Model::AddBody() (or
+   * Model::AddBodyCustomJoint()) for each description in order between
+   * Model::BeginBulkConstruction() and Model::EndBulkConstruction().
+   *
+   * \param bodies the descriptions of the bodies that are added
+   *
+   * \returns the ids of the added bodies in the order of bodies
+   */
+  std::vector<unsigned int> AddBodies (
+      const std::vector<BodyDescription> &bodies
+      );
+
+  /** \brief Starts adding many bodies to the model.
+   *
+   * Model::AddBody() updates some derived quantities of the whole model
+   * for every added body, e.g. the indices of the Quaternion w-components
+   * in q, the size of the workspace vectors, and
+   * Model::mJointUpdateOrder. This makes building a model with n bodies
+   * cost O(n^2). Between this call and Model::EndBulkConstruction() these
+   * updates are deferred and the per-body storage is reserved up front.
+   *
+   * \note The model must not be used with any of the algorithms until
+   * Model::EndBulkConstruction() was called.
+   *
+   * \param body_count the number of movable bodies that will be added
+   * (including the virtual bodies of multi-DoF joints). It is only used
+   * to reserve memory.
+   */
+  void BeginBulkConstruction (unsigned int body_count = 0);
+
+  /** \brief Computes the quantities that were deferred since
+   * Model::BeginBulkConstruction() in a single pass over all bodies.
+   */
+  void EndBulkConstruction ();
+
   /** \brief Returns the id of a body that was passed to AddBody()
    *
    * Bodies can be given a human readable name. This function allows to
@@ -344,28 +545,76 @@ struct RBDL_DLLAPI Model {
    *          int\>::max() if the id was not found.
    */
   unsigned int GetBodyId (const char *body_name) const {
-    if (mBodyNameMap.count(body_name) == 0) {
-      return std::numeric_limits<unsigned int>::max();
-    }
-
-    return mBodyNameMap.find(body_name)->second;
+    return mBodyNameIndex.Find (body_name);
   }
 
   /** \brief Returns the name of a body for a given body id */
   std::string GetBodyName (unsigned int body_id) const {
-    std::map<std::string, unsigned int>::const_iterator iter 
-      = mBodyNameMap.begin();
+    return mBodyNameIndex.GetName (body_id);
+  }
+
+  /** \brief Assigns a human readable name to the joint of a body.
+   *
+   * The joint is identified by the id of the body that it connects to its
+   * parent, i.e. the value returned by Model::AddBody(). If the joint was
+   * emulated by virtual bodies the name refers to all of them.
+   *
+   * The degrees of freedom of the joint are named as well: a joint with a
+   * single degree of freedom gives its name to the degree of freedom,
+   * otherwise they are called joint_name_0, joint_name_1, etc. in the order
+   * of their indices in qdot.
+   *
+   * Names that are already taken are not assigned and a warning is
+   * printed. E.g. a 3 DoF joint "arm" would name its degrees of freedom
+   * arm_0, arm_1 and arm_2, which collides with a 1 DoF joint "arm_0". The
+   * degree of freedom whose name is taken stays unnamed while the joint
+   * and its other degrees of freedom keep their names.
+   *
+   * \param body_id the id of a movable or fixed body
+   * \param joint_name the name of the joint
+   *
+   * \returns true if the joint and all of its degrees of freedom were
+   *          named, false if a name was already taken.
+   */
+  bool SetJointName (unsigned int body_id, const std::string &joint_name);
 
-    while (iter != mBodyNameMap.end()) {
-      if (iter->second == body_id)
-        return iter->first;
+  /** \brief Returns the id of the body whose joint has the given name
+   *
+   * \returns the id of the body or \c std::numeric_limits\<unsigned
+   *          int\>::max() if the joint was not found.
+   */
+  unsigned int GetJointId (const char *joint_name) const {
+    return mJointNameIndex.Find (joint_name);
+  }
 
-      iter++;
-    }
+  /** \brief Returns the name of the joint of a given body id */
+  std::string GetJointName (unsigned int body_id) const {
+    return mJointNameIndex.GetName (body_id);
+  }
+
+  /** \brief Returns the index in qdot of a named degree of freedom
+   *
+   * \returns the index or \c std::numeric_limits\<unsigned int\>::max()
+   *          if the degree of freedom was not found.
+   */
+  unsigned int GetDoFIndex (const char *dof_name) const {
+    return mDoFNameIndex.Find (dof_name);
+  }
 
-    return "";
+  /** \brief Returns the name of the degree of freedom with the given
+   * index in qdot */
+  std::string GetDoFName (unsigned int dof_index) const {
+    return mDoFNameIndex.GetName (dof_index);
   }
 
+  /** \brief Rebuilds the hashed name indices.
+   *
+   * The body index is created from mBodyNameMap and the degrees of freedom
+   * are renamed from the names in mJointNameIndex. This is only needed if
+   * mBodyNameMap was modified directly.
+   */
+  void UpdateNameIndices ();
+
   /** \brief Checks whether the body is rigidly attached to another body.
   */
   bool IsFixedBodyId (unsigned int body_id) {
@@ -440,6 +689,9 @@ struct RBDL_DLLAPI Model {
       abort();
     }
 
+    // a model that refers to a SharedModelData gets its own copy
+    X_T.Detach();
+
     unsigned int child_id = id;
     unsigned int parent_id = lambda[id];
     if (mBodies[parent_id].mIsVirtual) {
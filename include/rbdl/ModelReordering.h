@@ -0,0 +1,203 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_MODEL_REORDERING_H
+#define RBDL_MODEL_REORDERING_H
+
+#include <vector>
+#include <assert.h>
+
+#include "rbdl/rbdl_math.h"
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+/** \brief Orders in which ReorderModel() numbers the movable bodies.
+ *
+ * In both orders every body has a larger id than its parent such that the
+ * renumbered model can be used by all algorithms of RBDL.
+ */
+enum BodyOrdering {
+  /** \brief Level order: all bodies at the same depth of the tree are
+   * stored contiguously, from the root to the leaves.
+   */
+  BodyOrderingBreadthFirst = 0,
+  /// \brief Pre-order: the bodies of every subtree are stored contiguously.
+  BodyOrderingDepthFirst
+};
+
+/** \brief Maps between the numbering of a model and of its renumbered
+ * copy that was created by ReorderModel().
+ *
+ * The renumbered model stores the bodies and the entries of the
+ * generalized vectors in a different order. The maps of this struct
+ * convert ids and vectors between the original order (as it is used by
+ * the application) and the order of the renumbered model (as it is used
+ * by the algorithms):
+ *
+ * \code
+ * Model reordered_model;
+ * ModelPermutation permutation;
+ * ReorderModel (model, reordered_model, permutation);
+ *
+ * permutation.ToReorderedQ (Q, Q_reordered);
+ * permutation.ToReorderedQDot (QDot, QDot_reordered);
+ * permutation.ToReorderedQDot (Tau, Tau_reordered);
+ * ForwardDynamics (reordered_model, Q_reordered, QDot_reordered,
+ *     Tau_reordered, QDDot_reordered);
+ * permutation.FromReorderedQDot (QDDot_reordered, QDDot);
+ * \endcode
+ *
+ * Body names are kept, i.e. Model::GetBodyId() of the renumbered model
+ * returns the new id of a body. Ids of fixed bodies are not changed.
+ */
+struct RBDL_DLLAPI ModelPermutation {
+  /// \brief New id of each movable body of the original model.
+  std::vector<unsigned int> body_new_from_old;
+  /// \brief Original id of each movable body of the renumbered model.
+  std::vector<unsigned int> body_old_from_new;
+  /// \brief New index of each entry of the original q-vector.
+  std::vector<unsigned int> q_new_from_old;
+  /// \brief Original index of each entry of the renumbered q-vector.
+  std::vector<unsigned int> q_old_from_new;
+  /** \brief New index of each entry of the original qdot-vector (also used
+   * for qddot and tau).
+   */
+  std::vector<unsigned int> qdot_new_from_old;
+  /// \brief Original index of each entry of the renumbered qdot-vector.
+  std::vector<unsigned int> qdot_old_from_new;
+
+  /** \brief Returns the id in the renumbered model of a (movable or fixed)
+   * body of the original model.
+   */
+  unsigned int GetReorderedBodyId (unsigned int body_id) const {
+    if (body_id >= body_new_from_old.size()) {
+      // fixed bodies keep their ids
+      return body_id;
+    }
+    return body_new_from_old[body_id];
+  }
+
+  /** \brief Returns the id in the original model of a (movable or fixed)
+   * body of the renumbered model.
+   */
+  unsigned int GetOriginalBodyId (unsigned int body_id) const {
+    if (body_id >= body_old_from_new.size()) {
+      return body_id;
+    }
+    return body_old_from_new[body_id];
+  }
+
+  /// \brief Converts a q-vector from the original to the renumbered order.
+  void ToReorderedQ (const Math::VectorNd &q,
+      Math::VectorNd &q_reordered) const {
+    assert (q.size() == q_new_from_old.size());
+    assert (q_reordered.size() == q_new_from_old.size());
+
+    for (unsigned int i = 0; i < q_new_from_old.size(); i++) {
+      q_reordered[q_new_from_old[i]] = q[i];
+    }
+  }
+
+  /// \brief Converts a q-vector from the renumbered to the original order.
+  void FromReorderedQ (const Math::VectorNd &q_reordered,
+      Math::VectorNd &q) const {
+    assert (q.size() == q_old_from_new.size());
+    assert (q_reordered.size() == q_old_from_new.size());
+
+    for (unsigned int i = 0; i < q_old_from_new.size(); i++) {
+      q[q_old_from_new[i]] = q_reordered[i];
+    }
+  }
+
+  /** \brief Converts a qdot-, qddot-, or tau-vector from the original to
+   * the renumbered order.
+   */
+  void ToReorderedQDot (const Math::VectorNd &qdot,
+      Math::VectorNd &qdot_reordered) const {
+    assert (qdot.size() == qdot_new_from_old.size());
+    assert (qdot_reordered.size() == qdot_new_from_old.size());
+
+    for (unsigned int i = 0; i < qdot_new_from_old.size(); i++) {
+      qdot_reordered[qdot_new_from_old[i]] = qdot[i];
+    }
+  }
+
+  /** \brief Converts a qdot-, qddot-, or tau-vector from the renumbered to
+   * the original order.
+   */
+  void FromReorderedQDot (const Math::VectorNd &qdot_reordered,
+      Math::VectorNd &qdot) const {
+    assert (qdot.size() == qdot_old_from_new.size());
+    assert (qdot_reordered.size() == qdot_old_from_new.size());
+
+    for (unsigned int i = 0; i < qdot_old_from_new.size(); i++) {
+      qdot[qdot_old_from_new[i]] = qdot_reordered[i];
+    }
+  }
+
+  /** \brief Converts a matrix whose rows and columns both correspond to
+   * the qdot-vector (e.g. the joint space inertia matrix) from the
+   * renumbered to the original order.
+   */
+  void FromReorderedQDotMatrix (const Math::MatrixNd &M_reordered,
+      Math::MatrixNd &M) const {
+    assert (M.rows() == qdot_old_from_new.size()
+        && M.cols() == qdot_old_from_new.size());
+    assert (M_reordered.rows() == qdot_old_from_new.size()
+        && M_reordered.cols() == qdot_old_from_new.size());
+
+    for (unsigned int i = 0; i < qdot_old_from_new.size(); i++) {
+      for (unsigned int j = 0; j < qdot_old_from_new.size(); j++) {
+        M(qdot_old_from_new[i], qdot_old_from_new[j]) = M_reordered(i, j);
+      }
+    }
+  }
+};
+
+/** \brief Creates a copy of a model in which the bodies and degrees of
+ * freedom are renumbered.
+ *
+ * The order in which the bodies are added to a model determines the
+ * memory layout that all algorithms traverse as well as the structure of
+ * the joint space inertia matrix. Loaders such as the URDF reader add the
+ * bodies in the order of their model description. This function builds a
+ * model with the same kinematic tree and inertial properties but with the
+ * bodies (and their entries in q, qdot, qddot, and tau) ordered by
+ * the given BodyOrdering:
+ *
+ * - BodyOrderingBreadthFirst places all bodies of a level of the tree next
+ *   to each other. The bodies of a level are independent of each other
+ *   in the sweeps of the recursive algorithms.
+ * - BodyOrderingDepthFirst places every subtree in a contiguous range of
+ *   ids such that the nonzero blocks of the joint space inertia matrix
+ *   are clustered around the diagonal.
+ *
+ * Children are visited in the order in which they were added.
+ *
+ * Custom joints are shared between both models, i.e. the CustomJoint
+ * instances of the original model must outlive the renumbered model.
+ *
+ * \param model the model that should be renumbered
+ * \param reordered_model a default constructed model that receives the
+ * renumbered bodies
+ * \param permutation receives the maps between both numberings
+ * \param ordering the order in which the bodies are numbered
+ */
+RBDL_DLLAPI
+void ReorderModel (
+    const Model &model,
+    Model &reordered_model,
+    ModelPermutation &permutation,
+    BodyOrdering ordering = BodyOrderingBreadthFirst
+    );
+
+}
+
+/* RBDL_MODEL_REORDERING_H */
+#endif
@@ -0,0 +1,128 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_NAME_INDEX_H
+#define RBDL_NAME_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include "rbdl/rbdl_config.h"
+#include "rbdl/MappedVector.h"
+
+namespace RigidBodyDynamics {
+
+/** \brief Hashed bidirectional map between names and integer handles.
+ *
+ * Every name is associated with exactly one handle and vice versa. Both
+ * lookup directions, Find() and GetName(), hash their argument once and
+ * take constant time on average. This makes them suitable for code that
+ * resolves names every time step, e.g. logging of named signals.
+ *
+ * Entries can only be added, not removed. Handles are chosen by the owner
+ * of the index (e.g. the body ids of a Model) and do not have to be
+ * contiguous.
+ *
+ * The entries can be stored with WriteToBuffer() and used in place from
+ * read-only memory with Map() (see SharedModelData).
+ */
+struct RBDL_DLLAPI NameIndex {
+  /// \brief Handle that is returned for names that are not in the index.
+  static const unsigned int InvalidHandle;
+
+  NameIndex();
+
+  /** \brief Adds a name for a handle.
+   *
+   * \returns false if the name or the handle already exist in the index
+   * (the index is not modified in this case).
+   */
+  bool Insert (const std::string &name, unsigned int handle);
+
+  /// \brief Returns the handle of name or NameIndex::InvalidHandle.
+  unsigned int Find (const char *name) const;
+
+  /// \brief Returns the handle of name or NameIndex::InvalidHandle.
+  unsigned int Find (const std::string &name) const;
+
+  /// \brief Returns the name of handle or an empty string.
+  std::string GetName (unsigned int handle) const;
+
+  /// \brief Returns whether a name was added for handle.
+  bool HasHandle (unsigned int handle) const;
+
+  /// \brief Returns the number of names in the index.
+  size_t size () const {
+    return mHandles.size();
+  }
+
+  /// \brief Returns the name of the i'th entry in the order of insertion.
+  std::string GetEntryName (size_t i) const {
+    return std::string (&mNameData[mNameOffsets[i]], GetNameLength (i));
+  }
+
+  /// \brief Returns the handle of the i'th entry in the order of insertion.
+  unsigned int GetEntryHandle (size_t i) const {
+    return mHandles[i];
+  }
+
+  /// \brief Removes all entries.
+  void clear ();
+
+  /** \brief Appends the entries and hash tables to buffer.
+   *
+   * The appended data is padded to a multiple of 8 bytes.
+   */
+  void WriteToBuffer (std::vector<char> &buffer) const;
+
+  /** \brief Refers to entries that were stored with WriteToBuffer().
+   *
+   * The data is used in place and has to stay valid as long as the index
+   * refers to it. It must be aligned to 4 bytes. Adding names copies the
+   * entries into owned storage first.
+   *
+   * \returns false if the data is not a valid stored index (the index is
+   * not modified in this case).
+   */
+  bool Map (const char *data, size_t size);
+
+  private:
+  unsigned int FindEntry (const char *name, size_t length,
+      unsigned int hash) const;
+  unsigned int FindEntry (unsigned int handle) const;
+  void Rehash (size_t slot_count);
+
+  size_t GetNameLength (size_t entry) const {
+    size_t end = entry + 1 < mNameOffsets.size()
+      ? mNameOffsets[entry + 1] : mNameData.size();
+    // names are stored with a terminating zero
+    return end - mNameOffsets[entry] - 1;
+  }
+
+  /// \brief Zero terminated names of the entries in the order of insertion.
+  MappedVector<char> mNameData;
+  /// \brief Offsets of the names of the entries in mNameData.
+  MappedVector<unsigned int> mNameOffsets;
+  /// \brief Handles of the entries in the order of insertion.
+  MappedVector<unsigned int> mHandles;
+  /// \brief Hash values of the names of the entries.
+  MappedVector<unsigned int> mNameHashes;
+
+  /** \brief Open addressing hash tables that contain the entry index + 1
+   * for each occupied slot and 0 for empty slots.
+   *
+   * Both tables have a size that is a power of two and are at most half
+   * full.
+   */
+  MappedVector<unsigned int> mNameSlots;
+  MappedVector<unsigned int> mHandleSlots;
+};
+
+}
+
+/* RBDL_NAME_INDEX_H */
+#endif
@@ -0,0 +1,163 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#ifndef RBDL_SHARED_MODEL_DATA_H
+#define RBDL_SHARED_MODEL_DATA_H
+
+#include <cstddef>
+#include <vector>
+
+#include "rbdl/rbdl_math.h"
+
+namespace RigidBodyDynamics {
+
+struct Model;
+
+/** \brief Read-only block with the immutable data of a model that
+ * several processes map and use in place.
+ *
+ * Simulations with many worker processes that all use the same large
+ * model can keep a single copy of the data that does not change during
+ * simulation. The block contains
+ *   - the transformations Model::X_T,
+ *   - the spatial inertias Model::I,
+ *   - the axes of all joints (Joint::mJointAxes),
+ *   - the body, joint, and DoF name indices,
+ *   - the model description in the compiled model format (see
+ *     \ref compiled_model_page) from which the topology is built.
+ *
+ * The block is written once, e.g. to a file on a tmpfs such as
+ * /dev/shm, which is where POSIX shared memory objects live:
+ *
+ * \code
+ * SharedModelData::WriteToFile (model, "/dev/shm/robot.rbdls");
+ * \endcode
+ *
+ * Every worker maps the file read-only and creates its own model:
+ *
+ * \code
+ * SharedModelData shared_data;
+ * Model model;
+ * if (!shared_data.MapFile ("/dev/shm/robot.rbdls")
+ *     || !shared_data.CreateModel (&model)) {
+ *   // handle error
+ * }
+ * \endcode
+ *
+ * The model refers to the mapped pages instead of storing copies of
+ * X_T, I, the joint axes, and the name indices (see MappedVector and
+ * Joint::MapJointAxes()). All processes therefore share the same
+ * physical pages. Each model allocates only the per-body workspace of
+ * the algorithms, the topology (Model::lambda, Model::mu, ...), and the
+ * small Model::mBodies, Model::mJoints, and Model::mBodyNameMap.
+ *
+ * The SharedModelData has to outlive all models that were created from
+ * it, including their copies. Modifying the model through
+ * Model::SetJointFrame() or Model::AddBody() copies the affected arrays
+ * into the model first. Writing directly to Model::X_T or Model::I of a
+ * mapped model raises a segmentation fault as the pages are read-only.
+ *
+ * All values are stored in the memory layout of the writing build, i.e.
+ * the block can only be used by builds with the same math library and
+ * byte order. Models with custom joints cannot be stored.
+ *
+ * \note On systems without mmap() MapFile() reads the file into private
+ * memory. The created models then work the same, but nothing is shared.
+ */
+struct RBDL_DLLAPI SharedModelData {
+  /// \brief Version of the block format that is written.
+  static const unsigned int Version;
+
+  SharedModelData();
+  ~SharedModelData();
+
+  /** \brief Stores the immutable data of a model.
+   *
+   * \param model the model that should be stored
+   * \param buffer receives the block
+   * \param verbose if true, additional information is printed
+   *
+   * \returns true on success, false if the model cannot be stored
+   */
+  static bool WriteToBuffer (const Model &model, std::vector<char> &buffer,
+      bool verbose = false);
+
+  /** \brief Stores the immutable data of a model in a file.
+   *
+   * \param model the model that should be stored
+   * \param filename the name of the file that is created
+   * \param verbose if true, additional information is printed
+   *
+   * \returns true on success, false if the model or the file cannot be
+   * written
+   */
+  static bool WriteToFile (const Model &model, const char *filename,
+      bool verbose = false);
+
+  /** \brief Maps a file that was written with WriteToFile() read-only.
+   *
+   * A previously mapped block is unmapped first.
+   *
+   * \returns true on success, false if the file cannot be mapped or is
+   * not a valid block of this build
+   */
+  bool MapFile (const char *filename);
+
+  /** \brief Uses a block that was written with WriteToBuffer() in place.
+   *
+   * The memory is not copied and has to stay valid as long as this
+   * SharedModelData is mapped. It must be aligned to 16 bytes.
+   *
+   * \returns true on success, false if data is not a valid block of this
+   * build
+   */
+  bool Map (const void *data, size_t size);
+
+  /// \brief Releases the block.
+  void Unmap ();
+
+  /// \brief Returns whether a block is mapped.
+  bool IsMapped () const {
+    return mData != NULL;
+  }
+
+  /// \brief Returns the start of the mapped block or NULL.
+  const char* GetData () const {
+    return mData;
+  }
+
+  /// \brief Returns the size of the mapped block in bytes.
+  size_t GetSize () const {
+    return mSize;
+  }
+
+  /** \brief Builds a model that refers to the mapped block.
+   *
+   * \param model an empty model that receives the bodies
+   * \param verbose if true, additional information is printed
+   *
+   * \returns true on success, false if no block is mapped or the model
+   * cannot be built
+   */
+  bool CreateModel (Model *model, bool verbose = false) const;
+
+  private:
+  SharedModelData (const SharedModelData &);
+  SharedModelData& operator= (const SharedModelData &);
+
+  const char *mData;
+  size_t mSize;
+  /// \brief Size of the memory mapping that has to be released or 0.
+  size_t mMappedSize;
+  /// \brief File contents on systems without mmap().
+  std::vector<char> mBuffer;
+};
+
+}
+
+/* RBDL_SHARED_MODEL_DATA_H */
+#endif
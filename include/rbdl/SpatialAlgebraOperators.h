@@ -48,7 +48,7 @@ struct RBDL_DLLAPI SpatialRigidBodyInertia {
     Izx (Izx), Izy(Izy), Izz(Izz)
   { }
 
-  SpatialVector operator* (const SpatialVector &mv) {
+  SpatialVector operator* (const SpatialVector &mv) const {
     Vector3d mv_lower (mv[3], mv[4], mv[5]);
 
     Vector3d res_upper = Vector3d (
@@ -135,6 +135,174 @@ struct RBDL_DLLAPI SpatialRigidBodyInertia {
   double Ixx, Iyx, Iyy, Izx, Izy, Izz;
 };
 
+/** \brief Compact representation of articulated body inertias.
+ *
+ * An articulated body inertia is a symmetric 6x6 matrix
+ * \f[
+ *   I^A = \left[ \begin{array}{cc} I & H \\ H^T & M \end{array} \right]
+ * \f]
+ * with symmetric 3x3 blocks \f$I\f$ and \f$M\f$. Only the upper blocks
+ * and the lower right block are stored, which allows the transformation
+ * SpatialTransform::applyTranspose() to operate on 3x3 blocks instead of
+ * multiplying full 6x6 matrices.
+ */
+struct RBDL_DLLAPI SpatialArticulatedBodyInertia {
+  SpatialArticulatedBodyInertia() :
+    I (Matrix3d::Zero(3,3)),
+    H (Matrix3d::Zero(3,3)),
+    M (Matrix3d::Zero(3,3))
+  {}
+  SpatialArticulatedBodyInertia (
+      const Matrix3d &I, const Matrix3d &H, const Matrix3d &M) :
+    I (I), H (H), M (M)
+  {}
+  explicit SpatialArticulatedBodyInertia (const SpatialMatrix &IA) {
+    createFromMatrix (IA);
+  }
+  explicit SpatialArticulatedBodyInertia (const SpatialRigidBodyInertia &rbi) {
+    createFromRigidBodyInertia (rbi);
+  }
+
+  SpatialVector operator* (const SpatialVector &mv) const {
+    Vector3d mv_upper (mv[0], mv[1], mv[2]);
+    Vector3d mv_lower (mv[3], mv[4], mv[5]);
+
+    Vector3d res_upper = I * mv_upper + H * mv_lower;
+    Vector3d res_lower = H.transpose() * mv_upper + M * mv_lower;
+
+    return SpatialVector (
+        res_upper[0], res_upper[1], res_upper[2],
+        res_lower[0], res_lower[1], res_lower[2]
+        );
+  }
+
+  /** Same as toMatrix() * mat. */
+  Matrix63 operator* (const Matrix63 &mat) const {
+    Matrix63 result;
+    applyToColumns (mat, result, 3);
+    return result;
+  }
+
+  /** Same as result = toMatrix() * mat for the first n columns of the
+   * 6 x n matrices mat and result. result has to be sized by the caller.
+   */
+  template <typename MatrixTypeA, typename MatrixTypeB>
+  void applyToColumns (
+      const MatrixTypeA &mat, MatrixTypeB &result, unsigned int n) const {
+    for (unsigned int i = 0; i < 3; i++) {
+      for (unsigned int j = 0; j < n; j++) {
+        result(i,j) =
+          I(i,0) * mat(0,j) + I(i,1) * mat(1,j) + I(i,2) * mat(2,j)
+          + H(i,0) * mat(3,j) + H(i,1) * mat(4,j) + H(i,2) * mat(5,j);
+        result(i + 3,j) =
+          H(0,i) * mat(0,j) + H(1,i) * mat(1,j) + H(2,i) * mat(2,j)
+          + M(i,0) * mat(3,j) + M(i,1) * mat(4,j) + M(i,2) * mat(5,j);
+      }
+    }
+  }
+
+  SpatialArticulatedBodyInertia operator+ (
+      const SpatialArticulatedBodyInertia &IA) const {
+    return SpatialArticulatedBodyInertia (I + IA.I, H + IA.H, M + IA.M);
+  }
+
+  void operator+= (const SpatialArticulatedBodyInertia &IA) {
+    I += IA.I;
+    H += IA.H;
+    M += IA.M;
+  }
+
+  /** Subtracts UD * U^T where UD and U are 6 x n matrices such that the
+   * product is symmetric (e.g. UD = U * D^-1 for a symmetric D).
+   *
+   * This is the update of the articulated body inertia of a joint with n
+   * degrees of freedom in the Articulated Body Algorithm.
+   */
+  template <typename MatrixTypeA, typename MatrixTypeB>
+  void subtractSymmetricProduct (
+      const MatrixTypeA &UD, const MatrixTypeB &U, unsigned int n) {
+    for (unsigned int i = 0; i < 3; i++) {
+      for (unsigned int j = 0; j < 3; j++) {
+        double H_ij = 0.;
+        for (unsigned int k = 0; k < n; k++) {
+          H_ij += UD(i,k) * U(j + 3,k);
+        }
+        H(i,j) -= H_ij;
+      }
+
+      for (unsigned int j = i; j < 3; j++) {
+        double I_ij = 0.;
+        double M_ij = 0.;
+        for (unsigned int k = 0; k < n; k++) {
+          I_ij += UD(i,k) * U(j,k);
+          M_ij += UD(i + 3,k) * U(j + 3,k);
+        }
+        I(i,j) -= I_ij;
+        I(j,i) = I(i,j);
+        M(i,j) -= M_ij;
+        M(j,i) = M(i,j);
+      }
+    }
+  }
+
+  void setZero() {
+    I.setZero();
+    H.setZero();
+    M.setZero();
+  }
+
+  /** Takes the upper blocks and the lower right block of IA. */
+  void createFromMatrix (const SpatialMatrix &IA) {
+    I = IA.block<3,3>(0,0);
+    H = IA.block<3,3>(0,3);
+    M = IA.block<3,3>(3,3);
+  }
+
+  /** Same as createFromMatrix (rbi.toMatrix()). */
+  void createFromRigidBodyInertia (const SpatialRigidBodyInertia &rbi) {
+    I(0,0) = rbi.Ixx; I(0,1) = rbi.Iyx; I(0,2) = rbi.Izx;
+    I(1,0) = rbi.Iyx; I(1,1) = rbi.Iyy; I(1,2) = rbi.Izy;
+    I(2,0) = rbi.Izx; I(2,1) = rbi.Izy; I(2,2) = rbi.Izz;
+
+    H(0,0) =        0.; H(0,1) = -rbi.h[2]; H(0,2) =  rbi.h[1];
+    H(1,0) =  rbi.h[2]; H(1,1) =        0.; H(1,2) = -rbi.h[0];
+    H(2,0) = -rbi.h[1]; H(2,1) =  rbi.h[0]; H(2,2) =        0.;
+
+    M(0,0) = rbi.m; M(0,1) =    0.; M(0,2) =    0.;
+    M(1,0) =    0.; M(1,1) = rbi.m; M(1,2) =    0.;
+    M(2,0) =    0.; M(2,1) =    0.; M(2,2) = rbi.m;
+  }
+
+  SpatialMatrix toMatrix() const {
+    SpatialMatrix result;
+    result.block<3,3>(0,0) = I;
+    result.block<3,3>(0,3) = H;
+    result.block<3,3>(3,0) = H.transpose();
+    result.block<3,3>(3,3) = M;
+
+    return result;
+  }
+
+  /** Adds the inertia to mat, same as mat += toMatrix(). */
+  void addToSpatialMatrix (SpatialMatrix &mat) const {
+    for (unsigned int i = 0; i < 3; i++) {
+      for (unsigned int j = 0; j < 3; j++) {
+        mat(i, j) += I(i, j);
+        mat(i, j + 3) += H(i, j);
+        mat(i + 3, j) += H(j, i);
+        mat(i + 3, j + 3) += M(i, j);
+      }
+    }
+  }
+
+  /// Upper left block (symmetric)
+  Matrix3d I;
+  /// Upper right block
+  Matrix3d H;
+  /// Lower right block (symmetric)
+  Matrix3d M;
+};
+
 /** \brief Compact representation of spatial transformations.
  *
  * Instead of using a verbose 6x6 matrix, this structure only stores a 3x3
@@ -156,7 +324,7 @@ struct RBDL_DLLAPI SpatialTransform {
    *
    * \returns (E * w, - E * rxw + E * v)
    */
-  SpatialVector apply (const SpatialVector &v_sp) {
+  SpatialVector apply (const SpatialVector &v_sp) const {
     Vector3d v_rxw (
         v_sp[3] - r[1]*v_sp[2] + r[2]*v_sp[1],
         v_sp[4] - r[2]*v_sp[0] + r[0]*v_sp[2],
@@ -176,7 +344,7 @@ struct RBDL_DLLAPI SpatialTransform {
    *
    * \returns (E^T * n + rx * E^T * f, E^T * f)
    */
-  SpatialVector applyTranspose (const SpatialVector &f_sp) {
+  SpatialVector applyTranspose (const SpatialVector &f_sp) const {
     Vector3d E_T_f (
         E(0,0) * f_sp[3] + E(1,0) * f_sp[4] + E(2,0) * f_sp[5],
         E(0,1) * f_sp[3] + E(1,1) * f_sp[4] + E(2,1) * f_sp[5],
@@ -193,9 +361,54 @@ struct RBDL_DLLAPI SpatialTransform {
         );
   }
 
+  /** Same as result = X * mat for the first n columns of the 6 x n
+   * matrices of motion vectors mat and result. result has to be sized by
+   * the caller.
+   */
+  template <typename MatrixTypeA, typename MatrixTypeB>
+  void applyToColumns (
+      const MatrixTypeA &mat, MatrixTypeB &result, unsigned int n) const {
+    for (unsigned int j = 0; j < n; j++) {
+      double v_rxw_0 = mat(3,j) - r[1] * mat(2,j) + r[2] * mat(1,j);
+      double v_rxw_1 = mat(4,j) - r[2] * mat(0,j) + r[0] * mat(2,j);
+      double v_rxw_2 = mat(5,j) - r[0] * mat(1,j) + r[1] * mat(0,j);
+
+      for (unsigned int i = 0; i < 3; i++) {
+        result(i,j) = E(i,0) * mat(0,j) + E(i,1) * mat(1,j)
+          + E(i,2) * mat(2,j);
+        result(i + 3,j) = E(i,0) * v_rxw_0 + E(i,1) * v_rxw_1
+          + E(i,2) * v_rxw_2;
+      }
+    }
+  }
+
+  /** Same as result += X^T * mat for the first n columns of the 6 x n
+   * matrices of force vectors mat and result.
+   */
+  template <typename MatrixTypeA, typename MatrixTypeB>
+  void addApplyTransposeToColumns (
+      const MatrixTypeA &mat, MatrixTypeB &result, unsigned int n) const {
+    for (unsigned int j = 0; j < n; j++) {
+      double E_T_f[3];
+      for (unsigned int i = 0; i < 3; i++) {
+        E_T_f[i] = E(0,i) * mat(3,j) + E(1,i) * mat(4,j) + E(2,i) * mat(5,j);
+      }
+
+      result(0,j) += E(0,0) * mat(0,j) + E(1,0) * mat(1,j)
+        + E(2,0) * mat(2,j) - r[2] * E_T_f[1] + r[1] * E_T_f[2];
+      result(1,j) += E(0,1) * mat(0,j) + E(1,1) * mat(1,j)
+        + E(2,1) * mat(2,j) + r[2] * E_T_f[0] - r[0] * E_T_f[2];
+      result(2,j) += E(0,2) * mat(0,j) + E(1,2) * mat(1,j)
+        + E(2,2) * mat(2,j) - r[1] * E_T_f[0] + r[0] * E_T_f[1];
+      result(3,j) += E_T_f[0];
+      result(4,j) += E_T_f[1];
+      result(5,j) += E_T_f[2];
+    }
+  }
+
   /** Same as X^* I X^{-1}
   */
-  SpatialRigidBodyInertia apply (const SpatialRigidBodyInertia &rbi) {
+  SpatialRigidBodyInertia apply (const SpatialRigidBodyInertia &rbi) const {
     return SpatialRigidBodyInertia (
         rbi.m,
         E * (rbi.h - rbi.m * r),
@@ -215,7 +428,7 @@ struct RBDL_DLLAPI SpatialTransform {
 
   /** Same as X^T I X
   */
-  SpatialRigidBodyInertia applyTranspose (const SpatialRigidBodyInertia &rbi) {
+  SpatialRigidBodyInertia applyTranspose (const SpatialRigidBodyInertia &rbi) const {
     Vector3d E_T_mr = E.transpose() * rbi.h + rbi.m * r;
     return SpatialRigidBodyInertia (
         rbi.m,
@@ -230,7 +443,68 @@ struct RBDL_DLLAPI SpatialTransform {
         - VectorCrossMatrix (E_T_mr) * VectorCrossMatrix (r));
   }
 
-  SpatialVector applyAdjoint (const SpatialVector &f_sp) {
+  /** Same as X^T I^A X
+   *
+   * With the blocks rotated into the parent frame (\f$I' = E^T I E\f$,
+   * etc.) this is
+   * \returns (I' + rx H'^T + (rx H'^T)^T - rx M' rx, H' + rx M', M')
+   */
+  SpatialArticulatedBodyInertia applyTranspose (
+      const SpatialArticulatedBodyInertia &IA) const {
+    // rotate the blocks into the parent frame, I' and M' are symmetric
+    Matrix3d IE, HE, ME;
+    for (unsigned int i = 0; i < 3; i++) {
+      for (unsigned int j = 0; j < 3; j++) {
+        IE(i,j) = IA.I(i,0) * E(0,j) + IA.I(i,1) * E(1,j) + IA.I(i,2) * E(2,j);
+        HE(i,j) = IA.H(i,0) * E(0,j) + IA.H(i,1) * E(1,j) + IA.H(i,2) * E(2,j);
+        ME(i,j) = IA.M(i,0) * E(0,j) + IA.M(i,1) * E(1,j) + IA.M(i,2) * E(2,j);
+      }
+    }
+
+    Matrix3d E_T_I_E, E_T_H_E, E_T_M_E;
+    for (unsigned int i = 0; i < 3; i++) {
+      for (unsigned int j = 0; j < 3; j++) {
+        E_T_H_E(i,j) = E(0,i) * HE(0,j) + E(1,i) * HE(1,j) + E(2,i) * HE(2,j);
+      }
+      for (unsigned int j = i; j < 3; j++) {
+        E_T_I_E(i,j) = E(0,i) * IE(0,j) + E(1,i) * IE(1,j) + E(2,i) * IE(2,j);
+        E_T_I_E(j,i) = E_T_I_E(i,j);
+        E_T_M_E(i,j) = E(0,i) * ME(0,j) + E(1,i) * ME(1,j) + E(2,i) * ME(2,j);
+        E_T_M_E(j,i) = E_T_M_E(i,j);
+      }
+    }
+
+    // rx M', rx H'^T and rx M' rx using the structure of rx
+    Matrix3d rxM, rxHT, rxMrx;
+    for (unsigned int j = 0; j < 3; j++) {
+      rxM(0,j) = r[1] * E_T_M_E(2,j) - r[2] * E_T_M_E(1,j);
+      rxM(1,j) = r[2] * E_T_M_E(0,j) - r[0] * E_T_M_E(2,j);
+      rxM(2,j) = r[0] * E_T_M_E(1,j) - r[1] * E_T_M_E(0,j);
+
+      rxHT(0,j) = r[1] * E_T_H_E(j,2) - r[2] * E_T_H_E(j,1);
+      rxHT(1,j) = r[2] * E_T_H_E(j,0) - r[0] * E_T_H_E(j,2);
+      rxHT(2,j) = r[0] * E_T_H_E(j,1) - r[1] * E_T_H_E(j,0);
+    }
+    for (unsigned int i = 0; i < 3; i++) {
+      rxMrx(i,0) = r[2] * rxM(i,1) - r[1] * rxM(i,2);
+      rxMrx(i,1) = r[0] * rxM(i,2) - r[2] * rxM(i,0);
+      rxMrx(i,2) = r[1] * rxM(i,0) - r[0] * rxM(i,1);
+    }
+
+    SpatialArticulatedBodyInertia result;
+    for (unsigned int i = 0; i < 3; i++) {
+      for (unsigned int j = i; j < 3; j++) {
+        result.I(i,j) = E_T_I_E(i,j) + rxHT(i,j) + rxHT(j,i) - rxMrx(i,j);
+        result.I(j,i) = result.I(i,j);
+      }
+    }
+    result.H = E_T_H_E + rxM;
+    result.M = E_T_M_E;
+
+    return result;
+  }
+
+  SpatialVector applyAdjoint (const SpatialVector &f_sp) const {
     Vector3d En_rxf = E * (Vector3d (f_sp[0], f_sp[1], f_sp[2]) - r.cross(Vector3d (f_sp[3], f_sp[4], f_sp[5])));
     //		Vector3d En_rxf = E * (Vector3d (f_sp[0], f_sp[1], f_sp[2]) - r.cross(Eigen::Map<Vector3d> (&(f_sp[3]))));
 
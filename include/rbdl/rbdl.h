@@ -14,7 +14,11 @@
 #include "rbdl/Logging.h"
 
 #include "rbdl/Body.h"
+#include "rbdl/NameIndex.h"
 #include "rbdl/Model.h"
+#include "rbdl/ModelReordering.h"
+#include "rbdl/CompiledModel.h"
+#include "rbdl/SharedModelData.h"
 #include "rbdl/Dynamics.h"
 #include "rbdl/Joint.h"
 #include "rbdl/Kinematics.h"
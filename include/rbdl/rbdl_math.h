@@ -34,6 +34,12 @@ typedef SimpleMath::Fixed::Matrix<double, 4,3> Matrix43_t;
 typedef SimpleMath::Dynamic::Matrix<double> MatrixN_t;
 typedef SimpleMath::Dynamic::Matrix<double> VectorN_t;
 
+typedef SimpleMath::Dynamic::Matrix<double> JointMatrix6N_t;
+typedef SimpleMath::Dynamic::Matrix<double> JointMatrixNN_t;
+typedef SimpleMath::Dynamic::Matrix<double> JointVectorN_t;
+
+typedef SimpleMath::Dynamic::Matrix<double> SpatialMatrixN_t;
+
 #else
 #include <Eigen/Dense>
 #include <Eigen/StdVector>
@@ -46,6 +52,16 @@ typedef Eigen::Matrix<double, 4, 3> Matrix43_t;
 
 typedef Eigen::VectorXd VectorN_t;
 typedef Eigen::MatrixXd MatrixN_t;
+
+// Dynamically sized but bounded by the 6 degrees of freedom a joint can
+// have, such that temporaries are kept on the stack.
+typedef Eigen::Matrix<double, 6, Eigen::Dynamic, 0, 6, 6> JointMatrix6N_t;
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6>
+  JointMatrixNN_t;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 6, 1> JointVectorN_t;
+
+// 6 x n matrix whose columns are spatial vectors.
+typedef Eigen::Matrix<double, 6, Eigen::Dynamic> SpatialMatrixN_t;
 #endif
 
 namespace RigidBodyDynamics {
@@ -62,6 +78,10 @@ typedef Matrix63_t Matrix63;
 typedef Matrix43_t Matrix43;
 typedef VectorN_t VectorNd;
 typedef MatrixN_t MatrixNd;
+typedef JointMatrix6N_t JointMatrix6N;
+typedef JointMatrixNN_t JointMatrixNN;
+typedef JointVectorN_t JointVectorN;
+typedef SpatialMatrixN_t SpatialMatrixN;
 } /* Math */
 
 } /* RigidBodyDynamics */
@@ -78,6 +98,7 @@ typedef MatrixN_t MatrixNd;
   EIGEN_DEFINE_STL_VECTOR_SPECIALIZATION(RigidBodyDynamics::Math::Matrix43)
   EIGEN_DEFINE_STL_VECTOR_SPECIALIZATION(RigidBodyDynamics::Math::SpatialTransform)
   EIGEN_DEFINE_STL_VECTOR_SPECIALIZATION(RigidBodyDynamics::Math::SpatialRigidBodyInertia)
+  EIGEN_DEFINE_STL_VECTOR_SPECIALIZATION(RigidBodyDynamics::Math::SpatialArticulatedBodyInertia)
 #endif
 
   /* RBDL_MATH_H_H */
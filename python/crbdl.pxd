@@ -88,6 +88,10 @@ cdef extern from "<rbdl/SpatialAlgebraOperators.h>" namespace "RigidBodyDynamics
         Vector3d h
         double Ixx, Iyx, Iyy, Izx, Izy, Izz
 
+    cdef cppclass SpatialArticulatedBodyInertia:
+        SpatialArticulatedBodyInertia()
+        SpatialMatrix toMatrix()
+
 cdef extern from "<rbdl/Body.h>" namespace "RigidBodyDynamics":
     cdef cppclass Body:
         Body()
@@ -140,6 +144,12 @@ cdef extern from "<rbdl/Joint.h>" namespace "RigidBodyDynamics":
         unsigned int mDoFCount
         unsigned int q_index
 
+cdef extern from "<rbdl/MappedVector.h>" namespace "RigidBodyDynamics":
+    cdef cppclass MappedVector[T]:
+        unsigned int size()
+        T& operator[](unsigned int)
+        bool IsMapped()
+
 cdef extern from "<rbdl/Model.h>" namespace "RigidBodyDynamics":
     cdef cppclass Model:
         Model()
@@ -193,7 +203,7 @@ cdef extern from "<rbdl/Model.h>" namespace "RigidBodyDynamics":
 
         vector[unsigned int] mJointUpdateOrder
 
-        vector[SpatialTransform] X_T
+        MappedVector[SpatialTransform] X_T
 
         vector[unsigned int] mFixedJointCount
 
@@ -204,13 +214,13 @@ cdef extern from "<rbdl/Model.h>" namespace "RigidBodyDynamics":
         vector[unsigned int] multdof3_w_index
 
         vector[SpatialVector] c
-        vector[SpatialMatrix] IA
+        vector[SpatialArticulatedBodyInertia] IA
         vector[SpatialVector] pA
         vector[SpatialVector] U
         VectorNd d
         VectorNd u
         vector[SpatialVector] f
-        vector[SpatialRigidBodyInertia] I
+        MappedVector[SpatialRigidBodyInertia] I
         vector[SpatialRigidBodyInertia] Ic
         vector[SpatialVector] hc
 
@@ -418,6 +418,15 @@ cdef np.ndarray SpatialVectorToNumpy (crbdl.SpatialVector cx):
 
     return result
 
+# SpatialMatrix
+cdef np.ndarray SpatialMatrixToNumpy (crbdl.SpatialMatrix cM):
+    result = np.ndarray ([cM.rows(), cM.cols()])
+    for i in range (cM.rows()):
+        for j in range (cM.cols()):
+            result[i,j] = cM.coeff(i,j)
+
+    return result
+
 cdef crbdl.Quaternion NumpyToQuaternion (np.ndarray[double, ndim=1, mode="c"] x):
     cdef crbdl.Quaternion cx = crbdl.Quaternion()
     for i in range (3):
@@ -1012,7 +1021,12 @@ cdef class Model:
             return self.thisptr.multdof3_w_index
 
     %VectorWrapperAddProperty (TYPE=SpatialVector, MEMBER=c, PARENT=Model)%
-    %VectorWrapperAddProperty (TYPE=SpatialMatrix, MEMBER=IA, PARENT=Model)%
+    property IA:
+        """ Articulated body inertias as 6x6 matrices (read-only). """
+        def __get__ (self):
+            return [SpatialMatrixToNumpy (self.thisptr.IA[i].toMatrix())
+                    for i in range (self.thisptr.IA.size())]
+
     %VectorWrapperAddProperty (TYPE=SpatialVector, MEMBER=pA, PARENT=Model)%
     %VectorWrapperAddProperty (TYPE=SpatialVector, MEMBER=U, PARENT=Model)%
 
@@ -543,7 +543,7 @@ void ForwardDynamicsPtr (
 		*/
 
 		model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
-		model.I[i].setSpatialMatrix (model.IA[i]);
+		model.IA[i].createFromRigidBodyInertia (model.I[i]);
 
 		model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
 
@@ -574,13 +574,14 @@ void ForwardDynamicsPtr (
 //			LOG << "multdof3_u[" << i << "] = " << model.multdof3_u[i].transpose() << std::endl;
 			unsigned int lambda = model.lambda[i];
 			if (lambda != 0) {
-				SpatialMatrix Ia = model.IA[i] - model.multdof3_U[i] * model.multdof3_Dinv[i] * model.multdof3_U[i].transpose();
-				SpatialVector pa = model.pA[i] + Ia * model.c[i] + model.multdof3_U[i] * model.multdof3_Dinv[i] * model.multdof3_u[i];
+				Matrix63 UDinv (model.multdof3_U[i] * model.multdof3_Dinv[i]);
+				SpatialArticulatedBodyInertia Ia (model.IA[i]);
+				Ia.subtractSymmetricProduct (UDinv, model.multdof3_U[i], 3);
+				SpatialVector pa = model.pA[i] + Ia * model.c[i] + UDinv * model.multdof3_u[i];
+				model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-				model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-				model.IA[lambda] += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
 				LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose() << std::endl;
@@ -593,13 +594,14 @@ void ForwardDynamicsPtr (
 
 			unsigned int lambda = model.lambda[i];
 			if (lambda != 0) {
-				SpatialMatrix Ia = model.IA[i] - model.U[i] * (model.U[i] / model.d[i]).transpose();
-				SpatialVector pa = model.pA[i] + Ia * model.c[i] + model.U[i] * model.u[i] / model.d[i];
+				SpatialVector UDinv (model.U[i] / model.d[i]);
+				SpatialArticulatedBodyInertia Ia (model.IA[i]);
+				Ia.subtractSymmetricProduct (UDinv, model.U[i], 1);
+				SpatialVector pa = model.pA[i] + Ia * model.c[i] + UDinv * model.u[i];
+				model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-				model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-				model.IA[lambda] += model.X_lambda[i].toMatrixTranspose() * Ia * model.X_lambda[i].toMatrix();
 				model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
 				LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose() << std::endl;
@@ -170,6 +170,27 @@ class SampleModel3R (unittest.TestCase):
 
         assert_almost_equal (tau, tau_id)
 
+    def test_ArticulatedBodyInertias (self):
+        """ Checks the articulated body inertias of ForwardDynamics """
+        q = np.random.rand (self.model.q_size)
+        qdot = np.random.rand (self.model.q_size)
+
+        rbdl.ForwardDynamics (
+                self.model,
+                q,
+                qdot,
+                self.tau,
+                self.qddot)
+
+        self.assertEqual (len(self.model.mBodies), len(self.model.IA))
+
+        # the last body has no children so its articulated body inertia is
+        # its rigid body inertia
+        IA = self.model.IA[self.body_3]
+        assert_almost_equal (IA, IA.transpose())
+        assert_almost_equal (np.eye(3), IA[3:6,3:6])
+        assert_almost_equal (np.array([0.3, 0.3, 0.05]), np.diag(IA[0:3,0:3]))
+
     def test_NonlinearEffectsConsistency (self):
         """ Checks whether NonlinearEffects is consistent with InverseDynamics """
         q = np.random.rand (self.model.q_size)
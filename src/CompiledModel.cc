@@ -0,0 +1,691 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <limits>
+#include <stdint.h>
+
+#if defined(WIN32) || defined (_WIN32)
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define RBDL_COMPILED_MODEL_USE_MMAP
+#endif
+
+#include "rbdl/rbdl_mathutils.h"
+#include "rbdl/Logging.h"
+
+#include "rbdl/Model.h"
+#include "rbdl/CompiledModel.h"
+
+namespace RigidBodyDynamics {
+
+using namespace Math;
+
+static const char CompiledModelMagic[8] = {
+  'R', 'B', 'D', 'L', 'C', 'M', 'P', '\0'
+};
+static const uint32_t CompiledModelByteOrderMark = 0x01020304;
+
+/* The records are copied with memcpy from and to the file contents. All
+ * members are ordered such that the structs do not contain any padding.
+ */
+struct CompiledModelHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  /// \brief Number of movable bodies including the root body.
+  uint32_t body_count;
+  uint32_t fixed_body_count;
+  uint32_t name_table_size;
+  uint32_t body_record_size;
+  uint32_t fixed_body_record_size;
+  uint32_t padding;
+  double gravity[3];
+};
+
+struct CompiledBodyRecord {
+  uint32_t parent_id;
+  uint32_t joint_type;
+  uint32_t dof_count;
+  uint32_t is_virtual;
+  uint32_t name_offset;
+  uint32_t name_length;
+  uint32_t joint_name_offset;
+  uint32_t joint_name_length;
+  /// \brief Rotation of X_T in row major order.
+  double joint_frame_E[9];
+  double joint_frame_r[3];
+  double joint_axes[3][6];
+  double mass;
+  double center_of_mass[3];
+  /// \brief Inertia at the center of mass in row major order.
+  double inertia[9];
+};
+
+struct CompiledFixedBodyRecord {
+  uint32_t movable_parent_id;
+  uint32_t name_offset;
+  uint32_t name_length;
+  uint32_t joint_name_offset;
+  uint32_t joint_name_length;
+  uint32_t padding;
+  double parent_transform_E[9];
+  double parent_transform_r[3];
+  double mass;
+  double center_of_mass[3];
+  double inertia[9];
+};
+
+static void StoreTransform (const SpatialTransform &X, double *E, double *r) {
+  for (unsigned int i = 0; i < 3; i++) {
+    for (unsigned int j = 0; j < 3; j++) {
+      E[i * 3 + j] = X.E(i, j);
+    }
+    r[i] = X.r[i];
+  }
+}
+
+static SpatialTransform LoadTransform (const double *E, const double *r) {
+  return SpatialTransform (
+      Matrix3d (
+        E[0], E[1], E[2],
+        E[3], E[4], E[5],
+        E[6], E[7], E[8]),
+      Vector3d (r[0], r[1], r[2]));
+}
+
+static void StoreInertia (const Matrix3d &inertia, double *values) {
+  for (unsigned int i = 0; i < 3; i++) {
+    for (unsigned int j = 0; j < 3; j++) {
+      values[i * 3 + j] = inertia(i, j);
+    }
+  }
+}
+
+static Matrix3d LoadInertia (const double *values) {
+  return Matrix3d (
+      values[0], values[1], values[2],
+      values[3], values[4], values[5],
+      values[6], values[7], values[8]);
+}
+
+static uint32_t AppendName (const std::string &name,
+    std::vector<char> &name_table) {
+  uint32_t offset = static_cast<uint32_t>(name_table.size());
+  name_table.insert (name_table.end(), name.begin(), name.end());
+  name_table.push_back ('\0');
+  return offset;
+}
+
+/** \brief Reads a name of length length at offset from the name table.
+ *
+ * \returns false if the name is not contained in the name table.
+ */
+static bool LoadName (const char *name_table, uint32_t name_table_size,
+    uint32_t offset, uint32_t length, std::string &name) {
+  if (static_cast<uint64_t>(offset) + length >= name_table_size
+      || name_table[offset + length] != '\0') {
+    return false;
+  }
+
+  name.assign (name_table + offset, length);
+
+  return true;
+}
+
+/// \brief Returns the number of degrees of freedom of a stored joint type.
+static unsigned int GetCompiledJointDoFCount (uint32_t joint_type) {
+  switch (joint_type) {
+    case JointTypeRevolute:
+    case JointTypePrismatic:
+    case JointTypeRevoluteX:
+    case JointTypeRevoluteY:
+    case JointTypeRevoluteZ:
+    case JointTypeHelical:
+      return 1;
+    case JointTypeSpherical:
+    case JointTypeEulerZYX:
+    case JointTypeEulerXYZ:
+    case JointTypeEulerYXZ:
+    case JointTypeTranslationXYZ:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+/** \brief Reads the name of the joint of body_id and adds it to
+ * joint_name_index.
+ *
+ * \returns false if the name is invalid or already exists.
+ */
+static bool ReadJointName (const char *name_table, uint32_t name_table_size,
+    uint32_t offset, uint32_t length, unsigned int body_id,
+    NameIndex &joint_name_index) {
+  std::string joint_name;
+
+  if (!LoadName (name_table, name_table_size, offset, length, joint_name)) {
+    std::cerr << "Error: invalid name of the joint of body " << body_id
+      << " in compiled model!" << std::endl;
+    return false;
+  }
+
+  if (!joint_name_index.Insert (joint_name, body_id)) {
+    std::cerr << "Error: Joint with name '" << joint_name
+      << "' already exists!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+RBDL_DLLAPI bool CompiledModelWriteToBuffer (
+    const Model &model,
+    std::vector<char> &buffer,
+    bool verbose) {
+  if (model.mCustomJoints.size() != 0) {
+    std::cerr << "Error: cannot compile a model that contains custom joints!"
+      << std::endl;
+    return false;
+  }
+
+  unsigned int body_count = model.mBodies.size();
+  unsigned int fixed_body_count = model.mFixedBodies.size();
+
+  std::vector<CompiledBodyRecord> body_records (body_count);
+  std::vector<CompiledFixedBodyRecord> fixed_body_records (fixed_body_count);
+  std::vector<char> name_table;
+
+  if (body_count > 0) {
+    memset (&body_records[0], 0, body_count * sizeof (CompiledBodyRecord));
+  }
+  if (fixed_body_count > 0) {
+    memset (&fixed_body_records[0], 0,
+        fixed_body_count * sizeof (CompiledFixedBodyRecord));
+  }
+
+  for (unsigned int i = 0; i < body_count; i++) {
+    CompiledBodyRecord &record = body_records[i];
+    const Body &body = model.mBodies[i];
+
+    record.is_virtual = body.mIsVirtual ? 1 : 0;
+    record.mass = body.mMass;
+    for (unsigned int j = 0; j < 3; j++) {
+      record.center_of_mass[j] = body.mCenterOfMass[j];
+    }
+    StoreInertia (body.mInertia, record.inertia);
+
+    if (i == 0) {
+      record.joint_type = JointTypeUndefined;
+      StoreTransform (SpatialTransform(), record.joint_frame_E,
+          record.joint_frame_r);
+      continue;
+    }
+
+    const Joint &joint = model.mJoints[i];
+    if (GetCompiledJointDoFCount (joint.mJointType) != joint.mDoFCount) {
+      std::cerr << "Error: cannot compile joint of body " << i
+        << " with joint type " << joint.mJointType << "!" << std::endl;
+      return false;
+    }
+
+    record.parent_id = model.lambda[i];
+    record.joint_type = joint.mJointType;
+    record.dof_count = joint.mDoFCount;
+    StoreTransform (model.X_T[i], record.joint_frame_E, record.joint_frame_r);
+    for (unsigned int j = 0; j < joint.mDoFCount; j++) {
+      for (unsigned int k = 0; k < 6; k++) {
+        record.joint_axes[j][k] = joint.mJointAxes[j][k];
+      }
+    }
+  }
+
+  for (unsigned int i = 0; i < fixed_body_count; i++) {
+    CompiledFixedBodyRecord &record = fixed_body_records[i];
+    const FixedBody &fbody = model.mFixedBodies[i];
+
+    record.movable_parent_id = fbody.mMovableParent;
+    StoreTransform (fbody.mParentTransform, record.parent_transform_E,
+        record.parent_transform_r);
+    record.mass = fbody.mMass;
+    for (unsigned int j = 0; j < 3; j++) {
+      record.center_of_mass[j] = fbody.mCenterOfMass[j];
+    }
+    StoreInertia (fbody.mInertia, record.inertia);
+  }
+
+  // names (the name of the root body is set by the Model constructor)
+  std::map<std::string, unsigned int>::const_iterator name_iter;
+  for (name_iter = model.mBodyNameMap.begin();
+      name_iter != model.mBodyNameMap.end(); ++name_iter) {
+    unsigned int body_id = name_iter->second;
+    uint32_t name_length = static_cast<uint32_t>(name_iter->first.size());
+
+    if (body_id == 0) {
+      continue;
+    } else if (body_id < body_count) {
+      body_records[body_id].name_offset =
+        AppendName (name_iter->first, name_table);
+      body_records[body_id].name_length = name_length;
+    } else if (body_id >= model.fixed_body_discriminator
+        && body_id - model.fixed_body_discriminator < fixed_body_count) {
+      CompiledFixedBodyRecord &record =
+        fixed_body_records[body_id - model.fixed_body_discriminator];
+      record.name_offset = AppendName (name_iter->first, name_table);
+      record.name_length = name_length;
+    }
+  }
+
+  for (size_t i = 0; i < model.mJointNameIndex.size(); i++) {
+    const std::string &joint_name = model.mJointNameIndex.GetEntryName (i);
+    unsigned int body_id = model.mJointNameIndex.GetEntryHandle (i);
+    uint32_t name_length = static_cast<uint32_t>(joint_name.size());
+
+    if (body_id == 0 || name_length == 0) {
+      continue;
+    } else if (body_id < body_count) {
+      body_records[body_id].joint_name_offset =
+        AppendName (joint_name, name_table);
+      body_records[body_id].joint_name_length = name_length;
+    } else if (body_id >= model.fixed_body_discriminator
+        && body_id - model.fixed_body_discriminator < fixed_body_count) {
+      CompiledFixedBodyRecord &record =
+        fixed_body_records[body_id - model.fixed_body_discriminator];
+      record.joint_name_offset = AppendName (joint_name, name_table);
+      record.joint_name_length = name_length;
+    }
+  }
+
+  // keep the size of the file a multiple of 8 bytes
+  while (name_table.size() % 8 != 0) {
+    name_table.push_back ('\0');
+  }
+
+  CompiledModelHeader header;
+  memset (&header, 0, sizeof (CompiledModelHeader));
+  memcpy (header.magic, CompiledModelMagic, sizeof (header.magic));
+  header.version = CompiledModelVersion;
+  header.byte_order = CompiledModelByteOrderMark;
+  header.body_count = body_count;
+  header.fixed_body_count = fixed_body_count;
+  header.name_table_size = static_cast<uint32_t>(name_table.size());
+  header.body_record_size = sizeof (CompiledBodyRecord);
+  header.fixed_body_record_size = sizeof (CompiledFixedBodyRecord);
+  for (unsigned int i = 0; i < 3; i++) {
+    header.gravity[i] = model.gravity[i];
+  }
+
+  size_t body_records_size = body_count * sizeof (CompiledBodyRecord);
+  size_t fixed_body_records_size =
+    fixed_body_count * sizeof (CompiledFixedBodyRecord);
+
+  buffer.resize (sizeof (CompiledModelHeader) + body_records_size
+      + fixed_body_records_size + name_table.size());
+
+  char *data = &buffer[0];
+  memcpy (data, &header, sizeof (CompiledModelHeader));
+  data += sizeof (CompiledModelHeader);
+  if (body_records_size > 0) {
+    memcpy (data, &body_records[0], body_records_size);
+    data += body_records_size;
+  }
+  if (fixed_body_records_size > 0) {
+    memcpy (data, &fixed_body_records[0], fixed_body_records_size);
+    data += fixed_body_records_size;
+  }
+  if (name_table.size() > 0) {
+    memcpy (data, &name_table[0], name_table.size());
+  }
+
+  if (verbose) {
+    std::cout << "Compiled model with " << body_count - 1
+      << " movable bodies, " << fixed_body_count << " fixed bodies, and "
+      << model.dof_count << " degrees of freedom (" << buffer.size()
+      << " bytes)" << std::endl;
+  }
+
+  return true;
+}
+
+RBDL_DLLAPI bool CompiledModelWriteToFile (
+    const Model &model,
+    const char *filename,
+    bool verbose) {
+  std::vector<char> buffer;
+
+  if (!CompiledModelWriteToBuffer (model, buffer, verbose)) {
+    return false;
+  }
+
+  std::ofstream file (filename, std::ios::out | std::ios::binary);
+  if (!file) {
+    std::cerr << "Error opening file '" << filename << "' for writing!"
+      << std::endl;
+    return false;
+  }
+
+  file.write (&buffer[0], buffer.size());
+  file.close();
+
+  if (!file) {
+    std::cerr << "Error writing file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+RBDL_DLLAPI bool CompiledModelReadFromMemory (
+    const void *data,
+    size_t size,
+    Model *model,
+    bool verbose) {
+  assert (model);
+
+  if (model->mBodies.size() != 1 || model->mFixedBodies.size() != 0) {
+    std::cerr << "Error: a compiled model can only be loaded into an empty "
+      << "model!" << std::endl;
+    return false;
+  }
+
+  const char *bytes = static_cast<const char*>(data);
+
+  CompiledModelHeader header;
+  if (size < sizeof (CompiledModelHeader)) {
+    std::cerr << "Error: compiled model is too small!" << std::endl;
+    return false;
+  }
+  memcpy (&header, bytes, sizeof (CompiledModelHeader));
+
+  if (memcmp (header.magic, CompiledModelMagic, sizeof (header.magic)) != 0) {
+    std::cerr << "Error: data is not a compiled model!" << std::endl;
+    return false;
+  }
+
+  if (header.byte_order != CompiledModelByteOrderMark) {
+    std::cerr << "Error: compiled model was created on a machine with a "
+      << "different byte order!" << std::endl;
+    return false;
+  }
+
+  if (header.version != CompiledModelVersion) {
+    std::cerr << "Error: unsupported compiled model version "
+      << header.version << " (expected " << CompiledModelVersion << ")!"
+      << std::endl;
+    return false;
+  }
+
+  if (header.body_record_size != sizeof (CompiledBodyRecord)
+      || header.fixed_body_record_size != sizeof (CompiledFixedBodyRecord)) {
+    std::cerr << "Error: compiled model was created with a different record "
+      << "layout!" << std::endl;
+    return false;
+  }
+
+  if (header.body_count < 1
+      || header.body_count >= model->fixed_body_discriminator
+      || header.fixed_body_count > std::numeric_limits<unsigned int>::max()
+      - model->fixed_body_discriminator) {
+    std::cerr << "Error: invalid number of bodies in compiled model!"
+      << std::endl;
+    return false;
+  }
+
+  uint64_t expected_size = sizeof (CompiledModelHeader)
+    + static_cast<uint64_t>(header.body_count) * sizeof (CompiledBodyRecord)
+    + static_cast<uint64_t>(header.fixed_body_count)
+    * sizeof (CompiledFixedBodyRecord)
+    + header.name_table_size;
+
+  if (expected_size != size) {
+    std::cerr << "Error: compiled model has size " << size
+      << " but its header describes " << expected_size << " bytes!"
+      << std::endl;
+    return false;
+  }
+
+  const char *body_data = bytes + sizeof (CompiledModelHeader);
+  const char *fixed_body_data = body_data
+    + header.body_count * sizeof (CompiledBodyRecord);
+  const char *name_table = fixed_body_data
+    + header.fixed_body_count * sizeof (CompiledFixedBodyRecord);
+
+  // check all records and names before the model is modified
+  std::map<std::string, unsigned int> body_name_map = model->mBodyNameMap;
+  NameIndex joint_name_index = model->mJointNameIndex;
+  CompiledBodyRecord record;
+  CompiledFixedBodyRecord fixed_record;
+
+  for (unsigned int i = 0; i < header.body_count; i++) {
+    memcpy (&record, body_data + i * sizeof (CompiledBodyRecord),
+        sizeof (CompiledBodyRecord));
+
+    if (i > 0 && (record.parent_id >= i
+          || record.dof_count == 0
+          || GetCompiledJointDoFCount (record.joint_type)
+          != record.dof_count)) {
+      std::cerr << "Error: invalid joint of body " << i
+        << " in compiled model!" << std::endl;
+      return false;
+    }
+
+    if (i > 0 && record.joint_name_length > 0 && !ReadJointName (name_table,
+          header.name_table_size, record.joint_name_offset,
+          record.joint_name_length, i, joint_name_index)) {
+      return false;
+    }
+
+    if (record.name_length == 0) {
+      continue;
+    }
+
+    std::string body_name;
+    if (!LoadName (name_table, header.name_table_size, record.name_offset,
+          record.name_length, body_name)) {
+      std::cerr << "Error: invalid name of body " << i
+        << " in compiled model!" << std::endl;
+      return false;
+    }
+
+    if (!body_name_map.insert (std::make_pair (body_name, i)).second) {
+      std::cerr << "Error: Body with name '" << body_name
+        << "' already exists!" << std::endl;
+      return false;
+    }
+  }
+
+  for (unsigned int i = 0; i < header.fixed_body_count; i++) {
+    memcpy (&fixed_record,
+        fixed_body_data + i * sizeof (CompiledFixedBodyRecord),
+        sizeof (CompiledFixedBodyRecord));
+
+    if (fixed_record.movable_parent_id >= header.body_count) {
+      std::cerr << "Error: invalid parent of fixed body " << i
+        << " in compiled model!" << std::endl;
+      return false;
+    }
+
+    if (fixed_record.joint_name_length > 0 && !ReadJointName (name_table,
+          header.name_table_size, fixed_record.joint_name_offset,
+          fixed_record.joint_name_length,
+          model->fixed_body_discriminator + i, joint_name_index)) {
+      return false;
+    }
+
+    if (fixed_record.name_length == 0) {
+      continue;
+    }
+
+    std::string body_name;
+    if (!LoadName (name_table, header.name_table_size,
+          fixed_record.name_offset, fixed_record.name_length, body_name)) {
+      std::cerr << "Error: invalid name of fixed body " << i
+        << " in compiled model!" << std::endl;
+      return false;
+    }
+
+    if (!body_name_map.insert (std::make_pair (body_name,
+            model->fixed_body_discriminator + i)).second) {
+      std::cerr << "Error: Body with name '" << body_name
+        << "' already exists!" << std::endl;
+      return false;
+    }
+  }
+
+  // build the model
+  model->gravity.set (header.gravity[0], header.gravity[1],
+      header.gravity[2]);
+
+  model->BeginBulkConstruction (header.body_count - 1);
+
+  Body body;
+  for (unsigned int i = 0; i < header.body_count; i++) {
+    memcpy (&record, body_data + i * sizeof (CompiledBodyRecord),
+        sizeof (CompiledBodyRecord));
+
+    body.mMass = record.mass;
+    body.mCenterOfMass.set (record.center_of_mass[0],
+        record.center_of_mass[1], record.center_of_mass[2]);
+    body.mInertia = LoadInertia (record.inertia);
+    body.mIsVirtual = record.is_virtual != 0;
+
+    if (i == 0) {
+      model->mBodies[0] = body;
+      model->I[0] = SpatialRigidBodyInertia::createFromMassComInertiaC (
+          body.mMass, body.mCenterOfMass, body.mInertia);
+      continue;
+    }
+
+    // the joint axes are copied exactly instead of being recomputed by
+    // the constructors of Joint
+    Joint joint (JointTypeCustom, record.dof_count);
+    joint.mJointType = static_cast<JointType>(record.joint_type);
+    joint.custom_joint_index = -1;
+    for (unsigned int j = 0; j < record.dof_count; j++) {
+      joint.mJointAxes[j].set (
+          record.joint_axes[j][0], record.joint_axes[j][1],
+          record.joint_axes[j][2], record.joint_axes[j][3],
+          record.joint_axes[j][4], record.joint_axes[j][5]);
+    }
+
+    // the names were already added to body_name_map
+    unsigned int body_id = model->AddBody (record.parent_id,
+        LoadTransform (record.joint_frame_E, record.joint_frame_r),
+        joint,
+        body);
+
+    if (body_id != i) {
+      std::cerr << "Error: body " << i << " of compiled model was added as "
+        << "body " << body_id << "!" << std::endl;
+      model->EndBulkConstruction();
+      return false;
+    }
+  }
+
+  model->EndBulkConstruction();
+
+  model->mFixedBodies.resize (header.fixed_body_count);
+  for (unsigned int i = 0; i < header.fixed_body_count; i++) {
+    memcpy (&fixed_record,
+        fixed_body_data + i * sizeof (CompiledFixedBodyRecord),
+        sizeof (CompiledFixedBodyRecord));
+
+    FixedBody &fbody = model->mFixedBodies[i];
+    fbody.mMass = fixed_record.mass;
+    fbody.mCenterOfMass.set (fixed_record.center_of_mass[0],
+        fixed_record.center_of_mass[1], fixed_record.center_of_mass[2]);
+    fbody.mInertia = LoadInertia (fixed_record.inertia);
+    fbody.mMovableParent = fixed_record.movable_parent_id;
+    fbody.mParentTransform = LoadTransform (fixed_record.parent_transform_E,
+        fixed_record.parent_transform_r);
+    fbody.mBaseTransform = SpatialTransform();
+  }
+
+  model->mBodyNameMap.swap (body_name_map);
+  model->mJointNameIndex = joint_name_index;
+  model->UpdateNameIndices();
+
+  if (verbose) {
+    std::cout << "Loaded compiled model with " << header.body_count - 1
+      << " movable bodies, " << header.fixed_body_count
+      << " fixed bodies, and " << model->dof_count
+      << " degrees of freedom" << std::endl;
+  }
+
+  return true;
+}
+
+RBDL_DLLAPI bool CompiledModelReadFromFile (
+    const char *filename,
+    Model *model,
+    bool verbose) {
+#ifdef RBDL_COMPILED_MODEL_USE_MMAP
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error opening file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat (fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    std::cerr << "Error reading file '" << filename << "'!" << std::endl;
+    close (fd);
+    return false;
+  }
+
+  size_t size = static_cast<size_t>(file_stat.st_size);
+  void *data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (data == MAP_FAILED) {
+    std::cerr << "Error mapping file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  bool result = CompiledModelReadFromMemory (data, size, model, verbose);
+  munmap (data, size);
+
+  return result;
+#else
+  FILE *file = fopen (filename, "rb");
+  if (!file) {
+    std::cerr << "Error opening file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  std::vector<char> buffer;
+  long size = -1;
+  if (fseek (file, 0, SEEK_END) == 0) {
+    size = ftell (file);
+  }
+
+  if (size > 0 && fseek (file, 0, SEEK_SET) == 0) {
+    buffer.resize (static_cast<size_t>(size));
+    if (fread (&buffer[0], 1, buffer.size(), file) != buffer.size()) {
+      buffer.clear();
+    }
+  }
+  fclose (file);
+
+  if (buffer.size() == 0) {
+    std::cerr << "Error reading file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  return CompiledModelReadFromMemory (&buffer[0], buffer.size(), model,
+      verbose);
+#endif
+}
+
+}
@@ -8,6 +8,8 @@
 #include <iostream>
 #include <sstream>
 #include <limits>
+#include <algorithm>
+#include <cmath>
 #include <assert.h>
 
 #include "rbdl/rbdl_mathutils.h"
@@ -51,6 +53,11 @@ unsigned int ConstraintSet::AddContactConstraint (
 
   constraintType.push_back (ContactConstraint);
   name.push_back (name_str);
+  if (name_str.size() != 0) {
+    mNameIndex.Insert (name_str, name.size() - 1);
+  }
+  active.push_back (true);
+  mActiveConstraintIndices.push_back(size());
   mContactConstraintIndices.push_back(size());
 
   // These variables will be used for this type of constraint.
@@ -108,6 +115,11 @@ unsigned int ConstraintSet::AddLoopConstraint (
 
   constraintType.push_back(LoopConstraint);
   name.push_back (name_str);
+  if (name_str.size() != 0) {
+    mNameIndex.Insert (name_str, name.size() - 1);
+  }
+  active.push_back (true);
+  mActiveConstraintIndices.push_back(size());
   mLoopConstraintIndices.push_back(size());
 
   // These variables will be used for this kind of constraint.
@@ -183,7 +195,12 @@ unsigned int ConstraintSet::AddCustomConstraint(
       constraintType.push_back( ConstraintTypeCustom );
       nameConstraintIndex << name_str << "_" << i;
       name.push_back (nameConstraintIndex.str());
+      if (name_str.size() != 0) {
+        mNameIndex.Insert (name.back(), name.size() - 1);
+      }
       nameConstraintIndex.str(std::string());
+      active.push_back (true);
+      mActiveConstraintIndices.push_back(n_constr_start_idx + i);
       if(i==0){
         mCustomConstraintIndices.push_back(n_constr_start_idx);
       }
@@ -238,7 +255,56 @@ unsigned int ConstraintSet::AddCustomConstraint(
   return n_constr_size - 1;
 }
 
-bool ConstraintSet::Bind (const Model &model) {
+/** \brief Marks the degrees of freedom that influence the motion of a
+ * body.
+ */
+static void MarkSupportDoFs (
+  const Model &model,
+  unsigned int body_id,
+  std::vector<bool> &dof_mask
+  ) {
+  if (body_id >= model.fixed_body_discriminator) {
+    body_id = model.mFixedBodies[body_id - model.fixed_body_discriminator]
+      .mMovableParent;
+  }
+
+  while (body_id != 0) {
+    const Joint &joint = model.mJoints[body_id];
+    for (unsigned int i = 0; i < joint.mDoFCount; i++) {
+      dof_mask[joint.q_index + i] = true;
+    }
+    body_id = model.lambda[body_id];
+  }
+}
+
+/** \brief Appends the sorted indices of the marked degrees of freedom
+ * closed under Model::lambda_q to indices.
+ */
+static void AppendMarkedDoFs (
+  const Model &model,
+  std::vector<bool> &dof_mask,
+  std::vector<unsigned int> &indices
+  ) {
+  // The sparse solves propagate values along lambda_q, hence the pattern
+  // has to contain all lambda_q ancestors of its entries.
+  for (unsigned int i = model.dof_count; i > 0; i--) {
+    if (dof_mask[i - 1]) {
+      unsigned int j = model.lambda_q[i];
+      while (j != 0 && !dof_mask[j - 1]) {
+        dof_mask[j - 1] = true;
+        j = model.lambda_q[j];
+      }
+    }
+  }
+
+  for (unsigned int i = 0; i < model.dof_count; i++) {
+    if (dof_mask[i]) {
+      indices.push_back (i);
+    }
+  }
+}
+
+bool ConstraintSet::Bind (const Model &model, unsigned int solvers) {
   assert (bound == false);
 
   if (bound) {
@@ -255,57 +321,271 @@ bool ConstraintSet::Bind (const Model &model) {
   gamma.setZero();
   G.conservativeResize (n_constr, model.dof_count);
   G.setZero();
-  A.conservativeResize (model.dof_count + n_constr, model.dof_count + n_constr);
-  A.setZero();
-  b.conservativeResize (model.dof_count + n_constr);
-  b.setZero();
-  x.conservativeResize (model.dof_count + n_constr);
-  x.setZero();
 
   Gi.conservativeResize (3, model.qdot_size);
   GSpi.conservativeResize (6, model.qdot_size);
   GSsi.conservativeResize (6, model.qdot_size);
   GSJ.conservativeResize (6, model.qdot_size);
+  QDDot_0.conservativeResize (model.dof_count);
+  QDDot_0.setZero();
+
+  mActiveConstraintIndices.reserve (n_constr);
+
+  // Sparsity pattern of G: a row of a contact or loop constraint can only
+  // be nonzero on the degrees of freedom that move the involved bodies.
+  // CustomConstraint rows are treated as dense.
+  std::vector<bool> dof_mask (model.dof_count);
+  mGColumnIndices.clear();
+  mGRowOffsets.assign (1, 0);
+  for (unsigned int i = 0; i < n_constr; i++) {
+    dof_mask.assign (model.dof_count, constraintType[i] == ConstraintTypeCustom);
+
+    if (constraintType[i] == ContactConstraint) {
+      MarkSupportDoFs (model, body[i], dof_mask);
+    } else if (constraintType[i] == LoopConstraint) {
+      MarkSupportDoFs (model, body_p[i], dof_mask);
+      MarkSupportDoFs (model, body_s[i], dof_mask);
+    }
+
+    AppendMarkedDoFs (model, dof_mask, mGColumnIndices);
+    mGRowOffsets.push_back (mGColumnIndices.size());
+  }
 
-  // HouseHolderQR crashes if matrix G has more rows than columns.
+  // Release the workspaces that may have been copied from another set so
+  // that only the requested ones are held.
+  A.resize (0, 0);
+  b.resize (0);
+  x.resize (0);
 #ifdef RBDL_USE_SIMPLE_MATH
-  GT_qr = SimpleMath::HouseholderQR<Math::MatrixNd> (G.transpose());
+  GT_qr = SimpleMath::HouseholderQR<Math::MatrixNd> ();
 #else
-  GT_qr = Eigen::HouseholderQR<Math::MatrixNd> (G.transpose());
+  GT_qr = Eigen::HouseholderQR<Math::MatrixNd> ();
 #endif
-  GT_qr_Q = MatrixNd::Zero (model.dof_count, model.dof_count);
-  Y = MatrixNd::Zero (model.dof_count, G.rows());
-  Z = MatrixNd::Zero (model.dof_count, model.dof_count - G.rows());
-  qddot_y = VectorNd::Zero (model.dof_count);
-  qddot_z = VectorNd::Zero (model.dof_count);
+  GT_qr_Q.resize (0, 0);
+  Y.resize (0, 0);
+  Z.resize (0, 0);
+  qddot_y.resize (0);
+  qddot_z.resize (0);
+#ifndef RBDL_USE_SIMPLE_MATH
+  A_decomposition.Release();
+  GY_decomposition.Release();
+  HZ.resize (0, 0);
+  ZHZ.resize (0, 0);
+  // see LinearSystemDecomposition::Release()
+  ZHZ_llt.compute (MatrixNd::Identity (1, 1));
+  K_llt.compute (MatrixNd::Identity (1, 1));
+#endif
+  K.resize (0, 0);
+  a.resize (0);
+  QDDot_t.resize (0);
+  std::vector<SpatialVector>().swap (f_t);
+  std::vector<SpatialVector>().swap (f_ext_constraints);
+  std::vector<Vector3d>().swap (point_accel_0);
+  std::vector<SpatialVector>().swap (d_pA);
+  std::vector<SpatialVector>().swap (d_a);
+  d_u.resize (0);
+  std::vector<SpatialMatrix>().swap (d_IA);
+  std::vector<SpatialVector>().swap (d_U);
+  d_d.resize (0);
+  std::vector<Vector3d>().swap (d_multdof3_u);
+  std::vector<unsigned int>().swap (id_unactuated);
+  std::vector<unsigned int>().swap (id_W_perm);
+  std::vector<unsigned int>().swap (id_M_perm);
+  id_W.resize (0, 0);
+  id_V.resize (0, 0);
+  id_A.resize (0, 0);
+  id_M.resize (0, 0);
+  id_b.resize (0);
+  id_x.resize (0);
+  id_y.resize (0);
+
+  allocated_solvers = 0;
+  AllocateSolverWorkspace (model, solvers);
 
-  K.conservativeResize (n_constr, n_constr);
-  K.setZero();
-  a.conservativeResize (n_constr);
-  a.setZero();
-  QDDot_t.conservativeResize (model.dof_count);
-  QDDot_t.setZero();
-  QDDot_0.conservativeResize (model.dof_count);
-  QDDot_0.setZero();
-  f_t.resize (n_constr, SpatialVector::Zero());
-  f_ext_constraints.resize (model.mBodies.size(), SpatialVector::Zero());
-  point_accel_0.resize (n_constr, Vector3d::Zero());
+  bound = true;
+
+  return bound;
+}
 
-  d_pA =std::vector<SpatialVector> (model.mBodies.size(),SpatialVector::Zero());
-  d_a = std::vector<SpatialVector> (model.mBodies.size(),SpatialVector::Zero());
-  d_u = VectorNd::Zero (model.mBodies.size());
+void ConstraintSet::AllocateSolverWorkspace (
+  const Model &model,
+  unsigned int solvers
+  ) {
+  unsigned int missing = solvers & ~allocated_solvers;
 
-  d_IA = std::vector<SpatialMatrix> (model.mBodies.size()
-    , SpatialMatrix::Identity());
-  d_U = std::vector<SpatialVector> (model.mBodies.size(),SpatialVector::Zero());
-  d_d = VectorNd::Zero (model.mBodies.size());
+  if (missing == 0) {
+    return;
+  }
 
-  d_multdof3_u = std::vector<Math::Vector3d> (model.mBodies.size()
-    , Math::Vector3d::Zero());
+  unsigned int n_constr = size();
 
-  bound = true;
+  if (missing & SolverDirect) {
+    A = MatrixNd::Zero (model.dof_count + n_constr
+      , model.dof_count + n_constr);
+    b = VectorNd::Zero (model.dof_count + n_constr);
+  }
 
-  return bound;
+  if (missing & (SolverDirect | SolverRangeSpaceSparse | SolverNullSpace)) {
+    x = VectorNd::Zero (model.dof_count + n_constr);
+  }
+
+  if (missing & (SolverRangeSpaceSparse | SolverNullSpace)) {
+    Y = MatrixNd::Zero (model.dof_count, n_constr);
+  }
+
+  if (missing & SolverNullSpace) {
+    // HouseHolderQR crashes if matrix G has more rows than columns.
+#ifdef RBDL_USE_SIMPLE_MATH
+    GT_qr = SimpleMath::HouseholderQR<Math::MatrixNd> (G.transpose());
+#else
+    GT_qr = Eigen::HouseholderQR<Math::MatrixNd> (G.transpose());
+#endif
+    GT_qr_Q = MatrixNd::Zero (model.dof_count, model.dof_count);
+    Z = MatrixNd::Zero (model.dof_count, model.dof_count - n_constr);
+    qddot_y = VectorNd::Zero (model.dof_count);
+    qddot_z = VectorNd::Zero (model.dof_count);
+#ifndef RBDL_USE_SIMPLE_MATH
+    GY_decomposition.Allocate (n_constr, linear_solver);
+    HZ = MatrixNd::Zero (model.dof_count, model.dof_count);
+    ZHZ = MatrixNd::Zero (model.dof_count, model.dof_count);
+    // Decomposing an identity matrix allocates the storage and, unlike
+    // the sized constructor, sets the status of the LLT.
+    ZHZ_llt.compute (MatrixNd::Identity (model.dof_count, model.dof_count));
+#endif
+  }
+
+#ifndef RBDL_USE_SIMPLE_MATH
+  if (missing & SolverDirect) {
+    A_decomposition.Allocate (model.dof_count + n_constr, linear_solver);
+  }
+
+  if (missing & SolverRangeSpaceSparse) {
+    // see ZHZ_llt above
+    K_llt.compute (MatrixNd::Identity (n_constr, n_constr));
+  }
+#endif
+
+  if (missing & (SolverRangeSpaceSparse | SolverKokkevis)) {
+    K = MatrixNd::Zero (n_constr, n_constr);
+    a = VectorNd::Zero (n_constr);
+  }
+
+  if (missing & SolverKokkevis) {
+    QDDot_t = VectorNd::Zero (model.dof_count);
+    f_t.assign (n_constr, SpatialVector::Zero());
+    f_ext_constraints.assign (model.mBodies.size(), SpatialVector::Zero());
+    point_accel_0.assign (n_constr, Vector3d::Zero());
+
+    d_pA.assign (model.mBodies.size(), SpatialVector::Zero());
+    d_a.assign (model.mBodies.size(), SpatialVector::Zero());
+    d_u = VectorNd::Zero (model.mBodies.size());
+
+    d_IA.assign (model.mBodies.size(), SpatialMatrix::Identity());
+    d_U.assign (model.mBodies.size(), SpatialVector::Zero());
+    d_d = VectorNd::Zero (model.mBodies.size());
+
+    d_multdof3_u.assign (model.mBodies.size(), Math::Vector3d::Zero());
+  }
+
+  if (missing & SolverInverseDynamics) {
+    // Sized for any selection of unactuated degrees of freedom.
+    id_unactuated.reserve (model.dof_count);
+    id_W_perm.reserve (model.dof_count);
+    id_M_perm.reserve (n_constr + model.dof_count);
+    id_W = MatrixNd::Zero (model.dof_count, model.dof_count);
+    id_V = MatrixNd::Zero (model.dof_count, model.dof_count);
+    id_A = MatrixNd::Zero (n_constr + model.dof_count, model.dof_count);
+    id_M = MatrixNd::Zero (n_constr + model.dof_count
+      , n_constr + model.dof_count);
+    id_b = VectorNd::Zero (n_constr + model.dof_count);
+    id_x = VectorNd::Zero (n_constr + model.dof_count);
+    id_y = VectorNd::Zero (n_constr + model.dof_count);
+  }
+
+  allocated_solvers |= solvers;
+}
+
+template <typename T>
+static size_t VectorMemorySize (const std::vector<T> &values) {
+  return values.capacity() * sizeof (T);
+}
+
+size_t ConstraintSet::GetWorkspaceSize (unsigned int solvers) const {
+  size_t result = 0;
+
+  if (solvers & SolverDirect) {
+    result += A.size() * sizeof(double);
+    result += b.size() * sizeof(double);
+  }
+
+  if (solvers & (SolverDirect | SolverRangeSpaceSparse | SolverNullSpace)) {
+    result += x.size() * sizeof(double);
+  }
+
+  if (solvers & (SolverRangeSpaceSparse | SolverNullSpace)) {
+    result += Y.size() * sizeof(double);
+  }
+
+  if (solvers & SolverNullSpace) {
+    if (allocated_solvers & SolverNullSpace) {
+      // factorization of G^T and its Householder coefficients
+      result += (G.size() + G.rows()) * sizeof(double);
+    }
+    result += GT_qr_Q.size() * sizeof(double);
+    result += Z.size() * sizeof(double);
+    result += qddot_y.size() * sizeof(double);
+    result += qddot_z.size() * sizeof(double);
+#ifndef RBDL_USE_SIMPLE_MATH
+    result += GY_decomposition.GetMemorySize();
+    result += HZ.size() * sizeof(double);
+    result += ZHZ.size() * sizeof(double);
+    result += ZHZ_llt.rows() * ZHZ_llt.cols() * sizeof(double);
+#endif
+  }
+
+#ifndef RBDL_USE_SIMPLE_MATH
+  if (solvers & SolverDirect) {
+    result += A_decomposition.GetMemorySize();
+  }
+
+  if (solvers & SolverRangeSpaceSparse) {
+    result += K_llt.rows() * K_llt.cols() * sizeof(double);
+  }
+#endif
+
+  if (solvers & (SolverRangeSpaceSparse | SolverKokkevis)) {
+    result += K.size() * sizeof(double);
+    result += a.size() * sizeof(double);
+  }
+
+  if (solvers & SolverKokkevis) {
+    result += QDDot_t.size() * sizeof(double);
+    result += VectorMemorySize (f_t);
+    result += VectorMemorySize (f_ext_constraints);
+    result += VectorMemorySize (point_accel_0);
+    result += VectorMemorySize (d_pA);
+    result += VectorMemorySize (d_a);
+    result += d_u.size() * sizeof(double);
+    result += VectorMemorySize (d_IA);
+    result += VectorMemorySize (d_U);
+    result += d_d.size() * sizeof(double);
+    result += VectorMemorySize (d_multdof3_u);
+  }
+
+  if (solvers & SolverInverseDynamics) {
+    result += VectorMemorySize (id_unactuated);
+    result += VectorMemorySize (id_W_perm);
+    result += VectorMemorySize (id_M_perm);
+    result += id_W.size() * sizeof(double);
+    result += id_V.size() * sizeof(double);
+    result += id_A.size() * sizeof(double);
+    result += id_M.size() * sizeof(double);
+    result += id_b.size() * sizeof(double);
+    result += id_x.size() * sizeof(double);
+    result += id_y.size() * sizeof(double);
+  }
+
+  return result;
 }
 
 void ConstraintSet::clear() {
@@ -345,6 +625,526 @@ void ConstraintSet::clear() {
   d_u.setZero();
 }
 
+void ConstraintSet::SetActive (unsigned int constraint_id, bool is_active) {
+  assert (constraint_id < size());
+
+  if (active[constraint_id] == is_active) {
+    return;
+  }
+
+  active[constraint_id] = is_active;
+
+  // The capacity of the index list already covers all constraints, hence
+  // rebuilding it does not allocate memory.
+  mActiveConstraintIndices.clear();
+  for (unsigned int i = 0; i < active.size(); i++) {
+    if (active[i]) {
+      mActiveConstraintIndices.push_back (i);
+    }
+  }
+}
+
+/** \brief Moves the rows of the active constraints to the top of the
+ * workspaces.
+ *
+ * The rows of ConstraintSet::G of all active constraints are moved to the
+ * top of G and the corresponding entries of rhs are stored in the top of
+ * ConstraintSet::gamma. rhs may be ConstraintSet::gamma itself. The
+ * remaining rows of G and gamma are set to zero.
+ *
+ * \returns the number of active constraints
+ */
+static unsigned int CompactActiveConstraints (
+  ConstraintSet &CS,
+  const VectorNd &rhs
+  ) {
+  const unsigned int n_active = CS.mActiveConstraintIndices.size();
+  const unsigned int n_cols = CS.G.cols();
+
+  for (unsigned int k = 0; k < n_active; k++) {
+    // The indices are sorted, i.e. c >= k, therefore no row gets
+    // overwritten before it was moved.
+    const unsigned int c = CS.mActiveConstraintIndices[k];
+    if (c != k) {
+      CS.G.block(k, 0, 1, n_cols) = CS.G.block(c, 0, 1, n_cols);
+    }
+    CS.gamma[k] = rhs[c];
+  }
+
+  for (unsigned int k = n_active; k < CS.G.rows(); k++) {
+    for (unsigned int j = 0; j < n_cols; j++) {
+      CS.G(k, j) = 0.;
+    }
+    CS.gamma[k] = 0.;
+  }
+
+  return n_active;
+}
+
+/** \brief Scatters compacted constraint values back to their constraints.
+ *
+ * Entries of inactive constraints are set to zero.
+ */
+static void ScatterActiveConstraintValues (
+  const ConstraintSet &CS,
+  const VectorNd &compact,
+  unsigned int offset,
+  double scale,
+  VectorNd &values
+  ) {
+  values.setZero();
+  for (unsigned int k = 0; k < CS.mActiveConstraintIndices.size(); k++) {
+    values[CS.mActiveConstraintIndices[k]] = scale * compact[offset + k];
+  }
+}
+
+#ifndef RBDL_USE_SIMPLE_MATH
+/** \brief Applies the adjoint of the first length Householder reflections
+ * of a QR decomposition to x.
+ *
+ * Same as x.applyOnTheLeft(householderQ().adjoint()) but without the
+ * temporaries that Eigen creates for each reflection.
+ */
+static void ApplyHouseholderAdjointInPlace (
+  const MatrixNd &vectors,
+  const VectorNd &coeffs,
+  unsigned int length,
+  Eigen::Ref<VectorNd> x
+  ) {
+  const unsigned int n = x.size();
+
+  for (unsigned int k = 0; k < length; k++) {
+    const unsigned int m = n - k - 1;
+    const double w = coeffs[k] * (x[k]
+        + vectors.col(k).tail(m).dot (x.tail(m)));
+
+    x[k] -= w;
+    x.tail(m) -= w * vectors.col(k).tail(m);
+  }
+}
+
+void LinearSystemDecomposition::Allocate (
+  unsigned int n,
+  LinearSolver linear_solver
+  ) {
+  Release();
+
+  switch (linear_solver) {
+    case (LinearSolverPartialPivLU) :
+      lu = Eigen::PartialPivLU<MatrixNd> (n);
+      break;
+    case (LinearSolverColPivHouseholderQR) :
+      colpiv_qr = Eigen::ColPivHouseholderQR<MatrixNd> (n, n);
+      break;
+    case (LinearSolverHouseholderQR) :
+      qr = Eigen::HouseholderQR<MatrixNd> (n, n);
+      break;
+    default:
+      LOG << "Error: Invalid linear solver: " << linear_solver << std::endl;
+      assert (0);
+      break;
+  }
+
+  workspace = VectorNd::Zero (n);
+  solver = linear_solver;
+}
+
+void LinearSystemDecomposition::Release () {
+  lu = Eigen::PartialPivLU<MatrixNd> ();
+  qr = Eigen::HouseholderQR<MatrixNd> ();
+  // Assigning a default constructed ColPivHouseholderQR copies its
+  // uninitialized pivot members. Decomposing a 1x1 matrix instead shrinks
+  // all its buffers (an empty matrix is rejected by Eigen's assertions).
+  colpiv_qr.compute (MatrixNd::Zero (1, 1));
+  workspace.resize (0);
+  solver = LinearSolverUnknown;
+}
+
+void LinearSystemDecomposition::Compute (
+  const Eigen::Ref<const MatrixNd> &A,
+  LinearSolver linear_solver
+  ) {
+  if (linear_solver != solver
+      || workspace.size() != A.rows()) {
+    Allocate (A.rows(), linear_solver);
+  }
+
+  switch (solver) {
+    case (LinearSolverPartialPivLU) :
+      lu.compute (A);
+      break;
+    case (LinearSolverColPivHouseholderQR) :
+      colpiv_qr.compute (A);
+      break;
+    case (LinearSolverHouseholderQR) :
+      qr.compute (A);
+      break;
+    default:
+      break;
+  }
+}
+
+void LinearSystemDecomposition::SolveInPlace (Eigen::Ref<VectorNd> x) {
+  // Same as the solve() methods of the decompositions, but the right-hand
+  // side is neither copied nor are temporaries created.
+  switch (solver) {
+    case (LinearSolverPartialPivLU) :
+      workspace.noalias() = lu.solve (x);
+      x = workspace;
+      break;
+    case (LinearSolverColPivHouseholderQR) : {
+      const unsigned int n = x.size();
+      const unsigned int nonzero_pivots = colpiv_qr.nonzeroPivots();
+
+      ApplyHouseholderAdjointInPlace (colpiv_qr.matrixQR()
+          , colpiv_qr.hCoeffs(), nonzero_pivots, x);
+      colpiv_qr.matrixQR().topLeftCorner (nonzero_pivots, nonzero_pivots)
+        .triangularView<Eigen::Upper>().solveInPlace (
+            x.head (nonzero_pivots));
+
+      const Eigen::ColPivHouseholderQR<MatrixNd>::PermutationType::IndicesType
+        &indices = colpiv_qr.colsPermutation().indices();
+      for (unsigned int i = 0; i < n; i++) {
+        workspace[indices[i]] = i < nonzero_pivots ? x[i] : 0.;
+      }
+      x = workspace;
+      break;
+    }
+    case (LinearSolverHouseholderQR) :
+      ApplyHouseholderAdjointInPlace (qr.matrixQR(), qr.hCoeffs(), x.size()
+          , x);
+      qr.matrixQR().triangularView<Eigen::Upper>().solveInPlace (x);
+      break;
+    default:
+      LOG << "Error: Invalid linear solver: " << solver << std::endl;
+      assert (0);
+      break;
+  }
+}
+
+size_t LinearSystemDecomposition::GetMemorySize () const {
+  const size_t n = workspace.size();
+
+  switch (solver) {
+    case (LinearSolverPartialPivLU) :
+      return (n * n + n) * sizeof(double) + 2 * n * sizeof(int);
+    case (LinearSolverColPivHouseholderQR) :
+      // matrix, Householder coefficients, temporary, column norms and the
+      // workspace
+      return (n * n + 5 * n) * sizeof(double) + 2 * n * sizeof(int);
+    case (LinearSolverHouseholderQR) :
+      return (n * n + 3 * n) * sizeof(double);
+    default:
+      return 0;
+  }
+}
+#endif
+
+/** \brief Variant of SolveConstrainedSystemDirect() that only uses the
+ * first n_active (compacted) rows of ConstraintSet::G and
+ * ConstraintSet::gamma. The solution is stored in the top of
+ * ConstraintSet::x.
+ */
+static void SolveActiveConstrainedSystemDirect (
+  ConstraintSet &CS,
+  const VectorNd &c,
+  unsigned int n_active
+  ) {
+  const unsigned int n_dof = c.rows();
+
+#ifdef RBDL_USE_SIMPLE_MATH
+  const unsigned int n = n_dof + n_active;
+
+  CS.A.block(0, 0, n_dof, n_dof) = CS.H;
+  CS.A.block(0, n_dof, n_dof, n_active)
+    = CS.G.block(0, 0, n_active, n_dof).transpose();
+  CS.A.block(n_dof, 0, n_active, n_dof) = CS.G.block(0, 0, n_active, n_dof);
+  CS.A.block(n_dof, n_dof, n_active, n_active)
+    = MatrixNd::Zero (n_active, n_active);
+
+  CS.b.block(0, 0, n_dof, 1) = c;
+  CS.b.block(n_dof, 0, n_active, 1) = CS.gamma.block(0, 0, n_active, 1);
+
+  // SimpleMath blocks cannot be decomposed, hence solve on a copy
+  MatrixNd A_active = CS.A.block(0, 0, n, n);
+  VectorNd b_active = CS.b.block(0, 0, n, 1);
+  VectorNd x_active (VectorNd::Zero (n));
+
+  SolveLinearSystem (A_active, b_active, x_active, CS.linear_solver);
+
+  CS.x.block(0, 0, n, 1) = x_active;
+#else
+  const unsigned int n_constr = CS.G.rows();
+
+  // The rows of the inactive constraints in G and gamma are zero. Their
+  // rows and columns in A get replaced by identity rows which decouples
+  // them from the system and keeps the size of the full system.
+  CS.A.block(0, 0, n_dof, n_dof) = CS.H;
+  CS.A.block(0, n_dof, n_dof, n_constr) = CS.G.transpose();
+  CS.A.block(n_dof, 0, n_constr, n_dof) = CS.G;
+  CS.A.block(n_dof, n_dof, n_constr, n_constr).setZero();
+  for (unsigned int k = n_active; k < n_constr; k++) {
+    CS.A(n_dof + k, n_dof + k) = 1.;
+  }
+
+  CS.b.segment(0, n_dof) = c;
+  CS.b.segment(n_dof, n_constr) = CS.gamma;
+
+  CS.A_decomposition.Compute (CS.A, CS.linear_solver);
+
+  // SolveConstrainedSystemDirect() expects the bottom right block of A to
+  // be zero.
+  for (unsigned int k = n_active; k < n_constr; k++) {
+    CS.A(n_dof + k, n_dof + k) = 0.;
+  }
+
+  CS.x = CS.b;
+  CS.A_decomposition.SolveInPlace (CS.x);
+#endif
+}
+
+/** \brief Solves L^T x = b in place on column col of X for a right-hand
+ * side b that is only nonzero on the entries in indices.
+ *
+ * The indices have to be sorted and closed under Model::lambda_q (which is
+ * the case for the rows of ConstraintSet::mGColumnIndices). Only those
+ * entries of the column are read and written.
+ */
+static void SparseSolveLTxPattern (
+  const Model &model,
+  const MatrixNd &L,
+  MatrixNd &X,
+  unsigned int col,
+  const unsigned int *indices,
+  unsigned int count
+  ) {
+  for (unsigned int p = count; p > 0; p--) {
+    const unsigned int i = indices[p - 1];
+    X(i,col) = X(i,col) / L(i,i);
+    unsigned int j = model.lambda_q[i + 1];
+    while (j != 0) {
+      X(j - 1,col) = X(j - 1,col) - L(i,j - 1) * X(i,col);
+      j = model.lambda_q[j];
+    }
+  }
+}
+
+/** \brief Range-space solver on the first n_active (compacted) rows of
+ * ConstraintSet::G and ConstraintSet::gamma.
+ *
+ * Same as SolveConstrainedSystemRangeSpaceSparse() but exploits the
+ * sparsity pattern of the constraint Jacobian: the columns of Y = L^-T G^T
+ * are only computed on the structurally nonzero entries of the rows of G
+ * and K = Y^T Y is only accumulated over the overlapping entries. The
+ * constraint forces are stored in the top of ConstraintSet::x.
+ */
+static void SolveActiveConstrainedSystemRangeSpaceSparse (
+  Model &model,
+  ConstraintSet &CS,
+  const VectorNd &c,
+  VectorNd &qddot,
+  unsigned int n_active
+  ) {
+  const unsigned int *col_indices = CS.mGColumnIndices.empty() ? NULL
+    : &CS.mGColumnIndices[0];
+
+  SparseFactorizeLTL (model, CS.H);
+
+  // Y = L^-T G^T, solved in place on the columns of Y. Entries of Y
+  // outside of the pattern of the row are never written nor read.
+  for (unsigned int k = 0; k < n_active; k++) {
+    const unsigned int row = CS.mActiveConstraintIndices[k];
+    const unsigned int start = CS.mGRowOffsets[row];
+    const unsigned int count = CS.mGRowOffsets[row + 1] - start;
+
+    for (unsigned int p = start; p < start + count; p++) {
+      CS.Y(col_indices[p], k) = CS.G(k, col_indices[p]);
+    }
+
+    SparseSolveLTxPattern (model, CS.H, CS.Y, k, col_indices + start
+        , count);
+  }
+
+  // z = L^-T c, stored in qddot until it gets computed
+  qddot = c;
+  SparseSolveLTx (model, CS.H, qddot);
+
+  // K = Y^T Y and a = gamma - Y^T z over the structural nonzeros only
+  for (unsigned int k = 0; k < n_active; k++) {
+    const unsigned int row_k = CS.mActiveConstraintIndices[k];
+    const unsigned int end_k = CS.mGRowOffsets[row_k + 1];
+
+    double a_k = CS.gamma[k];
+    for (unsigned int p = CS.mGRowOffsets[row_k]; p < end_k; p++) {
+      a_k -= CS.Y(col_indices[p], k) * qddot[col_indices[p]];
+    }
+    CS.a[k] = a_k;
+
+    for (unsigned int l = 0; l <= k; l++) {
+      const unsigned int row_l = CS.mActiveConstraintIndices[l];
+      const unsigned int end_l = CS.mGRowOffsets[row_l + 1];
+      unsigned int p = CS.mGRowOffsets[row_k];
+      unsigned int q = CS.mGRowOffsets[row_l];
+
+      double K_kl = 0.;
+      while (p < end_k && q < end_l) {
+        if (col_indices[p] < col_indices[q]) {
+          p++;
+        } else if (col_indices[q] < col_indices[p]) {
+          q++;
+        } else {
+          K_kl += CS.Y(col_indices[p], k) * CS.Y(col_indices[p], l);
+          p++;
+          q++;
+        }
+      }
+
+      CS.K(k,l) = K_kl;
+      CS.K(l,k) = K_kl;
+    }
+  }
+
+#ifdef RBDL_USE_SIMPLE_MATH
+  // SimpleMath blocks cannot be decomposed, hence solve on a copy
+  MatrixNd K_active = CS.K.block(0, 0, n_active, n_active);
+  VectorNd a_active = CS.a.block(0, 0, n_active, 1);
+  CS.x.block(0, 0, n_active, 1) = K_active.llt().solve(a_active);
+#else
+  // Inactive constraints are decoupled by identity rows, such that K keeps
+  // its size and is decomposed without allocating memory.
+  const unsigned int n_constr = CS.K.rows();
+  CS.K.block(n_active, 0, n_constr - n_active, n_constr).setZero();
+  CS.K.block(0, n_active, n_active, n_constr - n_active).setZero();
+  for (unsigned int k = n_active; k < n_constr; k++) {
+    CS.K(k,k) = 1.;
+  }
+
+  CS.x.segment(0, n_active) = CS.a.segment(0, n_active);
+  CS.x.segment(n_active, n_constr - n_active).setZero();
+
+  CS.K_llt.compute (CS.K);
+  CS.K_llt.solveInPlace (CS.x.segment(0, n_constr));
+#endif
+
+  qddot = c;
+  for (unsigned int k = 0; k < n_active; k++) {
+    const unsigned int row = CS.mActiveConstraintIndices[k];
+    for (unsigned int p = CS.mGRowOffsets[row]; p < CS.mGRowOffsets[row + 1];
+        p++) {
+      qddot[col_indices[p]] += CS.G(k, col_indices[p]) * CS.x[k];
+    }
+  }
+  SparseSolveLTx (model, CS.H, qddot);
+  SparseSolveLx (model, CS.H, qddot);
+}
+
+/** \brief Variant of SolveConstrainedSystemNullSpace() that only uses the
+ * first n_active (compacted) rows of ConstraintSet::G and
+ * ConstraintSet::gamma. The range and null space bases are taken directly
+ * from ConstraintSet::GT_qr_Q and the constraint forces are stored in the
+ * top of ConstraintSet::x. The systems are solved with the preallocated
+ * decompositions of the ConstraintSet.
+ */
+static void SolveActiveConstrainedSystemNullSpace (
+  ConstraintSet &CS,
+  const VectorNd &c,
+  VectorNd &qddot,
+  unsigned int n_active
+  ) {
+  const unsigned int n_dof = c.rows();
+  const unsigned int n_null = n_dof - n_active;
+
+#ifdef RBDL_USE_SIMPLE_MATH
+  CS.GT_qr.compute (CS.G.block(0, 0, n_active, n_dof).transpose());
+  CS.GT_qr_Q = CS.GT_qr.householderQ();
+
+  // SimpleMath blocks cannot be multiplied, hence work on copies of the
+  // active parts
+  MatrixNd G_active = CS.G.block(0, 0, n_active, n_dof);
+  MatrixNd Y_active = CS.GT_qr_Q.block(0, 0, n_dof, n_active);
+  MatrixNd Z_active = CS.GT_qr_Q.block(0, n_active, n_dof, n_null);
+
+  MatrixNd GY = G_active * Y_active;
+  VectorNd gamma_active = CS.gamma.block(0, 0, n_active, 1);
+  VectorNd qddot_y (VectorNd::Zero (n_active));
+
+  SolveLinearSystem (GY, gamma_active, qddot_y, CS.linear_solver);
+
+  CS.qddot_y = c - CS.H * Y_active * qddot_y;
+  CS.qddot_z = (Z_active.transpose() * CS.H * Z_active).llt().solve(
+      Z_active.transpose() * CS.qddot_y);
+
+  qddot = Y_active * qddot_y + Z_active * CS.qddot_z;
+
+  VectorNd lambda_rhs = Y_active.transpose() * (CS.H * qddot - c);
+  VectorNd lambda (VectorNd::Zero (n_active));
+  SolveLinearSystem (GY, lambda_rhs, lambda, CS.linear_solver);
+
+  CS.x.block(0, 0, n_active, 1) = lambda;
+#else
+  // The rows of the inactive constraints in G are zero, hence the
+  // Householder reflections of their columns in G^T are the identity and
+  // the first n_active columns of Q span the range space of the active
+  // constraints. All decompositions keep the size of the full set.
+  const unsigned int n_constr = CS.G.rows();
+
+  CS.GT_qr.compute (CS.G.transpose());
+  CS.GT_qr.householderQ().evalTo (CS.GT_qr_Q, CS.qddot_z);
+
+  // G Y is stored in the top left of Y with identity rows for the
+  // inactive constraints. The range space part of qddot is solved in the
+  // second n_constr entries of x.
+  CS.Y.block(0, 0, n_constr, n_active).noalias()
+    = CS.G * CS.GT_qr_Q.block(0, 0, n_dof, n_active);
+  CS.Y.block(0, n_active, n_constr, n_constr - n_active).setZero();
+  for (unsigned int k = n_active; k < n_constr; k++) {
+    CS.Y(k,k) = 1.;
+  }
+
+  CS.GY_decomposition.Compute (CS.Y.block(0, 0, n_constr, n_constr)
+      , CS.linear_solver);
+
+  CS.x.segment(n_constr, n_constr) = CS.gamma;
+  CS.GY_decomposition.SolveInPlace (CS.x.segment(n_constr, n_constr));
+
+  qddot.noalias() = CS.GT_qr_Q.block(0, 0, n_dof, n_active)
+    * CS.x.segment(n_constr, n_active);
+  CS.qddot_y = c;
+  CS.qddot_y.noalias() -= CS.H * qddot;
+
+  // Z^T H Z is stored in the bottom right of ZHZ with an identity block
+  // in the top left.
+  CS.HZ.block(0, n_active, n_dof, n_null).noalias()
+    = CS.H * CS.GT_qr_Q.block(0, n_active, n_dof, n_null);
+  CS.ZHZ.block(n_active, n_active, n_null, n_null).noalias()
+    = CS.GT_qr_Q.block(0, n_active, n_dof, n_null).transpose()
+    * CS.HZ.block(0, n_active, n_dof, n_null);
+  CS.ZHZ.block(0, 0, n_active, n_dof).setZero();
+  CS.ZHZ.block(n_active, 0, n_null, n_active).setZero();
+  for (unsigned int k = 0; k < n_active; k++) {
+    CS.ZHZ(k,k) = 1.;
+  }
+
+  CS.ZHZ_llt.compute (CS.ZHZ);
+
+  CS.qddot_z.segment(0, n_active).setZero();
+  CS.qddot_z.segment(n_active, n_null).noalias()
+    = CS.GT_qr_Q.block(0, n_active, n_dof, n_null).transpose() * CS.qddot_y;
+  CS.ZHZ_llt.solveInPlace (CS.qddot_z);
+
+  qddot.noalias() += CS.GT_qr_Q.block(0, n_active, n_dof, n_null)
+    * CS.qddot_z.segment(n_active, n_null);
+
+  CS.qddot_y.noalias() = CS.H * qddot;
+  CS.qddot_y -= c;
+  CS.x.segment(0, n_active).noalias()
+    = CS.GT_qr_Q.block(0, 0, n_dof, n_active).transpose() * CS.qddot_y;
+  CS.x.segment(n_active, n_constr - n_active).setZero();
+
+  CS.GY_decomposition.SolveInPlace (CS.x.segment(0, n_constr));
+#endif
+}
+
 RBDL_DLLAPI
 void SolveConstrainedSystemDirect (
   Math::MatrixNd &H, 
@@ -476,7 +1276,7 @@ void SolveConstrainedSystemNullSpace (
     case (LinearSolverPartialPivLU) :
 #ifdef RBDL_USE_SIMPLE_MATH
       // SimpleMath does not have a LU solver so just use its QR solver
-      qddot_y = (G * Y).householderQr().solve (gamma);
+      lambda = (G * Y).householderQr().solve (Y.transpose() * (H * qddot - c));
 #else
       lambda = (G * Y).partialPivLu().solve (Y.transpose() * (H * qddot - c));
 #endif
@@ -988,8 +1788,21 @@ void ForwardDynamicsConstraintsDirect (
   ) {
   LOG << "-------- " << __func__ << " --------" << std::endl;
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverDirect);
+
   CalcConstrainedSystemVariables (model, Q, QDot, Tau, CS, f_ext);
 
+  if (CS.GetActiveCount() < CS.size()) {
+    unsigned int n_active = CompactActiveConstraints (CS, CS.gamma);
+    SolveActiveConstrainedSystemDirect (CS, Tau - CS.C, n_active);
+
+    for (unsigned int i = 0; i < model.dof_count; i++)
+      QDDot[i] = CS.x[i];
+
+    ScatterActiveConstraintValues (CS, CS.x, model.dof_count, -1., CS.force);
+    return;
+  }
+
   SolveConstrainedSystemDirect (CS.H, CS.G, Tau - CS.C, CS.gamma, QDDot
     , CS.force, CS.A, CS.b, CS.x, CS.linear_solver);
 
@@ -1013,10 +1826,14 @@ void ForwardDynamicsConstraintsRangeSpaceSparse (
   Math::VectorNd &QDDot,
   std::vector<Math::SpatialVector> *f_ext) {
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverRangeSpaceSparse);
+
   CalcConstrainedSystemVariables (model, Q, QDot, Tau, CS, f_ext);
 
-  SolveConstrainedSystemRangeSpaceSparse (model, CS.H, CS.G, Tau - CS.C
-    , CS.gamma, QDDot, CS.force, CS.K, CS.a, CS.linear_solver);
+  unsigned int n_active = CompactActiveConstraints (CS, CS.gamma);
+  SolveActiveConstrainedSystemRangeSpaceSparse (model, CS, Tau - CS.C, QDDot
+      , n_active);
+  ScatterActiveConstraintValues (CS, CS.x, 0, 1., CS.force);
 }
 
 RBDL_DLLAPI
@@ -1030,10 +1847,19 @@ void ForwardDynamicsConstraintsNullSpace (
   std::vector<Math::SpatialVector> *f_ext
   ) {
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverNullSpace);
+
   LOG << "-------- " << __func__ << " --------" << std::endl;
 
   CalcConstrainedSystemVariables (model, Q, QDot, Tau, CS, f_ext);
 
+  if (CS.GetActiveCount() < CS.size()) {
+    unsigned int n_active = CompactActiveConstraints (CS, CS.gamma);
+    SolveActiveConstrainedSystemNullSpace (CS, Tau - CS.C, QDDot, n_active);
+    ScatterActiveConstraintValues (CS, CS.x, 0, 1., CS.force);
+    return;
+  }
+
   CS.GT_qr.compute (CS.G.transpose());
 #ifdef RBDL_USE_SIMPLE_MATH
   CS.GT_qr_Q = CS.GT_qr.householderQ();
@@ -1058,6 +1884,8 @@ void ComputeConstraintImpulsesDirect (
   Math::VectorNd &QDotPlus
   ) {
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverDirect);
+
   // Compute H
   UpdateKinematicsCustom (model, &Q, NULL, NULL);
   CompositeRigidBodyAlgorithm (model, Q, CS.H, false);
@@ -1065,6 +1893,18 @@ void ComputeConstraintImpulsesDirect (
   // Compute G
   CalcConstraintsJacobian (model, Q, CS, CS.G, false);
 
+  if (CS.GetActiveCount() < CS.size()) {
+    unsigned int n_active = CompactActiveConstraints (CS, CS.v_plus);
+    SolveActiveConstrainedSystemDirect (CS, CS.H * QDotMinus, n_active);
+
+    for (unsigned int i = 0; i < model.dof_count; i++)
+      QDotPlus[i] = CS.x[i];
+
+    ScatterActiveConstraintValues (CS, CS.x, model.dof_count, 1.
+        , CS.impulse);
+    return;
+  }
+
   SolveConstrainedSystemDirect (CS.H, CS.G, CS.H * QDotMinus, CS.v_plus
     , QDotPlus, CS.impulse, CS.A, CS.b, CS.x, CS.linear_solver);
 
@@ -1088,6 +1928,8 @@ void ComputeConstraintImpulsesRangeSpaceSparse (
   Math::VectorNd &QDotPlus
   ) {
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverRangeSpaceSparse);
+
   // Compute H
   UpdateKinematicsCustom (model, &Q, NULL, NULL);
   CompositeRigidBodyAlgorithm (model, Q, CS.H, false);
@@ -1095,8 +1937,10 @@ void ComputeConstraintImpulsesRangeSpaceSparse (
   // Compute G
   CalcConstraintsJacobian (model, Q, CS, CS.G, false);
 
-  SolveConstrainedSystemRangeSpaceSparse (model, CS.H, CS.G, CS.H * QDotMinus
-    , CS.v_plus, QDotPlus, CS.impulse, CS.K, CS.a, CS.linear_solver);
+  unsigned int n_active = CompactActiveConstraints (CS, CS.v_plus);
+  SolveActiveConstrainedSystemRangeSpaceSparse (model, CS, CS.H * QDotMinus
+      , QDotPlus, n_active);
+  ScatterActiveConstraintValues (CS, CS.x, 0, 1., CS.impulse);
 
 }
 
@@ -1109,6 +1953,8 @@ void ComputeConstraintImpulsesNullSpace (
   Math::VectorNd &QDotPlus
   ) {
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverNullSpace);
+
   // Compute H
   UpdateKinematicsCustom (model, &Q, NULL, NULL);
   CompositeRigidBodyAlgorithm (model, Q, CS.H, false);
@@ -1116,6 +1962,14 @@ void ComputeConstraintImpulsesNullSpace (
   // Compute G
   CalcConstraintsJacobian (model, Q, CS, CS.G, false);
 
+  if (CS.GetActiveCount() < CS.size()) {
+    unsigned int n_active = CompactActiveConstraints (CS, CS.v_plus);
+    SolveActiveConstrainedSystemNullSpace (CS, CS.H * QDotMinus, QDotPlus
+        , n_active);
+    ScatterActiveConstraintValues (CS, CS.x, 0, 1., CS.impulse);
+    return;
+  }
+
   CS.GT_qr.compute(CS.G.transpose());
   CS.GT_qr_Q = CS.GT_qr.householderQ();
 
@@ -1128,6 +1982,360 @@ void ComputeConstraintImpulsesNullSpace (
     , CS.linear_solver);
 }
 
+/** \brief Determines the unactuated degrees of freedom for
+ * InverseDynamicsConstraints().
+ *
+ * If no explicit selection is given, the degrees of freedom of joints that
+ * attach a body to the base and have six degrees of freedom are unactuated.
+ * Joints that are emulated by a chain of virtual bodies are followed to
+ * their last body.
+ */
+static void CalcUnactuatedDoFIndices (
+  const Model &model,
+  const std::vector<bool> *actuated_dofs,
+  std::vector<unsigned int> &indices
+  ) {
+  indices.clear();
+
+  if (actuated_dofs != NULL) {
+    if (actuated_dofs->size() != model.dof_count) {
+      std::cerr << "Error: size of actuated_dofs (" << actuated_dofs->size()
+        << ") does not match the degrees of freedom of the model ("
+        << model.dof_count << ")!" << std::endl;
+      assert (0);
+      abort();
+    }
+
+    for (unsigned int i = 0; i < model.dof_count; i++) {
+      if (!(*actuated_dofs)[i]) {
+        indices.push_back (i);
+      }
+    }
+    return;
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (model.lambda[i] != 0) {
+      continue;
+    }
+
+    const size_t joint_start = indices.size();
+    unsigned int body_id = i;
+
+    while (true) {
+      const Joint &joint = model.mJoints[body_id];
+      unsigned int dof_count = joint.mDoFCount;
+      if (joint.mJointType == JointTypeCustom) {
+        dof_count =
+          model.mCustomJoints[joint.custom_joint_index]->mDoFCount;
+      }
+
+      for (unsigned int j = 0; j < dof_count; j++) {
+        indices.push_back (joint.q_index + j);
+      }
+
+      if (!model.mBodies[body_id].mIsVirtual || model.mu[body_id].empty()) {
+        break;
+      }
+      body_id = model.mu[body_id][0];
+    }
+
+    if (indices.size() - joint_start != 6) {
+      indices.resize (joint_start);
+    }
+  }
+}
+
+/** \brief Computes the pivoted Cholesky factorization P W P^T = L L^T of
+ * the symmetric positive semi-definite top left n x n block of W.
+ *
+ * L is stored in the lower triangle of the block and perm[k] is the index
+ * of the k-th pivot. The factorization stops at the first pivot that is
+ * negligible compared to the largest diagonal entry of W.
+ *
+ * \returns the numerical rank of W
+ */
+static unsigned int FactorizePivotedCholesky (
+  MatrixNd &W,
+  unsigned int n,
+  std::vector<unsigned int> &perm
+  ) {
+  perm.resize (n);
+
+  double max_diag = 0.;
+  for (unsigned int i = 0; i < n; i++) {
+    perm[i] = i;
+    max_diag = std::max (max_diag, W(i,i));
+  }
+  const double threshold = max_diag * n * 1.0e-12;
+
+  for (unsigned int k = 0; k < n; k++) {
+    unsigned int pivot = k;
+    for (unsigned int i = k + 1; i < n; i++) {
+      if (W(i,i) > W(pivot,pivot)) {
+        pivot = i;
+      }
+    }
+
+    if (W(pivot,pivot) <= threshold) {
+      return k;
+    }
+
+    if (pivot != k) {
+      std::swap (perm[k], perm[pivot]);
+      for (unsigned int i = 0; i < n; i++) {
+        std::swap (W(k,i), W(pivot,i));
+      }
+      for (unsigned int i = 0; i < n; i++) {
+        std::swap (W(i,k), W(i,pivot));
+      }
+    }
+
+    const double l_kk = std::sqrt (W(k,k));
+    W(k,k) = l_kk;
+    for (unsigned int i = k + 1; i < n; i++) {
+      W(i,k) /= l_kk;
+    }
+
+    for (unsigned int j = k + 1; j < n; j++) {
+      for (unsigned int i = j; i < n; i++) {
+        W(i,j) -= W(i,k) * W(j,k);
+        W(j,i) = W(i,j);
+      }
+    }
+  }
+
+  return n;
+}
+
+/** \brief Solves W x = b using the factorization of
+ * FactorizePivotedCholesky().
+ *
+ * The entries of x that belong to pivots beyond the rank are zero. The
+ * first n entries of y are used as workspace.
+ */
+static void SolvePivotedCholesky (
+  const MatrixNd &L,
+  unsigned int n,
+  unsigned int rank,
+  const std::vector<unsigned int> &perm,
+  const VectorNd &b,
+  VectorNd &x,
+  VectorNd &y
+  ) {
+  for (unsigned int k = 0; k < rank; k++) {
+    double value = b[perm[k]];
+    for (unsigned int j = 0; j < k; j++) {
+      value -= L(k,j) * y[j];
+    }
+    y[k] = value / L(k,k);
+  }
+
+  for (int k = static_cast<int>(rank) - 1; k >= 0; k--) {
+    double value = y[k];
+    for (unsigned int j = k + 1; j < rank; j++) {
+      value -= L(j,k) * y[j];
+    }
+    y[k] = value / L(k,k);
+  }
+
+  for (unsigned int i = 0; i < n; i++) {
+    x[i] = 0.;
+  }
+  for (unsigned int k = 0; k < rank; k++) {
+    x[perm[k]] = y[k];
+  }
+}
+
+/** \brief Computes a basis of the null space of the matrix that was
+ * factorized by FactorizePivotedCholesky() with a rank below n.
+ *
+ * The n - rank basis vectors are stored in the first columns of V. The
+ * first rank entries of y are used as workspace.
+ */
+static void CalcPivotedCholeskyNullSpace (
+  const MatrixNd &L,
+  unsigned int n,
+  unsigned int rank,
+  const std::vector<unsigned int> &perm,
+  MatrixNd &V,
+  VectorNd &y
+  ) {
+  for (unsigned int c = 0; c < n - rank; c++) {
+    // L11^T y = -L21^T e_c
+    for (int k = static_cast<int>(rank) - 1; k >= 0; k--) {
+      double value = -L(rank + c, k);
+      for (unsigned int j = k + 1; j < rank; j++) {
+        value -= L(j,k) * y[j];
+      }
+      y[k] = value / L(k,k);
+    }
+
+    for (unsigned int i = 0; i < n; i++) {
+      V(i,c) = 0.;
+    }
+    for (unsigned int k = 0; k < rank; k++) {
+      V(perm[k],c) = y[k];
+    }
+    V(perm[rank + c],c) = 1.;
+  }
+}
+
+RBDL_DLLAPI
+void InverseDynamicsConstraints (
+  Model &model,
+  const Math::VectorNd &Q,
+  const Math::VectorNd &QDot,
+  const Math::VectorNd &QDDotDesired,
+  ConstraintSet &CS,
+  Math::VectorNd &QDDotOutput,
+  Math::VectorNd &TauOutput,
+  const std::vector<bool> *actuated_dofs,
+  std::vector<Math::SpatialVector> *f_ext
+  ) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  const unsigned int n_dof = model.dof_count;
+
+  assert (QDDotDesired.size() == n_dof);
+  assert (QDDotOutput.size() == n_dof);
+  assert (TauOutput.size() == n_dof);
+
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverInverseDynamics);
+
+  // Compute H, C, G, and gamma. The generalized forces are not used by it.
+  CalcConstrainedSystemVariables (model, Q, QDot, TauOutput, CS, f_ext);
+
+  const unsigned int n_active = CompactActiveConstraints (CS, CS.gamma);
+
+  CalcUnactuatedDoFIndices (model, actuated_dofs, CS.id_unactuated);
+  const std::vector<unsigned int> &unact = CS.id_unactuated;
+  const unsigned int n_unact = unact.size();
+
+  // The unactuated rows of the equations of motion
+  //   H_u qddot + C_u = G_u^T force
+  // only involve the columns G_u of G of the unactuated degrees of
+  // freedom. W = G_u^T G_u is at most 6 x 6 for a floating base.
+  for (unsigned int i = 0; i < n_unact; i++) {
+    for (unsigned int j = 0; j <= i; j++) {
+      double value = 0.;
+      for (unsigned int k = 0; k < n_active; k++) {
+        value += CS.G(k, unact[i]) * CS.G(k, unact[j]);
+      }
+      CS.id_W(i,j) = value;
+      CS.id_W(j,i) = value;
+    }
+  }
+
+  const unsigned int rank_W =
+    FactorizePivotedCholesky (CS.id_W, n_unact, CS.id_W_perm);
+  const unsigned int n_cond = n_unact - rank_W;
+
+  // Directions V with G_u V = 0 cannot be compensated by constraint forces
+  // and require V^T (H_u qddot + C_u) = 0.
+  if (n_cond > 0) {
+    CalcPivotedCholeskyNullSpace (CS.id_W, n_unact, rank_W, CS.id_W_perm,
+        CS.id_V, CS.id_y);
+  }
+
+  // Stack the conditions A qddot = b, i.e. G qddot = gamma and
+  // V^T H_u qddot = -V^T C_u.
+  const unsigned int n_rows = n_active + n_cond;
+
+  for (unsigned int k = 0; k < n_active; k++) {
+    for (unsigned int j = 0; j < n_dof; j++) {
+      CS.id_A(k,j) = CS.G(k,j);
+    }
+    CS.id_b[k] = CS.gamma[k];
+  }
+
+  for (unsigned int c = 0; c < n_cond; c++) {
+    for (unsigned int j = 0; j < n_dof; j++) {
+      double value = 0.;
+      for (unsigned int i = 0; i < n_unact; i++) {
+        value += CS.id_V(i,c) * CS.H(unact[i], j);
+      }
+      CS.id_A(n_active + c, j) = value;
+    }
+
+    double value = 0.;
+    for (unsigned int i = 0; i < n_unact; i++) {
+      value -= CS.id_V(i,c) * CS.C[unact[i]];
+    }
+    CS.id_b[n_active + c] = value;
+  }
+
+  // Accelerations closest to the desired ones that fulfill the conditions:
+  // qddot = qddot_desired + A^T (A A^T)^+ (b - A qddot_desired)
+  for (unsigned int r = 0; r < n_rows; r++) {
+    double value = CS.id_b[r];
+    for (unsigned int j = 0; j < n_dof; j++) {
+      value -= CS.id_A(r,j) * QDDotDesired[j];
+    }
+    CS.id_b[r] = value;
+
+    for (unsigned int s = 0; s <= r; s++) {
+      double product = 0.;
+      for (unsigned int j = 0; j < n_dof; j++) {
+        product += CS.id_A(r,j) * CS.id_A(s,j);
+      }
+      CS.id_M(r,s) = product;
+      CS.id_M(s,r) = product;
+    }
+  }
+
+  const unsigned int rank_M =
+    FactorizePivotedCholesky (CS.id_M, n_rows, CS.id_M_perm);
+  SolvePivotedCholesky (CS.id_M, n_rows, rank_M, CS.id_M_perm, CS.id_b,
+      CS.id_x, CS.id_y);
+
+  for (unsigned int j = 0; j < n_dof; j++) {
+    double value = QDDotDesired[j];
+    for (unsigned int r = 0; r < n_rows; r++) {
+      value += CS.id_A(r,j) * CS.id_x[r];
+    }
+    QDDotOutput[j] = value;
+  }
+
+  for (unsigned int i = 0; i < n_dof; i++) {
+    double value = CS.C[i];
+    for (unsigned int j = 0; j < n_dof; j++) {
+      value += CS.H(i,j) * QDDotOutput[j];
+    }
+    TauOutput[i] = value;
+  }
+
+  // Constraint forces of minimal norm that balance the unactuated rows:
+  // force = G_u mu with W mu = H_u qddot + C_u
+  for (unsigned int i = 0; i < n_unact; i++) {
+    CS.id_b[i] = TauOutput[unact[i]];
+  }
+  SolvePivotedCholesky (CS.id_W, n_unact, rank_W, CS.id_W_perm, CS.id_b,
+      CS.id_x, CS.id_y);
+
+  for (unsigned int k = 0; k < n_active; k++) {
+    double value = 0.;
+    for (unsigned int i = 0; i < n_unact; i++) {
+      value += CS.G(k, unact[i]) * CS.id_x[i];
+    }
+    CS.id_b[k] = value;
+  }
+
+  // The actuated rows directly give tau = H qddot + C - G^T force.
+  for (unsigned int j = 0; j < n_dof; j++) {
+    double value = TauOutput[j];
+    for (unsigned int k = 0; k < n_active; k++) {
+      value -= CS.G(k,j) * CS.id_b[k];
+    }
+    TauOutput[j] = value;
+  }
+  for (unsigned int i = 0; i < n_unact; i++) {
+    TauOutput[unact[i]] = 0.;
+  }
+
+  ScatterActiveConstraintValues (CS, CS.id_b, 0, 1., CS.force);
+}
+
 /** \brief Compute only the effects of external forces on the generalized accelerations
  *
  * This function is a reduced version of ForwardDynamics() which only
@@ -1143,12 +2351,13 @@ void ForwardDynamicsApplyConstraintForces (
     VectorNd &QDDot
     ) {
   LOG << "-------- " << __func__ << " --------" << std::endl;
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverKokkevis);
   assert (QDDot.size() == model.dof_count);
 
   unsigned int i = 0;
 
   for (i = 1; i < model.mBodies.size(); i++) {
-    model.IA[i] = model.I[i].toMatrix();;
+    model.IA[i].createFromRigidBodyInertia (model.I[i]);
     model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
 
     if (CS.f_ext_constraints[i] != SpatialVector::Zero()) {
@@ -1173,20 +2382,17 @@ void ForwardDynamicsApplyConstraintForces (
         - model.multdof3_S[i].transpose() * model.pA[i];
 
       if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i] - (model.multdof3_U[i] 
-            * model.multdof3_Dinv[i] 
-            * model.multdof3_U[i].transpose());
+        Matrix63 UDinv (model.multdof3_U[i] * model.multdof3_Dinv[i]);
+        SpatialArticulatedBodyInertia Ia (model.IA[i]);
+        Ia.subtractSymmetricProduct (UDinv, model.multdof3_U[i], 3);
 
         SpatialVector pa = model.pA[i] + Ia * model.c[i] 
-          + model.multdof3_U[i] * model.multdof3_Dinv[i] * model.multdof3_u[i];
+          + UDinv * model.multdof3_u[i];
 
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += (model.X_lambda[i].toMatrixTranspose() 
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda] += (model.X_lambda[i].toMatrixTranspose() 
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose() 
@@ -1198,17 +2404,15 @@ void ForwardDynamicsApplyConstraintForces (
 
       unsigned int lambda = model.lambda[i];
       if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i] 
-          - model.U[i] * (model.U[i] / model.d[i]).transpose();
+        SpatialVector UDinv (model.U[i] / model.d[i]);
+        SpatialArticulatedBodyInertia Ia (model.IA[i]);
+        Ia.subtractSymmetricProduct (UDinv, model.U[i], 1);
         SpatialVector pa =  model.pA[i] + Ia * model.c[i] 
-          + model.U[i] * model.u[i] / model.d[i];
+          + UDinv * model.u[i];
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += (model.X_lambda[i].toMatrixTranspose() 
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda] += (model.X_lambda[i].toMatrixTranspose() 
-            * Ia * model.X_lambda[i].toMatrix());
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = " 
@@ -1230,24 +2434,17 @@ void ForwardDynamicsApplyConstraintForces (
             * model.pA[i]);
 
       if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i]
-          - (   model.mCustomJoints[kI]->U
-              * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->U.transpose());
+        MatrixNd UDinv (model.mCustomJoints[kI]->U
+            * model.mCustomJoints[kI]->Dinv);
+        SpatialArticulatedBodyInertia Ia (model.IA[i]);
+        Ia.subtractSymmetricProduct (UDinv, model.mCustomJoints[kI]->U, dofI);
 
         SpatialVector pa = model.pA[i] + Ia * model.c[i]
-          + (   model.mCustomJoints[kI]->U
-              * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->u);
+          + UDinv * model.mCustomJoints[kI]->u;
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
-
         model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
-
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = " << model.pA[lambda].transpose()
@@ -1317,6 +2514,8 @@ void ForwardDynamicsAccelerationDeltas (
     ) {
   LOG << "-------- " << __func__ << " ------" << std::endl;
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverKokkevis);
+
   assert (CS.d_pA.size() == model.mBodies.size());
   assert (CS.d_a.size() == model.mBodies.size());
   assert (CS.d_u.size() == model.mBodies.size());
@@ -1452,6 +2651,8 @@ void ForwardDynamicsContactsKokkevis (
   ) {
   LOG << "-------- " << __func__ << " ------" << std::endl;
 
+  CS.AllocateSolverWorkspace (model, ConstraintSet::SolverKokkevis);
+
   assert (CS.f_ext_constraints.size() == model.mBodies.size());
   assert (CS.QDDot_0.size() == model.dof_count);
   assert (CS.QDDot_t.size() == model.dof_count);
@@ -1477,6 +2678,13 @@ void ForwardDynamicsContactsKokkevis (
   // compute the effects of each test force
   for(ci = 0; ci < CS.size(); ci++) {
 
+    // Inactive constraints get a decoupled unit row in K and therefore
+    // a zero force.
+    if (!CS.active[ci]) {
+      CS.a[ci] = 0.;
+      continue;
+    }
+
     {
       SUPPRESS_LOGGING;
       UpdateKinematicsCustom(model, NULL, NULL, &CS.QDDot_0);
@@ -1512,6 +2720,14 @@ void ForwardDynamicsContactsKokkevis (
 
     LOG << "=== Testforce Loop Start ===" << std::endl;
 
+    if (!CS.active[ci]) {
+      for (unsigned int cj = 0; cj < CS.size(); cj++) {
+        CS.K(ci,cj) = 0.;
+      }
+      CS.K(ci,ci) = 1.;
+      continue;
+    }
+
     unsigned int movable_body_id = 0;
     Vector3d point_global;
 
@@ -1558,6 +2774,11 @@ void ForwardDynamicsContactsKokkevis (
         }
 
         for(unsigned int cj = 0; cj < CS.size(); cj++) {
+          if (!CS.active[cj]) {
+            CS.K(ci,cj) = 0.;
+            continue;
+          }
+
           {
             SUPPRESS_LOGGING;
 
@@ -1615,6 +2836,10 @@ void ForwardDynamicsContactsKokkevis (
   LOG << "f = " << CS.force.transpose() << std::endl;
 
   for (ci = 0; ci < CS.size(); ci++) {
+    if (!CS.active[ci]) {
+      continue;
+    }
+
     unsigned int body_id = CS.body[ci];
     unsigned int movable_body_id = body_id;
 
@@ -23,24 +23,27 @@ namespace RigidBodyDynamics {
 
 using namespace Math;
 
-RBDL_DLLAPI void InverseDynamics (
+/** \brief First pass of the recursive Newton-Euler algorithm.
+ *
+ * Computes the velocities and accelerations of all bodies and the forces
+ * Model::f that are needed to produce them.
+ */
+static void InverseDynamicsForwardPass (
     Model &model,
     const VectorNd &Q,
     const VectorNd &QDot,
-    const VectorNd &QDDot,
-    VectorNd &Tau,
-    std::vector<SpatialVector> *f_ext) {
-  LOG << "-------- " << __func__ << " --------" << std::endl;
-
+    const VectorNd &QDDot) {
   // Reset the velocity of the root body
   model.v[0].setZero();
   model.a[0].set (0., 0., 0., -model.gravity[0], -model.gravity[1], -model.gravity[2]);
 
+  jcalc_sincos (model, Q);
+
   for (unsigned int i = 1; i < model.mBodies.size(); i++) {
     unsigned int q_index = model.mJoints[i].q_index;
     unsigned int lambda = model.lambda[i];
 
-    jcalc (model, i, Q, QDot);
+    jcalc (model, i, Q, QDot, true);
 
     model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
     model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
@@ -59,7 +62,7 @@ RBDL_DLLAPI void InverseDynamics (
       }
     }else if(model.mJoints[i].mJointType == JointTypeCustom){
       unsigned int k = model.mJoints[i].custom_joint_index;
-      VectorNd customJointQDDot(model.mCustomJoints[k]->mDoFCount);
+      JointVectorN customJointQDDot(model.mCustomJoints[k]->mDoFCount);
       for(unsigned z = 0; z < model.mCustomJoints[k]->mDoFCount; ++z){
         customJointQDDot[z] = QDDot[q_index+z];
       }
@@ -74,15 +77,16 @@ RBDL_DLLAPI void InverseDynamics (
       model.f[i].setZero();
     }
   }
+}
 
-  if (f_ext != NULL) {
-    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
-      unsigned int lambda = model.lambda[i];
-      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
-      model.f[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
-    }
-  }
-
+/** \brief Second pass of the recursive Newton-Euler algorithm.
+ *
+ * Projects the forces Model::f onto the joints and propagates them to
+ * the parents.
+ */
+static void InverseDynamicsBackwardPass (
+    Model &model,
+    VectorNd &Tau) {
   for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
     if(model.mJoints[i].mJointType != JointTypeCustom){
       if (model.mJoints[i].mDoFCount == 1) {
@@ -104,22 +108,251 @@ RBDL_DLLAPI void InverseDynamics (
   }
 }
 
-RBDL_DLLAPI void NonlinearEffects ( 
+/** \brief Updates Model::X_base if any of the external forces is given in
+ * base coordinates.
+ */
+static void UpdateBaseTransformsForExternalForces (
+    Model &model,
+    const std::vector<ExternalForce> &f_ext) {
+  bool have_base_forces = false;
+  for (unsigned int k = 0; k < f_ext.size(); k++) {
+    if (!f_ext[k].in_body_coordinates) {
+      have_base_forces = true;
+      break;
+    }
+  }
+
+  if (!have_base_forces) {
+    return;
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int lambda = model.lambda[i];
+    if (lambda != 0) {
+      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+    } else {
+      model.X_base[i] = model.X_lambda[i];
+    }
+  }
+}
+
+/** \brief Subtracts the external forces from the body forces f, i.e.
+ * Model::f or Model::pA.
+ *
+ * Model::X_base has to be up to date for the forces that are given in
+ * base coordinates.
+ */
+static void SubtractExternalForces (
+    Model &model,
+    const std::vector<ExternalForce> &f_ext,
+    std::vector<SpatialVector> &f) {
+  for (unsigned int k = 0; k < f_ext.size(); k++) {
+    unsigned int body_id = f_ext[k].body_id;
+    SpatialVector force = f_ext[k].force;
+
+    if (model.IsFixedBodyId (body_id)) {
+      const FixedBody &fixed_body =
+        model.mFixedBodies[body_id - model.fixed_body_discriminator];
+      body_id = fixed_body.mMovableParent;
+
+      if (f_ext[k].in_body_coordinates) {
+        force = fixed_body.mParentTransform.applyTranspose (force);
+      }
+    }
+
+    assert (body_id > 0 && body_id < model.mBodies.size());
+
+    if (f_ext[k].in_body_coordinates) {
+      f[body_id] -= force;
+    } else {
+      f[body_id] -= model.X_base[body_id].applyAdjoint (force);
+    }
+  }
+}
+
+RBDL_DLLAPI void InverseDynamics (
     Model &model,
     const VectorNd &Q,
     const VectorNd &QDot,
+    const VectorNd &QDDot,
     VectorNd &Tau,
-    std::vector<Math::SpatialVector> *f_ext) {
+    std::vector<SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  InverseDynamicsForwardPass (model, Q, QDot, QDDot);
+
+  if (f_ext != NULL) {
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      unsigned int lambda = model.lambda[i];
+      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+      model.f[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
+    }
+  }
+
+  InverseDynamicsBackwardPass (model, Tau);
+}
+
+RBDL_DLLAPI void InverseDynamics (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &QDDot,
+    VectorNd &Tau,
+    const std::vector<ExternalForce> &f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  InverseDynamicsForwardPass (model, Q, QDot, QDDot);
+
+  UpdateBaseTransformsForExternalForces (model, f_ext);
+  SubtractExternalForces (model, f_ext, model.f);
+
+  InverseDynamicsBackwardPass (model, Tau);
+}
+
+/** \brief Marks the bodies that are affected by a change of the joints of
+ * the bodies in changed_body_ids.
+ *
+ * changed[i] is set if body i is in changed_body_ids, in_subtree[i] is
+ * set if body i is a changed body or one of its descendants, on_path[i] is
+ * set if body i is a changed body or one of its ancestors.
+ */
+static void CalcChangedBodyMasks (
+    const Model &model,
+    const std::vector<unsigned int> &changed_body_ids,
+    std::vector<bool> &changed,
+    std::vector<bool> &in_subtree,
+    std::vector<bool> &on_path) {
+  changed.assign (model.mBodies.size(), false);
+  in_subtree.assign (model.mBodies.size(), false);
+  on_path.assign (model.mBodies.size(), false);
+
+  for (unsigned int i = 0; i < changed_body_ids.size(); i++) {
+    unsigned int body_id = changed_body_ids[i];
+    assert (body_id > 0 && body_id < model.mBodies.size());
+
+    changed[body_id] = true;
+    in_subtree[body_id] = true;
+
+    while (body_id != 0 && !on_path[body_id]) {
+      on_path[body_id] = true;
+      body_id = model.lambda[body_id];
+    }
+  }
+
+  // parents always have smaller ids than their children
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (in_subtree[model.lambda[i]]) {
+      in_subtree[i] = true;
+    }
+  }
+}
+
+RBDL_DLLAPI void InverseDynamicsIncremental (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &QDDot,
+    VectorNd &Tau,
+    const std::vector<unsigned int> &changed_body_ids,
+    std::vector<SpatialVector> *f_ext) {
   LOG << "-------- " << __func__ << " --------" << std::endl;
 
+  std::vector<bool> changed;
+  std::vector<bool> in_subtree;
+  std::vector<bool> on_path;
+  CalcChangedBodyMasks (model, changed_body_ids, changed, in_subtree,
+      on_path);
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (!in_subtree[i] && !on_path[i]) {
+      continue;
+    }
+
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
+
+    // Motion only changes in the subtrees of the changed joints, the
+    // ancestors only need their body forces to be reset.
+    if (in_subtree[i]) {
+      if (changed[i]) {
+        jcalc (model, i, Q, QDot);
+      }
+
+      model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
+      model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+      model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
+
+      if (model.mJoints[i].mJointType == JointTypeCustom) {
+        unsigned int k = model.mJoints[i].custom_joint_index;
+        JointVectorN qdd_temp (QDDot.block(q_index, 0,
+              model.mCustomJoints[k]->mDoFCount, 1));
+        model.a[i] += model.mCustomJoints[k]->S * qdd_temp;
+      } else if (model.mJoints[i].mDoFCount == 1) {
+        model.a[i] += model.S[i] * QDDot[q_index];
+      } else if (model.mJoints[i].mDoFCount == 3) {
+        model.a[i] += model.multdof3_S[i]
+          * Vector3d (QDDot[q_index], QDDot[q_index + 1], QDDot[q_index + 2]);
+      }
+
+      if (f_ext != NULL) {
+        model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+      }
+    }
+
+    if (!model.mBodies[i].mIsVirtual) {
+      model.f[i] = model.I[i] * model.a[i] + crossf(model.v[i],model.I[i] * model.v[i]);
+    } else {
+      model.f[i].setZero();
+    }
+
+    if (f_ext != NULL) {
+      model.f[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
+    }
+  }
+
+  // The forces of unaffected children are still valid from the previous
+  // evaluation.
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    if (in_subtree[i] || on_path[i]) {
+      if (model.mJoints[i].mJointType != JointTypeCustom) {
+        if (model.mJoints[i].mDoFCount == 1) {
+          Tau[model.mJoints[i].q_index] = model.S[i].dot(model.f[i]);
+        } else if (model.mJoints[i].mDoFCount == 3) {
+          Tau.block<3,1>(model.mJoints[i].q_index, 0)
+            = model.multdof3_S[i].transpose() * model.f[i];
+        }
+      } else {
+        unsigned int k = model.mJoints[i].custom_joint_index;
+        Tau.block(model.mJoints[i].q_index,0,
+            model.mCustomJoints[k]->mDoFCount, 1)
+          = model.mCustomJoints[k]->S.transpose() * model.f[i];
+      }
+    }
+
+    unsigned int lambda = model.lambda[i];
+    if (lambda != 0 && (in_subtree[lambda] || on_path[lambda])) {
+      model.f[lambda] = model.f[lambda] + model.X_lambda[i].applyTranspose(model.f[i]);
+    }
+  }
+}
+
+/** \brief Computes the velocities of all bodies and the forces Model::f
+ * that are needed to produce zero joint accelerations.
+ */
+static void NonlinearEffectsForwardPass (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot) {
   SpatialVector spatial_gravity (0., 0., 0., -model.gravity[0], -model.gravity[1], -model.gravity[2]);
 
   // Reset the velocity of the root body
   model.v[0].setZero();
   model.a[0] = spatial_gravity;
 
+  jcalc_sincos (model, Q);
+
   for (unsigned int i = 1; i < model.mJointUpdateOrder.size(); i++) {
-    jcalc (model, model.mJointUpdateOrder[i], Q, QDot);
+    jcalc (model, model.mJointUpdateOrder[i], Q, QDot, true);
   }
 
   for (unsigned int i = 1; i < model.mBodies.size(); i++) {
@@ -134,9 +367,70 @@ RBDL_DLLAPI void NonlinearEffects (
 
     if (!model.mBodies[i].mIsVirtual) {
       model.f[i] = model.I[i] * model.a[i] + crossf(model.v[i],model.I[i] * model.v[i]);
-      if (f_ext != NULL && (*f_ext)[i] != SpatialVector::Zero()) {
+    } else {
+      model.f[i].setZero();
+    }
+  }
+}
+
+RBDL_DLLAPI void NonlinearEffects ( 
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    VectorNd &Tau,
+    std::vector<Math::SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  NonlinearEffectsForwardPass (model, Q, QDot);
+
+  if (f_ext != NULL) {
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      if (!model.mBodies[i].mIsVirtual
+          && (*f_ext)[i] != SpatialVector::Zero()) {
         model.f[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
-      }            
+      }
+    }
+  }
+
+  InverseDynamicsBackwardPass (model, Tau);
+}
+
+RBDL_DLLAPI void NonlinearEffects (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    VectorNd &Tau,
+    const std::vector<ExternalForce> &f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  NonlinearEffectsForwardPass (model, Q, QDot);
+
+  UpdateBaseTransformsForExternalForces (model, f_ext);
+  SubtractExternalForces (model, f_ext, model.f);
+
+  InverseDynamicsBackwardPass (model, Tau);
+}
+
+RBDL_DLLAPI void CalcGravityTorques (
+    Model &model,
+    const VectorNd &Q,
+    VectorNd &Tau,
+    bool update_kinematics) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  if (update_kinematics) {
+    UpdateKinematicsCustom (model, &Q, NULL, NULL);
+  }
+
+  // With zero velocities and accelerations every body only carries its
+  // own weight, i.e. only the transformations of the bodies are needed.
+  model.a[0].set (0., 0., 0., -model.gravity[0], -model.gravity[1], -model.gravity[2]);
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    model.a[i] = model.X_lambda[i].apply(model.a[model.lambda[i]]);
+
+    if (!model.mBodies[i].mIsVirtual) {
+      model.f[i] = model.I[i] * model.a[i];
     } else {
       model.f[i].setZero();
     }
@@ -164,209 +458,585 @@ RBDL_DLLAPI void NonlinearEffects (
   }
 }
 
-RBDL_DLLAPI void CompositeRigidBodyAlgorithm (
-    Model& model,
+/** \brief Adds X^T B X to result for a general 6x6 matrix B.
+ *
+ * The rows of B X are the rows of B transformed with
+ * SpatialTransform::applyTranspose(), X^T B X are the columns of B X
+ * transformed the same way.
+ */
+static void AddTransposeCongruence (
+    const SpatialTransform &X,
+    const SpatialMatrix &B,
+    SpatialMatrix &result) {
+  SpatialMatrix BX;
+
+  for (unsigned int r = 0; r < 6; r++) {
+    SpatialVector row = X.applyTranspose (SpatialVector (
+          B(r,0), B(r,1), B(r,2), B(r,3), B(r,4), B(r,5)));
+    for (unsigned int c = 0; c < 6; c++) {
+      BX(r,c) = row[c];
+    }
+  }
+
+  for (unsigned int c = 0; c < 6; c++) {
+    SpatialVector col = X.applyTranspose (SpatialVector (
+          BX(0,c), BX(1,c), BX(2,c), BX(3,c), BX(4,c), BX(5,c)));
+    for (unsigned int r = 0; r < 6; r++) {
+      result(r,c) += col[r];
+    }
+  }
+}
+
+RBDL_DLLAPI void CalcCoriolisMatrix (
+    Model &model,
     const VectorNd &Q,
-    MatrixNd &H,
+    const VectorNd &QDot,
+    MatrixNd &C,
     bool update_kinematics) {
   LOG << "-------- " << __func__ << " --------" << std::endl;
 
-  assert (H.rows() == model.dof_count && H.cols() == model.dof_count);
+  assert (C.rows() == model.dof_count && C.cols() == model.dof_count);
+
+  if (update_kinematics) {
+    UpdateKinematicsCustom (model, &Q, &QDot, NULL);
+  }
+
+  C.setZero();
+
+  // Motion subspace S and its time derivative for every degree of freedom
+  // expressed in the coordinates of the body of the joint.
+  std::vector<SpatialVector> &S = model.S_dof;
+  std::vector<SpatialVector> &S_dot = model.S_dot_dof;
+  std::vector<SpatialMatrix> &Bc = model.Bc;
 
   for (unsigned int i = 1; i < model.mBodies.size(); i++) {
-    if (update_kinematics) {
-      jcalc_X_lambda_S (model, i, Q);
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int dof_count = model.mJoints[i].mDoFCount;
+
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int k = model.mJoints[i].custom_joint_index;
+      dof_count = model.mCustomJoints[k]->mDoFCount;
+      for (unsigned int j = 0; j < dof_count; j++) {
+        S[q_index + j] = model.mCustomJoints[k]->S.block(0, j, 6, 1);
+      }
+    } else if (dof_count == 1) {
+      S[q_index] = model.S[i];
+    } else if (dof_count == 3) {
+      for (unsigned int j = 0; j < 3; j++) {
+        S[q_index + j] = model.multdof3_S[i].block(0, j, 6, 1);
+      }
+    }
+
+    // Joints whose motion subspace depends on q report its derivative only
+    // as c_J = dS/dt qdot, which gets distributed over the joint velocity.
+    double qdot_norm2 = 0.;
+    for (unsigned int j = 0; j < dof_count; j++) {
+      qdot_norm2 += QDot[q_index + j] * QDot[q_index + j];
+    }
+
+    for (unsigned int j = 0; j < dof_count; j++) {
+      S_dot[q_index + j] = crossm (model.v[i], S[q_index + j]);
+      if (qdot_norm2 > 0.) {
+        S_dot[q_index + j] += model.c_J[i] * (QDot[q_index + j] / qdot_norm2);
+      }
     }
+
+    // B = 1/2 (v x* I - I v x + (I v) xbar) with B v = v x* I v and
+    // dI/dt - 2 B skew-symmetric. Column k is B e_k where
+    // (I v) xbar e_k = e_k x* I v.
     model.Ic[i] = model.I[i];
+    SpatialVector Iv = model.I[i] * model.v[i];
+    for (unsigned int k = 0; k < 6; k++) {
+      SpatialVector e_k (SpatialVector::Zero());
+      e_k[k] = 1.;
+
+      SpatialVector B_col = 0.5 * (crossf (model.v[i], model.I[i] * e_k)
+          - model.I[i] * crossm (model.v[i], e_k)
+          + crossf (e_k, Iv));
+      for (unsigned int r = 0; r < 6; r++) {
+        Bc[i](r,k) = B_col[r];
+      }
+    }
   }
 
   for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
-    if (model.lambda[i] != 0) {
-      model.Ic[model.lambda[i]] = model.Ic[model.lambda[i]] + model.X_lambda[i].applyTranspose(model.Ic[i]);
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int dof_count = model.mJoints[i].mDoFCount;
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      dof_count = model.mCustomJoints[model.mJoints[i].custom_joint_index]
+        ->mDoFCount;
     }
 
-    unsigned int dof_index_i = model.mJoints[i].q_index;
+    for (unsigned int l = q_index; l < q_index + dof_count; l++) {
+      SpatialVector F_col = model.Ic[i] * S_dot[l] + Bc[i] * S[l];
+      SpatialVector F_row_I = model.Ic[i] * S[l];
+      SpatialVector F_row_B = Bc[i].transpose() * S[l];
 
-    if (model.mJoints[i].mDoFCount == 1 
-        && model.mJoints[i].mJointType != JointTypeCustom) {
-
-      SpatialVector F             = model.Ic[i] * model.S[i];
-      H(dof_index_i, dof_index_i) = model.S[i].dot(F);
-
-      unsigned int j = i;
-      unsigned int dof_index_j = dof_index_i;
-
-      while (model.lambda[j] != 0) {
-        F = model.X_lambda[j].applyTranspose(F);
-        j = model.lambda[j];
-        dof_index_j = model.mJoints[j].q_index;
-
-        if(model.mJoints[j].mJointType != JointTypeCustom) {
-          if (model.mJoints[j].mDoFCount == 1) {
-            H(dof_index_i,dof_index_j) = F.dot(model.S[j]);
-            H(dof_index_j,dof_index_i) = H(dof_index_i,dof_index_j);
-          } else if (model.mJoints[j].mDoFCount == 3) {
-            Vector3d H_temp2 = 
-              (F.transpose() * model.multdof3_S[j]).transpose();
-            LOG << F.transpose() << std::endl 
-              << model.multdof3_S[j] << std::endl;
-            LOG << H_temp2.transpose() << std::endl;
-
-            H.block<1,3>(dof_index_i,dof_index_j) = H_temp2.transpose();
-            H.block<3,1>(dof_index_j,dof_index_i) = H_temp2;
-          }
-        } else if (model.mJoints[j].mJointType == JointTypeCustom){        
-          unsigned int k      = model.mJoints[j].custom_joint_index;
-          unsigned int dof    = model.mCustomJoints[k]->mDoFCount;
-          VectorNd H_temp2    =
-            (F.transpose() * model.mCustomJoints[k]->S).transpose();
-
-          LOG << F.transpose()
-            << std::endl
-            << model.mCustomJoints[j]->S << std::endl;
+      for (unsigned int j = q_index; j < q_index + dof_count; j++) {
+        C(j,l) = S[j].dot(F_col);
+      }
 
-          LOG << H_temp2.transpose() << std::endl;
+      unsigned int k = i;
+      while (model.lambda[k] != 0) {
+        F_col = model.X_lambda[k].applyTranspose(F_col);
+        F_row_I = model.X_lambda[k].applyTranspose(F_row_I);
+        F_row_B = model.X_lambda[k].applyTranspose(F_row_B);
+        k = model.lambda[k];
+
+        unsigned int k_index = model.mJoints[k].q_index;
+        unsigned int k_dof_count = model.mJoints[k].mDoFCount;
+        if (model.mJoints[k].mJointType == JointTypeCustom) {
+          k_dof_count = model.mCustomJoints[model.mJoints[k].custom_joint_index]
+            ->mDoFCount;
+        }
 
-          H.block(dof_index_i,dof_index_j,1,dof) = H_temp2.transpose();
-          H.block(dof_index_j,dof_index_i,dof,1) = H_temp2;
+        for (unsigned int j = k_index; j < k_index + k_dof_count; j++) {
+          C(j,l) = S[j].dot(F_col);
+          C(l,j) = F_row_I.dot(S_dot[j]) + F_row_B.dot(S[j]);
         }
       }
-    } else if (model.mJoints[i].mDoFCount == 3
-        && model.mJoints[i].mJointType != JointTypeCustom) {
-      Matrix63 F_63 = model.Ic[i].toMatrix() * model.multdof3_S[i];
-      H.block<3,3>(dof_index_i, dof_index_i) = model.multdof3_S[i].transpose() * F_63;
-
-      unsigned int j = i;
-      unsigned int dof_index_j = dof_index_i;
-
-      while (model.lambda[j] != 0) {
-        F_63 = model.X_lambda[j].toMatrixTranspose() * (F_63);
-        j = model.lambda[j];
-        dof_index_j = model.mJoints[j].q_index;
-
-        if(model.mJoints[j].mJointType != JointTypeCustom){
-          if (model.mJoints[j].mDoFCount == 1) {
-            Vector3d H_temp2 = F_63.transpose() * (model.S[j]);
+    }
 
-            H.block<3,1>(dof_index_i,dof_index_j) = H_temp2;
-            H.block<1,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
-          } else if (model.mJoints[j].mDoFCount == 3) {
-            Matrix3d H_temp2 = F_63.transpose() * (model.multdof3_S[j]);
+    unsigned int lambda = model.lambda[i];
+    if (lambda != 0) {
+      model.Ic[lambda] = model.Ic[lambda] + model.X_lambda[i].applyTranspose(model.Ic[i]);
+      AddTransposeCongruence (model.X_lambda[i], Bc[i], Bc[lambda]);
+    }
+  }
+}
 
-            H.block<3,3>(dof_index_i,dof_index_j) = H_temp2;
-            H.block<3,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
-          }
-        } else if (model.mJoints[j].mJointType == JointTypeCustom){
-          unsigned int k = model.mJoints[j].custom_joint_index;
-          unsigned int dof = model.mCustomJoints[k]->mDoFCount;
+/** \brief Placeholder for the number of degrees of freedom of custom joint
+ * kernels that use dynamically sized matrices. */
+static const int CustomJointDynamicDoF = -1;
 
-          MatrixNd H_temp2 = F_63.transpose() * (model.mCustomJoints[k]->S);
+/** \brief Matrix types of the custom joint kernels.
+ *
+ * With Eigen the kernels are instantiated for each number of degrees of
+ * freedom such that all products with the motion subspace are fixed-size.
+ * SimpleMath only uses the dynamically sized matrices.
+ */
+template <int NDoF>
+struct CustomJointMatrices {
+#ifdef EIGEN_CORE_H
+  enum { MaxDoF = (NDoF == CustomJointDynamicDoF) ? 6 : NDoF };
+  typedef Eigen::Matrix<double, 6, NDoF, 0, 6, MaxDoF> Matrix6N;
+  typedef Eigen::Matrix<double, NDoF, NDoF, 0, MaxDoF, MaxDoF> MatrixNN;
+  typedef Eigen::Matrix<double, NDoF, 1, 0, MaxDoF, 1> VectorN;
+#else
+  typedef JointMatrix6N Matrix6N;
+  typedef JointMatrixNN MatrixNN;
+  typedef JointVectorN VectorN;
+#endif
+};
 
-          H.block(dof_index_i,dof_index_j,3,dof) = H_temp2;
-          H.block(dof_index_j,dof_index_i,dof,3) = H_temp2.transpose();
-        }
+/** \brief Computes the entries of the joint space inertia matrix for the
+ * custom joint of body i with NDoF degrees of freedom, see
+ * CompositeRigidBodyAlgorithmColumn().
+ */
+template <int NDoF>
+static void CompositeRigidBodyAlgorithmCustomColumn (
+    Model &model,
+    unsigned int i,
+    MatrixNd &H) {
+  unsigned int dof_index_i = model.mJoints[i].q_index;
+  unsigned int kI = model.mJoints[i].custom_joint_index;
+  unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
+
+  typename CustomJointMatrices<NDoF>::Matrix6N S (model.mCustomJoints[kI]->S);
+  typename CustomJointMatrices<NDoF>::Matrix6N F_Nd
+    = model.Ic[i].toMatrix() * S;
+
+  // S^T F is computed element-wise: Eigen's vectorized assignment of the
+  // 1 x 1 product triggers bogus -Warray-bounds warnings.
+  for (unsigned int r = 0; r < dofI; r++) {
+    for (unsigned int c = 0; c < dofI; c++) {
+      double value = 0.;
+      for (unsigned int k = 0; k < 6; k++) {
+        value += S(k,r) * F_Nd(k,c);
       }
-    } else if (model.mJoints[i].mJointType == JointTypeCustom) {      
-      unsigned int kI = model.mJoints[i].custom_joint_index;
-      unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
+      H(dof_index_i + r, dof_index_i + c) = value;
+    }
+  }
 
-      MatrixNd F_Nd = model.Ic[i].toMatrix()
-        * model.mCustomJoints[kI]->S;
-
-      H.block(dof_index_i, dof_index_i,dofI,dofI)
-        = model.mCustomJoints[kI]->S.transpose() * F_Nd;
-
-      unsigned int j = i;
-      unsigned int dof_index_j = dof_index_i;
-
-      while (model.lambda[j] != 0) {
-        F_Nd = model.X_lambda[j].toMatrixTranspose() * (F_Nd);
-        j = model.lambda[j];
-        dof_index_j = model.mJoints[j].q_index;
-
-        if(model.mJoints[j].mJointType != JointTypeCustom){
-          if (model.mJoints[j].mDoFCount == 1) {
-            MatrixNd H_temp2 = F_Nd.transpose() * (model.S[j]);
-            H.block(   dof_index_i,  dof_index_j,
-                H_temp2.rows(),H_temp2.cols()) = H_temp2;
-            H.block(dof_index_j,dof_index_i,
-                H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
-          } else if (model.mJoints[j].mDoFCount == 3) {
-            MatrixNd H_temp2 = F_Nd.transpose() * (model.multdof3_S[j]);
-            H.block(dof_index_i,   dof_index_j,
-                H_temp2.rows(),H_temp2.cols()) = H_temp2;
-            H.block(dof_index_j,   dof_index_i,
-                H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
-          }
-        } else if (model.mJoints[j].mJointType == JointTypeCustom){
-          unsigned int k   = model.mJoints[j].custom_joint_index;
-          unsigned int dof = model.mCustomJoints[k]->mDoFCount;
-
-          MatrixNd H_temp2 = F_Nd.transpose() * (model.mCustomJoints[k]->S);
-
-          H.block(dof_index_i,dof_index_j,3,dof) = H_temp2;
-          H.block(dof_index_j,dof_index_i,dof,3) = H_temp2.transpose();
-        }
+  unsigned int j = i;
+  unsigned int dof_index_j = dof_index_i;
+
+  while (model.lambda[j] != 0) {
+    F_Nd = model.X_lambda[j].toMatrixTranspose() * (F_Nd);
+    j = model.lambda[j];
+    dof_index_j = model.mJoints[j].q_index;
+
+    if(model.mJoints[j].mJointType != JointTypeCustom){
+      if (model.mJoints[j].mDoFCount == 1) {
+        JointMatrixNN H_temp2 = F_Nd.transpose() * (model.S[j]);
+        H.block(   dof_index_i,  dof_index_j,
+            H_temp2.rows(),H_temp2.cols()) = H_temp2;
+        H.block(dof_index_j,dof_index_i,
+            H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
+      } else if (model.mJoints[j].mDoFCount == 3) {
+        JointMatrixNN H_temp2 = F_Nd.transpose() * (model.multdof3_S[j]);
+        H.block(dof_index_i,   dof_index_j,
+            H_temp2.rows(),H_temp2.cols()) = H_temp2;
+        H.block(dof_index_j,   dof_index_i,
+            H_temp2.cols(),H_temp2.rows()) = H_temp2.transpose();
       }
+    } else if (model.mJoints[j].mJointType == JointTypeCustom){
+      unsigned int k   = model.mJoints[j].custom_joint_index;
+      unsigned int dof = model.mCustomJoints[k]->mDoFCount;
+
+      JointMatrixNN H_temp2 = F_Nd.transpose() * (model.mCustomJoints[k]->S);
+
+      H.block(dof_index_i,dof_index_j,dofI,dof) = H_temp2;
+      H.block(dof_index_j,dof_index_i,dof,dofI) = H_temp2.transpose();
     }
   }
 }
 
-RBDL_DLLAPI void ForwardDynamics (
+/** \brief Computes the entries of the joint space inertia matrix that
+ * couple the joint of body i with itself and with the joints of its
+ * ancestors.
+ *
+ * Model::Ic[i] has to contain the composite rigid body inertia of body i.
+ */
+static void CompositeRigidBodyAlgorithmColumn (
     Model &model,
-    const VectorNd &Q,
-    const VectorNd &QDot,
-    const VectorNd &Tau,
-    VectorNd &QDDot,
-    std::vector<SpatialVector> *f_ext) {
+    unsigned int i,
+    MatrixNd &H) {
+  unsigned int dof_index_i = model.mJoints[i].q_index;
+
+  if (model.mJoints[i].mDoFCount == 1 
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+
+    SpatialVector F             = model.Ic[i] * model.S[i];
+    H(dof_index_i, dof_index_i) = model.S[i].dot(F);
+
+    unsigned int j = i;
+    unsigned int dof_index_j = dof_index_i;
+
+    while (model.lambda[j] != 0) {
+      F = model.X_lambda[j].applyTranspose(F);
+      j = model.lambda[j];
+      dof_index_j = model.mJoints[j].q_index;
+
+      if(model.mJoints[j].mJointType != JointTypeCustom) {
+        if (model.mJoints[j].mDoFCount == 1) {
+          H(dof_index_i,dof_index_j) = F.dot(model.S[j]);
+          H(dof_index_j,dof_index_i) = H(dof_index_i,dof_index_j);
+        } else if (model.mJoints[j].mDoFCount == 3) {
+          Vector3d H_temp2 = 
+            (F.transpose() * model.multdof3_S[j]).transpose();
+          LOG << F.transpose() << std::endl 
+            << model.multdof3_S[j] << std::endl;
+          LOG << H_temp2.transpose() << std::endl;
+
+          H.block<1,3>(dof_index_i,dof_index_j) = H_temp2.transpose();
+          H.block<3,1>(dof_index_j,dof_index_i) = H_temp2;
+        }
+      } else if (model.mJoints[j].mJointType == JointTypeCustom){        
+        unsigned int k      = model.mJoints[j].custom_joint_index;
+        unsigned int dof    = model.mCustomJoints[k]->mDoFCount;
+        JointVectorN H_temp2 =
+          (F.transpose() * model.mCustomJoints[k]->S).transpose();
+
+        LOG << F.transpose()
+          << std::endl
+          << model.mCustomJoints[j]->S << std::endl;
+
+        LOG << H_temp2.transpose() << std::endl;
+
+        H.block(dof_index_i,dof_index_j,1,dof) = H_temp2.transpose();
+        H.block(dof_index_j,dof_index_i,dof,1) = H_temp2;
+      }
+    }
+  } else if (model.mJoints[i].mDoFCount == 3
+      && model.mJoints[i].mJointType != JointTypeCustom) {
+    Matrix63 F_63 = model.Ic[i].toMatrix() * model.multdof3_S[i];
+    H.block<3,3>(dof_index_i, dof_index_i) = model.multdof3_S[i].transpose() * F_63;
+
+    unsigned int j = i;
+    unsigned int dof_index_j = dof_index_i;
+
+    while (model.lambda[j] != 0) {
+      F_63 = model.X_lambda[j].toMatrixTranspose() * (F_63);
+      j = model.lambda[j];
+      dof_index_j = model.mJoints[j].q_index;
+
+      if(model.mJoints[j].mJointType != JointTypeCustom){
+        if (model.mJoints[j].mDoFCount == 1) {
+          Vector3d H_temp2 = F_63.transpose() * (model.S[j]);
+
+          H.block<3,1>(dof_index_i,dof_index_j) = H_temp2;
+          H.block<1,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
+        } else if (model.mJoints[j].mDoFCount == 3) {
+          Matrix3d H_temp2 = F_63.transpose() * (model.multdof3_S[j]);
+
+          H.block<3,3>(dof_index_i,dof_index_j) = H_temp2;
+          H.block<3,3>(dof_index_j,dof_index_i) = H_temp2.transpose();
+        }
+      } else if (model.mJoints[j].mJointType == JointTypeCustom){
+        unsigned int k = model.mJoints[j].custom_joint_index;
+        unsigned int dof = model.mCustomJoints[k]->mDoFCount;
+
+        JointMatrixNN H_temp2 = F_63.transpose() * (model.mCustomJoints[k]->S);
+
+        H.block(dof_index_i,dof_index_j,3,dof) = H_temp2;
+        H.block(dof_index_j,dof_index_i,dof,3) = H_temp2.transpose();
+      }
+    }
+  } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+    switch (model.mCustomJoints[model.mJoints[i].custom_joint_index]
+        ->mDoFCount) {
+#ifdef EIGEN_CORE_H
+      case 1: CompositeRigidBodyAlgorithmCustomColumn<1> (model, i, H); break;
+      case 2: CompositeRigidBodyAlgorithmCustomColumn<2> (model, i, H); break;
+      case 3: CompositeRigidBodyAlgorithmCustomColumn<3> (model, i, H); break;
+      case 4: CompositeRigidBodyAlgorithmCustomColumn<4> (model, i, H); break;
+      case 5: CompositeRigidBodyAlgorithmCustomColumn<5> (model, i, H); break;
+      case 6: CompositeRigidBodyAlgorithmCustomColumn<6> (model, i, H); break;
+#endif
+      default:
+        CompositeRigidBodyAlgorithmCustomColumn<CustomJointDynamicDoF> (
+            model, i, H);
+    }
+  }
+}
+
+RBDL_DLLAPI void CompositeRigidBodyAlgorithm (
+    Model& model,
+    const VectorNd &Q,
+    MatrixNd &H,
+    bool update_kinematics) {
   LOG << "-------- " << __func__ << " --------" << std::endl;
 
-  SpatialVector spatial_gravity (0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
+  assert (H.rows() == model.dof_count && H.cols() == model.dof_count);
 
-  unsigned int i = 0;
+  if (update_kinematics) {
+    jcalc_sincos (model, Q);
+  }
 
-  LOG << "Q          = " << Q.transpose() << std::endl;
-  LOG << "QDot       = " << QDot.transpose() << std::endl;
-  LOG << "Tau        = " << Tau.transpose() << std::endl;
-  LOG << "---" << std::endl;
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (update_kinematics) {
+      jcalc_X_lambda_S (model, i, Q, true);
+    }
+    model.Ic[i] = model.I[i];
+  }
 
-  // Reset the velocity of the root body
-  model.v[0].setZero();
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    if (model.lambda[i] != 0) {
+      model.Ic[model.lambda[i]] = model.Ic[model.lambda[i]] + model.X_lambda[i].applyTranspose(model.Ic[i]);
+    }
 
-  for (i = 1; i < model.mBodies.size(); i++) {
-    unsigned int lambda = model.lambda[i];
+    CompositeRigidBodyAlgorithmColumn (model, i, H);
+  }
+}
 
-    jcalc (model, i, Q, QDot);
+RBDL_DLLAPI void CompositeRigidBodyAlgorithmIncremental (
+    Model& model,
+    const VectorNd &Q,
+    MatrixNd &H,
+    const std::vector<unsigned int> &changed_body_ids,
+    bool update_kinematics) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
 
-    if (lambda != 0)
-      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
-    else
-      model.X_base[i] = model.X_lambda[i];
+  assert (H.rows() == model.dof_count && H.cols() == model.dof_count);
 
-    model.v[i] = model.X_lambda[i].apply( model.v[lambda]) + model.v_J[i];
+  if (update_kinematics) {
+    for (unsigned int i = 0; i < changed_body_ids.size(); i++) {
+      jcalc_X_lambda_S (model, changed_body_ids[i], Q);
+    }
+  }
 
-    /*
-       LOG << "X_J (" << i << "):" << std::endl << X_J << std::endl;
-       LOG << "v_J (" << i << "):" << std::endl << v_J << std::endl;
-       LOG << "v_lambda" << i << ":" << std::endl << model.v.at(lambda) << std::endl;
-       LOG << "X_base (" << i << "):" << std::endl << model.X_base[i] << std::endl;
-       LOG << "X_lambda (" << i << "):" << std::endl << model.X_lambda[i] << std::endl;
-       LOG << "SpatialVelocity (" << i << "): " << model.v[i] << std::endl;
-       */
-    model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
-    model.I[i].setSpatialMatrix (model.IA[i]);
+  std::vector<bool> changed;
+  std::vector<bool> in_subtree;
+  std::vector<bool> on_path;
+  CalcChangedBodyMasks (model, changed_body_ids, changed, in_subtree,
+      on_path);
 
-    model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    // Only the composite inertias of the changed bodies and their
+    // ancestors change. They are reassembled from their children.
+    if (on_path[i]) {
+      model.Ic[i] = model.I[i];
+
+      for (unsigned int j = 0; j < model.mu[i].size(); j++) {
+        unsigned int child_id = model.mu[i][j];
+        model.Ic[i] = model.Ic[i] + model.X_lambda[child_id].applyTranspose(model.Ic[child_id]);
+      }
+    }
 
-    if (f_ext != NULL && (*f_ext)[i] != SpatialVector::Zero()) {
-      LOG << "External force (" << i << ") = " << model.X_base[i].toMatrixAdjoint() * (*f_ext)[i] << std::endl;
-      model.pA[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
+    if (in_subtree[i] || on_path[i]) {
+      CompositeRigidBodyAlgorithmColumn (model, i, H);
+    }
+  }
+}
+
+/** \brief Articulated body inertia step of the Articulated Body Algorithm
+ * for the custom joint of body i with NDoF degrees of freedom.
+ *
+ * Stores U and Dinv in the custom joint. If Tau is given u is stored as
+ * well. If Ia is given it receives the articulated inertia I^A - U Dinv
+ * U^T that body i transmits to its parent and, if also pa is given, pa
+ * receives the transmitted bias force.
+ */
+template <int NDoF>
+static void CustomJointArticulatedInertia (
+    Model &model,
+    unsigned int i,
+    const VectorNd *Tau,
+    SpatialArticulatedBodyInertia *Ia,
+    SpatialVector *pa) {
+  typedef CustomJointMatrices<NDoF> Matrices;
+
+  unsigned int q_index = model.mJoints[i].q_index;
+  CustomJoint *custom_joint =
+    model.mCustomJoints[model.mJoints[i].custom_joint_index];
+  unsigned int dofI = custom_joint->mDoFCount;
+
+  typename Matrices::Matrix6N S (custom_joint->S);
+  typename Matrices::Matrix6N U (S);
+  model.IA[i].applyToColumns (S, U, dofI);
+#ifdef EIGEN_CORE_H
+  // S^T U is symmetric positive definite for any physical joint
+  typename Matrices::MatrixNN Dinv (Matrices::MatrixNN::Identity (dofI, dofI));
+  (S.transpose() * U).eval().llt().solveInPlace (Dinv);
+#else
+  typename Matrices::MatrixNN Dinv ((S.transpose() * U).inverse());
+#endif
+
+  custom_joint->U = U;
+  // element-wise for the same reason as in
+  // CompositeRigidBodyAlgorithmCustomColumn()
+  if (static_cast<unsigned int>(custom_joint->Dinv.rows()) != dofI
+      || static_cast<unsigned int>(custom_joint->Dinv.cols()) != dofI) {
+    custom_joint->Dinv.resize (dofI, dofI);
+  }
+  for (unsigned int r = 0; r < dofI; r++) {
+    for (unsigned int c = 0; c < dofI; c++) {
+      custom_joint->Dinv(r,c) = Dinv(r,c);
     }
   }
 
-  // ClearLogOutput();
+  typename Matrices::VectorN u (Matrices::VectorN::Zero (dofI));
+  if (Tau != NULL) {
+    u = Tau->block(q_index,0,dofI,1);
+    u -= S.transpose() * model.pA[i];
+    custom_joint->u = u;
+  }
 
-  LOG << "--- first loop ---" << std::endl;
+  if (Ia == NULL) {
+    return;
+  }
+
+  typename Matrices::Matrix6N UDinv (U * Dinv);
+  *Ia = model.IA[i];
+  Ia->subtractSymmetricProduct (UDinv, U, dofI);
+
+  if (pa != NULL) {
+    assert (Tau != NULL);
+    *pa = model.pA[i] + (*Ia) * model.c[i] + UDinv * u;
+  }
+}
+
+/** \brief Calls CustomJointArticulatedInertia() with the fixed-size
+ * kernel for the number of degrees of freedom of the custom joint of body
+ * i. */
+static void CalcCustomJointArticulatedInertia (
+    Model &model,
+    unsigned int i,
+    const VectorNd *Tau,
+    SpatialArticulatedBodyInertia *Ia,
+    SpatialVector *pa) {
+  switch (model.mCustomJoints[model.mJoints[i].custom_joint_index]
+      ->mDoFCount) {
+#ifdef EIGEN_CORE_H
+    case 1: CustomJointArticulatedInertia<1> (model, i, Tau, Ia, pa); break;
+    case 2: CustomJointArticulatedInertia<2> (model, i, Tau, Ia, pa); break;
+    case 3: CustomJointArticulatedInertia<3> (model, i, Tau, Ia, pa); break;
+    case 4: CustomJointArticulatedInertia<4> (model, i, Tau, Ia, pa); break;
+    case 5: CustomJointArticulatedInertia<5> (model, i, Tau, Ia, pa); break;
+    case 6: CustomJointArticulatedInertia<6> (model, i, Tau, Ia, pa); break;
+#endif
+    default:
+      CustomJointArticulatedInertia<CustomJointDynamicDoF> (
+          model, i, Tau, Ia, pa);
+  }
+}
+
+/** \brief Backward pass of the Articulated Body Algorithm for the custom
+ * joint of body i.
+ *
+ * Stores U, Dinv and u in the custom joint and propagates the articulated
+ * body inertia and bias force to the parent.
+ */
+static void ForwardDynamicsCustomJointBackward (
+    Model &model,
+    unsigned int i,
+    const VectorNd &Tau) {
+  unsigned int lambda = model.lambda[i];
+  if (lambda == 0) {
+    CalcCustomJointArticulatedInertia (model, i, &Tau, NULL, NULL);
+    return;
+  }
+
+  SpatialArticulatedBodyInertia Ia;
+  SpatialVector pa;
+  CalcCustomJointArticulatedInertia (model, i, &Tau, &Ia, &pa);
+
+  model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+#ifdef EIGEN_CORE_H
+  model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
+#else
+  model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
+#endif
+  LOG << "pA[" << lambda << "] = "
+    << model.pA[lambda].transpose()
+    << std::endl;
+}
+
+/** \brief Forward pass of the Articulated Body Algorithm for the custom
+ * joint of body i with NDoF degrees of freedom.
+ *
+ * Model::a[i] has to contain the acceleration of body i without the
+ * contribution of its joint accelerations.
+ */
+template <int NDoF>
+static void ForwardDynamicsCustomJointForward (
+    Model &model,
+    unsigned int i,
+    VectorNd &QDDot) {
+  typedef CustomJointMatrices<NDoF> Matrices;
+
+  unsigned int q_index = model.mJoints[i].q_index;
+  CustomJoint *custom_joint =
+    model.mCustomJoints[model.mJoints[i].custom_joint_index];
+
+  typename Matrices::Matrix6N S (custom_joint->S);
+  typename Matrices::Matrix6N U (custom_joint->U);
+  typename Matrices::MatrixNN Dinv (custom_joint->Dinv);
+  typename Matrices::VectorN u (custom_joint->u);
+
+  typename Matrices::VectorN qdd_temp (Dinv * (u - U.transpose() * model.a[i]));
+
+  for (unsigned int z = 0; z < custom_joint->mDoFCount; ++z) {
+    QDDot[q_index + z] = qdd_temp[z];
+  }
+
+  model.a[i] = model.a[i] + S * qdd_temp;
+}
+
+/** \brief Second and third pass of the Articulated Body Algorithm.
+ *
+ * Model::IA and Model::pA have to be initialized with the rigid body
+ * inertias and bias forces of each body and Model::X_lambda, Model::c and
+ * the motion subspaces have to be up to date.
+ */
+static void ForwardDynamicsArticulatedBodyPasses (
+    Model &model,
+    const VectorNd &Tau,
+    VectorNd &QDDot) {
+  SpatialVector spatial_gravity (0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
+
+  unsigned int i = 0;
 
   for (i = model.mBodies.size() - 1; i > 0; i--) {
     unsigned int q_index = model.mJoints[i].q_index;
@@ -381,25 +1051,19 @@ RBDL_DLLAPI void ForwardDynamics (
 
       unsigned int lambda = model.lambda[i];
       if (lambda != 0) {
-        SpatialMatrix Ia =    model.IA[i]
-          - model.U[i]
-          * (model.U[i] / model.d[i]).transpose();
+        SpatialVector UDinv (model.U[i] / model.d[i]);
+        SpatialArticulatedBodyInertia Ia (model.IA[i]);
+        Ia.subtractSymmetricProduct (UDinv, model.U[i], 1);
 
         SpatialVector pa =  model.pA[i]
           + Ia * model.c[i]
-          + model.U[i] * model.u[i] / model.d[i];
+          + UDinv * model.u[i];
 
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias()
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
         model.pA[lambda].noalias()
           += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda]
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia * model.X_lambda[i].toMatrix();
-
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = "
@@ -423,30 +1087,19 @@ RBDL_DLLAPI void ForwardDynamics (
       //                      << model.multdof3_u[i].transpose() << std::endl;
       unsigned int lambda = model.lambda[i];
       if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i]
-          - model.multdof3_U[i]
-          * model.multdof3_Dinv[i]
-          * model.multdof3_U[i].transpose();
+        Matrix63 UDinv (model.multdof3_U[i] * model.multdof3_Dinv[i]);
+        SpatialArticulatedBodyInertia Ia (model.IA[i]);
+        Ia.subtractSymmetricProduct (UDinv, model.multdof3_U[i], 3);
         SpatialVector pa = model.pA[i]
           + Ia
           * model.c[i]
-          + model.multdof3_U[i]
-          * model.multdof3_Dinv[i]
+          + UDinv
           * model.multdof3_u[i];
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias()
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
-
         model.pA[lambda].noalias()
           += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.IA[lambda]
-          += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
-
         model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
         LOG << "pA[" << lambda << "] = "
@@ -454,53 +1107,7 @@ RBDL_DLLAPI void ForwardDynamics (
           << std::endl;
       }
     } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-      unsigned int kI   = model.mJoints[i].custom_joint_index;
-      unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
-      model.mCustomJoints[kI]->U =
-        model.IA[i] * model.mCustomJoints[kI]->S;
-
-#ifdef EIGEN_CORE_H
-      model.mCustomJoints[kI]->Dinv
-        = (model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U).inverse().eval();
-#else
-      model.mCustomJoints[kI]->Dinv
-        = (model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U).inverse();
-#endif
-      VectorNd tau_temp(Tau.block(q_index,0,dofI,1));
-      model.mCustomJoints[kI]->u = tau_temp
-        - model.mCustomJoints[kI]->S.transpose() * model.pA[i];
-
-      //      LOG << "multdof3_u[" << i << "] = " 
-      //      << model.multdof3_u[i].transpose() << std::endl;
-      unsigned int lambda = model.lambda[i];
-      if (lambda != 0) {
-        SpatialMatrix Ia = model.IA[i]
-          - (model.mCustomJoints[kI]->U
-              * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->U.transpose());
-        SpatialVector pa =  model.pA[i] 
-          + Ia * model.c[i]
-          + (model.mCustomJoints[kI]->U
-              * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->u);
-
-#ifdef EIGEN_CORE_H
-        model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
-        model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
-#else
-        model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-          * Ia
-          * model.X_lambda[i].toMatrix();
-        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
-#endif
-        LOG << "pA[" << lambda << "] = "
-          << model.pA[lambda].transpose()
-          << std::endl;
-      }
+      ForwardDynamicsCustomJointBackward (model, i, Tau);
     }
   }
 
@@ -528,340 +1135,1420 @@ RBDL_DLLAPI void ForwardDynamics (
       QDDot[q_index + 2] = qdd_temp[2];
       model.a[i] = model.a[i] + model.multdof3_S[i] * qdd_temp;
     } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-      unsigned int kI = model.mJoints[i].custom_joint_index;
-      unsigned int dofI=model.mCustomJoints[kI]->mDoFCount;
-
-      VectorNd qdd_temp = model.mCustomJoints[kI]->Dinv
-        * (  model.mCustomJoints[kI]->u
-            - model.mCustomJoints[kI]->U.transpose()
-            * model.a[i]);
-
-      for(int z=0; z<dofI; ++z){
-        QDDot[q_index+z] = qdd_temp[z];
+      switch (model.mCustomJoints[model.mJoints[i].custom_joint_index]
+          ->mDoFCount) {
+#ifdef EIGEN_CORE_H
+        case 1: ForwardDynamicsCustomJointForward<1> (model, i, QDDot); break;
+        case 2: ForwardDynamicsCustomJointForward<2> (model, i, QDDot); break;
+        case 3: ForwardDynamicsCustomJointForward<3> (model, i, QDDot); break;
+        case 4: ForwardDynamicsCustomJointForward<4> (model, i, QDDot); break;
+        case 5: ForwardDynamicsCustomJointForward<5> (model, i, QDDot); break;
+        case 6: ForwardDynamicsCustomJointForward<6> (model, i, QDDot); break;
+#endif
+        default:
+          ForwardDynamicsCustomJointForward<CustomJointDynamicDoF> (
+              model, i, QDDot);
       }
-
-      model.a[i] = model.a[i]
-        + model.mCustomJoints[kI]->S * qdd_temp;
     } 
   }
-
-  LOG << "QDDot = " << QDDot.transpose() << std::endl;
 }
 
-RBDL_DLLAPI void ForwardDynamicsLagrangian (
+/** \brief First pass of the Articulated Body Algorithm.
+ *
+ * Computes the transformations and velocities of all bodies and
+ * initializes Model::IA and Model::pA with the rigid body inertias and
+ * the velocity-product forces.
+ */
+static void ForwardDynamicsFirstPass (
     Model &model,
     const VectorNd &Q,
-    const VectorNd &QDot,
-    const VectorNd &Tau,
-    VectorNd &QDDot,
-    Math::LinearSolver linear_solver,
-    std::vector<SpatialVector> *f_ext,
-    Math::MatrixNd *H,
-    Math::VectorNd *C) {
-  LOG << "-------- " << __func__ << " --------" << std::endl;
-
-  bool free_H = false;
-  bool free_C = false;
-
-  if (H == NULL) {
-    H = new MatrixNd (MatrixNd::Zero(model.dof_count, model.dof_count));
-    free_H = true;
-  }
+    const VectorNd &QDot) {
+  // Reset the velocity of the root body
+  model.v[0].setZero();
 
-  if (C == NULL) {
-    C = new VectorNd (VectorNd::Zero(model.dof_count));
-    free_C = true;
-  }
+  jcalc_sincos (model, Q);
 
-  // we set QDDot to zero to compute C properly with the InverseDynamics
-  // method.
-  QDDot.setZero();
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int lambda = model.lambda[i];
 
-  InverseDynamics (model, Q, QDot, QDDot, (*C), f_ext);
-  CompositeRigidBodyAlgorithm (model, Q, *H, false);
+    jcalc (model, i, Q, QDot, true);
 
-  LOG << "A = " << std::endl << *H << std::endl;
-  LOG << "b = " << std::endl << *C * -1. + Tau << std::endl;
+    if (lambda != 0)
+      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+    else
+      model.X_base[i] = model.X_lambda[i];
 
-#ifndef RBDL_USE_SIMPLE_MATH
-  switch (linear_solver) {
-    case (LinearSolverPartialPivLU) :
-      QDDot = H->partialPivLu().solve (*C * -1. + Tau);
-      break;
-    case (LinearSolverColPivHouseholderQR) :
-      QDDot = H->colPivHouseholderQr().solve (*C * -1. + Tau);
-      break;
-    case (LinearSolverHouseholderQR) :
-      QDDot = H->householderQr().solve (*C * -1. + Tau);
-      break;
-    case (LinearSolverLLT) :
-      QDDot = H->llt().solve (*C * -1. + Tau);
-      break;
-    default:
-      LOG << "Error: Invalid linear solver: " << linear_solver << std::endl;
-      assert (0);
-      break;
-  }
-#else
-  bool solve_successful = LinSolveGaussElimPivot (*H, *C * -1. + Tau, QDDot);
-  assert (solve_successful);
-#endif
+    model.v[i] = model.X_lambda[i].apply( model.v[lambda]) + model.v_J[i];
 
-  if (free_C) {
-    delete C;
-  }
+    /*
+       LOG << "X_J (" << i << "):" << std::endl << X_J << std::endl;
+       LOG << "v_J (" << i << "):" << std::endl << v_J << std::endl;
+       LOG << "v_lambda" << i << ":" << std::endl << model.v.at(lambda) << std::endl;
+       LOG << "X_base (" << i << "):" << std::endl << model.X_base[i] << std::endl;
+       LOG << "X_lambda (" << i << "):" << std::endl << model.X_lambda[i] << std::endl;
+       LOG << "SpatialVelocity (" << i << "): " << model.v[i] << std::endl;
+       */
+    model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+    model.IA[i].createFromRigidBodyInertia (model.I[i]);
 
-  if (free_H) {
-    delete H;
+    model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
   }
-
-  LOG << "x = " << QDDot << std::endl;
 }
 
-RBDL_DLLAPI void CalcMInvTimesTau ( Model &model,
+RBDL_DLLAPI void ForwardDynamics (
+    Model &model,
     const VectorNd &Q,
+    const VectorNd &QDot,
     const VectorNd &Tau,
     VectorNd &QDDot,
-    bool update_kinematics) {
+    std::vector<SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
 
   LOG << "Q          = " << Q.transpose() << std::endl;
+  LOG << "QDot       = " << QDot.transpose() << std::endl;
+  LOG << "Tau        = " << Tau.transpose() << std::endl;
   LOG << "---" << std::endl;
 
-  // Reset the velocity of the root body
-  model.v[0].setZero();
-  model.a[0].setZero();
+  ForwardDynamicsFirstPass (model, Q, QDot);
 
-  if (update_kinematics) {
+  if (f_ext != NULL) {
     for (unsigned int i = 1; i < model.mBodies.size(); i++) {
-      jcalc_X_lambda_S (model, model.mJointUpdateOrder[i], Q);
-
-      model.v_J[i].setZero();
-      model.v[i].setZero();
-      model.c[i].setZero();
-      model.pA[i].setZero();
-      model.I[i].setSpatialMatrix (model.IA[i]);
+      if ((*f_ext)[i] != SpatialVector::Zero()) {
+        LOG << "External force (" << i << ") = " << model.X_base[i].toMatrixAdjoint() * (*f_ext)[i] << std::endl;
+        model.pA[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
+      }
     }
   }
 
-  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
-    model.pA[i].setZero();
+  // ClearLogOutput();
+
+  LOG << "--- first loop ---" << std::endl;
+
+  ForwardDynamicsArticulatedBodyPasses (model, Tau, QDDot);
+
+  LOG << "QDDot = " << QDDot.transpose() << std::endl;
+}
+
+RBDL_DLLAPI void ForwardDynamics (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &Tau,
+    VectorNd &QDDot,
+    const std::vector<ExternalForce> &f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  ForwardDynamicsFirstPass (model, Q, QDot);
+
+  // Model::X_base is up to date after the first pass
+  SubtractExternalForces (model, f_ext, model.pA);
+
+  ForwardDynamicsArticulatedBodyPasses (model, Tau, QDDot);
+
+  LOG << "QDDot = " << QDDot.transpose() << std::endl;
+}
+
+/** \brief Returns whether the accelerations of the joint of body i are
+ * prescribed for HybridDynamics().
+ *
+ * All degrees of freedom of a joint have to be either prescribed or
+ * torque-driven.
+ */
+static bool IsJointAccelerationKnown (
+    const Model &model,
+    unsigned int i,
+    const std::vector<bool> &qddot_known) {
+  unsigned int q_index = model.mJoints[i].q_index;
+  unsigned int dof_count = model.mJoints[i].mDoFCount;
+
+  if (model.mJoints[i].mJointType == JointTypeCustom) {
+    dof_count = model.mCustomJoints[model.mJoints[i].custom_joint_index]
+      ->mDoFCount;
   }
 
-  // ClearLogOutput();
+  bool known = qddot_known[q_index];
+  for (unsigned int j = 1; j < dof_count; j++) {
+    if (qddot_known[q_index + j] != known) {
+      std::cerr << "Error: the accelerations of the joint of body " << i
+        << " are only partially prescribed!" << std::endl;
+      assert (0);
+      abort();
+    }
+  }
 
-  if (update_kinematics) {
-    // Compute Articulate Body Inertias
-    for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
-      unsigned int q_index = model.mJoints[i].q_index;
+  return known;
+}
 
-      if (model.mJoints[i].mDoFCount == 1
-          && model.mJoints[i].mJointType != JointTypeCustom) {
-        model.U[i] = model.IA[i] * model.S[i];
-        model.d[i] = model.S[i].dot(model.U[i]);
-        //      LOG << "u[" << i << "] = " << model.u[i] << std::endl;
-        unsigned int lambda = model.lambda[i];
-
-        if (lambda != 0) {
-          SpatialMatrix Ia = model.IA[i] - 
-            model.U[i] * (model.U[i] / model.d[i]).transpose();
-#ifdef EIGEN_CORE_H
-          model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#else
-          model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#endif
-        }
-      } else if (model.mJoints[i].mDoFCount == 3
-          && model.mJoints[i].mJointType != JointTypeCustom) {
+RBDL_DLLAPI void HybridDynamics (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    VectorNd &QDDot,
+    VectorNd &Tau,
+    const std::vector<bool> &qddot_known,
+    std::vector<SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
 
-        model.multdof3_U[i] = model.IA[i] * model.multdof3_S[i];
+  assert (qddot_known.size() == model.dof_count);
 
-#ifdef EIGEN_CORE_H
-        model.multdof3_Dinv[i] = 
-          (model.multdof3_S[i].transpose()*model.multdof3_U[i]).inverse().eval();
-#else
-        model.multdof3_Dinv[i] = 
-          (model.multdof3_S[i].transpose() * model.multdof3_U[i]).inverse();
-#endif
-        //      LOG << "mCustomJoints[kI]->u[" << i << "] = "
-        //<< model.mCustomJoints[kI]->u[i].transpose() << std::endl;
+  SpatialVector spatial_gravity (0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
 
-        unsigned int lambda = model.lambda[i];
+  unsigned int i = 0;
 
-        if (lambda != 0) {
-          SpatialMatrix Ia = model.IA[i]
-            - ( model.multdof3_U[i]
-                * model.multdof3_Dinv[i]
-                * model.multdof3_U[i].transpose());
-#ifdef EIGEN_CORE_H
-          model.IA[lambda].noalias() +=
-            model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#else
-          model.IA[lambda] +=
-            model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix();
-#endif
-        }
-      } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-        unsigned int kI     = model.mJoints[i].custom_joint_index;
-        unsigned int dofI   = model.mCustomJoints[kI]->mDoFCount;
-        model.mCustomJoints[kI]->U = model.IA[i] * model.mCustomJoints[kI]->S;
+  // Reset the velocity of the root body
+  model.v[0].setZero();
 
-#ifdef EIGEN_CORE_H
-        model.mCustomJoints[kI]->Dinv = (model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U
-            ).inverse().eval();
-#else
-        model.mCustomJoints[kI]->Dinv=(model.mCustomJoints[kI]->S.transpose()
-            * model.mCustomJoints[kI]->U
-            ).inverse();
-#endif
-        //      LOG << "mCustomJoints[kI]->u[" << i << "] = "
-        //<< model.mCustomJoints[kI]->u.transpose() << std::endl;
-        unsigned int lambda = model.lambda[i];
-
-        if (lambda != 0) {
-          SpatialMatrix Ia = model.IA[i] 
-            - ( model.mCustomJoints[kI]->U
-                * model.mCustomJoints[kI]->Dinv
-                * model.mCustomJoints[kI]->U.transpose());
-#ifdef EIGEN_CORE_H
-          model.IA[lambda].noalias() += model.X_lambda[i].toMatrixTranspose()
-            * Ia
-            * model.X_lambda[i].toMatrix();
-#else
-          model.IA[lambda] += model.X_lambda[i].toMatrixTranspose()
-            * Ia * model.X_lambda[i].toMatrix();
-#endif
-        }
-      }
+  jcalc_sincos (model, Q);
+
+  for (i = 1; i < model.mBodies.size(); i++) {
+    unsigned int lambda = model.lambda[i];
+
+    jcalc (model, i, Q, QDot, true);
+
+    if (lambda != 0)
+      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+    else
+      model.X_base[i] = model.X_lambda[i];
+
+    model.v[i] = model.X_lambda[i].apply( model.v[lambda]) + model.v_J[i];
+    model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+    model.IA[i].createFromRigidBodyInertia (model.I[i]);
+
+    model.pA[i] = crossf(model.v[i],model.I[i] * model.v[i]);
+
+    if (f_ext != NULL && (*f_ext)[i] != SpatialVector::Zero()) {
+      model.pA[i] -= model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
     }
   }
 
-  // compute articulated bias forces
-  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+  for (i = model.mBodies.size() - 1; i > 0; i--) {
     unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
 
-    if (model.mJoints[i].mDoFCount == 1
-        && model.mJoints[i].mJointType != JointTypeCustom) {
+    SpatialArticulatedBodyInertia Ia (model.IA[i]);
+    SpatialVector pa;
 
-      model.u[i] = Tau[q_index] - model.S[i].dot(model.pA[i]);
-      // LOG << "u[" << i << "] = " << model.u[i] << std::endl;
-      unsigned int lambda = model.lambda[i];
-      if (lambda != 0) {
-        SpatialVector pa = model.pA[i] + model.U[i] * model.u[i] / model.d[i];
+    if (IsJointAccelerationKnown (model, i, qddot_known)) {
+      // The motion of a prescribed joint is known, i.e. the joint does not
+      // decouple the inertia of the body from its parent.
+      SpatialVector a_J (model.c[i]);
 
-#ifdef EIGEN_CORE_H
-        model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
-#else
-        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
-#endif
-        LOG << "pA[" << lambda << "] = "
-          << model.pA[lambda].transpose() << std::endl;
+      if (model.mJoints[i].mDoFCount == 1
+          && model.mJoints[i].mJointType != JointTypeCustom) {
+        a_J += model.S[i] * QDDot[q_index];
+      } else if (model.mJoints[i].mDoFCount == 3
+          && model.mJoints[i].mJointType != JointTypeCustom) {
+        a_J += model.multdof3_S[i]
+          * Vector3d (QDDot[q_index], QDDot[q_index + 1], QDDot[q_index + 2]);
+      } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+        unsigned int kI = model.mJoints[i].custom_joint_index;
+        unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
+        JointVectorN qdd_temp (QDDot.block(q_index, 0, dofI, 1));
+        a_J += model.mCustomJoints[kI]->S * qdd_temp;
       }
-    } else if (model.mJoints[i].mDoFCount == 3
-        && model.mJoints[i].mJointType != JointTypeCustom) {
-
-      Vector3d tau_temp ( Tau[q_index],
-          Tau[q_index + 1],
-          Tau[q_index + 2]);
-      model.multdof3_u[i] = tau_temp 
-        - model.multdof3_S[i].transpose()*model.pA[i];
-      //      LOG << "multdof3_u[" << i << "] = "
-      // << model.multdof3_u[i].transpose() << std::endl;
-      unsigned int lambda = model.lambda[i];
 
-      if (lambda != 0) {
-        SpatialVector pa = model.pA[i]
-          + model.multdof3_U[i]
-          * model.multdof3_Dinv[i]
-          * model.multdof3_u[i];
+      pa = model.pA[i] + model.IA[i] * a_J;
+    } else if (model.mJoints[i].mDoFCount == 1
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      model.U[i] = model.IA[i] * model.S[i];
+      model.d[i] = model.S[i].dot(model.U[i]);
+      model.u[i] = Tau[q_index] - model.S[i].dot(model.pA[i]);
 
+      SpatialVector UDinv (model.U[i] / model.d[i]);
+      Ia.subtractSymmetricProduct (UDinv, model.U[i], 1);
+      pa = model.pA[i] + Ia * model.c[i] + UDinv * model.u[i];
+    } else if (model.mJoints[i].mDoFCount == 3
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      model.multdof3_U[i] = model.IA[i] * model.multdof3_S[i];
 #ifdef EIGEN_CORE_H
-        model.pA[lambda].noalias() +=
-          model.X_lambda[i].applyTranspose(pa);
+      model.multdof3_Dinv[i] = (model.multdof3_S[i].transpose()
+          * model.multdof3_U[i]).inverse().eval();
 #else
-        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
+      model.multdof3_Dinv[i] = (model.multdof3_S[i].transpose()
+          * model.multdof3_U[i]).inverse();
 #endif
-        LOG << "pA[" << lambda << "] = "
-          << model.pA[lambda].transpose() << std::endl;
-      }
-    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-      unsigned int kI     = model.mJoints[i].custom_joint_index;
-      unsigned int dofI   = model.mCustomJoints[kI]->mDoFCount;
-      VectorNd tau_temp(Tau.block(q_index,0,dofI,1));
-
-      model.mCustomJoints[kI]->u = 
-        tau_temp - ( model.mCustomJoints[kI]->S.transpose()* model.pA[i]);
-      //      LOG << "mCustomJoints[kI]->u"
-      // << model.mCustomJoints[kI]->u.transpose() << std::endl;
-      unsigned int lambda = model.lambda[i];
+      Vector3d tau_temp(Tau.block(q_index,0,3,1));
+      model.multdof3_u[i] = tau_temp
+        - model.multdof3_S[i].transpose() * model.pA[i];
 
-      if (lambda != 0) {
-        SpatialVector pa = model.pA[i]
-          + (   model.mCustomJoints[kI]->U
-              * model.mCustomJoints[kI]->Dinv
-              * model.mCustomJoints[kI]->u);
+      Matrix63 UDinv (model.multdof3_U[i] * model.multdof3_Dinv[i]);
+      Ia.subtractSymmetricProduct (UDinv, model.multdof3_U[i], 3);
+      pa = model.pA[i]
+        + Ia * model.c[i]
+        + UDinv * model.multdof3_u[i];
+    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+      CalcCustomJointArticulatedInertia (model, i, &Tau, &Ia, &pa);
+    }
 
+    if (lambda != 0) {
+      model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
 #ifdef EIGEN_CORE_H
-        model.pA[lambda].noalias() +=
-          model.X_lambda[i].applyTranspose(pa);
+      model.pA[lambda].noalias()
+        += model.X_lambda[i].applyTranspose(pa);
 #else
-        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
+      model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
 #endif
-        LOG << "pA[" << lambda << "] = "
-          << model.pA[lambda].transpose() << std::endl;
-      }
     }
   }
 
-  //  ClearLogOutput();
+  model.a[0] = spatial_gravity * -1.;
 
-  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+  for (i = 1; i < model.mBodies.size(); i++) {
     unsigned int q_index = model.mJoints[i].q_index;
     unsigned int lambda = model.lambda[i];
-    SpatialTransform X_lambda = model.X_lambda[i];
 
-    model.a[i] = X_lambda.apply(model.a[lambda]) + model.c[i];
-    LOG << "a'[" << i << "] = " << model.a[i].transpose() << std::endl;
+    model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
 
-    if (model.mJoints[i].mDoFCount == 1
+    if (IsJointAccelerationKnown (model, i, qddot_known)) {
+      // The force transmitted by the joint is I^A a + p^A as all
+      // accelerations of the subtree are now determined.
+      if (model.mJoints[i].mDoFCount == 1
+          && model.mJoints[i].mJointType != JointTypeCustom) {
+        model.a[i] = model.a[i] + model.S[i] * QDDot[q_index];
+        Tau[q_index] = model.S[i].dot(model.IA[i] * model.a[i] + model.pA[i]);
+      } else if (model.mJoints[i].mDoFCount == 3
+          && model.mJoints[i].mJointType != JointTypeCustom) {
+        model.a[i] = model.a[i] + model.multdof3_S[i]
+          * Vector3d (QDDot[q_index], QDDot[q_index + 1], QDDot[q_index + 2]);
+        Vector3d tau_temp = model.multdof3_S[i].transpose()
+          * (model.IA[i] * model.a[i] + model.pA[i]);
+        Tau[q_index] = tau_temp[0];
+        Tau[q_index + 1] = tau_temp[1];
+        Tau[q_index + 2] = tau_temp[2];
+      } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+        unsigned int kI = model.mJoints[i].custom_joint_index;
+        unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
+        JointVectorN qdd_temp (QDDot.block(q_index, 0, dofI, 1));
+        model.a[i] = model.a[i] + model.mCustomJoints[kI]->S * qdd_temp;
+        Tau.block(q_index, 0, dofI, 1) = model.mCustomJoints[kI]->S.transpose()
+          * (model.IA[i] * model.a[i] + model.pA[i]);
+      }
+    } else if (model.mJoints[i].mDoFCount == 1
         && model.mJoints[i].mJointType != JointTypeCustom) {
-      QDDot[q_index] = (1./model.d[i])*(model.u[i]-model.U[i].dot(model.a[i]));
-      model.a[i]     = model.a[i] + model.S[i] * QDDot[q_index];
+      QDDot[q_index] = (1./model.d[i]) * (model.u[i] - model.U[i].dot(model.a[i]));
+      model.a[i] = model.a[i] + model.S[i] * QDDot[q_index];
     } else if (model.mJoints[i].mDoFCount == 3
         && model.mJoints[i].mJointType != JointTypeCustom) {
-      Vector3d qdd_temp = 
-        model.multdof3_Dinv[i] * (model.multdof3_u[i]
-            - model.multdof3_U[i].transpose()*model.a[i]);
-
-      QDDot[q_index]      = qdd_temp[0];
-      QDDot[q_index + 1]  = qdd_temp[1];
-      QDDot[q_index + 2]  = qdd_temp[2];
-      model.a[i]          = model.a[i] + model.multdof3_S[i] * qdd_temp;
+      Vector3d qdd_temp = model.multdof3_Dinv[i] * (model.multdof3_u[i] - model.multdof3_U[i].transpose() * model.a[i]);
+      QDDot[q_index] = qdd_temp[0];
+      QDDot[q_index + 1] = qdd_temp[1];
+      QDDot[q_index + 2] = qdd_temp[2];
+      model.a[i] = model.a[i] + model.multdof3_S[i] * qdd_temp;
     } else if (model.mJoints[i].mJointType == JointTypeCustom) {
-      unsigned int kI     = model.mJoints[i].custom_joint_index;
-      unsigned int dofI   = model.mCustomJoints[kI]->mDoFCount;
+      unsigned int kI = model.mJoints[i].custom_joint_index;
+      unsigned int dofI = model.mCustomJoints[kI]->mDoFCount;
 
-      VectorNd qdd_temp = model.mCustomJoints[kI]->Dinv
-        * (  model.mCustomJoints[kI]->u 
-            - model.mCustomJoints[kI]->U.transpose() * model.a[i]);
+      JointVectorN u_temp (model.mCustomJoints[kI]->u);
+      u_temp -= model.mCustomJoints[kI]->U.transpose() * model.a[i];
+      JointVectorN qdd_temp (model.mCustomJoints[kI]->Dinv * u_temp);
 
-      for(unsigned z = 0; z < dofI; ++z){
-        QDDot[q_index+z]      = qdd_temp[z];
+      for (unsigned int z = 0; z < dofI; ++z) {
+        QDDot[q_index + z] = qdd_temp[z];
       }
 
-      model.a[i] =    model.a[i]
-        + model.mCustomJoints[kI]->S * qdd_temp;
+      model.a[i] = model.a[i] + model.mCustomJoints[kI]->S * qdd_temp;
     }
   }
 
   LOG << "QDDot = " << QDDot.transpose() << std::endl;
+  LOG << "Tau   = " << Tau.transpose() << std::endl;
+}
+
+RBDL_DLLAPI void ForwardDynamicsLagrangian (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &Tau,
+    VectorNd &QDDot,
+    Math::LinearSolver linear_solver,
+    std::vector<SpatialVector> *f_ext,
+    Math::MatrixNd *H,
+    Math::VectorNd *C) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  bool free_H = false;
+  bool free_C = false;
+
+  if (H == NULL) {
+    H = new MatrixNd (MatrixNd::Zero(model.dof_count, model.dof_count));
+    free_H = true;
+  }
+
+  if (C == NULL) {
+    C = new VectorNd (VectorNd::Zero(model.dof_count));
+    free_C = true;
+  }
+
+  // we set QDDot to zero to compute C properly with the InverseDynamics
+  // method.
+  QDDot.setZero();
+
+  InverseDynamics (model, Q, QDot, QDDot, (*C), f_ext);
+  CompositeRigidBodyAlgorithm (model, Q, *H, false);
+
+  LOG << "A = " << std::endl << *H << std::endl;
+  LOG << "b = " << std::endl << *C * -1. + Tau << std::endl;
+
+#ifndef RBDL_USE_SIMPLE_MATH
+  switch (linear_solver) {
+    case (LinearSolverPartialPivLU) :
+      QDDot = H->partialPivLu().solve (*C * -1. + Tau);
+      break;
+    case (LinearSolverColPivHouseholderQR) :
+      QDDot = H->colPivHouseholderQr().solve (*C * -1. + Tau);
+      break;
+    case (LinearSolverHouseholderQR) :
+      QDDot = H->householderQr().solve (*C * -1. + Tau);
+      break;
+    case (LinearSolverLLT) :
+      QDDot = H->llt().solve (*C * -1. + Tau);
+      break;
+    default:
+      LOG << "Error: Invalid linear solver: " << linear_solver << std::endl;
+      assert (0);
+      break;
+  }
+#else
+  bool solve_successful = LinSolveGaussElimPivot (*H, *C * -1. + Tau, QDDot);
+  assert (solve_successful);
+#endif
+
+  if (free_C) {
+    delete C;
+  }
+
+  if (free_H) {
+    delete H;
+  }
+
+  LOG << "x = " << QDDot << std::endl;
+}
+
+/** \brief Computes the articulated body inertias Model::IA and the joint
+ * space projections Model::U, Model::d (resp. Model::multdof3_U,
+ * Model::multdof3_Dinv and the CustomJoint counterparts) of the
+ * Articulated Body Algorithm.
+ *
+ * Model::IA has to be initialized with the rigid body inertias and
+ * Model::X_lambda and the motion subspaces have to be up to date.
+ */
+static void CalcArticulatedBodyInertias (Model &model) {
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    if (model.mJoints[i].mDoFCount == 1
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      model.U[i] = model.IA[i] * model.S[i];
+      model.d[i] = model.S[i].dot(model.U[i]);
+      //      LOG << "u[" << i << "] = " << model.u[i] << std::endl;
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        SpatialArticulatedBodyInertia Ia (model.IA[i]);
+        Ia.subtractSymmetricProduct (model.U[i] / model.d[i], model.U[i], 1);
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+      }
+    } else if (model.mJoints[i].mDoFCount == 3
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+
+      model.multdof3_U[i] = model.IA[i] * model.multdof3_S[i];
+
+#ifdef EIGEN_CORE_H
+      model.multdof3_Dinv[i] = 
+        (model.multdof3_S[i].transpose()*model.multdof3_U[i]).inverse().eval();
+#else
+      model.multdof3_Dinv[i] = 
+        (model.multdof3_S[i].transpose() * model.multdof3_U[i]).inverse();
+#endif
+      //      LOG << "mCustomJoints[kI]->u[" << i << "] = "
+      //<< model.mCustomJoints[kI]->u[i].transpose() << std::endl;
+
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        SpatialArticulatedBodyInertia Ia (model.IA[i]);
+        Ia.subtractSymmetricProduct (
+            Matrix63 (model.multdof3_U[i] * model.multdof3_Dinv[i]),
+            model.multdof3_U[i], 3);
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+      }
+    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        SpatialArticulatedBodyInertia Ia;
+        CalcCustomJointArticulatedInertia (model, i, NULL, &Ia, NULL);
+        model.IA[lambda] += model.X_lambda[i].applyTranspose (Ia);
+      } else {
+        CalcCustomJointArticulatedInertia (model, i, NULL, NULL, NULL);
+      }
+    }
+  }
+}
+
+RBDL_DLLAPI void CalcMInvTimesTau ( Model &model,
+    const VectorNd &Q,
+    const VectorNd &Tau,
+    VectorNd &QDDot,
+    bool update_kinematics) {
+
+  LOG << "Q          = " << Q.transpose() << std::endl;
+  LOG << "---" << std::endl;
+
+  // Reset the velocity of the root body
+  model.v[0].setZero();
+  model.a[0].setZero();
+
+  if (update_kinematics) {
+    jcalc_sincos (model, Q);
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      jcalc_X_lambda_S (model, model.mJointUpdateOrder[i], Q, true);
+
+      model.v_J[i].setZero();
+      model.v[i].setZero();
+      model.c[i].setZero();
+      model.pA[i].setZero();
+      model.IA[i].createFromRigidBodyInertia (model.I[i]);
+    }
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    model.pA[i].setZero();
+  }
+
+  // ClearLogOutput();
+
+  if (update_kinematics) {
+    CalcArticulatedBodyInertias (model);
+  }
+
+  // compute articulated bias forces
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    unsigned int q_index = model.mJoints[i].q_index;
+
+    if (model.mJoints[i].mDoFCount == 1
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+
+      model.u[i] = Tau[q_index] - model.S[i].dot(model.pA[i]);
+      // LOG << "u[" << i << "] = " << model.u[i] << std::endl;
+      unsigned int lambda = model.lambda[i];
+      if (lambda != 0) {
+        SpatialVector pa = model.pA[i] + model.U[i] * model.u[i] / model.d[i];
+
+#ifdef EIGEN_CORE_H
+        model.pA[lambda].noalias() += model.X_lambda[i].applyTranspose(pa);
+#else
+        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
+#endif
+        LOG << "pA[" << lambda << "] = "
+          << model.pA[lambda].transpose() << std::endl;
+      }
+    } else if (model.mJoints[i].mDoFCount == 3
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+
+      Vector3d tau_temp ( Tau[q_index],
+          Tau[q_index + 1],
+          Tau[q_index + 2]);
+      model.multdof3_u[i] = tau_temp 
+        - model.multdof3_S[i].transpose()*model.pA[i];
+      //      LOG << "multdof3_u[" << i << "] = "
+      // << model.multdof3_u[i].transpose() << std::endl;
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        SpatialVector pa = model.pA[i]
+          + model.multdof3_U[i]
+          * model.multdof3_Dinv[i]
+          * model.multdof3_u[i];
+
+#ifdef EIGEN_CORE_H
+        model.pA[lambda].noalias() +=
+          model.X_lambda[i].applyTranspose(pa);
+#else
+        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
+#endif
+        LOG << "pA[" << lambda << "] = "
+          << model.pA[lambda].transpose() << std::endl;
+      }
+    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int kI     = model.mJoints[i].custom_joint_index;
+      unsigned int dofI   = model.mCustomJoints[kI]->mDoFCount;
+      JointVectorN tau_temp(Tau.block(q_index,0,dofI,1));
+      tau_temp -= model.mCustomJoints[kI]->S.transpose() * model.pA[i];
+      model.mCustomJoints[kI]->u = tau_temp;
+      //      LOG << "mCustomJoints[kI]->u"
+      // << model.mCustomJoints[kI]->u.transpose() << std::endl;
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        JointVectorN Dinv_u (model.mCustomJoints[kI]->Dinv * tau_temp);
+        SpatialVector pa = model.pA[i]
+          + model.mCustomJoints[kI]->U * Dinv_u;
+
+#ifdef EIGEN_CORE_H
+        model.pA[lambda].noalias() +=
+          model.X_lambda[i].applyTranspose(pa);
+#else
+        model.pA[lambda] += model.X_lambda[i].applyTranspose(pa);
+#endif
+        LOG << "pA[" << lambda << "] = "
+          << model.pA[lambda].transpose() << std::endl;
+      }
+    }
+  }
+
+  //  ClearLogOutput();
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
+    SpatialTransform X_lambda = model.X_lambda[i];
+
+    model.a[i] = X_lambda.apply(model.a[lambda]) + model.c[i];
+    LOG << "a'[" << i << "] = " << model.a[i].transpose() << std::endl;
+
+    if (model.mJoints[i].mDoFCount == 1
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      QDDot[q_index] = (1./model.d[i])*(model.u[i]-model.U[i].dot(model.a[i]));
+      model.a[i]     = model.a[i] + model.S[i] * QDDot[q_index];
+    } else if (model.mJoints[i].mDoFCount == 3
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      Vector3d qdd_temp = 
+        model.multdof3_Dinv[i] * (model.multdof3_u[i]
+            - model.multdof3_U[i].transpose()*model.a[i]);
+
+      QDDot[q_index]      = qdd_temp[0];
+      QDDot[q_index + 1]  = qdd_temp[1];
+      QDDot[q_index + 2]  = qdd_temp[2];
+      model.a[i]          = model.a[i] + model.multdof3_S[i] * qdd_temp;
+    } else if (model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int kI     = model.mJoints[i].custom_joint_index;
+      unsigned int dofI   = model.mCustomJoints[kI]->mDoFCount;
+
+      JointVectorN u_temp (model.mCustomJoints[kI]->u);
+      u_temp -= model.mCustomJoints[kI]->U.transpose() * model.a[i];
+      JointVectorN qdd_temp (model.mCustomJoints[kI]->Dinv * u_temp);
+
+      for(unsigned z = 0; z < dofI; ++z){
+        QDDot[q_index+z]      = qdd_temp[z];
+      }
+
+      model.a[i] =    model.a[i]
+        + model.mCustomJoints[kI]->S * qdd_temp;
+    }
+  }
+
+  LOG << "QDDot = " << QDDot.transpose() << std::endl;
+}
+
+/** \brief Sizes the per-body 6 x n_cols blocks that are used by
+ * CalcMInvTimesMatrix() such that they only get reallocated if the model
+ * or the number of columns changed.
+ */
+static void ResizeMInvTimesMatrixWorkspace (
+    Model &model,
+    unsigned int n_cols) {
+  if (model.pA_cols.size() != model.mBodies.size()) {
+    model.pA_cols.resize (model.mBodies.size());
+    model.u_cols.resize (model.mBodies.size());
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int dof_count = model.mJoints[i].mDoFCount;
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      dof_count = model.mCustomJoints[model.mJoints[i].custom_joint_index]
+        ->mDoFCount;
+    }
+
+    if (static_cast<unsigned int>(model.pA_cols[i].cols()) != n_cols) {
+      model.pA_cols[i].resize (6, n_cols);
+    }
+    if (static_cast<unsigned int>(model.u_cols[i].rows()) != dof_count
+        || static_cast<unsigned int>(model.u_cols[i].cols()) != n_cols) {
+      model.u_cols[i].resize (dof_count, n_cols);
+    }
+  }
+}
+
+/** \brief Backward step of CalcMInvTimesMatrix() for a joint with n
+ * degrees of freedom.
+ *
+ * Computes the n x k joint space bias forces u = B_rows - S^T pA of all
+ * columns and adds U D^-1 u to the 6 x k articulated bias forces pA.
+ */
+template <typename MatrixType6N>
+static void MInvTimesMatrixJointBackward (
+    const MatrixType6N &S,
+    const MatrixType6N &UDinv,
+    const MatrixNd &B,
+    unsigned int q_index,
+    MatrixNd &u,
+    SpatialMatrixN &pA) {
+  u = B.block (q_index, 0, u.rows(), u.cols());
+#ifdef EIGEN_CORE_H
+  u.noalias() -= S.transpose() * pA;
+  pA.noalias() += UDinv * u;
+#else
+  // SimpleMath treats dynamic matrices as scalars in products with const
+  // fixed size matrices
+  u -= MatrixNd (S).transpose() * pA;
+  pA += MatrixNd (UDinv) * u;
+#endif
+}
+
+/** \brief Forward step of CalcMInvTimesMatrix() for a joint with n
+ * degrees of freedom.
+ *
+ * Writes qdd = D^-1 (u - U^T a) of all columns into the rows of X that
+ * belong to the joint and adds S qdd to the 6 x k accelerations a. u is
+ * overwritten.
+ */
+template <typename MatrixType6N, typename MatrixTypeNN>
+static void MInvTimesMatrixJointForward (
+    const MatrixType6N &S,
+    const MatrixType6N &U,
+    const MatrixTypeNN &Dinv,
+    unsigned int q_index,
+    MatrixNd &u,
+    SpatialMatrixN &a,
+    MatrixNd &X) {
+#ifdef EIGEN_CORE_H
+  u.noalias() -= U.transpose() * a;
+  X.block (q_index, 0, u.rows(), u.cols()).noalias() = Dinv * u;
+  a.noalias() += S * X.block (q_index, 0, u.rows(), u.cols());
+#else
+  u -= MatrixNd (U).transpose() * a;
+  MatrixNd qdd (MatrixNd (Dinv) * u);
+  X.block (q_index, 0, u.rows(), u.cols()) = qdd;
+  a += MatrixNd (S) * qdd;
+#endif
+}
+
+/** \brief Forward step of CalcMInvTimesMatrix() for a joint with a
+ * single degree of freedom and the scalar D = d.
+ */
+static void MInvTimesMatrixJointForward (
+    const SpatialVector &S,
+    const SpatialVector &U,
+    double d,
+    unsigned int q_index,
+    MatrixNd &u,
+    SpatialMatrixN &a,
+    MatrixNd &X) {
+#ifdef EIGEN_CORE_H
+  u.noalias() -= U.transpose() * a;
+  X.block (q_index, 0, 1, u.cols()).noalias() = u / d;
+  a.noalias() += S * X.block (q_index, 0, 1, u.cols());
+#else
+  u -= MatrixNd (U).transpose() * a;
+  MatrixNd qdd (u * (1. / d));
+  X.block (q_index, 0, 1, u.cols()) = qdd;
+  a += MatrixNd (S) * qdd;
+#endif
+}
+
+RBDL_DLLAPI void CalcMInvTimesMatrix ( Model &model,
+    const VectorNd &Q,
+    const MatrixNd &B,
+    MatrixNd &X,
+    bool update_kinematics) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  const unsigned int n_cols = B.cols();
+
+  assert (B.rows() == model.dof_count);
+  assert (X.rows() == model.dof_count && X.cols() == n_cols);
+
+  if (update_kinematics) {
+    jcalc_sincos (model, Q);
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      jcalc_X_lambda_S (model, model.mJointUpdateOrder[i], Q, true);
+
+      model.v_J[i].setZero();
+      model.v[i].setZero();
+      model.c[i].setZero();
+      model.pA[i].setZero();
+      model.IA[i].createFromRigidBodyInertia (model.I[i]);
+    }
+
+    CalcArticulatedBodyInertias (model);
+  }
+
+  // Articulated bias forces and accelerations of all columns are
+  // propagated together as 6 x n_cols blocks.
+  ResizeMInvTimesMatrixWorkspace (model, n_cols);
+  std::vector<SpatialMatrixN> &pA = model.pA_cols;
+  std::vector<MatrixNd> &u = model.u_cols;
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    pA[i].setZero();
+  }
+
+  for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
+
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      CustomJoint *custom_joint =
+        model.mCustomJoints[model.mJoints[i].custom_joint_index];
+      JointMatrix6N S (custom_joint->S);
+      JointMatrix6N UDinv (custom_joint->U * custom_joint->Dinv);
+
+      MInvTimesMatrixJointBackward (S, UDinv, B, q_index, u[i], pA[i]);
+    } else if (model.mJoints[i].mDoFCount == 1) {
+      SpatialVector UDinv (model.U[i] / model.d[i]);
+
+      MInvTimesMatrixJointBackward (model.S[i], UDinv, B, q_index, u[i],
+          pA[i]);
+    } else if (model.mJoints[i].mDoFCount == 3) {
+      Matrix63 UDinv (model.multdof3_U[i] * model.multdof3_Dinv[i]);
+
+      MInvTimesMatrixJointBackward (model.multdof3_S[i], UDinv, B, q_index,
+          u[i], pA[i]);
+    }
+
+    if (lambda != 0) {
+      model.X_lambda[i].addApplyTransposeToColumns (pA[i], pA[lambda],
+          n_cols);
+    }
+  }
+
+  // pA of the bodies is not needed anymore and is reused for the
+  // accelerations
+  std::vector<SpatialMatrixN> &a = pA;
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
+
+    // the acceleration of the root is zero
+    if (lambda != 0) {
+      model.X_lambda[i].applyToColumns (a[lambda], a[i], n_cols);
+    } else {
+      a[i].setZero();
+    }
+
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      CustomJoint *custom_joint =
+        model.mCustomJoints[model.mJoints[i].custom_joint_index];
+      JointMatrix6N S (custom_joint->S);
+      JointMatrix6N U (custom_joint->U);
+      JointMatrixNN Dinv (custom_joint->Dinv);
+
+      MInvTimesMatrixJointForward (S, U, Dinv, q_index, u[i], a[i], X);
+    } else if (model.mJoints[i].mDoFCount == 1) {
+      MInvTimesMatrixJointForward (model.S[i], model.U[i], model.d[i],
+          q_index, u[i], a[i], X);
+    } else if (model.mJoints[i].mDoFCount == 3) {
+      MInvTimesMatrixJointForward (model.multdof3_S[i], model.multdof3_U[i],
+          model.multdof3_Dinv[i], q_index, u[i], a[i], X);
+    }
+  }
+}
+
+/** \brief Computes X Omega X^T for a symmetric matrix Omega that maps
+ * spatial forces to spatial accelerations, e.g. an inverse inertia.
+ *
+ * Omega X^T is symmetric to X Omega, so both products are computed by
+ * applying X to columns.
+ */
+static void TransformInverseInertia (
+    const SpatialTransform &X,
+    const SpatialMatrix &Omega,
+    SpatialMatrix &result) {
+  SpatialMatrix XOmega;
+
+  for (unsigned int c = 0; c < 6; c++) {
+    SpatialVector col = X.apply (SpatialVector (
+          Omega(0,c), Omega(1,c), Omega(2,c),
+          Omega(3,c), Omega(4,c), Omega(5,c)));
+    for (unsigned int r = 0; r < 6; r++) {
+      XOmega(r,c) = col[r];
+    }
+  }
+
+  for (unsigned int c = 0; c < 6; c++) {
+    SpatialVector col = X.apply (SpatialVector (
+          XOmega(c,0), XOmega(c,1), XOmega(c,2),
+          XOmega(c,3), XOmega(c,4), XOmega(c,5)));
+    for (unsigned int r = 0; r < 6; r++) {
+      result(r,c) = col[r];
+    }
+  }
+}
+
+/** \brief Computes (1 - K U^T) W (1 - U K^T) + S D^-1 S^T in place of W
+ * with K = S D^-1 for a joint with motion subspace S, U = I^A S and
+ * D^-1 = (S^T U)^-1.
+ *
+ * With Y = W U this is W - K Y^T - Y K^T + K (U^T Y + D) K^T, which only
+ * needs products with the joint columns.
+ */
+template <typename Matrix6N, typename MatrixNN>
+static void AddJointInverseInertia (
+    const Matrix6N &S,
+    const Matrix6N &U,
+    const MatrixNN &Dinv,
+    SpatialMatrix &W) {
+  Matrix6N K (S * Dinv);
+  Matrix6N Y (W * U);
+  MatrixNN C (U.transpose() * Y);
+  C += S.transpose() * U;
+  Matrix6N KC (K * C);
+
+  W -= K * Y.transpose() + Y * K.transpose();
+  W += KC * K.transpose();
+}
+
+/** \brief Same as AddJointInverseInertia() for joints with a single degree
+ * of freedom. */
+static void AddJointInverseInertia (
+    const SpatialVector &S,
+    const SpatialVector &U,
+    double d,
+    SpatialMatrix &W) {
+  SpatialVector K (S / d);
+  SpatialVector Y (W * U);
+  double c = U.dot (Y) + d;
+
+  W -= K * Y.transpose() + Y * K.transpose();
+  W += (c * K) * K.transpose();
+}
+
+/** \brief Computes Phi (1 - S D^-1 U^T) X, i.e. multiplies the extended
+ * force propagator Phi of a task with the acceleration propagator of the
+ * joint from its parent body.
+ */
+template <typename Matrix6N, typename MatrixNN>
+static void ApplyAccelerationPropagator (
+    const Matrix6N &S,
+    const Matrix6N &U,
+    const MatrixNN &Dinv,
+    const SpatialTransform &X,
+    const SpatialMatrix &Phi,
+    SpatialMatrix &result) {
+  // multiplied with the non-const copy of Phi as SimpleMath treats
+  // dynamic matrices as scalars in products with const fixed size matrices
+  SpatialMatrix PhiP (Phi);
+  Matrix6N PhiK (PhiP * S);
+  PhiK = PhiK * Dinv;
+  PhiP -= PhiK * U.transpose();
+
+  // the rows of PhiP X are the rows of PhiP transformed by X^T
+  for (unsigned int r = 0; r < 6; r++) {
+    SpatialVector row = X.applyTranspose (SpatialVector (
+          PhiP(r,0), PhiP(r,1), PhiP(r,2), PhiP(r,3), PhiP(r,4), PhiP(r,5)));
+    for (unsigned int c = 0; c < 6; c++) {
+      result(r,c) = row[c];
+    }
+  }
+}
+
+/** \brief Same as ApplyAccelerationPropagator() for joints with a single
+ * degree of freedom. */
+static void ApplyAccelerationPropagator (
+    const SpatialVector &S,
+    const SpatialVector &U,
+    double d,
+    const SpatialTransform &X,
+    const SpatialMatrix &Phi,
+    SpatialMatrix &result) {
+  SpatialVector PhiK (Phi * S / d);
+  SpatialMatrix PhiP (Phi);
+  PhiP -= PhiK * U.transpose();
+
+  for (unsigned int r = 0; r < 6; r++) {
+    SpatialVector row = X.applyTranspose (SpatialVector (
+          PhiP(r,0), PhiP(r,1), PhiP(r,2), PhiP(r,3), PhiP(r,4), PhiP(r,5)));
+    for (unsigned int c = 0; c < 6; c++) {
+      result(r,c) = row[c];
+    }
+  }
+}
+
+/** \brief Sizes the workspaces of CalcOperationalSpaceInertiaInverse()
+ * such that they only get reallocated if the model or the task paths grow.
+ */
+static void ResizeOperationalSpaceInertiaWorkspace (
+    Model &model,
+    unsigned int n_tasks) {
+  if (model.Omega.size() != model.mBodies.size()) {
+    model.Omega.resize (model.mBodies.size());
+  }
+  model.Omega[0].setZero();
+
+  model.task_path_mask.assign (model.mBodies.size(), false);
+  model.task_path_offsets.resize (n_tasks + 1);
+  model.task_path_ids.clear();
+}
+
+/// \brief Returns the movable body of a movable or fixed body id.
+static unsigned int GetMovableBodyId (Model &model, unsigned int body_id) {
+  if (model.IsFixedBodyId (body_id)) {
+    return model.mFixedBodies[body_id - model.fixed_body_discriminator]
+      .mMovableParent;
+  }
+
+  return body_id;
+}
+
+RBDL_DLLAPI void CalcOperationalSpaceInertiaInverse (
+    Model &model,
+    const VectorNd &Q,
+    const std::vector<unsigned int> &body_ids,
+    const std::vector<Vector3d> &body_points,
+    MatrixNd &LambdaInv,
+    bool update_kinematics) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (body_ids.size() == body_points.size());
+  assert (LambdaInv.rows() == 6 * body_ids.size());
+  assert (LambdaInv.cols() == 6 * body_ids.size());
+
+  if (update_kinematics) {
+    UpdateKinematicsCustom (model, &Q, NULL, NULL);
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      model.IA[i].createFromRigidBodyInertia (model.I[i]);
+    }
+
+    CalcArticulatedBodyInertias (model);
+  }
+
+  const unsigned int n_tasks = body_ids.size();
+
+  ResizeOperationalSpaceInertiaWorkspace (model, n_tasks);
+
+  // Bodies that are an ancestor of (or equal to) a task body. Only for
+  // those the inverse inertias are needed.
+  for (unsigned int t = 0; t < n_tasks; t++) {
+    unsigned int body_id = GetMovableBodyId (model, body_ids[t]);
+
+    while (body_id != 0 && !model.task_path_mask[body_id]) {
+      model.task_path_mask[body_id] = true;
+      body_id = model.lambda[body_id];
+    }
+  }
+
+  // Omega_i = S_i D_i^-1 S_i^T + P_i Omega_lambda(i) P_i^T is the inverse
+  // of the apparent inertia at body i (in body coordinates) where
+  // P_i = (1 - S_i D_i^-1 U_i^T) X_lambda_i is the acceleration propagator
+  // of body i. Bodies are ordered such that parents come first.
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (!model.task_path_mask[i]) {
+      continue;
+    }
+
+    SpatialMatrix &Omega = model.Omega[i];
+    TransformInverseInertia (model.X_lambda[i], model.Omega[model.lambda[i]],
+        Omega);
+
+    if (model.mJoints[i].mDoFCount == 1
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      AddJointInverseInertia (model.S[i], model.U[i], model.d[i], Omega);
+    } else if (model.mJoints[i].mDoFCount == 3
+        && model.mJoints[i].mJointType != JointTypeCustom) {
+      AddJointInverseInertia (model.multdof3_S[i], model.multdof3_U[i],
+          model.multdof3_Dinv[i], Omega);
+    } else {
+      const CustomJoint *custom_joint =
+        model.mCustomJoints[model.mJoints[i].custom_joint_index];
+      AddJointInverseInertia (JointMatrix6N (custom_joint->S),
+          JointMatrix6N (custom_joint->U), JointMatrixNN (custom_joint->Dinv),
+          Omega);
+    }
+  }
+
+  // Extended force propagators: for task t and each ancestor j of its
+  // body, Phi_t(j) maps the spatial acceleration of body j (due to
+  // forces acting on j or its ancestors) to the task frame. The task frame
+  // is located at the point and aligned with the base frame. The
+  // propagators of task t are stored from task_path_offsets[t] on.
+  unsigned int n_entries = 0;
+  for (unsigned int t = 0; t < n_tasks; t++) {
+    model.task_path_offsets[t] = n_entries;
+    for (unsigned int body_id = GetMovableBodyId (model, body_ids[t]);
+        body_id != 0; body_id = model.lambda[body_id]) {
+      model.task_path_ids.push_back (body_id);
+      n_entries++;
+    }
+  }
+  model.task_path_offsets[n_tasks] = n_entries;
+
+  if (model.task_Phi.size() < n_entries) {
+    model.task_Phi.resize (n_entries);
+  }
+
+  for (unsigned int t = 0; t < n_tasks; t++) {
+    unsigned int body_id = GetMovableBodyId (model, body_ids[t]);
+    if (body_id == 0) {
+      continue;
+    }
+
+    unsigned int e = model.task_path_offsets[t];
+    SpatialTransform X_task = SpatialTransform (Matrix3d::Identity(),
+        CalcBodyToBaseCoordinates (model, Q, body_ids[t], body_points[t],
+          false)) * model.X_base[body_id].inverse();
+    model.task_Phi[e] = X_task.toMatrix();
+
+    for (; e + 1 < model.task_path_offsets[t + 1]; e++) {
+      unsigned int i = model.task_path_ids[e];
+      const SpatialMatrix &Phi = model.task_Phi[e];
+
+      if (model.mJoints[i].mDoFCount == 1
+          && model.mJoints[i].mJointType != JointTypeCustom) {
+        ApplyAccelerationPropagator (model.S[i], model.U[i], model.d[i],
+            model.X_lambda[i], Phi, model.task_Phi[e + 1]);
+      } else if (model.mJoints[i].mDoFCount == 3
+          && model.mJoints[i].mJointType != JointTypeCustom) {
+        ApplyAccelerationPropagator (model.multdof3_S[i],
+            model.multdof3_U[i], model.multdof3_Dinv[i], model.X_lambda[i],
+            Phi, model.task_Phi[e + 1]);
+      } else {
+        const CustomJoint *custom_joint =
+          model.mCustomJoints[model.mJoints[i].custom_joint_index];
+        ApplyAccelerationPropagator (JointMatrix6N (custom_joint->S),
+            JointMatrix6N (custom_joint->U),
+            JointMatrixNN (custom_joint->Dinv), model.X_lambda[i], Phi,
+            model.task_Phi[e + 1]);
+      }
+    }
+  }
+
+  // The block of two tasks only depends on their deepest common ancestor
+  // c: LambdaInv_st = Phi_s(c) Omega_c Phi_t(c)^T.
+  for (unsigned int s = 0; s < n_tasks; s++) {
+    for (unsigned int t = s; t < n_tasks; t++) {
+      unsigned int ps = model.task_path_offsets[s];
+      unsigned int pt = model.task_path_offsets[t];
+      const unsigned int ps_end = model.task_path_offsets[s + 1];
+      const unsigned int pt_end = model.task_path_offsets[t + 1];
+
+      while (ps < ps_end && pt < pt_end
+          && model.task_path_ids[ps] != model.task_path_ids[pt]) {
+        // parents always have smaller ids than their children
+        if (model.task_path_ids[ps] > model.task_path_ids[pt]) {
+          ps++;
+        } else {
+          pt++;
+        }
+      }
+
+      SpatialMatrix block (SpatialMatrix::Zero());
+      if (ps < ps_end && pt < pt_end) {
+        const unsigned int c = model.task_path_ids[ps];
+        SpatialMatrix PhiOmega (model.task_Phi[ps] * model.Omega[c]);
+        block = PhiOmega * model.task_Phi[pt].transpose();
+      }
+
+      LambdaInv.block(6 * s, 6 * t, 6, 6) = block;
+      if (s != t) {
+        LambdaInv.block(6 * t, 6 * s, 6, 6) = block.transpose();
+      }
+    }
+  }
+}
+
+/** \brief Computes the columns of the linear map from the 10 inertial
+ * parameters [m, h_x, h_y, h_z, I_xx, I_xy, I_xz, I_yy, I_yz, I_zz] of a
+ * body to the spatial vector I w.
+ */
+static void CalcInertiaTimesMotionColumns (
+    const SpatialVector &w,
+    SpatialVector K[10]) {
+  K[0] = SpatialVector (0., 0., 0., w[3], w[4], w[5]);
+
+  // I w = [ Ibar w_ang + h x w_lin ; m w_lin - h x w_ang ]
+  K[1] = SpatialVector (0., -w[5], w[4], 0., w[2], -w[1]);
+  K[2] = SpatialVector (w[5], 0., -w[3], -w[2], 0., w[0]);
+  K[3] = SpatialVector (-w[4], w[3], 0., w[1], -w[0], 0.);
+
+  K[4] = SpatialVector (w[0], 0., 0., 0., 0., 0.);
+  K[5] = SpatialVector (w[1], w[0], 0., 0., 0., 0.);
+  K[6] = SpatialVector (w[2], 0., w[0], 0., 0., 0.);
+  K[7] = SpatialVector (0., w[1], 0., 0., 0., 0.);
+  K[8] = SpatialVector (0., w[2], w[1], 0., 0., 0.);
+  K[9] = SpatialVector (0., 0., w[2], 0., 0., 0.);
+}
+
+/** \brief Stores the projection S^T f of a spatial force onto the joint of
+ * body i in the rows of the joint starting at row_offset.
+ */
+static void StoreJointProjection (
+    const Model &model,
+    unsigned int i,
+    const SpatialVector &f,
+    MatrixNd &Y,
+    unsigned int row_offset,
+    unsigned int col) {
+  unsigned int row = row_offset + model.mJoints[i].q_index;
+
+  if (model.mJoints[i].mJointType == JointTypeCustom) {
+    unsigned int k = model.mJoints[i].custom_joint_index;
+    VectorNd tau_temp = model.mCustomJoints[k]->S.transpose() * f;
+    for (unsigned int j = 0; j < model.mCustomJoints[k]->mDoFCount; j++) {
+      Y(row + j, col) = tau_temp[j];
+    }
+  } else if (model.mJoints[i].mDoFCount == 1) {
+    Y(row, col) = model.S[i].dot(f);
+  } else if (model.mJoints[i].mDoFCount == 3) {
+    Vector3d tau_temp = model.multdof3_S[i].transpose() * f;
+    Y(row, col) = tau_temp[0];
+    Y(row + 1, col) = tau_temp[1];
+    Y(row + 2, col) = tau_temp[2];
+  }
+}
+
+/** \brief Writes the regressor of a single sample into the rows
+ * row_offset, ..., row_offset + dof_count - 1 of Y.
+ */
+static void CalcInverseDynamicsRegressorRows (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &QDDot,
+    MatrixNd &Y,
+    unsigned int row_offset) {
+  // Reset the velocity of the root body
+  model.v[0].setZero();
+  model.a[0].set (0., 0., 0., -model.gravity[0], -model.gravity[1], -model.gravity[2]);
+
+  jcalc_sincos (model, Q);
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
+
+    jcalc (model, i, Q, QDot, true);
+
+    model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
+    model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+    model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
+
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int k = model.mJoints[i].custom_joint_index;
+      VectorNd qdd_temp (QDDot.block(q_index, 0,
+            model.mCustomJoints[k]->mDoFCount, 1));
+      model.a[i] += model.mCustomJoints[k]->S * qdd_temp;
+    } else if (model.mJoints[i].mDoFCount == 1) {
+      model.a[i] += model.S[i] * QDDot[q_index];
+    } else if (model.mJoints[i].mDoFCount == 3) {
+      model.a[i] += model.multdof3_S[i]
+        * Vector3d (QDDot[q_index], QDDot[q_index + 1], QDDot[q_index + 2]);
+    }
+  }
+
+  Y.block(row_offset, 0, model.dof_count, Y.cols())
+    = MatrixNd::Zero (model.dof_count, Y.cols());
+
+  SpatialVector K_a[10];
+  SpatialVector K_v[10];
+  SpatialVector F[10];
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    // f_i = I_i a_i + v_i x* I_i v_i is linear in the parameters of body i
+    CalcInertiaTimesMotionColumns (model.a[i], K_a);
+    CalcInertiaTimesMotionColumns (model.v[i], K_v);
+
+    for (unsigned int p = 0; p < 10; p++) {
+      F[p] = K_a[p] + crossf (model.v[i], K_v[p]);
+    }
+
+    // The force of body i is transmitted by all joints on its path to the
+    // root.
+    unsigned int col = 10 * (i - 1);
+    unsigned int k = i;
+    while (true) {
+      for (unsigned int p = 0; p < 10; p++) {
+        StoreJointProjection (model, k, F[p], Y, row_offset, col + p);
+      }
+
+      if (model.lambda[k] == 0) {
+        break;
+      }
+
+      for (unsigned int p = 0; p < 10; p++) {
+        F[p] = model.X_lambda[k].applyTranspose(F[p]);
+      }
+      k = model.lambda[k];
+    }
+  }
+}
+
+RBDL_DLLAPI void CalcInverseDynamicsRegressor (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &QDDot,
+    MatrixNd &Y) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (Y.rows() == model.dof_count);
+  assert (Y.cols() == 10 * (model.mBodies.size() - 1));
+
+  CalcInverseDynamicsRegressorRows (model, Q, QDot, QDDot, Y, 0);
+}
+
+RBDL_DLLAPI void CalcInverseDynamicsRegressorBatch (
+    Model &model,
+    const std::vector<VectorNd> &Q,
+    const std::vector<VectorNd> &QDot,
+    const std::vector<VectorNd> &QDDot,
+    MatrixNd &Y) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (Q.size() == QDot.size() && Q.size() == QDDot.size());
+  assert (Y.rows() == Q.size() * model.dof_count);
+  assert (Y.cols() == 10 * (model.mBodies.size() - 1));
+
+  for (unsigned int s = 0; s < Q.size(); s++) {
+    CalcInverseDynamicsRegressorRows (model, Q[s], QDot[s], QDDot[s], Y,
+        s * model.dof_count);
+  }
+}
+
+RBDL_DLLAPI void InverseDynamicsBatch (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &QDDot,
+    const std::vector<std::vector<SpatialRigidBodyInertia> > &inertias,
+    MatrixNd &Tau,
+    std::vector<SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (Tau.rows() == model.dof_count);
+  assert (Tau.cols() == inertias.size());
+
+  // Kinematics are independent of the inertial parameters
+  model.v[0].setZero();
+  model.a[0].set (0., 0., 0., -model.gravity[0], -model.gravity[1], -model.gravity[2]);
+
+  jcalc_sincos (model, Q);
+
+  // the external forces in body coordinates are the same for all variants
+  std::vector<SpatialVector> f_ext_body;
+  if (f_ext != NULL) {
+    f_ext_body.resize (model.mBodies.size(), SpatialVector::Zero());
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
+
+    jcalc (model, i, Q, QDot, true);
+
+    model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
+    model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+    model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
+
+    if (model.mJoints[i].mJointType == JointTypeCustom) {
+      unsigned int k = model.mJoints[i].custom_joint_index;
+      JointVectorN qdd_temp (QDDot.block(q_index, 0,
+            model.mCustomJoints[k]->mDoFCount, 1));
+      model.a[i] += model.mCustomJoints[k]->S * qdd_temp;
+    } else if (model.mJoints[i].mDoFCount == 1) {
+      model.a[i] += model.S[i] * QDDot[q_index];
+    } else if (model.mJoints[i].mDoFCount == 3) {
+      model.a[i] += model.multdof3_S[i]
+        * Vector3d (QDDot[q_index], QDDot[q_index + 1], QDDot[q_index + 2]);
+    }
+
+    if (f_ext != NULL) {
+      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+      f_ext_body[i] = model.X_base[i].applyAdjoint ((*f_ext)[i]);
+    }
+  }
+
+  for (unsigned int k = 0; k < inertias.size(); k++) {
+    const std::vector<SpatialRigidBodyInertia> &I = inertias[k];
+    assert (I.size() == model.mBodies.size());
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      if (!model.mBodies[i].mIsVirtual) {
+        model.f[i] = I[i] * model.a[i] + crossf(model.v[i], I[i] * model.v[i]);
+      } else {
+        model.f[i].setZero();
+      }
+
+      if (f_ext != NULL) {
+        model.f[i] -= f_ext_body[i];
+      }
+    }
+
+    for (unsigned int i = model.mBodies.size() - 1; i > 0; i--) {
+      StoreJointProjection (model, i, model.f[i], Tau, 0, k);
+
+      if (model.lambda[i] != 0) {
+        model.f[model.lambda[i]] += model.X_lambda[i].applyTranspose(model.f[i]);
+      }
+    }
+  }
+}
+
+RBDL_DLLAPI void ForwardDynamicsBatch (
+    Model &model,
+    const VectorNd &Q,
+    const VectorNd &QDot,
+    const VectorNd &Tau,
+    const std::vector<std::vector<SpatialRigidBodyInertia> > &inertias,
+    MatrixNd &QDDot,
+    std::vector<SpatialVector> *f_ext) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (QDDot.rows() == model.dof_count);
+  assert (QDDot.cols() == inertias.size());
+
+  // Kinematics are independent of the inertial parameters
+  model.v[0].setZero();
+
+  jcalc_sincos (model, Q);
+
+  // the external forces in body coordinates are the same for all variants
+  std::vector<SpatialVector> f_ext_body;
+  if (f_ext != NULL) {
+    f_ext_body.resize (model.mBodies.size(), SpatialVector::Zero());
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    unsigned int lambda = model.lambda[i];
+
+    jcalc (model, i, Q, QDot, true);
+
+    if (lambda != 0)
+      model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+    else
+      model.X_base[i] = model.X_lambda[i];
+
+    model.v[i] = model.X_lambda[i].apply( model.v[lambda]) + model.v_J[i];
+    model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+
+    if (f_ext != NULL && (*f_ext)[i] != SpatialVector::Zero()) {
+      f_ext_body[i] = model.X_base[i].applyAdjoint ((*f_ext)[i]);
+    }
+  }
+
+  VectorNd qddot_variant (VectorNd::Zero (model.dof_count));
+
+  for (unsigned int k = 0; k < inertias.size(); k++) {
+    const std::vector<SpatialRigidBodyInertia> &I = inertias[k];
+    assert (I.size() == model.mBodies.size());
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      model.IA[i].createFromRigidBodyInertia (I[i]);
+      model.pA[i] = crossf(model.v[i], I[i] * model.v[i]);
+
+      if (f_ext != NULL) {
+        model.pA[i] -= f_ext_body[i];
+      }
+    }
+
+    ForwardDynamicsArticulatedBodyPasses (model, Tau, qddot_variant);
+
+    for (unsigned int j = 0; j < model.dof_count; j++) {
+      QDDot(j, k) = qddot_variant[j];
+    }
+  }
 }
 
 } /* namespace RigidBodyDynamics */
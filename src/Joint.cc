@@ -6,6 +6,8 @@
  */
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <assert.h>
 
@@ -18,27 +20,209 @@ namespace RigidBodyDynamics {
 
 using namespace Math;
 
+/** \brief Magnitude of an angle from which jcalc_sincos() uses std::sin()
+ * and std::cos() as the argument reduction is no longer accurate.
+ */
+static const double SinCosLimit = 1.0e6;
+
+/// \brief Number of coordinates jcalc_sincos() evaluates per batch.
+static const unsigned int SinCosBatchSize = 64;
+
+/** \brief Evaluates sin (x[i]) and cos (x[i]) for |x[i]| < SinCosLimit.
+ *
+ * Uses the argument reduction and the minimax polynomials of the Cephes
+ * library. The octant is selected arithmetically instead of with branches
+ * such that the compiler can vectorize the loop.
+ */
+static void SinCosBatch (
+    unsigned int n,
+    const double *x,
+    double *s,
+    double *c) {
+  const double four_over_pi = 1.27323954473516268615;
+  const double DP1 = 7.85398125648498535156e-1;
+  const double DP2 = 3.77489470793079817668e-8;
+  const double DP3 = 2.69515142907905952645e-15;
+
+  for (unsigned int i = 0; i < n; i++) {
+    double ax = std::fabs (x[i]);
+
+    // round the octant up to an even number such that the reduced
+    // argument zh + zl is in [-pi/4, pi/4]. The products with DP1 and DP2
+    // are exact and the rounding error of the subtraction is carried in zl.
+    int j = static_cast<int>(ax * four_over_pi);
+    j += j & 1;
+    double y = static_cast<double>(j);
+    double z1 = ax - y * DP1;
+    double t = y * DP2;
+    double z2 = z1 - t;
+    double zl = t - (z1 - z2) - y * DP3;
+    double zh = z2 + zl;
+    zl = zl - (zh - z2);
+    double zz = zh * zh;
+
+    double rs = zz * (((((1.58962301576546568060e-10 * zz
+                  - 2.50507477628578072866e-8) * zz
+                + 2.75573136213857245213e-6) * zz
+              - 1.98412698295895385996e-4) * zz
+            + 8.33333333332211858878e-3) * zz
+          - 1.66666666666666307295e-1);
+    double rc = zz * zz * (((((-1.13585365213876817300e-11 * zz
+                  + 2.08757008419747316778e-9) * zz
+                - 2.75573141792967388112e-7) * zz
+              + 2.48015872888517045348e-5) * zz
+            - 1.38888888888730564116e-3) * zz
+          + 4.16666666666665929218e-2);
+
+    // add the small terms first to round only once at the end
+    double ps = zh + (zl + zh * rs - 0.5 * zz * zl);
+    double hz = 0.5 * zz;
+    double w = 1. - hz;
+    double pc = w + (((1. - w) - hz) + (rc - zh * zl));
+
+    double swap = static_cast<double>((j >> 1) & 1);
+    double sin_sign = static_cast<double>(1 - 2 * ((j >> 2) & 1));
+    double cos_sign = static_cast<double>(1 - 2 * (((j >> 1) ^ (j >> 2)) & 1));
+
+    s[i] = (ps * (1. - swap) + pc * swap) * sin_sign * std::copysign (1., x[i]);
+    c[i] = (pc * (1. - swap) + ps * swap) * cos_sign;
+  }
+}
+
+static inline void JointSinCos (
+    const Model &model,
+    const VectorNd &q,
+    unsigned int q_index,
+    bool use_sincos_cache,
+    double &s,
+    double &c) {
+  if (use_sincos_cache) {
+    s = model.q_sin[q_index];
+    c = model.q_cos[q_index];
+  } else {
+    s = sin (q[q_index]);
+    c = cos (q[q_index]);
+  }
+}
+
+static inline SpatialTransform XrotxCached (
+    const Model &model,
+    const VectorNd &q,
+    unsigned int q_index,
+    bool use_sincos_cache) {
+  if (!use_sincos_cache) {
+    return Xrotx (q[q_index]);
+  }
+
+  double s = model.q_sin[q_index];
+  double c = model.q_cos[q_index];
+  return SpatialTransform (
+      Matrix3d (
+        1., 0., 0.,
+        0., c, s,
+        0., -s, c
+        ),
+      Vector3d (0., 0., 0.)
+      );
+}
+
+static inline SpatialTransform XrotyCached (
+    const Model &model,
+    const VectorNd &q,
+    unsigned int q_index,
+    bool use_sincos_cache) {
+  if (!use_sincos_cache) {
+    return Xroty (q[q_index]);
+  }
+
+  double s = model.q_sin[q_index];
+  double c = model.q_cos[q_index];
+  return SpatialTransform (
+      Matrix3d (
+        c, 0., -s,
+        0., 1., 0.,
+        s, 0., c
+        ),
+      Vector3d (0., 0., 0.)
+      );
+}
+
+static inline SpatialTransform XrotzCached (
+    const Model &model,
+    const VectorNd &q,
+    unsigned int q_index,
+    bool use_sincos_cache) {
+  if (!use_sincos_cache) {
+    return Xrotz (q[q_index]);
+  }
+
+  double s = model.q_sin[q_index];
+  double c = model.q_cos[q_index];
+  return SpatialTransform (
+      Matrix3d (
+        c, s, 0.,
+        -s, c, 0.,
+        0., 0., 1.
+        ),
+      Vector3d (0., 0., 0.)
+      );
+}
+
+static inline SpatialTransform XrotCached (
+    const Model &model,
+    const VectorNd &q,
+    unsigned int q_index,
+    bool use_sincos_cache,
+    const Vector3d &axis) {
+  if (!use_sincos_cache) {
+    return Xrot (q[q_index], axis);
+  }
+
+  double s = model.q_sin[q_index];
+  double c = model.q_cos[q_index];
+  return SpatialTransform (
+      Matrix3d (
+        axis[0] * axis[0] * (1.0f - c) + c,
+        axis[1] * axis[0] * (1.0f - c) + axis[2] * s,
+        axis[0] * axis[2] * (1.0f - c) - axis[1] * s,
+
+        axis[0] * axis[1] * (1.0f - c) - axis[2] * s,
+        axis[1] * axis[1] * (1.0f - c) + c,
+        axis[1] * axis[2] * (1.0f - c) + axis[0] * s,
+
+        axis[0] * axis[2] * (1.0f - c) + axis[1] * s,
+        axis[1] * axis[2] * (1.0f - c) - axis[0] * s,
+        axis[2] * axis[2] * (1.0f - c) + c
+        ),
+      Vector3d (0., 0., 0.)
+      );
+}
+
 RBDL_DLLAPI void jcalc (
     Model &model,
     unsigned int joint_id,
     const VectorNd &q,
-    const VectorNd &qdot
+    const VectorNd &qdot,
+    bool use_sincos_cache
     ) {
   // exception if we calculate it for the root body
   assert (joint_id > 0);
 
   if (model.mJoints[joint_id].mJointType == JointTypeRevoluteX) {
-    model.X_J[joint_id] = Xrotx (q[model.mJoints[joint_id].q_index]);
+    model.X_J[joint_id] = XrotxCached (model, q,
+        model.mJoints[joint_id].q_index, use_sincos_cache);
     model.v_J[joint_id][0] = qdot[model.mJoints[joint_id].q_index];
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteY) {
-    model.X_J[joint_id] = Xroty (q[model.mJoints[joint_id].q_index]);
+    model.X_J[joint_id] = XrotyCached (model, q,
+        model.mJoints[joint_id].q_index, use_sincos_cache);
     model.v_J[joint_id][1] = qdot[model.mJoints[joint_id].q_index];
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteZ) {
-    model.X_J[joint_id] = Xrotz (q[model.mJoints[joint_id].q_index]);
+    model.X_J[joint_id] = XrotzCached (model, q,
+        model.mJoints[joint_id].q_index, use_sincos_cache);
     model.v_J[joint_id][2] = qdot[model.mJoints[joint_id].q_index];
   } else if (model.mJoints[joint_id].mJointType == JointTypeHelical) {
-    model.X_J[joint_id] = jcalc_XJ (model, joint_id, q);
-    jcalc_X_lambda_S(model, joint_id, q);
+    model.X_J[joint_id] = jcalc_XJ (model, joint_id, q, use_sincos_cache);
+    jcalc_X_lambda_S(model, joint_id, q, use_sincos_cache);
     double Jqd = qdot[model.mJoints[joint_id].q_index];
     model.v_J[joint_id] = model.S[joint_id] * Jqd;
     
@@ -49,7 +233,7 @@ RBDL_DLLAPI void jcalc (
     model.c_J[joint_id] = SpatialVector(0,0,0,c[0],c[1],c[2]);
   } else if (model.mJoints[joint_id].mDoFCount == 1 &&
       model.mJoints[joint_id].mJointType != JointTypeCustom) {
-    model.X_J[joint_id] = jcalc_XJ (model, joint_id, q);
+    model.X_J[joint_id] = jcalc_XJ (model, joint_id, q, use_sincos_cache);
     model.v_J[joint_id] = 
       model.S[joint_id] * qdot[model.mJoints[joint_id].q_index];
   } else if (model.mJoints[joint_id].mJointType == JointTypeSpherical) {
@@ -69,16 +253,12 @@ RBDL_DLLAPI void jcalc (
         omega[0], omega[1], omega[2],
         0., 0., 0.);
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerZYX) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, use_sincos_cache, s0, c0);
+    JointSinCos (model, q, q_index + 1, use_sincos_cache, s1, c1);
+    JointSinCos (model, q, q_index + 2, use_sincos_cache, s2, c2);
 
     model.X_J[joint_id].E = Matrix3d(
         c0 * c1, s0 * c1, -s1,
@@ -108,16 +288,12 @@ RBDL_DLLAPI void jcalc (
         -s1*c2*qdot0*qdot1 - c1*s2*qdot0*qdot2 - c2*qdot1*qdot2,
         0.,0., 0.);
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerXYZ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, use_sincos_cache, s0, c0);
+    JointSinCos (model, q, q_index + 1, use_sincos_cache, s1, c1);
+    JointSinCos (model, q, q_index + 2, use_sincos_cache, s2, c2);
 
     model.X_J[joint_id].E = Matrix3d(
         c2 * c1, s2 * c0 + c2 * s1 * s0, s2 * s0 - c2 * s1 * c0,
@@ -148,16 +324,12 @@ RBDL_DLLAPI void jcalc (
         0., 0., 0.
         );
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerYXZ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, use_sincos_cache, s0, c0);
+    JointSinCos (model, q, q_index + 1, use_sincos_cache, s1, c1);
+    JointSinCos (model, q, q_index + 2, use_sincos_cache, s2, c2);
 
     model.X_J[joint_id].E = Matrix3d(
         c2 * c0 + s2 * s1 * s0, s2 * c1, -c2 * s0 + s2 * s1 * c0,
@@ -222,14 +394,16 @@ RBDL_DLLAPI void jcalc (
 RBDL_DLLAPI Math::SpatialTransform jcalc_XJ (
     Model &model,
     unsigned int joint_id,
-    const Math::VectorNd &q) {
+    const Math::VectorNd &q,
+    bool use_sincos_cache) {
   // exception if we calculate it for the root body
   assert (joint_id > 0);
 
   if (model.mJoints[joint_id].mDoFCount == 1
       && model.mJoints[joint_id].mJointType != JointTypeCustom) {
     if (model.mJoints[joint_id].mJointType == JointTypeRevolute) {
-      return Xrot (q[model.mJoints[joint_id].q_index], Vector3d (
+      return XrotCached (model, q, model.mJoints[joint_id].q_index,
+          use_sincos_cache, Vector3d (
             model.mJoints[joint_id].mJointAxes[0][0],
             model.mJoints[joint_id].mJointAxes[0][1],
             model.mJoints[joint_id].mJointAxes[0][2]
@@ -245,8 +419,8 @@ RBDL_DLLAPI Math::SpatialTransform jcalc_XJ (
             )
           );
     } else if (model.mJoints[joint_id].mJointType == JointTypeHelical) {
-      SpatialTransform rot = Xrot(
-          q[model.mJoints[joint_id].q_index], Vector3d (
+      SpatialTransform rot = XrotCached (model, q,
+          model.mJoints[joint_id].q_index, use_sincos_cache, Vector3d (
             model.mJoints[joint_id].mJointAxes[0][0],
             model.mJoints[joint_id].mJointAxes[0][1],
             model.mJoints[joint_id].mJointAxes[0][2]
@@ -271,25 +445,29 @@ RBDL_DLLAPI Math::SpatialTransform jcalc_XJ (
 RBDL_DLLAPI void jcalc_X_lambda_S (
     Model &model,
     unsigned int joint_id,
-    const VectorNd &q
+    const VectorNd &q,
+    bool use_sincos_cache
     ) {
   // exception if we calculate it for the root body
   assert (joint_id > 0);
 
   if (model.mJoints[joint_id].mJointType == JointTypeRevoluteX) {
     model.X_lambda[joint_id] = 
-      Xrotx (q[model.mJoints[joint_id].q_index]) * model.X_T[joint_id];
+      XrotxCached (model, q, model.mJoints[joint_id].q_index,
+          use_sincos_cache) * model.X_T[joint_id];
     model.S[joint_id] = model.mJoints[joint_id].mJointAxes[0];
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteY) {
     model.X_lambda[joint_id] = 
-      Xroty (q[model.mJoints[joint_id].q_index]) * model.X_T[joint_id];
+      XrotyCached (model, q, model.mJoints[joint_id].q_index,
+          use_sincos_cache) * model.X_T[joint_id];
     model.S[joint_id] = model.mJoints[joint_id].mJointAxes[0];
   } else if (model.mJoints[joint_id].mJointType == JointTypeRevoluteZ) {
     model.X_lambda[joint_id] = 
-      Xrotz (q[model.mJoints[joint_id].q_index]) * model.X_T[joint_id];
+      XrotzCached (model, q, model.mJoints[joint_id].q_index,
+          use_sincos_cache) * model.X_T[joint_id];
     model.S[joint_id] = model.mJoints[joint_id].mJointAxes[0];
   } else if (model.mJoints[joint_id].mJointType == JointTypeHelical){
-    SpatialTransform XJ = jcalc_XJ (model, joint_id, q);
+    SpatialTransform XJ = jcalc_XJ (model, joint_id, q, use_sincos_cache);
     model.X_lambda[joint_id] = XJ * model.X_T[joint_id];
     // Set the joint axis
     Vector3d trans = XJ.E * model.mJoints[joint_id].mJointAxes[0].block(3,0,3,1);
@@ -301,7 +479,7 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
   } else if (model.mJoints[joint_id].mDoFCount == 1
       && model.mJoints[joint_id].mJointType != JointTypeCustom){
     model.X_lambda[joint_id] = 
-      jcalc_XJ (model, joint_id, q) * model.X_T[joint_id];
+      jcalc_XJ (model, joint_id, q, use_sincos_cache) * model.X_T[joint_id];
     model.S[joint_id] = model.mJoints[joint_id].mJointAxes[0];
   } else if (model.mJoints[joint_id].mJointType == JointTypeSpherical) {
     model.X_lambda[joint_id] = SpatialTransform (
@@ -315,16 +493,12 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.multdof3_S[joint_id](1,1) = 1.;
     model.multdof3_S[joint_id](2,2) = 1.;
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerZYX) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, use_sincos_cache, s0, c0);
+    JointSinCos (model, q, q_index + 1, use_sincos_cache, s1, c1);
+    JointSinCos (model, q, q_index + 2, use_sincos_cache, s2, c2);
 
     model.X_lambda[joint_id] = SpatialTransform ( 
         Matrix3d(
@@ -346,16 +520,12 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.multdof3_S[joint_id](2,0) = c1 * c2;
     model.multdof3_S[joint_id](2,1) = - s2;
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerXYZ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, use_sincos_cache, s0, c0);
+    JointSinCos (model, q, q_index + 1, use_sincos_cache, s1, c1);
+    JointSinCos (model, q, q_index + 2, use_sincos_cache, s2, c2);
 
     model.X_lambda[joint_id] = SpatialTransform (
         Matrix3d(
@@ -377,16 +547,12 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     model.multdof3_S[joint_id](2,0) = s1;
     model.multdof3_S[joint_id](2,2) = 1.;
   } else if (model.mJoints[joint_id].mJointType == JointTypeEulerYXZ ) {
-    double q0 = q[model.mJoints[joint_id].q_index];
-    double q1 = q[model.mJoints[joint_id].q_index + 1];
-    double q2 = q[model.mJoints[joint_id].q_index + 2];
+    unsigned int q_index = model.mJoints[joint_id].q_index;
 
-    double s0 = sin (q0);
-    double c0 = cos (q0);
-    double s1 = sin (q1);
-    double c1 = cos (q1);
-    double s2 = sin (q2);
-    double c2 = cos (q2);
+    double s0, c0, s1, c1, s2, c2;
+    JointSinCos (model, q, q_index, use_sincos_cache, s0, c0);
+    JointSinCos (model, q, q_index + 1, use_sincos_cache, s1, c1);
+    JointSinCos (model, q, q_index + 2, use_sincos_cache, s2, c2);
 
     model.X_lambda[joint_id] = SpatialTransform (
         Matrix3d(
@@ -433,4 +599,166 @@ RBDL_DLLAPI void jcalc_X_lambda_S (
     abort();
   }
 }
+
+RBDL_DLLAPI void jcalc_sincos (
+    Model &model,
+    const VectorNd &q
+    ) {
+  assert (q.size() == model.q_size);
+  assert (model.q_sin.size() == model.q_size);
+  assert (model.q_cos.size() == model.q_size);
+
+  double angles[SinCosBatchSize];
+
+  for (unsigned int offset = 0; offset < model.q_size;
+      offset += SinCosBatchSize) {
+    unsigned int n = std::min (SinCosBatchSize, model.q_size - offset);
+    bool out_of_range = false;
+
+    // coordinates outside of the range of the batch evaluation (including
+    // NaN) are replaced by zero and evaluated separately below
+    for (unsigned int i = 0; i < n; i++) {
+      if (std::fabs (q[offset + i]) < SinCosLimit) {
+        angles[i] = q[offset + i];
+      } else {
+        angles[i] = 0.;
+        out_of_range = true;
+      }
+    }
+
+    SinCosBatch (n, angles, &model.q_sin[offset], &model.q_cos[offset]);
+
+    if (out_of_range) {
+      for (unsigned int i = 0; i < n; i++) {
+        if (!(std::fabs (q[offset + i]) < SinCosLimit)) {
+          model.q_sin[offset + i] = sin (q[offset + i]);
+          model.q_cos[offset + i] = cos (q[offset + i]);
+        }
+      }
+    }
+  }
+}
+
+unsigned int CustomJoint::GetJointQIndex (
+    const Model &model,
+    unsigned int joint_id) {
+  return model.mJoints[joint_id].q_index;
+}
+
+void CustomJoint::StoreJointKinematics (
+    Model &model,
+    unsigned int joint_id,
+    const SpatialTransform &X_J,
+    const SpatialVector &v_J,
+    const SpatialVector &c_J) {
+  model.X_J[joint_id] = X_J;
+  model.v_J[joint_id] = v_J;
+  model.c_J[joint_id] = c_J;
+}
+
+void CustomJoint::StoreJointTransform (
+    Model &model,
+    unsigned int joint_id,
+    const SpatialTransform &X_J) {
+  model.X_J[joint_id] = X_J;
+  model.X_lambda[joint_id] = X_J * model.X_T[joint_id];
+}
+
+MultiDofJoint::MultiDofJoint (const Joint &joint) {
+  if (joint.mJointType < JointType1DoF || joint.mJointType > JointType6DoF) {
+    std::cerr << "Error: MultiDofJoint requires a joint of type "
+      << "JointType1DoF, ..., JointType6DoF!" << std::endl;
+    assert (0);
+    abort();
+  }
+
+  mDoFCount = joint.mDoFCount;
+  mJointAxes.resize (mDoFCount);
+
+  for (unsigned int i = 0; i < mDoFCount; i++) {
+    mJointAxes[i] = joint.mJointAxes[i];
+
+    const SpatialVector &axis = mJointAxes[i];
+    if ((axis[0] != 0. || axis[1] != 0. || axis[2] != 0.)
+        && (axis[3] != 0. || axis[4] != 0. || axis[5] != 0.)) {
+      std::cerr << "Error: MultiDofJoint axes must either be pure rotations "
+        << "or pure translations!" << std::endl;
+      assert (0);
+      abort();
+    }
+  }
+
+  S = MatrixNd::Zero (6, mDoFCount);
+  U = MatrixNd::Zero (6, mDoFCount);
+  Dinv = MatrixNd::Zero (mDoFCount, mDoFCount);
+  u = VectorNd::Zero (mDoFCount);
+  d_u = VectorNd::Zero (mDoFCount);
+}
+
+SpatialTransform MultiDofJoint::CalcJointTransform (
+    unsigned int q_index,
+    const VectorNd &q) {
+  SpatialTransform X_J;
+
+  // Going from the last to the first axis X_J transforms from the frame of
+  // axis k to the frame of the body which expresses the motion subspace
+  // of the axis in body coordinates.
+  for (int k = mDoFCount - 1; k >= 0; k--) {
+    const SpatialVector &axis = mJointAxes[k];
+    S.block(0, k, 6, 1) = X_J.apply (axis);
+
+    SpatialTransform X_axis;
+    if (axis[0] == 0. && axis[1] == 0. && axis[2] == 0.) {
+      X_axis = Xtrans (Vector3d (axis[3], axis[4], axis[5]) * q[q_index + k]);
+    } else if (axis == SpatialVector (1., 0., 0., 0., 0., 0.)) {
+      X_axis = Xrotx (q[q_index + k]);
+    } else if (axis == SpatialVector (0., 1., 0., 0., 0., 0.)) {
+      X_axis = Xroty (q[q_index + k]);
+    } else if (axis == SpatialVector (0., 0., 1., 0., 0., 0.)) {
+      X_axis = Xrotz (q[q_index + k]);
+    } else {
+      X_axis = Xrot (q[q_index + k], Vector3d (axis[0], axis[1], axis[2]));
+    }
+
+    X_J = X_J * X_axis;
+  }
+
+  return X_J;
+}
+
+void MultiDofJoint::jcalc (
+    Model &model,
+    unsigned int joint_id,
+    const VectorNd &q,
+    const VectorNd &qdot) {
+  unsigned int q_index = model.mJoints[joint_id].q_index;
+
+  model.X_J[joint_id] = CalcJointTransform (q_index, q);
+
+  // The velocity-product acceleration of the joint is the sum of the
+  // cross products of the velocities of the preceding axes with the
+  // velocity of each axis.
+  SpatialVector v_J (SpatialVector::Zero());
+  SpatialVector c_J (SpatialVector::Zero());
+
+  for (unsigned int k = 0; k < mDoFCount; k++) {
+    SpatialVector v_axis (S(0,k), S(1,k), S(2,k), S(3,k), S(4,k), S(5,k));
+    v_axis = v_axis * qdot[q_index + k];
+
+    c_J += crossm (v_J, v_axis);
+    v_J += v_axis;
+  }
+
+  model.v_J[joint_id] = v_J;
+  model.c_J[joint_id] = c_J;
+}
+
+void MultiDofJoint::jcalc_X_lambda_S (
+    Model &model,
+    unsigned int joint_id,
+    const VectorNd &q) {
+  model.X_lambda[joint_id] = CalcJointTransform (
+      model.mJoints[joint_id].q_index, q) * model.X_T[joint_id];
+}
+
 }
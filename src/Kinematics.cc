@@ -8,6 +8,7 @@
 #include <iostream>
 #include <limits>
 #include <cstring>
+#include <algorithm>
 #include <assert.h>
 
 #include "rbdl/rbdl_mathutils.h"
@@ -31,11 +32,13 @@ RBDL_DLLAPI void UpdateKinematics(
 
   model.a[0].setZero();
 
+  jcalc_sincos (model, Q);
+
   for (i = 1; i < model.mBodies.size(); i++) {
     unsigned int q_index = model.mJoints[i].q_index;
     unsigned int lambda = model.lambda[i];
 
-    jcalc (model, i, Q, QDot);
+    jcalc (model, i, Q, QDot, true);
 
     model.X_lambda[i] = model.X_J[i] * model.X_T[i];
 
@@ -85,12 +88,14 @@ RBDL_DLLAPI void UpdateKinematicsCustom(
   unsigned int i;
 
   if (Q) {
+    jcalc_sincos (model, *Q);
+
     for (i = 1; i < model.mBodies.size(); i++) {
       unsigned int lambda = model.lambda[i];
 
       VectorNd QDot_zero (VectorNd::Zero (model.q_size));
 
-      jcalc (model, i, (*Q), QDot_zero);
+      jcalc (model, i, (*Q), QDot_zero, true);
 
       model.X_lambda[i] = model.X_J[i] * model.X_T[i];
 
@@ -106,7 +111,7 @@ RBDL_DLLAPI void UpdateKinematicsCustom(
     for (i = 1; i < model.mBodies.size(); i++) {
       unsigned int lambda = model.lambda[i];
 
-      jcalc (model, i, *Q, *QDot);
+      jcalc (model, i, *Q, *QDot, true);
 
       if (lambda != 0) {
         model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
@@ -156,6 +161,111 @@ RBDL_DLLAPI void UpdateKinematicsCustom(
   }
 }
 
+RBDL_DLLAPI void UpdateKinematicsCustomIncremental(
+    Model &model,
+    const VectorNd *Q,
+    const VectorNd *QDot,
+    const VectorNd *QDDot,
+    const std::vector<unsigned int> &changed_body_ids) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  unsigned int i;
+
+  std::vector<bool> changed (model.mBodies.size(), false);
+  for (i = 0; i < changed_body_ids.size(); i++) {
+    assert (changed_body_ids[i] > 0
+        && changed_body_ids[i] < model.mBodies.size());
+    changed[changed_body_ids[i]] = true;
+  }
+
+  // parents always have smaller ids than their children
+  std::vector<bool> in_subtree (changed);
+  for (i = 1; i < model.mBodies.size(); i++) {
+    if (in_subtree[model.lambda[i]]) {
+      in_subtree[i] = true;
+    }
+  }
+
+  if (Q) {
+    VectorNd QDot_zero (VectorNd::Zero (model.qdot_size));
+
+    for (i = 1; i < model.mBodies.size(); i++) {
+      if (!in_subtree[i]) {
+        continue;
+      }
+
+      unsigned int lambda = model.lambda[i];
+
+      if (changed[i]) {
+        jcalc (model, i, (*Q), QDot_zero);
+      }
+
+      if (lambda != 0) {
+        model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+      } else {
+        model.X_base[i] = model.X_lambda[i];
+      }
+    }
+  }
+
+  if (QDot) {
+    for (i = 1; i < model.mBodies.size(); i++) {
+      if (!in_subtree[i]) {
+        continue;
+      }
+
+      unsigned int lambda = model.lambda[i];
+
+      if (changed[i]) {
+        jcalc (model, i, *Q, *QDot);
+      }
+
+      if (lambda != 0) {
+        model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
+      } else {
+        model.v[i] = model.v_J[i];
+      }
+      model.c[i] = model.c_J[i] + crossm(model.v[i],model.v_J[i]);
+    }
+  }
+
+  if (QDDot) {
+    for (i = 1; i < model.mBodies.size(); i++) {
+      if (!in_subtree[i]) {
+        continue;
+      }
+
+      unsigned int q_index = model.mJoints[i].q_index;
+      unsigned int lambda = model.lambda[i];
+
+      if (lambda != 0) {
+        model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
+      } else {
+        model.a[i] = model.c[i];
+      }
+
+      if (model.mJoints[i].mJointType != JointTypeCustom) {
+        if (model.mJoints[i].mDoFCount == 1) {
+          model.a[i] = model.a[i] + model.S[i] * (*QDDot)[q_index];
+        } else if (model.mJoints[i].mDoFCount == 3) {
+          Vector3d omegadot_temp ((*QDDot)[q_index],
+              (*QDDot)[q_index + 1],
+              (*QDDot)[q_index + 2]);
+          model.a[i] = model.a[i]
+            + model.multdof3_S[i] * omegadot_temp;
+        }
+      } else {
+        unsigned int k = model.mJoints[i].custom_joint_index;
+        unsigned int joint_dof_count = model.mCustomJoints[k]->mDoFCount;
+
+        model.a[i] = model.a[i]
+          + (  (model.mCustomJoints[k]->S)
+              *(QDDot->block(q_index, 0, joint_dof_count, 1)));
+      }
+    }
+  }
+}
+
 RBDL_DLLAPI Vector3d CalcBodyToBaseCoordinates (
     Model &model,
     const VectorNd &Q,
@@ -369,6 +479,155 @@ RBDL_DLLAPI void CalcPointJacobian6D (
   }
 }
 
+RBDL_DLLAPI void CalcPointJacobianTransposeTimes (
+    Model &model,
+    const VectorNd &Q,
+    unsigned int body_id,
+    const Vector3d &point_position,
+    const SpatialVector &wrench,
+    VectorNd &tau,
+    bool update_kinematics) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  // update the Kinematics if necessary
+  if (update_kinematics) {
+    UpdateKinematicsCustom (model, &Q, NULL, NULL);
+  }
+
+  assert (tau.size() == model.qdot_size);
+
+  SpatialTransform point_trans =
+    SpatialTransform (Matrix3d::Identity(),
+        CalcBodyToBaseCoordinates (model,
+          Q,
+          body_id,
+          point_position,
+          false));
+
+  unsigned int reference_body_id = body_id;
+
+  if (model.IsFixedBodyId(body_id)) {
+    unsigned int fbody_id = body_id - model.fixed_body_discriminator;
+    reference_body_id = model.mFixedBodies[fbody_id].mMovableParent;
+  }
+
+  // wrench in the coordinates of the reference body
+  SpatialVector f = model.X_base[reference_body_id].applyAdjoint (
+      point_trans.applyTranspose (wrench));
+
+  unsigned int j = reference_body_id;
+
+  while (j != 0) {
+    unsigned int q_index = model.mJoints[j].q_index;
+
+    if(model.mJoints[j].mJointType != JointTypeCustom){
+      if (model.mJoints[j].mDoFCount == 1) {
+        tau[q_index] += model.S[j].dot(f);
+      } else if (model.mJoints[j].mDoFCount == 3) {
+        Vector3d tau_temp = model.multdof3_S[j].transpose() * f;
+        tau[q_index] += tau_temp[0];
+        tau[q_index + 1] += tau_temp[1];
+        tau[q_index + 2] += tau_temp[2];
+      }
+    } else {
+      unsigned int k = model.mJoints[j].custom_joint_index;
+      JointVectorN tau_temp = model.mCustomJoints[k]->S.transpose() * f;
+
+      for (unsigned int z = 0; z < model.mCustomJoints[k]->mDoFCount; z++) {
+        tau[q_index + z] += tau_temp[z];
+      }
+    }
+
+    f = model.X_lambda[j].applyTranspose (f);
+    j = model.lambda[j];
+  }
+}
+
+RBDL_DLLAPI void CalcPointJacobianTransposeTimes (
+    Model &model,
+    const VectorNd &Q,
+    const std::vector<unsigned int> &body_ids,
+    const std::vector<Vector3d> &point_positions,
+    const std::vector<SpatialVector> &wrenches,
+    VectorNd &tau,
+    bool update_kinematics) {
+  LOG << "-------- " << __func__ << " --------" << std::endl;
+
+  assert (body_ids.size() == point_positions.size());
+  assert (body_ids.size() == wrenches.size());
+
+  // update the Kinematics if necessary
+  if (update_kinematics) {
+    UpdateKinematicsCustom (model, &Q, NULL, NULL);
+  }
+
+  assert (tau.size() == model.qdot_size);
+
+  // Accumulate the wrenches of all points in the coordinates of their
+  // bodies such that every joint is visited only once. Model::f_point is
+  // used instead of Model::f as the latter holds the forces of the
+  // previous call of InverseDynamicsIncremental().
+  unsigned int last_body_id = 0;
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    model.f_point[i].setZero();
+  }
+
+  for (unsigned int i = 0; i < body_ids.size(); i++) {
+    unsigned int reference_body_id = body_ids[i];
+
+    if (model.IsFixedBodyId(reference_body_id)) {
+      unsigned int fbody_id = reference_body_id
+        - model.fixed_body_discriminator;
+      reference_body_id = model.mFixedBodies[fbody_id].mMovableParent;
+    }
+
+    SpatialTransform point_trans =
+      SpatialTransform (Matrix3d::Identity(),
+          CalcBodyToBaseCoordinates (model,
+            Q,
+            body_ids[i],
+            point_positions[i],
+            false));
+
+    model.f_point[reference_body_id] += model.X_base[reference_body_id]
+      .applyAdjoint (point_trans.applyTranspose (wrenches[i]));
+    last_body_id = std::max (last_body_id, reference_body_id);
+  }
+
+  // Bodies are ordered such that parents come first, hence a single sweep
+  // from the leaves to the root collects the forces of all subtrees.
+  for (unsigned int j = last_body_id; j > 0; j--) {
+    const SpatialVector &f = model.f_point[j];
+    if (f == SpatialVector::Zero()) {
+      continue;
+    }
+
+    unsigned int q_index = model.mJoints[j].q_index;
+
+    if(model.mJoints[j].mJointType != JointTypeCustom){
+      if (model.mJoints[j].mDoFCount == 1) {
+        tau[q_index] += model.S[j].dot(f);
+      } else if (model.mJoints[j].mDoFCount == 3) {
+        Vector3d tau_temp = model.multdof3_S[j].transpose() * f;
+        tau[q_index] += tau_temp[0];
+        tau[q_index + 1] += tau_temp[1];
+        tau[q_index + 2] += tau_temp[2];
+      }
+    } else {
+      unsigned int k = model.mJoints[j].custom_joint_index;
+      JointVectorN tau_temp = model.mCustomJoints[k]->S.transpose() * f;
+
+      for (unsigned int z = 0; z < model.mCustomJoints[k]->mDoFCount; z++) {
+        tau[q_index + z] += tau_temp[z];
+      }
+    }
+
+    if (model.lambda[j] != 0) {
+      model.f_point[model.lambda[j]] += model.X_lambda[j].applyTranspose (f);
+    }
+  }
+}
+
 RBDL_DLLAPI void CalcBodySpatialJacobian (
     Model &model,
     const VectorNd &Q,
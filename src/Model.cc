@@ -7,6 +7,8 @@
 
 #include <iostream>
 #include <limits>
+#include <algorithm>
+#include <sstream>
 #include <assert.h>
 
 #include "rbdl/rbdl_mathutils.h"
@@ -60,14 +62,19 @@ Model::Model() {
 
   // Dynamic variables
   c.push_back(zero_spatial);
-  IA.push_back(SpatialMatrix::Identity());
+  IA.push_back(SpatialArticulatedBodyInertia (Matrix3d::Identity(3,3),
+        Matrix3d::Zero(3,3), Matrix3d::Identity(3,3)));
   pA.push_back(zero_spatial);
   U.push_back(zero_spatial);
 
   u = VectorNd::Zero(1);
   d = VectorNd::Zero(1);
 
+  q_sin = VectorNd::Zero(1);
+  q_cos = VectorNd::Zero(1);
+
   f.push_back (zero_spatial);
+  f_point.push_back (zero_spatial);
   SpatialRigidBodyInertia rbi(0., 
       Vector3d (0., 0., 0.), 
       Matrix3d::Zero(3,3));
@@ -75,6 +82,7 @@ Model::Model() {
   I.push_back(rbi);
   hc.push_back (zero_spatial);
   hdotc.push_back (zero_spatial);
+  Bc.push_back (SpatialMatrix::Zero(6,6));
 
   // Bodies
   X_lambda.push_back(SpatialTransform());
@@ -82,8 +90,123 @@ Model::Model() {
 
   mBodies.push_back(root_body);
   mBodyNameMap["ROOT"] = 0;
+  mBodyNameIndex.Insert ("ROOT", 0);
 
   fixed_body_discriminator = std::numeric_limits<unsigned int>::max() / 2;
+
+  mBulkConstruction = false;
+  mNativeMultiDofJoints = false;
+}
+
+CustomJointPool::CustomJointPool() :
+  mShared (NULL)
+{}
+
+CustomJointPool::CustomJointPool (const CustomJointPool &other) :
+  mShared (other.mShared) {
+  if (mShared != NULL) {
+    mShared->ref_count++;
+  }
+}
+
+CustomJointPool& CustomJointPool::operator= (const CustomJointPool &other) {
+  if (mShared == other.mShared) {
+    return *this;
+  }
+
+  Release();
+
+  mShared = other.mShared;
+  if (mShared != NULL) {
+    mShared->ref_count++;
+  }
+
+  return *this;
+}
+
+CustomJointPool::~CustomJointPool() {
+  Release();
+}
+
+void CustomJointPool::Add (CustomJoint *custom_joint) {
+  if (mShared == NULL) {
+    mShared = new SharedJoints;
+    mShared->ref_count = 1;
+  }
+
+  mShared->joints.push_back (custom_joint);
+}
+
+unsigned int CustomJointPool::size() const {
+  if (mShared == NULL) {
+    return 0;
+  }
+
+  return mShared->joints.size();
+}
+
+void CustomJointPool::Release() {
+  if (mShared == NULL) {
+    return;
+  }
+
+  mShared->ref_count--;
+  if (mShared->ref_count == 0) {
+    for (unsigned int i = 0; i < mShared->joints.size(); i++) {
+      delete mShared->joints[i];
+    }
+    delete mShared;
+  }
+
+  mShared = NULL;
+}
+
+static void UpdateQuaternionWIndices (Model &model) {
+  // the w components of the Quaternions are stored at the end of the q
+  // vector
+  unsigned int multdof3_joint_counter = 0;
+  for (unsigned int i = 1; i < model.mJoints.size(); i++) {
+    if (model.mJoints[i].mJointType == JointTypeSpherical) {
+      model.multdof3_w_index[i] = model.dof_count + multdof3_joint_counter;
+      multdof3_joint_counter++;
+    }
+  }
+
+  model.q_size = model.dof_count + multdof3_joint_counter;
+}
+
+static void UpdateWorkspaceSizes (Model &model) {
+  model.d = VectorNd::Zero (model.mBodies.size());
+  model.u = VectorNd::Zero (model.mBodies.size());
+
+  model.q_sin = VectorNd::Zero (model.q_size);
+  model.q_cos = VectorNd::Zero (model.q_size);
+
+  model.S_dof.assign (model.qdot_size, SpatialVector::Zero());
+  model.S_dot_dof.assign (model.qdot_size, SpatialVector::Zero());
+}
+
+static void UpdateJointUpdateOrder (Model &model) {
+  // the joints are grouped by their type. The groups are ordered by the
+  // first occurrence of their type.
+  std::vector<JointType> joint_types;
+  for (unsigned int i = 0; i < model.mJoints.size(); i++) {
+    if (std::find (joint_types.begin(), joint_types.end(),
+          model.mJoints[i].mJointType) == joint_types.end()) {
+      joint_types.push_back (model.mJoints[i].mJointType);
+    }
+  }
+
+  model.mJointUpdateOrder.clear();
+  model.mJointUpdateOrder.reserve (model.mJoints.size());
+
+  for (unsigned int j = 0; j < joint_types.size(); j++) {
+    for (unsigned int i = 0; i < model.mJoints.size(); i++) {
+      if (model.mJoints[i].mJointType == joint_types[j]) {
+        model.mJointUpdateOrder.push_back (i);
+      }
+    }
+  }
 }
 
 unsigned int AddBodyFixedJoint (
@@ -109,6 +232,7 @@ unsigned int AddBodyFixedJoint (
   Body parent_body = model.mBodies[fbody.mMovableParent];
   parent_body.Join (fbody.mParentTransform, body);
   model.mBodies[fbody.mMovableParent] = parent_body;
+  model.I.Detach();
   model.I[fbody.mMovableParent] = 
     SpatialRigidBodyInertia::createFromMassComInertiaC ( 
         parent_body.mMass, 
@@ -140,11 +264,30 @@ unsigned int AddBodyFixedJoint (
     }
     model.mBodyNameMap[body_name] = model.mFixedBodies.size() 
       + model.fixed_body_discriminator - 1;
+    model.mBodyNameIndex.Insert (body_name, model.mFixedBodies.size()
+        + model.fixed_body_discriminator - 1);
   }
 
   return model.mFixedBodies.size() + model.fixed_body_discriminator - 1;
 }
 
+/** \brief Returns whether the joint can be added as a single body with
+ * a MultiDofJoint if Model::mNativeMultiDofJoints is set.
+ */
+static bool IsNativeMultiDofJoint (const Joint &joint) {
+  if (joint.mJointType < JointType2DoF || joint.mJointType > JointType6DoF)
+    return false;
+
+  for (unsigned int i = 0; i < joint.mDoFCount; i++) {
+    const SpatialVector &axis = joint.mJointAxes[i];
+    if ((axis[0] != 0. || axis[1] != 0. || axis[2] != 0.)
+        && (axis[3] != 0. || axis[4] != 0. || axis[5] != 0.))
+      return false;
+  }
+
+  return true;
+}
+
 unsigned int AddBodyMultiDofJoint (
     Model &model,
     const unsigned int parent_id,
@@ -283,6 +426,17 @@ unsigned int Model::AddBody(
       && joint.mJointType != JointTypeRevoluteZ
       && joint.mJointType != JointTypeHelical
       ) {
+    if (mNativeMultiDofJoints && IsNativeMultiDofJoint (joint)) {
+      MultiDofJoint *multi_dof_joint = new MultiDofJoint (joint);
+      mOwnedCustomJoints.Add (multi_dof_joint);
+
+      return AddBodyCustomJoint (parent_id,
+          joint_frame,
+          multi_dof_joint,
+          body,
+          body_name);
+    }
+
     previously_added_body_id = AddBodyMultiDofJoint (*this, 
         parent_id, 
         joint_frame, 
@@ -337,6 +491,7 @@ unsigned int Model::AddBody(
       abort();
     }
     mBodyNameMap[body_name] = mBodies.size() - 1;
+    mBodyNameIndex.Insert (body_name, mBodies.size() - 1);
   }
 
   // state information
@@ -371,20 +526,16 @@ unsigned int Model::AddBody(
 
   dof_count = dof_count + joint.mDoFCount;
 
-  // update the w components of the Quaternions. They are stored at the end
-  // of the q vector
-  int multdof3_joint_counter = 0;
-  int mCustomJoint_joint_counter = 0;
-  for (unsigned int i = 1; i < mJoints.size(); i++) {
-    if (mJoints[i].mJointType == JointTypeSpherical) {
-      multdof3_w_index[i] = dof_count + multdof3_joint_counter;
-      multdof3_joint_counter++;
+  if (!mBulkConstruction) {
+    UpdateQuaternionWIndices (*this);
+  } else {
+    // the w components are assigned in EndBulkConstruction()
+    q_size = q_size + joint.mDoFCount;
+    if (joint.mJointType == JointTypeSpherical) {
+      q_size++;
     }
   }
 
-  q_size = dof_count
-    + multdof3_joint_counter;
-
   qdot_size = qdot_size + joint.mDoFCount;
 
   // we have to invert the transformation as it is later always used from the
@@ -393,14 +544,16 @@ unsigned int Model::AddBody(
 
   // Dynamic variables
   c.push_back(SpatialVector(0., 0., 0., 0., 0., 0.));
-  IA.push_back(SpatialMatrix::Zero(6,6));
+  IA.push_back(SpatialArticulatedBodyInertia());
   pA.push_back(SpatialVector(0., 0., 0., 0., 0., 0.));
   U.push_back(SpatialVector(0., 0., 0., 0., 0., 0.));
 
-  d = VectorNd::Zero (mBodies.size());
-  u = VectorNd::Zero (mBodies.size());
+  if (!mBulkConstruction) {
+    UpdateWorkspaceSizes (*this);
+  }
 
   f.push_back (SpatialVector (0., 0., 0., 0., 0., 0.));
+  f_point.push_back (SpatialVector (0., 0., 0., 0., 0., 0.));
 
   SpatialRigidBodyInertia rbi = 
     SpatialRigidBodyInertia::createFromMassComInertiaC (body.mMass, 
@@ -411,6 +564,7 @@ unsigned int Model::AddBody(
   I.push_back (rbi);
   hc.push_back (SpatialVector(0., 0., 0., 0., 0., 0.));
   hdotc.push_back (SpatialVector(0., 0., 0., 0., 0., 0.));
+  Bc.push_back (SpatialMatrix::Zero(6,6));
 
   if (mBodies.size() == fixed_body_discriminator) {
     std::cerr << "Error: cannot add more than " 
@@ -424,39 +578,10 @@ unsigned int Model::AddBody(
 
   previously_added_body_id = mBodies.size() - 1;
 
-  mJointUpdateOrder.clear();
-
-  // update the joint order computation
-  std::vector<std::pair<JointType, unsigned int> > joint_types;
-  for (unsigned int i = 0; i < mJoints.size(); i++) {
-    joint_types.push_back(
-        std::pair<JointType, unsigned int> (mJoints[i].mJointType,i));
-    mJointUpdateOrder.push_back (mJoints[i].mJointType);
+  if (!mBulkConstruction) {
+    UpdateJointUpdateOrder (*this);
   }
 
-  mJointUpdateOrder.clear();
-  JointType current_joint_type = JointTypeUndefined;
-  while (joint_types.size() != 0) {
-    current_joint_type = joint_types[0].first;
-
-    std::vector<std::pair<JointType, unsigned int> >::iterator type_iter = 
-      joint_types.begin();
-
-    while (type_iter != joint_types.end()) {
-      if (type_iter->first == current_joint_type) {
-        mJointUpdateOrder.push_back (type_iter->second);
-        type_iter = joint_types.erase (type_iter);
-      } else {
-        ++type_iter;
-      }
-    }
-  }
-
-  //  for (unsigned int i = 0; i < mJointUpdateOrder.size(); i++) {
-  //    std::cout << "i = " << i << ": joint_id = " << mJointUpdateOrder[i] 
-  // << " joint_type = " << mJoints[mJointUpdateOrder[i]].mJointType << std::endl;
-  //  }
-
   return previously_added_body_id;
 }
 
@@ -494,3 +619,199 @@ unsigned int Model::AddBodyCustomJoint (
   return body_id;
 }
 
+
+std::vector<unsigned int> Model::AddBodies (
+    const std::vector<BodyDescription> &bodies) {
+  bool nested_bulk_construction = mBulkConstruction;
+
+  if (!nested_bulk_construction) {
+    BeginBulkConstruction (bodies.size());
+  }
+
+  std::vector<unsigned int> body_ids (bodies.size());
+
+  for (unsigned int i = 0; i < bodies.size(); i++) {
+    unsigned int parent_id = bodies[i].parent_id;
+
+    if (bodies[i].parent_index >= 0) {
+      if (static_cast<unsigned int>(bodies[i].parent_index) >= i) {
+        std::cerr << "Error: the parent of body " << i
+          << " must be added before the body!" << std::endl;
+        assert (0);
+        abort();
+      }
+      parent_id = body_ids[bodies[i].parent_index];
+    }
+
+    if (bodies[i].custom_joint != NULL) {
+      body_ids[i] = AddBodyCustomJoint (parent_id,
+          bodies[i].joint_frame,
+          bodies[i].custom_joint,
+          bodies[i].body,
+          bodies[i].body_name);
+    } else {
+      body_ids[i] = AddBody (parent_id,
+          bodies[i].joint_frame,
+          bodies[i].joint,
+          bodies[i].body,
+          bodies[i].body_name);
+    }
+  }
+
+  if (!nested_bulk_construction) {
+    EndBulkConstruction();
+  }
+
+  return body_ids;
+}
+
+/** \brief Adds the names of the degrees of freedom of the joint of body_id
+ * to mDoFNameIndex.
+ *
+ * \returns false if one of the names already exists.
+ */
+static bool AddDoFNames (
+    Model &model,
+    unsigned int body_id,
+    const std::string &joint_name) {
+  if (body_id >= model.mBodies.size()) {
+    // fixed joints have no degrees of freedom
+    return true;
+  }
+
+  // a joint that was emulated by virtual bodies starts at the first
+  // virtual body of the chain
+  std::vector<unsigned int> joint_bodies (1, body_id);
+  while (model.lambda[joint_bodies.back()] != 0
+      && model.mBodies[model.lambda[joint_bodies.back()]].mIsVirtual) {
+    joint_bodies.push_back (model.lambda[joint_bodies.back()]);
+  }
+  std::reverse (joint_bodies.begin(), joint_bodies.end());
+
+  std::vector<unsigned int> dof_indices;
+  for (unsigned int i = 0; i < joint_bodies.size(); i++) {
+    const Joint &joint = model.mJoints[joint_bodies[i]];
+    unsigned int dof_count = joint.mDoFCount;
+
+    if (joint.mJointType == JointTypeCustom) {
+      dof_count = model.mCustomJoints[joint.custom_joint_index]->mDoFCount;
+    }
+
+    for (unsigned int j = 0; j < dof_count; j++) {
+      dof_indices.push_back (joint.q_index + j);
+    }
+  }
+
+  bool success = true;
+  if (dof_indices.size() == 1) {
+    success = model.mDoFNameIndex.Insert (joint_name, dof_indices[0]);
+  } else {
+    std::stringstream dof_name;
+    for (unsigned int i = 0; i < dof_indices.size(); i++) {
+      dof_name.str (std::string());
+      dof_name << joint_name << "_" << i;
+      success = model.mDoFNameIndex.Insert (dof_name.str(), dof_indices[i])
+        && success;
+    }
+  }
+
+  return success;
+}
+
+bool Model::SetJointName (
+    unsigned int body_id,
+    const std::string &joint_name) {
+  if (!IsBodyId (body_id)) {
+    std::cerr << "Error: cannot name the joint of invalid body id "
+      << body_id << "!" << std::endl;
+    assert (0);
+    abort();
+  }
+
+  if (!mJointNameIndex.Insert (joint_name, body_id)) {
+    std::cerr << "Warning: Joint with name '"
+      << joint_name
+      << "' already exists or body " << body_id << " already has a named "
+      << "joint! The joint is not named."
+      << std::endl;
+    return false;
+  }
+
+  if (!AddDoFNames (*this, body_id, joint_name)) {
+    std::cerr << "Warning: some names of the degrees of freedom of joint '"
+      << joint_name << "' already exist! These degrees of freedom stay "
+      << "unnamed."
+      << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void Model::UpdateNameIndices () {
+  mBodyNameIndex.clear();
+
+  std::map<std::string, unsigned int>::const_iterator name_iter;
+  for (name_iter = mBodyNameMap.begin(); name_iter != mBodyNameMap.end();
+      ++name_iter) {
+    mBodyNameIndex.Insert (name_iter->first, name_iter->second);
+  }
+
+  mDoFNameIndex.clear();
+  for (size_t i = 0; i < mJointNameIndex.size(); i++) {
+    AddDoFNames (*this, mJointNameIndex.GetEntryHandle (i),
+        mJointNameIndex.GetEntryName (i));
+  }
+}
+
+void Model::BeginBulkConstruction (unsigned int body_count) {
+  mBulkConstruction = true;
+
+  unsigned int capacity = mBodies.size() + body_count;
+
+  lambda.reserve (capacity);
+  lambda_q.reserve (capacity);
+  mu.reserve (capacity);
+  X_lambda.reserve (capacity);
+  X_base.reserve (capacity);
+  mBodies.reserve (capacity);
+  v.reserve (capacity);
+  a.reserve (capacity);
+  mJoints.reserve (capacity);
+  S.reserve (capacity);
+  X_J.reserve (capacity);
+  v_J.reserve (capacity);
+  c_J.reserve (capacity);
+  multdof3_S.reserve (capacity);
+  multdof3_U.reserve (capacity);
+  multdof3_Dinv.reserve (capacity);
+  multdof3_u.reserve (capacity);
+  multdof3_w_index.reserve (capacity);
+  X_T.reserve (capacity);
+  c.reserve (capacity);
+  IA.reserve (capacity);
+  pA.reserve (capacity);
+  U.reserve (capacity);
+  f.reserve (capacity);
+  f_point.reserve (capacity);
+  I.reserve (capacity);
+  Ic.reserve (capacity);
+  hc.reserve (capacity);
+  hdotc.reserve (capacity);
+  Bc.reserve (capacity);
+}
+
+void Model::EndBulkConstruction () {
+  if (!mBulkConstruction) {
+    std::cerr << "Error: EndBulkConstruction() called without a call to "
+      << "BeginBulkConstruction()!" << std::endl;
+    assert (0);
+    abort();
+  }
+
+  mBulkConstruction = false;
+
+  UpdateQuaternionWIndices (*this);
+  UpdateWorkspaceSizes (*this);
+  UpdateJointUpdateOrder (*this);
+}
@@ -0,0 +1,205 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <iostream>
+#include <string>
+#include <deque>
+
+#include "rbdl/rbdl_mathutils.h"
+#include "rbdl/Logging.h"
+
+#include "rbdl/Model.h"
+#include "rbdl/ModelReordering.h"
+
+namespace RigidBodyDynamics {
+
+using namespace Math;
+
+static unsigned int GetJointDoFCount (const Model &model, unsigned int body_id) {
+  const Joint &joint = model.mJoints[body_id];
+
+  if (joint.mJointType == JointTypeCustom) {
+    return model.mCustomJoints[joint.custom_joint_index]->mDoFCount;
+  }
+
+  return joint.mDoFCount;
+}
+
+static void AppendSubtreeDepthFirst (
+    const Model &model,
+    unsigned int body_id,
+    std::vector<unsigned int> &order) {
+  // explicit stack as the depth of serial chains is not bounded. The
+  // children are pushed in reverse order such that they are visited in
+  // the order in which they were added.
+  std::vector<unsigned int> body_stack (1, body_id);
+
+  while (body_stack.size() != 0) {
+    unsigned int cur_id = body_stack.back();
+    body_stack.pop_back();
+
+    order.push_back (cur_id);
+
+    const std::vector<unsigned int> &children = model.mu[cur_id];
+    for (unsigned int i = children.size(); i > 0; i--) {
+      body_stack.push_back (children[i - 1]);
+    }
+  }
+}
+
+RBDL_DLLAPI void ReorderModel (
+    const Model &model,
+    Model &reordered_model,
+    ModelPermutation &permutation,
+    BodyOrdering ordering) {
+  if (reordered_model.mBodies.size() != 1
+      || reordered_model.mFixedBodies.size() != 0) {
+    std::cerr << "Error: ReorderModel() requires an empty model to store "
+      << "the reordered model!" << std::endl;
+    assert (0);
+    abort();
+  }
+
+  // compute the new order of the movable bodies, starting with the root
+  std::vector<unsigned int> &old_from_new = permutation.body_old_from_new;
+  old_from_new.clear();
+
+  if (ordering == BodyOrderingBreadthFirst) {
+    std::deque<unsigned int> queue (1, 0);
+
+    while (queue.size() != 0) {
+      unsigned int body_id = queue.front();
+      queue.pop_front();
+
+      old_from_new.push_back (body_id);
+      queue.insert (queue.end(), model.mu[body_id].begin(),
+          model.mu[body_id].end());
+    }
+  } else if (ordering == BodyOrderingDepthFirst) {
+    AppendSubtreeDepthFirst (model, 0, old_from_new);
+  } else {
+    std::cerr << "Error: invalid body ordering " << ordering << "!"
+      << std::endl;
+    assert (0);
+    abort();
+  }
+
+  assert (old_from_new.size() == model.mBodies.size());
+
+  std::vector<unsigned int> &new_from_old = permutation.body_new_from_old;
+  new_from_old.resize (old_from_new.size());
+  for (unsigned int i = 0; i < old_from_new.size(); i++) {
+    new_from_old[old_from_new[i]] = i;
+  }
+
+  // names of the movable bodies
+  std::vector<std::string> body_names (model.mBodies.size());
+  std::map<std::string, unsigned int>::const_iterator name_iter;
+  for (name_iter = model.mBodyNameMap.begin();
+      name_iter != model.mBodyNameMap.end(); ++name_iter) {
+    if (name_iter->second < model.mBodies.size()) {
+      body_names[name_iter->second] = name_iter->first;
+    }
+  }
+
+  reordered_model.gravity = model.gravity;
+  reordered_model.mNativeMultiDofJoints = model.mNativeMultiDofJoints;
+
+  // the reordered model refers to the same custom joints
+  reordered_model.mOwnedCustomJoints = model.mOwnedCustomJoints;
+
+  // the root body contains the bodies that are fixed to the base
+  reordered_model.mBodies[0] = model.mBodies[0];
+  reordered_model.I[0] = model.I[0];
+
+  // X_T already contains the transformations of fixed parent bodies and
+  // the bodies contain their fixed children. Therefore all bodies are
+  // added directly to their movable parents.
+  for (unsigned int i = 1; i < old_from_new.size(); i++) {
+    unsigned int old_id = old_from_new[i];
+    unsigned int parent_id = new_from_old[model.lambda[old_id]];
+    const Joint &joint = model.mJoints[old_id];
+    unsigned int body_id = 0;
+
+    if (joint.mJointType == JointTypeCustom) {
+      body_id = reordered_model.AddBodyCustomJoint (parent_id,
+          model.X_T[old_id],
+          model.mCustomJoints[joint.custom_joint_index],
+          model.mBodies[old_id],
+          body_names[old_id]);
+    } else {
+      body_id = reordered_model.AddBody (parent_id,
+          model.X_T[old_id],
+          joint,
+          model.mBodies[old_id],
+          body_names[old_id]);
+    }
+
+    if (body_id != i) {
+      std::cerr << "Error: could not reorder body " << old_id
+        << " as its joint is expanded into multiple bodies!" << std::endl;
+      assert (0);
+      abort();
+    }
+  }
+
+  // fixed bodies keep their ids and names
+  reordered_model.mFixedBodies = model.mFixedBodies;
+  for (unsigned int i = 0; i < reordered_model.mFixedBodies.size(); i++) {
+    reordered_model.mFixedBodies[i].mMovableParent =
+      new_from_old[model.mFixedBodies[i].mMovableParent];
+  }
+
+  for (name_iter = model.mBodyNameMap.begin();
+      name_iter != model.mBodyNameMap.end(); ++name_iter) {
+    if (name_iter->second >= model.fixed_body_discriminator) {
+      reordered_model.mBodyNameMap[name_iter->first] = name_iter->second;
+      reordered_model.mBodyNameIndex.Insert (name_iter->first,
+          name_iter->second);
+    }
+  }
+
+  // joint names refer to the renumbered bodies
+  for (size_t i = 0; i < model.mJointNameIndex.size(); i++) {
+    unsigned int body_id = model.mJointNameIndex.GetEntryHandle (i);
+
+    if (body_id < model.mBodies.size()) {
+      body_id = new_from_old[body_id];
+    }
+
+    reordered_model.SetJointName (body_id,
+        model.mJointNameIndex.GetEntryName (i));
+  }
+
+  // maps of the generalized coordinates and velocities
+  permutation.q_new_from_old.resize (model.q_size);
+  permutation.q_old_from_new.resize (model.q_size);
+  permutation.qdot_new_from_old.resize (model.qdot_size);
+  permutation.qdot_old_from_new.resize (model.qdot_size);
+
+  for (unsigned int old_id = 1; old_id < model.mBodies.size(); old_id++) {
+    unsigned int new_id = new_from_old[old_id];
+    unsigned int old_q_index = model.mJoints[old_id].q_index;
+    unsigned int new_q_index = reordered_model.mJoints[new_id].q_index;
+
+    for (unsigned int j = 0; j < GetJointDoFCount (model, old_id); j++) {
+      permutation.q_new_from_old[old_q_index + j] = new_q_index + j;
+      permutation.q_old_from_new[new_q_index + j] = old_q_index + j;
+      permutation.qdot_new_from_old[old_q_index + j] = new_q_index + j;
+      permutation.qdot_old_from_new[new_q_index + j] = old_q_index + j;
+    }
+
+    if (model.mJoints[old_id].mJointType == JointTypeSpherical) {
+      unsigned int old_w_index = model.multdof3_w_index[old_id];
+      unsigned int new_w_index = reordered_model.multdof3_w_index[new_id];
+      permutation.q_new_from_old[old_w_index] = new_w_index;
+      permutation.q_old_from_new[new_w_index] = old_w_index;
+    }
+  }
+}
+
+}
@@ -0,0 +1,296 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <cstring>
+#include <limits>
+#include <stdint.h>
+
+#include "rbdl/NameIndex.h"
+
+namespace RigidBodyDynamics {
+
+const unsigned int NameIndex::InvalidHandle
+  = std::numeric_limits<unsigned int>::max();
+
+/// \brief 32 bit FNV-1a hash of a name.
+static unsigned int HashName (const char *name, size_t length) {
+  unsigned int hash = 2166136261u;
+
+  for (size_t i = 0; i < length; i++) {
+    hash ^= static_cast<unsigned char>(name[i]);
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/// \brief Spreads the bits of consecutive handles over the hash table.
+static unsigned int HashHandle (unsigned int handle) {
+  unsigned int hash = handle;
+
+  hash ^= hash >> 16;
+  hash *= 0x45d9f3bu;
+  hash ^= hash >> 16;
+
+  return hash;
+}
+
+/// \brief Rounds size up to a multiple of 8 bytes.
+static size_t PaddedSize (size_t size) {
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+/// \brief Appends count values to buffer and pads it to 8 bytes.
+template <typename T>
+static void AppendArray (std::vector<char> &buffer, const T *values,
+    size_t count) {
+  size_t offset = buffer.size();
+  size_t size = count * sizeof (T);
+
+  buffer.resize (offset + PaddedSize (size), 0);
+  if (size > 0) {
+    memcpy (&buffer[offset], values, size);
+  }
+}
+
+/** \brief Header of an index that was stored with
+ * NameIndex::WriteToBuffer().
+ *
+ * It is followed by the arrays mHandles, mNameHashes, mNameOffsets,
+ * mNameSlots, mHandleSlots, and mNameData, each padded to 8 bytes.
+ */
+struct StoredNameIndex {
+  uint32_t entry_count;
+  uint32_t slot_count;
+  uint32_t name_data_size;
+  uint32_t padding;
+};
+
+NameIndex::NameIndex() {
+}
+
+unsigned int NameIndex::FindEntry (
+    const char *name,
+    size_t length,
+    unsigned int hash) const {
+  if (mNameSlots.size() == 0) {
+    return InvalidHandle;
+  }
+
+  size_t mask = mNameSlots.size() - 1;
+  size_t slot = hash & mask;
+
+  while (mNameSlots[slot] != 0) {
+    unsigned int entry = mNameSlots[slot] - 1;
+
+    if (mNameHashes[entry] == hash
+        && GetNameLength (entry) == length
+        && memcmp (&mNameData[mNameOffsets[entry]], name, length) == 0) {
+      return entry;
+    }
+
+    slot = (slot + 1) & mask;
+  }
+
+  return InvalidHandle;
+}
+
+unsigned int NameIndex::FindEntry (unsigned int handle) const {
+  if (mHandleSlots.size() == 0) {
+    return InvalidHandle;
+  }
+
+  size_t mask = mHandleSlots.size() - 1;
+  size_t slot = HashHandle (handle) & mask;
+
+  while (mHandleSlots[slot] != 0) {
+    unsigned int entry = mHandleSlots[slot] - 1;
+
+    if (mHandles[entry] == handle) {
+      return entry;
+    }
+
+    slot = (slot + 1) & mask;
+  }
+
+  return InvalidHandle;
+}
+
+void NameIndex::Rehash (size_t slot_count) {
+  mNameSlots.assign (slot_count, 0);
+  mHandleSlots.assign (slot_count, 0);
+
+  size_t mask = slot_count - 1;
+
+  for (unsigned int entry = 0; entry < mHandles.size(); entry++) {
+    size_t slot = mNameHashes[entry] & mask;
+    while (mNameSlots[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    mNameSlots[slot] = entry + 1;
+
+    slot = HashHandle (mHandles[entry]) & mask;
+    while (mHandleSlots[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    mHandleSlots[slot] = entry + 1;
+  }
+}
+
+bool NameIndex::Insert (const std::string &name, unsigned int handle) {
+  unsigned int hash = HashName (name.data(), name.size());
+
+  if (handle == InvalidHandle
+      || FindEntry (name.data(), name.size(), hash) != InvalidHandle
+      || FindEntry (handle) != InvalidHandle) {
+    return false;
+  }
+
+  mNameOffsets.push_back (mNameData.size());
+  mNameData.reserve (mNameData.size() + name.size() + 1);
+  for (size_t i = 0; i < name.size(); i++) {
+    mNameData.push_back (name[i]);
+  }
+  mNameData.push_back ('\0');
+
+  mHandles.push_back (handle);
+  mNameHashes.push_back (hash);
+
+  // keep the tables at most half full such that the probe sequences stay
+  // short
+  if (2 * mHandles.size() > mNameSlots.size()) {
+    size_t slot_count = mNameSlots.size() > 0 ? 2 * mNameSlots.size() : 16;
+    Rehash (slot_count);
+    return true;
+  }
+
+  mNameSlots.Detach();
+  mHandleSlots.Detach();
+
+  unsigned int entry = mHandles.size() - 1;
+  size_t mask = mNameSlots.size() - 1;
+
+  size_t slot = hash & mask;
+  while (mNameSlots[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  mNameSlots[slot] = entry + 1;
+
+  slot = HashHandle (handle) & mask;
+  while (mHandleSlots[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  mHandleSlots[slot] = entry + 1;
+
+  return true;
+}
+
+unsigned int NameIndex::Find (const char *name) const {
+  size_t length = strlen (name);
+  unsigned int entry = FindEntry (name, length, HashName (name, length));
+
+  if (entry == InvalidHandle) {
+    return InvalidHandle;
+  }
+
+  return mHandles[entry];
+}
+
+unsigned int NameIndex::Find (const std::string &name) const {
+  unsigned int entry = FindEntry (name.data(), name.size(),
+      HashName (name.data(), name.size()));
+
+  if (entry == InvalidHandle) {
+    return InvalidHandle;
+  }
+
+  return mHandles[entry];
+}
+
+std::string NameIndex::GetName (unsigned int handle) const {
+  unsigned int entry = FindEntry (handle);
+
+  if (entry == InvalidHandle) {
+    return std::string();
+  }
+
+  return GetEntryName (entry);
+}
+
+bool NameIndex::HasHandle (unsigned int handle) const {
+  return FindEntry (handle) != InvalidHandle;
+}
+
+void NameIndex::clear () {
+  mNameData.clear();
+  mNameOffsets.clear();
+  mHandles.clear();
+  mNameHashes.clear();
+  mNameSlots.clear();
+  mHandleSlots.clear();
+}
+
+void NameIndex::WriteToBuffer (std::vector<char> &buffer) const {
+  StoredNameIndex header;
+  header.entry_count = mHandles.size();
+  header.slot_count = mNameSlots.size();
+  header.name_data_size = mNameData.size();
+  header.padding = 0;
+
+  AppendArray (buffer, &header, 1);
+  AppendArray (buffer, mHandles.data(), mHandles.size());
+  AppendArray (buffer, mNameHashes.data(), mNameHashes.size());
+  AppendArray (buffer, mNameOffsets.data(), mNameOffsets.size());
+  AppendArray (buffer, mNameSlots.data(), mNameSlots.size());
+  AppendArray (buffer, mHandleSlots.data(), mHandleSlots.size());
+  AppendArray (buffer, mNameData.data(), mNameData.size());
+}
+
+bool NameIndex::Map (const char *data, size_t size) {
+  if (size < sizeof (StoredNameIndex)) {
+    return false;
+  }
+
+  StoredNameIndex header;
+  memcpy (&header, data, sizeof (StoredNameIndex));
+
+  size_t entry_array_size = PaddedSize (header.entry_count
+      * sizeof (unsigned int));
+  size_t slot_array_size = PaddedSize (header.slot_count
+      * sizeof (unsigned int));
+
+  if (size < sizeof (StoredNameIndex) + 3 * entry_array_size
+      + 2 * slot_array_size + header.name_data_size
+      || 2 * static_cast<size_t>(header.entry_count) > header.slot_count
+      || (header.slot_count & (header.slot_count - 1)) != 0
+      || (header.entry_count > 0 && header.name_data_size == 0)) {
+    return false;
+  }
+
+  const char *array = data + sizeof (StoredNameIndex);
+
+  mHandles.Map (reinterpret_cast<const unsigned int*>(array),
+      header.entry_count);
+  array += entry_array_size;
+  mNameHashes.Map (reinterpret_cast<const unsigned int*>(array),
+      header.entry_count);
+  array += entry_array_size;
+  mNameOffsets.Map (reinterpret_cast<const unsigned int*>(array),
+      header.entry_count);
+  array += entry_array_size;
+  mNameSlots.Map (reinterpret_cast<const unsigned int*>(array),
+      header.slot_count);
+  array += slot_array_size;
+  mHandleSlots.Map (reinterpret_cast<const unsigned int*>(array),
+      header.slot_count);
+  array += slot_array_size;
+  mNameData.Map (array, header.name_data_size);
+
+  return true;
+}
+
+}
@@ -0,0 +1,405 @@
+/*
+ * RBDL - Rigid Body Dynamics Library
+ * Copyright (c) 2011-2018 Martin Felis <martin@fysx.org>
+ *
+ * Licensed under the zlib license. See LICENSE for more details.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(WIN32) || defined (_WIN32)
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define RBDL_SHARED_MODEL_DATA_USE_MMAP
+#endif
+
+#include "rbdl/Logging.h"
+
+#include "rbdl/Model.h"
+#include "rbdl/CompiledModel.h"
+#include "rbdl/SharedModelData.h"
+
+namespace RigidBodyDynamics {
+
+using namespace Math;
+
+const unsigned int SharedModelData::Version = 1;
+
+static const char SharedModelDataMagic[8] = {
+  'R', 'B', 'D', 'L', 'S', 'H', 'M', '\0'
+};
+static const uint32_t SharedModelDataByteOrderMark = 0x01020304;
+
+/// \brief Alignment of the sections, which is at least that of Eigen.
+static const size_t SharedModelDataAlignment = 64;
+
+/// \brief Number of name indices: bodies, joints, and degrees of freedom.
+static const unsigned int SharedModelDataNameIndexCount = 3;
+
+/* The header is copied with memcpy from and to the block. All members are
+ * ordered such that the struct does not contain any padding. The offsets
+ * are relative to the start of the block.
+ */
+struct SharedModelDataHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t transform_size;
+  uint32_t inertia_size;
+  uint32_t axis_size;
+  uint32_t body_count;
+  /// \brief Sum of the DoF counts of all joints.
+  uint32_t joint_axis_count;
+  uint32_t padding;
+  uint64_t compiled_model_offset;
+  uint64_t compiled_model_size;
+  uint64_t transforms_offset;
+  uint64_t inertias_offset;
+  uint64_t joint_axes_offset;
+  uint64_t name_index_offsets[SharedModelDataNameIndexCount];
+  uint64_t name_index_sizes[SharedModelDataNameIndexCount];
+  uint64_t size;
+};
+
+/// \brief Appends an aligned section to buffer and returns its offset.
+static uint64_t AppendSection (std::vector<char> &buffer, const void *data,
+    size_t size) {
+  size_t offset = (buffer.size() + SharedModelDataAlignment - 1)
+    & ~(SharedModelDataAlignment - 1);
+
+  buffer.resize (offset + size, 0);
+  if (size > 0) {
+    memcpy (&buffer[offset], data, size);
+  }
+
+  return offset;
+}
+
+static bool IsValidSection (const SharedModelDataHeader &header,
+    uint64_t offset, uint64_t size) {
+  return offset % SharedModelDataAlignment == 0
+    && offset >= sizeof (SharedModelDataHeader)
+    && offset <= header.size
+    && size <= header.size - offset;
+}
+
+/// \brief Returns whether data contains a block that this build can use.
+static bool IsValidBlock (const char *data, size_t size) {
+  if (size < sizeof (SharedModelDataHeader)) {
+    return false;
+  }
+
+  SharedModelDataHeader header;
+  memcpy (&header, data, sizeof (SharedModelDataHeader));
+
+  if (memcmp (header.magic, SharedModelDataMagic, 8) != 0
+      || header.version != SharedModelData::Version
+      || header.byte_order != SharedModelDataByteOrderMark
+      || header.transform_size != sizeof (SpatialTransform)
+      || header.inertia_size != sizeof (SpatialRigidBodyInertia)
+      || header.axis_size != sizeof (SpatialVector)
+      || header.size != size) {
+    return false;
+  }
+
+  if (!IsValidSection (header, header.compiled_model_offset,
+        header.compiled_model_size)
+      || !IsValidSection (header, header.transforms_offset,
+        static_cast<uint64_t>(header.body_count) * header.transform_size)
+      || !IsValidSection (header, header.inertias_offset,
+        static_cast<uint64_t>(header.body_count) * header.inertia_size)
+      || !IsValidSection (header, header.joint_axes_offset,
+        static_cast<uint64_t>(header.joint_axis_count) * header.axis_size)) {
+    return false;
+  }
+
+  for (unsigned int i = 0; i < SharedModelDataNameIndexCount; i++) {
+    if (!IsValidSection (header, header.name_index_offsets[i],
+          header.name_index_sizes[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+SharedModelData::SharedModelData() :
+  mData (NULL),
+  mSize (0),
+  mMappedSize (0) {
+}
+
+SharedModelData::~SharedModelData() {
+  Unmap();
+}
+
+bool SharedModelData::WriteToBuffer (
+    const Model &model,
+    std::vector<char> &buffer,
+    bool verbose) {
+  std::vector<char> compiled_model;
+  if (!CompiledModelWriteToBuffer (model, compiled_model, verbose)) {
+    return false;
+  }
+
+  // the axes of all joints are stored consecutively in the order of the
+  // joints
+  std::vector<SpatialVector> joint_axes;
+  for (unsigned int i = 0; i < model.mJoints.size(); i++) {
+    for (unsigned int j = 0; j < model.mJoints[i].mDoFCount; j++) {
+      joint_axes.push_back (model.mJoints[i].mJointAxes[j]);
+    }
+  }
+
+  SharedModelDataHeader header;
+  memset (&header, 0, sizeof (SharedModelDataHeader));
+  memcpy (header.magic, SharedModelDataMagic, 8);
+  header.version = Version;
+  header.byte_order = SharedModelDataByteOrderMark;
+  header.transform_size = sizeof (SpatialTransform);
+  header.inertia_size = sizeof (SpatialRigidBodyInertia);
+  header.axis_size = sizeof (SpatialVector);
+  header.body_count = model.X_T.size();
+  header.joint_axis_count = joint_axes.size();
+
+  buffer.assign (sizeof (SharedModelDataHeader), 0);
+
+  header.compiled_model_size = compiled_model.size();
+  header.compiled_model_offset = AppendSection (buffer, &compiled_model[0],
+      compiled_model.size());
+  header.transforms_offset = AppendSection (buffer, model.X_T.data(),
+      model.X_T.size() * sizeof (SpatialTransform));
+  header.inertias_offset = AppendSection (buffer, model.I.data(),
+      model.I.size() * sizeof (SpatialRigidBodyInertia));
+  header.joint_axes_offset = AppendSection (buffer,
+      joint_axes.size() > 0 ? &joint_axes[0] : NULL,
+      joint_axes.size() * sizeof (SpatialVector));
+
+  const NameIndex *name_indices[SharedModelDataNameIndexCount] = {
+    &model.mBodyNameIndex,
+    &model.mJointNameIndex,
+    &model.mDoFNameIndex
+  };
+
+  for (unsigned int i = 0; i < SharedModelDataNameIndexCount; i++) {
+    std::vector<char> name_index;
+    name_indices[i]->WriteToBuffer (name_index);
+
+    header.name_index_sizes[i] = name_index.size();
+    header.name_index_offsets[i] = AppendSection (buffer, &name_index[0],
+        name_index.size());
+  }
+
+  header.size = buffer.size();
+  memcpy (&buffer[0], &header, sizeof (SharedModelDataHeader));
+
+  if (verbose) {
+    std::cout << "Stored shared model data with " << header.body_count
+      << " bodies and " << header.joint_axis_count << " joint axes ("
+      << buffer.size() << " bytes)" << std::endl;
+  }
+
+  return true;
+}
+
+bool SharedModelData::WriteToFile (
+    const Model &model,
+    const char *filename,
+    bool verbose) {
+  std::vector<char> buffer;
+
+  if (!WriteToBuffer (model, buffer, verbose)) {
+    return false;
+  }
+
+  std::ofstream file (filename, std::ios::out | std::ios::binary);
+  if (!file) {
+    std::cerr << "Error opening file '" << filename << "' for writing!"
+      << std::endl;
+    return false;
+  }
+
+  file.write (&buffer[0], buffer.size());
+  file.close();
+
+  if (!file) {
+    std::cerr << "Error writing file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool SharedModelData::MapFile (const char *filename) {
+  Unmap();
+
+#ifdef RBDL_SHARED_MODEL_DATA_USE_MMAP
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error opening file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat (fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    std::cerr << "Error reading file '" << filename << "'!" << std::endl;
+    close (fd);
+    return false;
+  }
+
+  size_t size = static_cast<size_t>(file_stat.st_size);
+  void *data = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (data == MAP_FAILED) {
+    std::cerr << "Error mapping file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  if (!Map (data, size)) {
+    munmap (data, size);
+    return false;
+  }
+
+  mMappedSize = size;
+
+  return true;
+#else
+  FILE *file = fopen (filename, "rb");
+  if (!file) {
+    std::cerr << "Error opening file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  std::vector<char> buffer;
+  long size = -1;
+  if (fseek (file, 0, SEEK_END) == 0) {
+    size = ftell (file);
+  }
+
+  if (size > 0 && fseek (file, 0, SEEK_SET) == 0) {
+    buffer.resize (static_cast<size_t>(size));
+    if (fread (&buffer[0], 1, buffer.size(), file) != buffer.size()) {
+      buffer.clear();
+    }
+  }
+  fclose (file);
+
+  if (buffer.size() == 0) {
+    std::cerr << "Error reading file '" << filename << "'!" << std::endl;
+    return false;
+  }
+
+  if (!Map (&buffer[0], buffer.size())) {
+    return false;
+  }
+
+  mBuffer.swap (buffer);
+
+  return true;
+#endif
+}
+
+bool SharedModelData::Map (const void *data, size_t size) {
+  Unmap();
+
+  if (reinterpret_cast<uintptr_t>(data) % 16 != 0
+      || !IsValidBlock (static_cast<const char*>(data), size)) {
+    std::cerr << "Error: invalid shared model data!" << std::endl;
+    return false;
+  }
+
+  mData = static_cast<const char*>(data);
+  mSize = size;
+
+  return true;
+}
+
+void SharedModelData::Unmap () {
+#ifdef RBDL_SHARED_MODEL_DATA_USE_MMAP
+  if (mMappedSize > 0) {
+    munmap (const_cast<char*>(mData), mMappedSize);
+  }
+#endif
+
+  std::vector<char>().swap (mBuffer);
+  mData = NULL;
+  mSize = 0;
+  mMappedSize = 0;
+}
+
+bool SharedModelData::CreateModel (Model *model, bool verbose) const {
+  assert (model);
+
+  if (mData == NULL) {
+    std::cerr << "Error: no shared model data is mapped!" << std::endl;
+    return false;
+  }
+
+  SharedModelDataHeader header;
+  memcpy (&header, mData, sizeof (SharedModelDataHeader));
+
+  if (!CompiledModelReadFromMemory (mData + header.compiled_model_offset,
+        header.compiled_model_size, model, verbose)) {
+    return false;
+  }
+
+  unsigned int joint_axis_count = 0;
+  for (unsigned int i = 0; i < model->mJoints.size(); i++) {
+    joint_axis_count += model->mJoints[i].mDoFCount;
+  }
+
+  if (model->X_T.size() != header.body_count
+      || model->I.size() != header.body_count
+      || joint_axis_count != header.joint_axis_count) {
+    std::cerr << "Error: the shared model data does not match its model "
+      << "description!" << std::endl;
+    return false;
+  }
+
+  NameIndex *name_indices[SharedModelDataNameIndexCount] = {
+    &model->mBodyNameIndex,
+    &model->mJointNameIndex,
+    &model->mDoFNameIndex
+  };
+
+  for (unsigned int i = 0; i < SharedModelDataNameIndexCount; i++) {
+    if (!name_indices[i]->Map (mData + header.name_index_offsets[i],
+          header.name_index_sizes[i])) {
+      std::cerr << "Error: invalid name index in the shared model data!"
+        << std::endl;
+      return false;
+    }
+  }
+
+  model->X_T.Map (reinterpret_cast<const SpatialTransform*>(
+        mData + header.transforms_offset), header.body_count);
+  model->I.Map (reinterpret_cast<const SpatialRigidBodyInertia*>(
+        mData + header.inertias_offset), header.body_count);
+
+  const SpatialVector *joint_axes = reinterpret_cast<const SpatialVector*>(
+      mData + header.joint_axes_offset);
+  for (unsigned int i = 0; i < model->mJoints.size(); i++) {
+    if (model->mJoints[i].mDoFCount > 0) {
+      model->mJoints[i].MapJointAxes (joint_axes);
+      joint_axes += model->mJoints[i].mDoFCount;
+    }
+  }
+
+  if (verbose) {
+    std::cout << "Mapped " << header.body_count << " bodies and "
+      << header.joint_axis_count << " joint axes from the shared model data"
+      << std::endl;
+  }
+
+  return true;
+}
+
+}
@@ -722,3 +722,475 @@ TEST_FIXTURE (Human36, ForwardDynamicsContactsImpulses) {
   CHECK_ARRAY_CLOSE (Vector3d(0., 0., 0.).data(), heel_left_velocity.data(), 3, TEST_PREC);
   CHECK_ARRAY_CLOSE (Vector3d(0., 0., 0.).data(), heel_right_velocity.data(), 3, TEST_PREC);
 }
+
+TEST_FIXTURE (Human36, ForwardDynamicsContactsInactiveConstraints) {
+  randomizeStates();
+
+  Vector3d heel_point (-0.03, 0., -0.03);
+
+  ConstraintSet constraint_left;
+  constraint_left.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (1., 0., 0.));
+  constraint_left.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 1., 0.));
+  constraint_left.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 0., 1.));
+  constraint_left.Bind (*model_3dof);
+
+  ConstraintSet constraint_both;
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootRight], heel_point, Vector3d (1., 0., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (1., 0., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootRight], heel_point, Vector3d (0., 1., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 1., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 0., 1.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootRight], heel_point, Vector3d (0., 0., 1.));
+  constraint_both.Bind (*model_3dof);
+
+  ConstraintSet constraint_both_reference = constraint_both.Copy();
+  constraint_both_reference.Bind (*model_3dof);
+
+  constraint_both.SetActive (0, false);
+  constraint_both.SetActive (2, false);
+  constraint_both.SetActive (5, false);
+
+  CHECK_EQUAL (3u, constraint_both.GetActiveCount());
+  CHECK (!constraint_both.IsActive (0));
+  CHECK (constraint_both.IsActive (1));
+
+  unsigned int left_rows[3] = { 1, 3, 4 };
+
+  VectorNd qddot_left (VectorNd::Zero (qddot.size()));
+  VectorNd qddot_both (VectorNd::Zero (qddot.size()));
+  VectorNd force_left (VectorNd::Zero (constraint_both.size()));
+  double prec = TEST_PREC * 100.;
+
+  for (unsigned int method = 0; method < 4; method++) {
+    switch (method) {
+      case 0:
+        ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_left, qddot_left);
+        ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_both, qddot_both);
+        break;
+      case 1:
+        ForwardDynamicsConstraintsRangeSpaceSparse (*model_3dof, q, qdot, tau, constraint_left, qddot_left);
+        ForwardDynamicsConstraintsRangeSpaceSparse (*model_3dof, q, qdot, tau, constraint_both, qddot_both);
+        break;
+      case 2:
+        ForwardDynamicsConstraintsNullSpace (*model_3dof, q, qdot, tau, constraint_left, qddot_left);
+        ForwardDynamicsConstraintsNullSpace (*model_3dof, q, qdot, tau, constraint_both, qddot_both);
+        break;
+      default:
+        ForwardDynamicsContactsKokkevis (*model_3dof, q, qdot, tau, constraint_left, qddot_left);
+        ForwardDynamicsContactsKokkevis (*model_3dof, q, qdot, tau, constraint_both, qddot_both);
+        break;
+    }
+
+    force_left.setZero();
+    for (unsigned int i = 0; i < 3; i++) {
+      force_left[left_rows[i]] = constraint_left.force[i];
+    }
+
+    CHECK_ARRAY_CLOSE (qddot_left.data(), qddot_both.data(), qddot_left.size(), prec);
+    CHECK_ARRAY_CLOSE (force_left.data(), constraint_both.force.data(), force_left.size(), prec);
+  }
+
+  VectorNd qdotplus_left (VectorNd::Zero (qdot.size()));
+  VectorNd qdotplus_both (VectorNd::Zero (qdot.size()));
+  VectorNd impulse_left (VectorNd::Zero (constraint_both.size()));
+
+  for (unsigned int method = 0; method < 3; method++) {
+    switch (method) {
+      case 0:
+        ComputeConstraintImpulsesDirect (*model_3dof, q, qdot, constraint_left, qdotplus_left);
+        ComputeConstraintImpulsesDirect (*model_3dof, q, qdot, constraint_both, qdotplus_both);
+        break;
+      case 1:
+        ComputeConstraintImpulsesRangeSpaceSparse (*model_3dof, q, qdot, constraint_left, qdotplus_left);
+        ComputeConstraintImpulsesRangeSpaceSparse (*model_3dof, q, qdot, constraint_both, qdotplus_both);
+        break;
+      default:
+        ComputeConstraintImpulsesNullSpace (*model_3dof, q, qdot, constraint_left, qdotplus_left);
+        ComputeConstraintImpulsesNullSpace (*model_3dof, q, qdot, constraint_both, qdotplus_both);
+        break;
+    }
+
+    impulse_left.setZero();
+    for (unsigned int i = 0; i < 3; i++) {
+      impulse_left[left_rows[i]] = constraint_left.impulse[i];
+    }
+
+    CHECK_ARRAY_CLOSE (qdotplus_left.data(), qdotplus_both.data(), qdotplus_left.size(), prec);
+    CHECK_ARRAY_CLOSE (impulse_left.data(), constraint_both.impulse.data(), impulse_left.size(), prec);
+  }
+
+  // re-enabling the constraints has to yield the full contact set again
+  constraint_both.SetActive (0, true);
+  constraint_both.SetActive (2, true);
+  constraint_both.SetActive (5, true);
+
+  CHECK_EQUAL (constraint_both.size(), constraint_both.GetActiveCount());
+
+  VectorNd qddot_reference (VectorNd::Zero (qddot.size()));
+  ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_both_reference, qddot_reference);
+  ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_both, qddot_both);
+
+  CHECK_ARRAY_CLOSE (qddot_reference.data(), qddot_both.data(), qddot_reference.size(), prec);
+  CHECK_ARRAY_CLOSE (constraint_both_reference.force.data(), constraint_both.force.data(), constraint_both.size(), prec);
+}
+
+TEST_FIXTURE (Human36, ForwardDynamicsContactsInactiveConstraintsLinearSolvers) {
+  // deterministic states to not alter the random states of other tests
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (static_cast<double>(i));
+    qdot[i] = 0.3 * cos (static_cast<double>(i));
+    tau[i] = 0.2 * sin (2. * i);
+  }
+
+  Vector3d heel_point (-0.03, 0., -0.03);
+
+  ConstraintSet constraint_left;
+  constraint_left.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (1., 0., 0.));
+  constraint_left.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 1., 0.));
+  constraint_left.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 0., 1.));
+  constraint_left.Bind (*model_3dof);
+
+  ConstraintSet constraint_both;
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (1., 0., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootRight], heel_point, Vector3d (1., 0., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 1., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootRight], heel_point, Vector3d (0., 1., 0.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootLeft], heel_point, Vector3d (0., 0., 1.));
+  constraint_both.AddContactConstraint (body_id_3dof[BodyFootRight], heel_point, Vector3d (0., 0., 1.));
+  constraint_both.Bind (*model_3dof);
+
+  constraint_both.SetActive (1, false);
+  constraint_both.SetActive (3, false);
+  constraint_both.SetActive (5, false);
+
+  VectorNd qddot_left (VectorNd::Zero (qddot.size()));
+  VectorNd qddot_both (VectorNd::Zero (qddot.size()));
+  VectorNd force_left (VectorNd::Zero (constraint_both.size()));
+  double prec = TEST_PREC * 100.;
+
+  LinearSolver solvers[3] = {
+    LinearSolverPartialPivLU,
+    LinearSolverHouseholderQR,
+    LinearSolverColPivHouseholderQR
+  };
+
+  // switching the linear solver reallocates the decompositions once
+  for (unsigned int i = 0; i < 3; i++) {
+    constraint_left.SetSolver (solvers[i]);
+    constraint_both.SetSolver (solvers[i]);
+
+    for (unsigned int method = 0; method < 2; method++) {
+      if (method == 0) {
+        ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_left, qddot_left);
+        ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_both, qddot_both);
+      } else {
+        ForwardDynamicsConstraintsNullSpace (*model_3dof, q, qdot, tau, constraint_left, qddot_left);
+        ForwardDynamicsConstraintsNullSpace (*model_3dof, q, qdot, tau, constraint_both, qddot_both);
+      }
+
+      force_left.setZero();
+      for (unsigned int j = 0; j < 3; j++) {
+        force_left[2 * j] = constraint_left.force[j];
+      }
+
+      CHECK_ARRAY_CLOSE (qddot_left.data(), qddot_both.data(), qddot_left.size(), prec);
+      CHECK_ARRAY_CLOSE (force_left.data(), constraint_both.force.data(), force_left.size(), prec);
+    }
+  }
+}
+
+TEST_FIXTURE (Human36, ForwardDynamicsContactsLazyWorkspace) {
+  randomizeStates();
+
+  ConstraintSet constraint_all = constraints_4B4C_3dof.Copy();
+  constraint_all.Bind (*model_3dof);
+
+  ConstraintSet constraint_lazy = constraints_4B4C_3dof.Copy();
+  constraint_lazy.Bind (*model_3dof, ConstraintSet::SolverRangeSpaceSparse);
+
+  CHECK (constraint_lazy.GetWorkspaceSize (ConstraintSet::SolverDirect)
+      < constraint_all.GetWorkspaceSize (ConstraintSet::SolverDirect));
+  CHECK (constraint_lazy.GetWorkspaceSize (ConstraintSet::SolverKokkevis)
+      < constraint_all.GetWorkspaceSize (ConstraintSet::SolverKokkevis));
+  CHECK (constraint_lazy.GetWorkspaceSize (ConstraintSet::SolverRangeSpaceSparse) > 0);
+  CHECK_EQUAL (
+      constraint_all.GetWorkspaceSize (ConstraintSet::SolverRangeSpaceSparse),
+      constraint_lazy.GetWorkspaceSize (ConstraintSet::SolverRangeSpaceSparse));
+  CHECK (constraint_lazy.GetWorkspaceSize (ConstraintSet::SolverAll)
+      < constraint_all.GetWorkspaceSize (ConstraintSet::SolverAll));
+
+  VectorNd qddot_all (VectorNd::Zero (qddot.size()));
+  VectorNd qddot_lazy (VectorNd::Zero (qddot.size()));
+
+  ForwardDynamicsConstraintsRangeSpaceSparse (*model_3dof, q, qdot, tau, constraint_all, qddot_all);
+  ForwardDynamicsConstraintsRangeSpaceSparse (*model_3dof, q, qdot, tau, constraint_lazy, qddot_lazy);
+  CHECK_ARRAY_CLOSE (qddot_all.data(), qddot_lazy.data(), qddot_all.size(), TEST_PREC);
+
+  // workspaces of other solvers get allocated on first use
+  ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_all, qddot_all);
+  ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, constraint_lazy, qddot_lazy);
+  CHECK_ARRAY_CLOSE (qddot_all.data(), qddot_lazy.data(), qddot_all.size(), TEST_PREC);
+  CHECK_EQUAL (
+      constraint_all.GetWorkspaceSize (ConstraintSet::SolverDirect),
+      constraint_lazy.GetWorkspaceSize (ConstraintSet::SolverDirect));
+
+  ForwardDynamicsContactsKokkevis (*model_3dof, q, qdot, tau, constraint_all, qddot_all);
+  ForwardDynamicsContactsKokkevis (*model_3dof, q, qdot, tau, constraint_lazy, qddot_lazy);
+  CHECK_ARRAY_CLOSE (qddot_all.data(), qddot_lazy.data(), qddot_all.size(), TEST_PREC);
+
+  VectorNd qdotplus_all (VectorNd::Zero (qdot.size()));
+  VectorNd qdotplus_lazy (VectorNd::Zero (qdot.size()));
+  ComputeConstraintImpulsesNullSpace (*model_3dof, q, qdot, constraint_all, qdotplus_all);
+  ComputeConstraintImpulsesNullSpace (*model_3dof, q, qdot, constraint_lazy, qdotplus_lazy);
+  CHECK_ARRAY_CLOSE (qdotplus_all.data(), qdotplus_lazy.data(), qdotplus_all.size(), TEST_PREC);
+
+  VectorNd tau_all (VectorNd::Zero (tau.size()));
+  VectorNd tau_lazy (VectorNd::Zero (tau.size()));
+  InverseDynamicsConstraints (*model_3dof, q, qdot, qddot, constraint_all, qddot_all, tau_all);
+  InverseDynamicsConstraints (*model_3dof, q, qdot, qddot, constraint_lazy, qddot_lazy, tau_lazy);
+  CHECK_ARRAY_CLOSE (tau_all.data(), tau_lazy.data(), tau_all.size(), TEST_PREC);
+
+  CHECK_EQUAL (
+      constraint_all.GetWorkspaceSize (ConstraintSet::SolverAll),
+      constraint_lazy.GetWorkspaceSize (ConstraintSet::SolverAll));
+}
+
+TEST_FIXTURE (Human36, ForwardDynamicsContactsJacobianPattern) {
+  randomizeStates();
+
+  ConstraintSet &cs = constraints_4B4C_3dof;
+  MatrixNd G (MatrixNd::Zero (cs.size(), model_3dof->dof_count));
+  CalcConstraintsJacobian (*model_3dof, q, cs, G);
+
+  CHECK_EQUAL (cs.size() + 1, cs.mGRowOffsets.size());
+
+  // all entries outside of the pattern have to be zero
+  for (unsigned int i = 0; i < cs.size(); i++) {
+    VectorNd row = G.block(i, 0, 1, G.cols()).transpose();
+    for (unsigned int p = cs.mGRowOffsets[i]; p < cs.mGRowOffsets[i + 1]; p++) {
+      row[cs.mGColumnIndices[p]] = 0.;
+    }
+    CHECK_EQUAL (0., row.norm());
+    CHECK (cs.mGRowOffsets[i + 1] - cs.mGRowOffsets[i] < model_3dof->dof_count);
+  }
+
+  VectorNd qddot_direct (VectorNd::Zero (qddot.size()));
+  VectorNd qddot_sparse (VectorNd::Zero (qddot.size()));
+
+  ForwardDynamicsConstraintsDirect (*model_3dof, q, qdot, tau, cs, qddot_direct);
+  VectorNd force_direct = cs.force;
+  ForwardDynamicsConstraintsRangeSpaceSparse (*model_3dof, q, qdot, tau, cs, qddot_sparse);
+
+  CHECK_ARRAY_CLOSE (qddot_direct.data(), qddot_sparse.data(), qddot_direct.size(), TEST_PREC * qddot_direct.norm());
+  CHECK_ARRAY_CLOSE (force_direct.data(), cs.force.data(), cs.size(), TEST_PREC * force_direct.norm());
+}
+
+static void CheckInverseDynamicsConstraints (
+  Model &model,
+  ConstraintSet &cs,
+  const VectorNd &q,
+  const VectorNd &qdot,
+  const VectorNd &qddot_desired,
+  const std::vector<bool> *actuated_dofs
+  ) {
+  VectorNd qddot_id (VectorNd::Zero (model.dof_count));
+  VectorNd tau_id (VectorNd::Zero (model.dof_count));
+
+  InverseDynamicsConstraints (model, q, qdot, qddot_desired, cs, qddot_id,
+      tau_id, actuated_dofs);
+  VectorNd force_id = cs.force;
+
+  for (unsigned int i = 0; i < model.dof_count; i++) {
+    if (actuated_dofs == NULL ? i < 6 : !(*actuated_dofs)[i]) {
+      CHECK_EQUAL (0., tau_id[i]);
+    }
+  }
+
+  // applying the actuation has to result in the same motion and forces
+  VectorNd qddot_fd (VectorNd::Zero (model.dof_count));
+  ForwardDynamicsConstraintsDirect (model, q, qdot, tau_id, cs, qddot_fd);
+
+  CHECK_ARRAY_CLOSE (qddot_fd.data(), qddot_id.data(), qddot_id.size(),
+      1.0e-9 * (1. + qddot_fd.norm()));
+  CHECK_ARRAY_CLOSE (cs.force.data(), force_id.data(), cs.size(),
+      1.0e-9 * (1. + cs.force.norm()));
+
+  // feasible accelerations have to be reproduced exactly
+  VectorNd qddot_feasible (VectorNd::Zero (model.dof_count));
+  InverseDynamicsConstraints (model, q, qdot, qddot_fd, cs, qddot_feasible,
+      tau_id, actuated_dofs);
+
+  CHECK_ARRAY_CLOSE (qddot_fd.data(), qddot_feasible.data(),
+      qddot_fd.size(), 1.0e-9 * (1. + qddot_fd.norm()));
+}
+
+TEST_FIXTURE (Human36, InverseDynamicsConstraints) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    qddot[i] = 0.5 * sin (0.3 * i + 0.2);
+  }
+
+  std::vector<bool> actuated (model_emulated->dof_count, true);
+  for (unsigned int i = 0; i < 6; i++) {
+    actuated[i] = false;
+  }
+
+  // both feet planted
+  ConstraintSet cs;
+  unsigned int feet[2] = { body_id_emulated[BodyFootRight],
+    body_id_emulated[BodyFootLeft] };
+  for (unsigned int i = 0; i < 2; i++) {
+    cs.AddContactConstraint (feet[i], Vector3d (0.1, 0., -0.05),
+        Vector3d (1., 0., 0.));
+    cs.AddContactConstraint (feet[i], Vector3d (0.1, 0., -0.05),
+        Vector3d (0., 1., 0.));
+    cs.AddContactConstraint (feet[i], Vector3d (0.1, 0., -0.05),
+        Vector3d (0., 0., 1.));
+    cs.AddContactConstraint (feet[i], Vector3d (-0.1, 0., -0.05),
+        Vector3d (0., 1., 0.));
+    cs.AddContactConstraint (feet[i], Vector3d (-0.1, 0., -0.05),
+        Vector3d (0., 0., 1.));
+    cs.AddContactConstraint (feet[i], Vector3d (0., 0.05, -0.05),
+        Vector3d (0., 0., 1.));
+  }
+  cs.Bind (*model_emulated);
+
+  CheckInverseDynamicsConstraints (*model_emulated, cs, q, qdot, qddot,
+      &actuated);
+
+  // only partial contact of a single foot: the floating base cannot be
+  // fully controlled
+  CheckInverseDynamicsConstraints (*model_emulated,
+      constraints_1B4C_emulated, q, qdot, qddot, &actuated);
+
+  // flight phase
+  for (unsigned int i = 0; i < cs.size(); i++) {
+    cs.SetActive (i, false);
+  }
+  CheckInverseDynamicsConstraints (*model_emulated, cs, q, qdot, qddot,
+      &actuated);
+}
+
+TEST ( InverseDynamicsConstraintsFloatingBase ) {
+  Model model;
+  model.gravity = Vector3d (0., 0., -9.81);
+
+  Body body (1., Vector3d (0., 0., -0.5), Vector3d (1., 1., 1.));
+  unsigned int base_id = model.AddBody (0, SpatialTransform(),
+      Joint (JointTypeFloatingBase), body);
+  unsigned int thigh_id = model.AddBody (base_id,
+      Xtrans (Vector3d (0., 0., -0.5)), Joint (JointTypeRevoluteY), body);
+  unsigned int shank_id = model.AddBody (thigh_id,
+      Xtrans (Vector3d (0., 0., -1.)), Joint (JointTypeRevoluteX), body);
+  model.AddBody (base_id, Xtrans (Vector3d (0., 0., 0.5)),
+      Joint (JointTypeRevoluteZ), body);
+
+  ConstraintSet cs;
+  cs.AddContactConstraint (shank_id, Vector3d (0., 0., -1.),
+      Vector3d (1., 0., 0.));
+  cs.AddContactConstraint (shank_id, Vector3d (0., 0., -1.),
+      Vector3d (0., 1., 0.));
+  cs.AddContactConstraint (shank_id, Vector3d (0., 0., -1.),
+      Vector3d (0., 0., 1.));
+  cs.Bind (model);
+
+  VectorNd q (VectorNd::Zero (model.q_size));
+  VectorNd qdot (VectorNd::Zero (model.dof_count));
+  VectorNd qddot (VectorNd::Zero (model.dof_count));
+
+  for (unsigned int i = 0; i < model.dof_count; i++) {
+    q[i] = 0.1 * i;
+    qdot[i] = 0.3 - 0.1 * i;
+    qddot[i] = 0.2 * i - 0.5;
+  }
+  model.SetQuaternion (base_id,
+      Quaternion::fromZYXAngles (Vector3d (0.1, 0.2, 0.3)), q);
+
+  CheckInverseDynamicsConstraints (model, cs, q, qdot, qddot, NULL);
+}
+
+TEST ( InverseDynamicsConstraintsNativeFloatingBase ) {
+  Joint free_flyer (
+      SpatialVector (0., 0., 0., 1., 0., 0.),
+      SpatialVector (0., 0., 0., 0., 1., 0.),
+      SpatialVector (0., 0., 0., 0., 0., 1.),
+      SpatialVector (0., 0., 1., 0., 0., 0.),
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.)
+      );
+  MultiDofJoint free_flyer_native (free_flyer);
+
+  Model model;
+  model.gravity = Vector3d (0., 0., -9.81);
+
+  Body body (1., Vector3d (0., 0., -0.5), Vector3d (1., 1., 1.));
+  unsigned int base_id = model.AddBodyCustomJoint (0, SpatialTransform(),
+      &free_flyer_native, body);
+  unsigned int thigh_id = model.AddBody (base_id,
+      Xtrans (Vector3d (0., 0., -0.5)), Joint (JointTypeRevoluteY), body);
+  unsigned int shank_id = model.AddBody (thigh_id,
+      Xtrans (Vector3d (0., 0., -1.)), Joint (JointTypeRevoluteX), body);
+  model.AddBody (base_id, Xtrans (Vector3d (0., 0., 0.5)),
+      Joint (JointTypeRevoluteZ), body);
+
+  ConstraintSet cs;
+  cs.AddContactConstraint (shank_id, Vector3d (0., 0., -1.),
+      Vector3d (1., 0., 0.));
+  cs.AddContactConstraint (shank_id, Vector3d (0., 0., -1.),
+      Vector3d (0., 1., 0.));
+  cs.AddContactConstraint (shank_id, Vector3d (0., 0., -1.),
+      Vector3d (0., 0., 1.));
+  cs.Bind (model);
+
+  VectorNd q (VectorNd::Zero (model.q_size));
+  VectorNd qdot (VectorNd::Zero (model.dof_count));
+  VectorNd qddot (VectorNd::Zero (model.dof_count));
+
+  for (unsigned int i = 0; i < model.dof_count; i++) {
+    q[i] = 0.1 * i;
+    qdot[i] = 0.3 - 0.1 * i;
+    qddot[i] = 0.2 * i - 0.5;
+  }
+
+  CheckInverseDynamicsConstraints (model, cs, q, qdot, qddot, NULL);
+
+  // the native base joint has to give the same result as an explicit
+  // selection of the actuated degrees of freedom
+  std::vector<bool> actuated (model.dof_count, true);
+  for (unsigned int i = 0; i < 6; i++) {
+    actuated[i] = false;
+  }
+
+  VectorNd qddot_default (VectorNd::Zero (model.dof_count));
+  VectorNd tau_default (VectorNd::Zero (model.dof_count));
+  VectorNd qddot_explicit (VectorNd::Zero (model.dof_count));
+  VectorNd tau_explicit (VectorNd::Zero (model.dof_count));
+
+  InverseDynamicsConstraints (model, q, qdot, qddot, cs, qddot_default,
+      tau_default);
+  InverseDynamicsConstraints (model, q, qdot, qddot, cs, qddot_explicit,
+      tau_explicit, &actuated);
+
+  CHECK_ARRAY_CLOSE (qddot_explicit.data(), qddot_default.data(),
+      model.dof_count, TEST_PREC);
+  CHECK_ARRAY_CLOSE (tau_explicit.data(), tau_default.data(),
+      model.dof_count, TEST_PREC);
+}
+
+TEST_FIXTURE (FixedBase6DoF, ConstraintSetNameIndex) {
+  ConstraintSet cs;
+  unsigned int id_x = cs.AddContactConstraint (contact_body_id,
+      contact_point, Vector3d (1., 0., 0.), "contact_x");
+  cs.AddContactConstraint (contact_body_id, contact_point,
+      Vector3d (0., 1., 0.));
+  unsigned int id_z = cs.AddContactConstraint (contact_body_id,
+      contact_point, Vector3d (0., 0., 1.), "contact_z");
+
+  CHECK_EQUAL (id_x, cs.GetConstraintId ("contact_x"));
+  CHECK_EQUAL (id_z, cs.GetConstraintId ("contact_z"));
+  CHECK_EQUAL (std::numeric_limits<unsigned int>::max(),
+      cs.GetConstraintId (""));
+  CHECK_EQUAL (std::string ("contact_z"), cs.GetConstraintName (id_z));
+  CHECK_EQUAL (2u, cs.mNameIndex.size());
+}
@@ -1032,6 +1032,142 @@ TEST_FIXTURE (CustomJointMultiBodyFixture, ForwardDynamicsContactsKokkevis){
 
 }
 
+//==============================================================================
+/*
+  The same Euler ZYX joint implemented as a FixedSizeCustomJoint which runs
+  through the fixed-size custom joint kernels. A chain of two of these
+  joints is compared against a reference model with JointTypeEulerZYX.
+*/
+//==============================================================================
+
+struct CustomEulerZYXJointFixedSize
+  : public FixedSizeCustomJoint<CustomEulerZYXJointFixedSize, 3> {
+  void jcalc_fixed (const JointVector &q,
+                    const JointVector &qdot,
+                    Math::SpatialTransform &X_J,
+                    MotionSubspace &S_J,
+                    Math::SpatialVector &c_J)
+  {
+    double s0 = sin (q[0]);
+    double c0 = cos (q[0]);
+    double s1 = sin (q[1]);
+    double c1 = cos (q[1]);
+    double s2 = sin (q[2]);
+    double c2 = cos (q[2]);
+
+    X_J.E = Matrix3d(
+                       c0 * c1,                s0 * c1,     -s1,
+        c0 * s1 * s2 - s0 * c2, s0 * s1 * s2 + c0 * c2, c1 * s2,
+        c0 * s1 * c2 + s0 * s2, s0 * s1 * c2 - c0 * s2, c1 * c2
+        );
+
+    S_J.setZero();
+    S_J(0,0) = -s1;
+    S_J(0,2) = 1.;
+
+    S_J(1,0) = c1 * s2;
+    S_J(1,1) = c2;
+
+    S_J(2,0) = c1 * c2;
+    S_J(2,1) = - s2;
+
+    c_J.set(
+        -c1*qdot[0]*qdot[1],
+        -s1*s2*qdot[0]*qdot[1] + c1*c2*qdot[0]*qdot[2] - s2*qdot[1]*qdot[2],
+        -s1*c2*qdot[0]*qdot[1] - c1*s2*qdot[0]*qdot[2] - c2*qdot[1]*qdot[2],
+        0., 0., 0.
+        );
+  }
+};
+
+struct CustomJointFixedSizeFixture {
+  CustomJointFixedSizeFixture () {
+    Matrix3d inertia = Matrix3d::Identity(3,3);
+    Body body (1., Vector3d (1.1, 1.2, 1.3), inertia);
+    Body child_body (0.7, Vector3d (0.3, -0.2, 0.4), Matrix3d (inertia * 0.5));
+
+    reference_model.AddBody (0, SpatialTransform(),
+        Joint (JointTypeEulerZYX), body);
+    reference_model.AddBody (1, Xtrans (Vector3d (0.5, 0., 0.)),
+        Joint (JointTypeEulerZYX), child_body);
+
+    custom_model.AddBodyCustomJoint (0, SpatialTransform(),
+        &custom_joints[0], body);
+    custom_model.AddBodyCustomJoint (1, Xtrans (Vector3d (0.5, 0., 0.)),
+        &custom_joints[1], child_body);
+
+    q = VectorNd::Zero (reference_model.q_size);
+    qdot = VectorNd::Zero (reference_model.qdot_size);
+    qddot = VectorNd::Zero (reference_model.qdot_size);
+    tau = VectorNd::Zero (reference_model.qdot_size);
+
+    for (unsigned int i = 0; i < reference_model.q_size; i++) {
+      q[i] = 0.4 * sin (i + 1.);
+      qdot[i] = 0.3 * cos (2. * i);
+      qddot[i] = 0.2 * sin (0.5 * i);
+      tau[i] = 0.6 * cos (0.3 * i);
+    }
+  }
+
+  CustomEulerZYXJointFixedSize custom_joints[2];
+  Model reference_model;
+  Model custom_model;
+
+  VectorNd q;
+  VectorNd qdot;
+  VectorNd qddot;
+  VectorNd tau;
+};
+
+TEST_FIXTURE (CustomJointFixedSizeFixture, UpdateKinematics) {
+  UpdateKinematics (reference_model, q, qdot, qddot);
+  UpdateKinematics (custom_model, q, qdot, qddot);
+
+  for (unsigned int i = 1; i < reference_model.mBodies.size(); i++) {
+    CHECK_ARRAY_CLOSE (reference_model.X_base[i].E.data(),
+                       custom_model.X_base[i].E.data(),
+                       9,
+                       TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference_model.v[i].data(),
+                       custom_model.v[i].data(),
+                       6,
+                       TEST_PREC);
+    CHECK_ARRAY_CLOSE (reference_model.a[i].data(),
+                       custom_model.a[i].data(),
+                       6,
+                       TEST_PREC);
+  }
+
+  Vector3d point (0.1, 0.2, 0.3);
+  CHECK_ARRAY_CLOSE (
+      CalcBodyToBaseCoordinates (reference_model, q, 2, point, true).data(),
+      CalcBodyToBaseCoordinates (custom_model, q, 2, point, true).data(),
+      3,
+      TEST_PREC);
+}
+
+TEST_FIXTURE (CustomJointFixedSizeFixture, Dynamics) {
+  unsigned int dof = reference_model.qdot_size;
+
+  VectorNd tau_ref (VectorNd::Zero (dof));
+  VectorNd tau_cus (VectorNd::Zero (dof));
+  InverseDynamics (reference_model, q, qdot, qddot, tau_ref);
+  InverseDynamics (custom_model, q, qdot, qddot, tau_cus);
+  CHECK_ARRAY_CLOSE (tau_ref.data(), tau_cus.data(), dof, TEST_PREC);
+
+  VectorNd qddot_ref (VectorNd::Zero (dof));
+  VectorNd qddot_cus (VectorNd::Zero (dof));
+  ForwardDynamics (reference_model, q, qdot, tau, qddot_ref);
+  ForwardDynamics (custom_model, q, qdot, tau, qddot_cus);
+  CHECK_ARRAY_CLOSE (qddot_ref.data(), qddot_cus.data(), dof, TEST_PREC);
+
+  MatrixNd H_ref (MatrixNd::Zero (dof, dof));
+  MatrixNd H_cus (MatrixNd::Zero (dof, dof));
+  CompositeRigidBodyAlgorithm (reference_model, q, H_ref);
+  CompositeRigidBodyAlgorithm (custom_model, q, H_cus);
+  CHECK_ARRAY_CLOSE (H_ref.data(), H_cus.data(), dof * dof, TEST_PREC);
+}
+
 //
 //Completed?
 // x  : implement test for UpdateKinematicsCustom
@@ -11,6 +11,7 @@
 #include "rbdl/Constraints.h"
 
 #include "Fixtures.h"
+#include "Human36Fixture.h"
 
 using namespace std;
 using namespace RigidBodyDynamics;
@@ -733,3 +734,540 @@ TEST_FIXTURE ( FixedBase3DoF, SolveMInvTimesNonZeroQDotKinematicsUpdate) {
 
   CHECK_ARRAY_CLOSE (qddot_solve_llt.data(), qddot_minv.data(), model->dof_count, TEST_PREC);
 }
+
+void CheckOperationalSpaceInertiaInverse (Model &model, const VectorNd &q,
+    const std::vector<unsigned int> &body_ids,
+    const std::vector<Vector3d> &body_points) {
+  const unsigned int n_tasks = body_ids.size();
+
+  MatrixNd H (MatrixNd::Zero (model.dof_count, model.dof_count));
+  CompositeRigidBodyAlgorithm (model, q, H);
+
+  MatrixNd J (MatrixNd::Zero (6 * n_tasks, model.dof_count));
+  for (unsigned int t = 0; t < n_tasks; t++) {
+    MatrixNd G (MatrixNd::Zero (6, model.dof_count));
+    CalcPointJacobian6D (model, q, body_ids[t], body_points[t], G);
+    J.block(6 * t, 0, 6, model.dof_count) = G;
+  }
+
+  MatrixNd HinvJT (MatrixNd::Zero (model.dof_count, 6 * n_tasks));
+  for (unsigned int k = 0; k < 6 * n_tasks; k++) {
+    VectorNd column = J.block(k, 0, 1, model.dof_count).transpose();
+    HinvJT.block(0, k, model.dof_count, 1) = H.llt().solve(column);
+  }
+  MatrixNd LambdaInvRef = J * HinvJT;
+
+  MatrixNd LambdaInv (MatrixNd::Zero (6 * n_tasks, 6 * n_tasks));
+  CalcOperationalSpaceInertiaInverse (model, q, body_ids, body_points, LambdaInv);
+
+  CHECK_ARRAY_CLOSE (LambdaInvRef.data(), LambdaInv.data(), LambdaInv.size(), 1.0e-14 * LambdaInvRef.norm());
+
+  // articulated body inertias of ForwardDynamics can be reused
+  VectorNd qddot (VectorNd::Zero (model.qdot_size));
+  ForwardDynamics (model, q, VectorNd::Zero (model.qdot_size), VectorNd::Zero (model.qdot_size), qddot);
+  LambdaInv.setZero();
+  CalcOperationalSpaceInertiaInverse (model, q, body_ids, body_points, LambdaInv, false);
+
+  CHECK_ARRAY_CLOSE (LambdaInvRef.data(), LambdaInv.data(), LambdaInv.size(), 1.0e-14 * LambdaInvRef.norm());
+}
+
+void CheckOperationalSpaceInertiaInverse (Model &model, const VectorNd &q) {
+  std::vector<unsigned int> body_ids;
+  std::vector<Vector3d> body_points;
+
+  body_ids.push_back (model.GetBodyId ("foot_r"));
+  body_points.push_back (Vector3d (0.1, 0., -0.05));
+  body_ids.push_back (model.GetBodyId ("foot_l"));
+  body_points.push_back (Vector3d (0.1, 0.2, -0.05));
+  body_ids.push_back (model.GetBodyId ("hand_r"));
+  body_points.push_back (Vector3d (0., 0., -0.1));
+  body_ids.push_back (model.GetBodyId ("uppertrunk"));
+  body_points.push_back (Vector3d (0., 0.1, 0.3));
+  body_ids.push_back (model.GetBodyId ("foot_r"));
+  body_points.push_back (Vector3d (-0.1, 0., -0.05));
+
+  CheckOperationalSpaceInertiaInverse (model, q, body_ids, body_points);
+
+  // the workspaces are reused for fewer tasks
+  body_ids.resize (2);
+  body_points.resize (2);
+  CheckOperationalSpaceInertiaInverse (model, q, body_ids, body_points);
+}
+
+TEST_FIXTURE ( Human36, CalcOperationalSpaceInertiaInverse ) {
+  randomizeStates();
+
+  CheckOperationalSpaceInertiaInverse (*model_emulated, q);
+  CheckOperationalSpaceInertiaInverse (*model_3dof, q);
+}
+
+static void CheckHybridDynamics (Model &model, const VectorNd &q,
+    const VectorNd &qdot, const VectorNd &tau) {
+  VectorNd qddot (VectorNd::Zero (model.qdot_size));
+  ForwardDynamics (model, q, qdot, tau, qddot);
+
+  // prescribe the motion of every other joint
+  std::vector<bool> qddot_known (model.dof_count, false);
+  for (unsigned int i = 1; i < model.mBodies.size(); i += 2) {
+    for (unsigned int j = 0; j < model.mJoints[i].mDoFCount; j++) {
+      qddot_known[model.mJoints[i].q_index + j] = true;
+    }
+  }
+
+  VectorNd qddot_hybrid (VectorNd::Zero (model.qdot_size));
+  VectorNd tau_hybrid (VectorNd::Zero (model.qdot_size));
+  for (unsigned int i = 0; i < model.dof_count; i++) {
+    if (qddot_known[i]) {
+      qddot_hybrid[i] = qddot[i];
+    } else {
+      tau_hybrid[i] = tau[i];
+    }
+  }
+
+  HybridDynamics (model, q, qdot, qddot_hybrid, tau_hybrid, qddot_known);
+
+  CHECK_ARRAY_CLOSE (qddot.data(), qddot_hybrid.data(), qddot.size(), 1.0e-10);
+  CHECK_ARRAY_CLOSE (tau, tau_hybrid, tau.size(), 1.0e-10);
+
+  // fully prescribed motion is inverse dynamics
+  std::vector<bool> all_known (model.dof_count, true);
+  tau_hybrid.setZero();
+  HybridDynamics (model, q, qdot, qddot_hybrid, tau_hybrid, all_known);
+
+  CHECK_ARRAY_CLOSE (tau, tau_hybrid, tau.size(), 1.0e-10);
+}
+
+TEST_FIXTURE ( Human36, HybridDynamics ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    tau[i] = 0.5 * sin (0.3 * i + 0.2);
+  }
+
+  CheckHybridDynamics (*model_emulated, q, qdot, tau);
+  CheckHybridDynamics (*model_3dof, q, qdot, tau);
+}
+
+static void CheckGravityTorquesAndCoriolisMatrix (Model &model,
+    const VectorNd &q, const VectorNd &qdot, bool check_skew_symmetry) {
+  VectorNd zero (VectorNd::Zero (model.qdot_size));
+  VectorNd gravity_ref (VectorNd::Zero (model.qdot_size));
+  VectorNd gravity (VectorNd::Zero (model.qdot_size));
+
+  InverseDynamics (model, q, zero, zero, gravity_ref);
+  CalcGravityTorques (model, q, gravity);
+  CHECK_ARRAY_CLOSE (gravity_ref.data(), gravity.data(), gravity.size(), 1.0e-12);
+
+  gravity.setZero();
+  CalcGravityTorques (model, q, gravity, false);
+  CHECK_ARRAY_CLOSE (gravity_ref.data(), gravity.data(), gravity.size(), 1.0e-12);
+
+  VectorNd nonlinear (VectorNd::Zero (model.qdot_size));
+  InverseDynamics (model, q, qdot, zero, nonlinear);
+
+  MatrixNd C (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+  CalcCoriolisMatrix (model, q, qdot, C);
+
+  VectorNd coriolis = C * qdot;
+  VectorNd coriolis_ref = nonlinear - gravity_ref;
+  CHECK_ARRAY_CLOSE (coriolis_ref.data(), coriolis.data(), coriolis.size(), 1.0e-10);
+
+  if (!check_skew_symmetry) {
+    return;
+  }
+
+  // dH/dt - 2 C has to be skew-symmetric
+  double h = 1.0e-6;
+  MatrixNd H_plus (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+  MatrixNd H_minus (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+  CompositeRigidBodyAlgorithm (model, q + h * qdot, H_plus);
+  CompositeRigidBodyAlgorithm (model, q - h * qdot, H_minus);
+
+  MatrixNd N = (H_plus - H_minus) / (2. * h) - 2. * C;
+  MatrixNd N_sym = N + N.transpose();
+  MatrixNd N_sym_ref (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+  CHECK_ARRAY_CLOSE (N_sym_ref.data(), N_sym.data(), N_sym.size(), 1.0e-6);
+}
+
+TEST_FIXTURE ( Human36, CalcGravityTorquesAndCoriolisMatrix ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+    qdot[i] = 0.5 * cos (0.7 * i);
+  }
+
+  CheckGravityTorquesAndCoriolisMatrix (*model_emulated, q, qdot, true);
+  CheckGravityTorquesAndCoriolisMatrix (*model_3dof, q, qdot, false);
+}
+
+static void CheckMInvTimesMatrix (Model &model, const VectorNd &q) {
+  MatrixNd B (MatrixNd::Zero (model.qdot_size, 7));
+  for (unsigned int i = 0; i < B.rows(); i++) {
+    for (unsigned int j = 0; j < B.cols(); j++) {
+      B(i,j) = sin (0.7 * i + 1.1 * j);
+    }
+  }
+
+  MatrixNd X_ref (MatrixNd::Zero (B.rows(), B.cols()));
+  for (unsigned int j = 0; j < B.cols(); j++) {
+    VectorNd tau = B.block(0, j, B.rows(), 1);
+    VectorNd qddot (VectorNd::Zero (B.rows()));
+    CalcMInvTimesTau (model, q, tau, qddot);
+    X_ref.block(0, j, B.rows(), 1) = qddot;
+  }
+
+  MatrixNd X (MatrixNd::Zero (B.rows(), B.cols()));
+  CalcMInvTimesMatrix (model, q, B, X);
+  CHECK_ARRAY_CLOSE (X_ref.data(), X.data(), X.size(), 1.0e-10);
+
+  X.setZero();
+  CalcMInvTimesMatrix (model, q, B, X, false);
+  CHECK_ARRAY_CLOSE (X_ref.data(), X.data(), X.size(), 1.0e-10);
+}
+
+TEST_FIXTURE ( Human36, CalcMInvTimesMatrix ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+  }
+
+  CheckMInvTimesMatrix (*model_emulated, q);
+  CheckMInvTimesMatrix (*model_3dof, q);
+}
+
+static VectorNd GetInertialParameters (const Model &model) {
+  VectorNd phi (VectorNd::Zero (10 * (model.mBodies.size() - 1)));
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    const SpatialRigidBodyInertia &I = model.I[i];
+    unsigned int col = 10 * (i - 1);
+    phi[col] = I.m;
+    phi[col + 1] = I.h[0];
+    phi[col + 2] = I.h[1];
+    phi[col + 3] = I.h[2];
+    phi[col + 4] = I.Ixx;
+    phi[col + 5] = I.Iyx;
+    phi[col + 6] = I.Izx;
+    phi[col + 7] = I.Iyy;
+    phi[col + 8] = I.Izy;
+    phi[col + 9] = I.Izz;
+  }
+
+  return phi;
+}
+
+TEST_FIXTURE ( Human36, CalcInverseDynamicsRegressor ) {
+  Model *models[2] = { model_emulated, model_3dof };
+
+  for (unsigned int m = 0; m < 2; m++) {
+    Model &model = *models[m];
+    VectorNd phi = GetInertialParameters (model);
+    unsigned int n_params = phi.size();
+
+    std::vector<VectorNd> Qs, QDots, QDDots;
+    VectorNd tau_ref (VectorNd::Zero (3 * model.dof_count));
+
+    for (unsigned int s = 0; s < 3; s++) {
+      for (unsigned int i = 0; i < q.size(); i++) {
+        q[i] = 0.4 * sin (1.3 * i + s);
+        qdot[i] = 0.5 * cos (0.7 * i - s);
+        qddot[i] = 0.5 * sin (0.3 * i + 0.2 * s);
+      }
+      Qs.push_back (q);
+      QDots.push_back (qdot);
+      QDDots.push_back (qddot);
+
+      InverseDynamics (model, q, qdot, qddot, tau);
+      tau_ref.block(s * model.dof_count, 0, model.dof_count, 1) = tau;
+    }
+
+    MatrixNd Y (MatrixNd::Zero (model.dof_count, n_params));
+    CalcInverseDynamicsRegressor (model, Qs[2], QDots[2], QDDots[2], Y);
+    VectorNd tau_regressor = Y * phi;
+    CHECK_ARRAY_CLOSE (tau.data(), tau_regressor.data(), tau.size(), 1.0e-10);
+
+    MatrixNd Y_batch (MatrixNd::Zero (3 * model.dof_count, n_params));
+    CalcInverseDynamicsRegressorBatch (model, Qs, QDots, QDDots, Y_batch);
+    VectorNd tau_batch = Y_batch * phi;
+    CHECK_ARRAY_CLOSE (tau_ref.data(), tau_batch.data(), tau_ref.size(), 1.0e-10);
+  }
+}
+
+static void CheckDynamicsBatch (Model &model, const VectorNd &q,
+    const VectorNd &qdot, const VectorNd &qddot, const VectorNd &tau,
+    std::vector<SpatialVector> *f_ext = NULL) {
+  unsigned int n_variants = 3;
+
+  std::vector<std::vector<SpatialRigidBodyInertia> > inertias (n_variants);
+  MatrixNd tau_ref (MatrixNd::Zero (model.dof_count, n_variants));
+  MatrixNd qddot_ref (MatrixNd::Zero (model.dof_count, n_variants));
+
+  for (unsigned int k = 0; k < n_variants; k++) {
+    Model model_variant (model);
+
+    for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+      const SpatialRigidBodyInertia &I = model.I[i];
+      double scale = 1. + 0.2 * sin (0.9 * i + 1.7 * k);
+      Vector3d h_offset = 0.01 * Vector3d (cos (1.1 * i + k),
+          sin (0.3 * i - k), cos (0.5 * i * k));
+      model_variant.I[i] = SpatialRigidBodyInertia (scale * I.m,
+          scale * I.h + h_offset,
+          scale * I.Ixx,
+          scale * I.Iyx, scale * I.Iyy,
+          scale * I.Izx, scale * I.Izy, scale * I.Izz);
+    }
+    inertias[k].assign (model_variant.I.begin(), model_variant.I.end());
+
+    VectorNd result (VectorNd::Zero (model.dof_count));
+    InverseDynamics (model_variant, q, qdot, qddot, result, f_ext);
+    tau_ref.block(0, k, model.dof_count, 1) = result;
+
+    ForwardDynamics (model_variant, q, qdot, tau, result, f_ext);
+    qddot_ref.block(0, k, model.dof_count, 1) = result;
+  }
+
+  MatrixNd tau_batch (MatrixNd::Zero (model.dof_count, n_variants));
+  InverseDynamicsBatch (model, q, qdot, qddot, inertias, tau_batch, f_ext);
+  CHECK_ARRAY_CLOSE (tau_ref.data(), tau_batch.data(), tau_ref.size(), 1.0e-10);
+
+  MatrixNd qddot_batch (MatrixNd::Zero (model.dof_count, n_variants));
+  ForwardDynamicsBatch (model, q, qdot, tau, inertias, qddot_batch, f_ext);
+  CHECK_ARRAY_CLOSE (qddot_ref.data(), qddot_batch.data(), qddot_ref.size(), 1.0e-10);
+}
+
+TEST_FIXTURE ( Human36, DynamicsBatch ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    qddot[i] = 0.5 * sin (0.3 * i + 0.2);
+    tau[i] = 0.5 * cos (0.4 * i - 0.1);
+  }
+
+  CheckDynamicsBatch (*model_emulated, q, qdot, qddot, tau);
+  CheckDynamicsBatch (*model_3dof, q, qdot, qddot, tau);
+
+  std::vector<SpatialVector> f_ext (model_3dof->mBodies.size(),
+      SpatialVector::Zero());
+  for (unsigned int i = 1; i < f_ext.size(); i += 2) {
+    f_ext[i] = 0.01 * SpatialVector (0.1 * i, -0.2, 0.3, cos (0.5 * i),
+        1.2, -0.4 * sin (0.7 * i));
+  }
+  CheckDynamicsBatch (*model_3dof, q, qdot, qddot, tau, &f_ext);
+}
+
+/// \brief Creates a model whose multi-DoF joints are native custom joints.
+static void CreateNativeMultiDofModel (Model &model) {
+  Joint free_flyer (
+      SpatialVector (0., 0., 0., 1., 0., 0.),
+      SpatialVector (0., 0., 0., 0., 1., 0.),
+      SpatialVector (0., 0., 0., 0., 0., 1.),
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.),
+      SpatialVector (0., 0., 1., 0., 0., 0.)
+      );
+  Joint rot_yx (
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.)
+      );
+  Joint rot_z (SpatialVector (0., 0., 1., 0., 0., 0.));
+  Body body (1.3, Vector3d (0.1, 0.2, -0.3), Vector3d (0.4, 0.5, 0.6));
+
+  model.gravity = Vector3d (0., 0., -9.81);
+  model.mNativeMultiDofJoints = true;
+  unsigned int base_id = model.AddBody (0, SpatialTransform(), free_flyer,
+      body);
+  unsigned int arm_id = model.AddBody (base_id,
+      Xtrans (Vector3d (0.2, 0., -0.1)), rot_yx, body);
+  model.AddBody (arm_id, Xtrans (Vector3d (0., 0., -0.4)), rot_z, body);
+  model.AddBody (arm_id, Xtrans (Vector3d (0.1, 0., -0.4)), rot_yx, body);
+}
+
+static void InitNativeMultiDofStates (const Model &model, VectorNd &q,
+    VectorNd &qdot, VectorNd &qddot, VectorNd &tau) {
+  unsigned int n = model.dof_count;
+  q.resize (n);
+  qdot.resize (n);
+  qddot.resize (n);
+  tau.resize (n);
+  for (unsigned int i = 0; i < n; i++) {
+    q[i] = 0.4 * sin (1.3 * i + 0.1);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    qddot[i] = 0.5 * sin (0.3 * i + 0.2);
+    tau[i] = 0.5 * cos (0.4 * i - 0.1);
+  }
+}
+
+TEST ( DynamicsBatchNativeMultiDofJoints ) {
+  Model model;
+  CreateNativeMultiDofModel (model);
+  CHECK_EQUAL (3u, model.mCustomJoints.size());
+
+  VectorNd q, qdot, qddot, tau;
+  InitNativeMultiDofStates (model, q, qdot, qddot, tau);
+
+  std::vector<SpatialVector> f_ext (model.mBodies.size(),
+      SpatialVector::Zero());
+  f_ext[2] = SpatialVector (0.1, -0.2, 0.3, 0.4, 1.2, -0.4);
+
+  CheckDynamicsBatch (model, q, qdot, qddot, tau);
+  CheckDynamicsBatch (model, q, qdot, qddot, tau, &f_ext);
+}
+
+TEST ( CalcOperationalSpaceInertiaInverseNativeMultiDofJoints ) {
+  Model model;
+  CreateNativeMultiDofModel (model);
+
+  VectorNd q, qdot, qddot, tau;
+  InitNativeMultiDofStates (model, q, qdot, qddot, tau);
+
+  std::vector<unsigned int> body_ids;
+  std::vector<Vector3d> body_points;
+  body_ids.push_back (3);
+  body_points.push_back (Vector3d (0.1, 0., -0.05));
+  body_ids.push_back (4);
+  body_points.push_back (Vector3d (0., 0.2, -0.1));
+  body_ids.push_back (2);
+  body_points.push_back (Vector3d (0., 0., 0.));
+
+  CheckOperationalSpaceInertiaInverse (model, q, body_ids, body_points);
+}
+
+TEST ( HybridDynamicsNativeMultiDofJoints ) {
+  Model model;
+  CreateNativeMultiDofModel (model);
+
+  VectorNd q, qdot, qddot, tau;
+  InitNativeMultiDofStates (model, q, qdot, qddot, tau);
+
+  CheckHybridDynamics (model, q, qdot, tau);
+}
+
+static void CheckIncrementalDynamics (Model &model, VectorNd q,
+    VectorNd qdot, VectorNd qddot) {
+  VectorNd tau (VectorNd::Zero (model.qdot_size));
+  MatrixNd H (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+  InverseDynamics (model, q, qdot, qddot, tau);
+  CompositeRigidBodyAlgorithm (model, q, H);
+
+  for (unsigned int body_id = 2; body_id < model.mBodies.size(); body_id += 3) {
+    unsigned int q_index = model.mJoints[body_id].q_index;
+    for (unsigned int j = 0; j < model.mJoints[body_id].mDoFCount; j++) {
+      q[q_index + j] += 0.1;
+      qdot[q_index + j] -= 0.2;
+      qddot[q_index + j] += 0.3;
+    }
+
+    std::vector<unsigned int> changed_body_ids (1, body_id);
+    InverseDynamicsIncremental (model, q, qdot, qddot, tau, changed_body_ids);
+    CompositeRigidBodyAlgorithmIncremental (model, q, H, changed_body_ids);
+
+    Model model_ref (model);
+    VectorNd tau_ref (VectorNd::Zero (model.qdot_size));
+    MatrixNd H_ref (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+    InverseDynamics (model_ref, q, qdot, qddot, tau_ref);
+    CompositeRigidBodyAlgorithm (model_ref, q, H_ref);
+
+    CHECK_ARRAY_CLOSE (tau_ref.data(), tau.data(), tau.size(), 1.0e-10);
+    CHECK_ARRAY_CLOSE (H_ref.data(), H.data(), H.size(), 1.0e-10);
+
+    // J^T f of contacts must not interfere with the next incremental
+    // evaluation
+    std::vector<unsigned int> contact_body_ids (1, body_id);
+    std::vector<Vector3d> contact_points (1, Vector3d (0.1, 0.2, 0.3));
+    std::vector<SpatialVector> contact_wrenches (1,
+        SpatialVector (1., 2., 3., 4., 5., 6.));
+    VectorNd tau_contacts (VectorNd::Zero (model.qdot_size));
+    CalcPointJacobianTransposeTimes (model, q, contact_body_ids,
+        contact_points, contact_wrenches, tau_contacts, false);
+  }
+
+  // several joints at once
+  std::vector<unsigned int> changed_body_ids;
+  changed_body_ids.push_back (model.mBodies.size() - 1);
+  changed_body_ids.push_back (3);
+  for (unsigned int k = 0; k < changed_body_ids.size(); k++) {
+    unsigned int q_index = model.mJoints[changed_body_ids[k]].q_index;
+    q[q_index] -= 0.2;
+    qdot[q_index] += 0.1;
+  }
+
+  InverseDynamicsIncremental (model, q, qdot, qddot, tau, changed_body_ids);
+  CompositeRigidBodyAlgorithmIncremental (model, q, H, changed_body_ids);
+
+  VectorNd tau_ref (VectorNd::Zero (model.qdot_size));
+  MatrixNd H_ref (MatrixNd::Zero (model.qdot_size, model.qdot_size));
+  InverseDynamics (model, q, qdot, qddot, tau_ref);
+  CompositeRigidBodyAlgorithm (model, q, H_ref);
+
+  CHECK_ARRAY_CLOSE (tau_ref.data(), tau.data(), tau.size(), 1.0e-10);
+  CHECK_ARRAY_CLOSE (H_ref.data(), H.data(), H.size(), 1.0e-10);
+}
+
+TEST_FIXTURE ( Human36, IncrementalDynamics ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    qddot[i] = 0.5 * sin (0.3 * i + 0.2);
+  }
+
+  CheckIncrementalDynamics (*model, q, qdot, qddot);
+  CheckIncrementalDynamics (*model_emulated, q, qdot, qddot);
+  CheckIncrementalDynamics (*model_3dof, q, qdot, qddot);
+}
+
+static void CheckSparseExternalForces (Model &model, const VectorNd &q,
+    const VectorNd &qdot, const VectorNd &qddot, const VectorNd &tau) {
+  UpdateKinematicsCustom (model, &q, NULL, NULL);
+
+  unsigned int foot_id = model.GetBodyId ("foot_r");
+  unsigned int hand_id = model.GetBodyId ("hand_l");
+  unsigned int trunk_id = model.GetBodyId ("uppertrunk");
+  CHECK (model.IsFixedBodyId (trunk_id));
+
+  SpatialVector foot_force (0.1, -0.2, 0.3, 10., -5., 200.);
+  SpatialVector hand_force (-0.3, 0.1, 0.2, 1., 2., -3.);
+  SpatialVector trunk_force (0.2, 0.4, -0.1, -4., 3., 6.);
+
+  std::vector<ExternalForce> f_ext_sparse;
+  f_ext_sparse.push_back (ExternalForce (foot_id, foot_force));
+  f_ext_sparse.push_back (ExternalForce (hand_id, hand_force, true));
+  f_ext_sparse.push_back (ExternalForce (trunk_id, trunk_force, true));
+
+  // dense forces in base coordinates
+  const FixedBody &trunk_body =
+    model.mFixedBodies[trunk_id - model.fixed_body_discriminator];
+  SpatialTransform X_trunk = trunk_body.mParentTransform
+    * model.X_base[trunk_body.mMovableParent];
+
+  std::vector<SpatialVector> f_ext (model.mBodies.size(),
+      SpatialVector::Zero());
+  f_ext[foot_id] += foot_force;
+  f_ext[hand_id] += model.X_base[hand_id].applyTranspose (hand_force);
+  f_ext[trunk_body.mMovableParent] += X_trunk.applyTranspose (trunk_force);
+
+  VectorNd tau_ref (VectorNd::Zero (model.qdot_size));
+  VectorNd tau_sparse (VectorNd::Zero (model.qdot_size));
+  InverseDynamics (model, q, qdot, qddot, tau_ref, &f_ext);
+  InverseDynamics (model, q, qdot, qddot, tau_sparse, f_ext_sparse);
+  CHECK_ARRAY_CLOSE (tau_ref.data(), tau_sparse.data(), tau.size(), 1.0e-10);
+
+  NonlinearEffects (model, q, qdot, tau_ref, &f_ext);
+  NonlinearEffects (model, q, qdot, tau_sparse, f_ext_sparse);
+  CHECK_ARRAY_CLOSE (tau_ref.data(), tau_sparse.data(), tau.size(), 1.0e-10);
+
+  VectorNd qddot_ref (VectorNd::Zero (model.qdot_size));
+  VectorNd qddot_sparse (VectorNd::Zero (model.qdot_size));
+  ForwardDynamics (model, q, qdot, tau, qddot_ref, &f_ext);
+  ForwardDynamics (model, q, qdot, tau, qddot_sparse, f_ext_sparse);
+  CHECK_ARRAY_CLOSE (qddot_ref.data(), qddot_sparse.data(), tau.size(), 1.0e-10);
+}
+
+TEST_FIXTURE ( Human36, SparseExternalForces ) {
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    qddot[i] = 0.5 * sin (0.3 * i + 0.2);
+    tau[i] = 0.5 * cos (0.4 * i - 0.1);
+  }
+
+  CheckSparseExternalForces (*model_emulated, q, qdot, qddot, tau);
+  CheckSparseExternalForces (*model_3dof, q, qdot, qddot, tau);
+}
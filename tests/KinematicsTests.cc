@@ -678,3 +678,93 @@ TEST_FIXTURE ( Human36, CalcPointAcceleration6D ) {
 
   CHECK_ARRAY_CLOSE (a_foot_0_ref.data(), a_foot_0.data(), 6, TEST_PREC);
 }
+
+TEST_FIXTURE ( Human36, UpdateKinematicsCustomIncremental ) {
+  Model *models[3] = { model, model_emulated, model_3dof };
+
+  for (unsigned int m = 0; m < 3; m++) {
+    Model &model_incremental = *models[m];
+
+    for (unsigned int i = 0; i < q.size(); i++) {
+      q[i] = 0.4 * sin (1.3 * i);
+      qdot[i] = 0.5 * cos (0.7 * i);
+      qddot[i] = 0.5 * sin (0.3 * i + 0.2);
+    }
+    UpdateKinematicsCustom (model_incremental, &q, &qdot, &qddot);
+
+    for (unsigned int body_id = 2; body_id < model_incremental.mBodies.size();
+        body_id += 3) {
+      unsigned int q_index = model_incremental.mJoints[body_id].q_index;
+      for (unsigned int j = 0; j < model_incremental.mJoints[body_id].mDoFCount;
+          j++) {
+        q[q_index + j] += 0.1;
+        qdot[q_index + j] -= 0.2;
+        qddot[q_index + j] += 0.3;
+      }
+
+      std::vector<unsigned int> changed_body_ids (1, body_id);
+      UpdateKinematicsCustomIncremental (model_incremental, &q, &qdot, &qddot,
+          changed_body_ids);
+
+      Model model_ref (model_incremental);
+      UpdateKinematicsCustom (model_ref, &q, &qdot, &qddot);
+
+      for (unsigned int i = 1; i < model_ref.mBodies.size(); i++) {
+        CHECK_ARRAY_CLOSE (model_ref.X_base[i].E.data(),
+            model_incremental.X_base[i].E.data(), 9, TEST_PREC);
+        CHECK_ARRAY_CLOSE (model_ref.X_base[i].r.data(),
+            model_incremental.X_base[i].r.data(), 3, TEST_PREC);
+        CHECK_ARRAY_CLOSE (model_ref.v[i].data(),
+            model_incremental.v[i].data(), 6, TEST_PREC);
+        CHECK_ARRAY_CLOSE (model_ref.a[i].data(),
+            model_incremental.a[i].data(), 6, TEST_PREC);
+      }
+    }
+  }
+}
+
+TEST_FIXTURE ( Human36, CalcPointJacobianTransposeTimes ) {
+  Model *models[3] = { model, model_emulated, model_3dof };
+
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+  }
+
+  for (unsigned int m = 0; m < 3; m++) {
+    Model &jac_model = *models[m];
+
+    std::vector<unsigned int> body_ids;
+    body_ids.push_back (jac_model.GetBodyId ("foot_r"));
+    body_ids.push_back (jac_model.GetBodyId ("hand_l"));
+    body_ids.push_back (jac_model.GetBodyId ("uppertrunk"));
+
+    std::vector<Vector3d> points;
+    points.push_back (Vector3d (1.1, 2.2, 3.3));
+    points.push_back (Vector3d (-0.3, 0.2, 0.1));
+    points.push_back (Vector3d (0.4, -0.5, 0.6));
+
+    std::vector<SpatialVector> wrenches;
+    wrenches.push_back (SpatialVector (0.1, -0.2, 0.3, 1.4, -2.5, 3.6));
+    wrenches.push_back (SpatialVector (-1.1, 0.7, 0.2, 0.4, 0.5, -0.6));
+    wrenches.push_back (SpatialVector (0.3, 0.2, -0.1, -2.1, 1.2, 0.9));
+
+    VectorNd tau_ref (VectorNd::Zero (jac_model.qdot_size));
+    for (unsigned int i = 0; i < body_ids.size(); i++) {
+      MatrixNd G (MatrixNd::Zero (6, jac_model.qdot_size));
+      CalcPointJacobian6D (jac_model, q, body_ids[i], points[i], G);
+      VectorNd tau_point (G.transpose() * wrenches[i]);
+
+      VectorNd tau (VectorNd::Zero (jac_model.qdot_size));
+      CalcPointJacobianTransposeTimes (jac_model, q, body_ids[i], points[i],
+          wrenches[i], tau);
+      CHECK_ARRAY_CLOSE (tau_point.data(), tau.data(), tau.size(), TEST_PREC);
+
+      tau_ref += tau_point;
+    }
+
+    VectorNd tau (VectorNd::Zero (jac_model.qdot_size));
+    CalcPointJacobianTransposeTimes (jac_model, q, body_ids, points, wrenches,
+        tau);
+    CHECK_ARRAY_CLOSE (tau_ref.data(), tau.data(), tau.size(), TEST_PREC);
+  }
+}
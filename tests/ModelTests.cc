@@ -1,12 +1,17 @@
 #include <UnitTest++.h>
 
 #include <iostream>
+#include <sstream>
+#include <cstdio>
 
 #include "Fixtures.h"
 #include "rbdl/rbdl_mathutils.h"
 #include "rbdl/Logging.h"
 
 #include "rbdl/Model.h"
+#include "rbdl/ModelReordering.h"
+#include "rbdl/CompiledModel.h"
+#include "rbdl/SharedModelData.h"
 #include "rbdl/Kinematics.h"
 #include "rbdl/Dynamics.h"
 
@@ -602,3 +607,600 @@ TEST (CalcBodyWorldOrientationFixedJoint) {
   CHECK_ARRAY_CLOSE (E_movable.data(), E_fixed.data(), 9, TEST_PREC);
 }
 
+
+struct ReorderingFixture {
+  ReorderingFixture () {
+    ClearLogOutput();
+    model = new Model;
+    model->gravity = Vector3d (0., -9.81, 0.);
+
+    Body body (1.1, Vector3d (0.1, 0.2, -0.3), Vector3d (0.3, 0.2, 0.1));
+    Body foot (0.4, Vector3d (0.05, 0., -0.02), Vector3d (0.02, 0.03, 0.01));
+
+    // bodies are added depth-first like the URDF reader does
+    unsigned int base_id = model->AddBody (0, SpatialTransform(),
+        Joint (JointTypeFloatingBase), body, "base");
+    unsigned int hip_l_id = model->AddBody (base_id,
+        Xtrans (Vector3d (0., 0.1, -0.2)), Joint (JointTypeEulerZYX), body,
+        "hip_l");
+    unsigned int knee_l_id = model->AddBody (hip_l_id,
+        Xtrans (Vector3d (0., 0., -0.4)), Joint (JointTypeRevoluteY), body,
+        "knee_l");
+    model->AddBody (knee_l_id, Xtrans (Vector3d (0.1, 0., -0.4)),
+        Joint (JointTypeFixed), foot, "foot_l");
+    unsigned int hip_r_id = model->AddBody (base_id,
+        Xtrans (Vector3d (0., -0.1, -0.2)), Joint (JointTypeEulerZYX), body,
+        "hip_r");
+    unsigned int knee_r_id = model->AddBody (hip_r_id,
+        Xtrans (Vector3d (0., 0., -0.4)), Joint (JointTypeRevoluteY), body,
+        "knee_r");
+    model->AddBody (knee_r_id, Xtrans (Vector3d (0.1, 0., -0.4)),
+        Joint (JointTypeFixed), foot, "foot_r");
+    model->AddBody (base_id, Xtrans (Vector3d (0., 0., 0.3)),
+        Joint (JointTypeRevoluteX), body, "arm");
+
+    q = VectorNd::Zero (model->q_size);
+    qdot = VectorNd::Zero (model->qdot_size);
+    tau = VectorNd::Zero (model->qdot_size);
+
+    for (unsigned int i = 0; i < model->qdot_size; i++) {
+      q[i] = 0.4 * sin (1.3 * i);
+      qdot[i] = 0.3 * cos (0.7 * i);
+      tau[i] = 0.2 * sin (0.9 * i + 0.5);
+    }
+    Quaternion base_orientation (0.1, -0.2, 0.3, 0.927);
+    base_orientation.normalize();
+    model->SetQuaternion (base_id, base_orientation, q);
+  }
+  ~ReorderingFixture () {
+    delete model;
+  }
+
+  void CheckReordering (BodyOrdering ordering) {
+    Model reordered_model;
+    ModelPermutation permutation;
+    ReorderModel (*model, reordered_model, permutation, ordering);
+
+    CHECK_EQUAL (model->q_size, reordered_model.q_size);
+    CHECK_EQUAL (model->qdot_size, reordered_model.qdot_size);
+    CHECK_EQUAL (model->mBodies.size(), reordered_model.mBodies.size());
+
+    std::map<std::string, unsigned int>::const_iterator name_iter;
+    for (name_iter = model->mBodyNameMap.begin();
+        name_iter != model->mBodyNameMap.end(); ++name_iter) {
+      CHECK_EQUAL (permutation.GetReorderedBodyId (name_iter->second),
+          reordered_model.GetBodyId (name_iter->first.c_str()));
+      CHECK_EQUAL (name_iter->second, permutation.GetOriginalBodyId (
+            reordered_model.GetBodyId (name_iter->first.c_str())));
+    }
+
+    VectorNd q_reordered (VectorNd::Zero (model->q_size));
+    VectorNd qdot_reordered (VectorNd::Zero (model->qdot_size));
+    VectorNd tau_reordered (VectorNd::Zero (model->qdot_size));
+    permutation.ToReorderedQ (q, q_reordered);
+    permutation.ToReorderedQDot (qdot, qdot_reordered);
+    permutation.ToReorderedQDot (tau, tau_reordered);
+
+    VectorNd q_restored (VectorNd::Zero (model->q_size));
+    permutation.FromReorderedQ (q_reordered, q_restored);
+    CHECK_ARRAY_EQUAL (q.data(), q_restored.data(), q.size());
+
+    VectorNd qddot (VectorNd::Zero (model->qdot_size));
+    VectorNd qddot_reordered (VectorNd::Zero (model->qdot_size));
+    VectorNd qddot_restored (VectorNd::Zero (model->qdot_size));
+    ForwardDynamics (*model, q, qdot, tau, qddot);
+    ForwardDynamics (reordered_model, q_reordered, qdot_reordered,
+        tau_reordered, qddot_reordered);
+    permutation.FromReorderedQDot (qddot_reordered, qddot_restored);
+    CHECK_ARRAY_CLOSE (qddot.data(), qddot_restored.data(), qddot.size(),
+        1.0e-12);
+
+    MatrixNd H (MatrixNd::Zero (model->qdot_size, model->qdot_size));
+    MatrixNd H_reordered (MatrixNd::Zero (model->qdot_size,
+          model->qdot_size));
+    MatrixNd H_restored (MatrixNd::Zero (model->qdot_size,
+          model->qdot_size));
+    CompositeRigidBodyAlgorithm (*model, q, H);
+    CompositeRigidBodyAlgorithm (reordered_model, q_reordered, H_reordered);
+    permutation.FromReorderedQDotMatrix (H_reordered, H_restored);
+    CHECK_ARRAY_CLOSE (H.data(), H_restored.data(), H.size(), TEST_PREC);
+
+    Vector3d point (0.1, 0.2, 0.3);
+    CHECK_ARRAY_CLOSE (
+        CalcBodyToBaseCoordinates (*model, q, model->GetBodyId ("foot_r"),
+          point).data(),
+        CalcBodyToBaseCoordinates (reordered_model, q_reordered,
+          reordered_model.GetBodyId ("foot_r"), point).data(),
+        3, TEST_PREC);
+  }
+
+  Model *model;
+  VectorNd q;
+  VectorNd qdot;
+  VectorNd tau;
+};
+
+TEST_FIXTURE (ReorderingFixture, ModelReorderBreadthFirst) {
+  CheckReordering (BodyOrderingBreadthFirst);
+
+  Model reordered_model;
+  ModelPermutation permutation;
+  ReorderModel (*model, reordered_model, permutation,
+      BodyOrderingBreadthFirst);
+
+  // the parents of the bodies of a level precede those of the next level
+  for (unsigned int i = 2; i < reordered_model.mBodies.size(); i++) {
+    CHECK (reordered_model.lambda[i - 1] <= reordered_model.lambda[i]);
+  }
+
+  CHECK_EQUAL (3u, reordered_model.GetBodyId ("hip_l"));
+  CHECK_EQUAL (4u, reordered_model.GetBodyId ("hip_r"));
+  CHECK_EQUAL (5u, reordered_model.GetBodyId ("arm"));
+  CHECK_EQUAL (6u, reordered_model.GetBodyId ("knee_l"));
+}
+
+TEST_FIXTURE (ReorderingFixture, ModelReorderDepthFirst) {
+  CheckReordering (BodyOrderingDepthFirst);
+
+  Model reordered_model;
+  ModelPermutation permutation;
+  ReorderModel (*model, reordered_model, permutation,
+      BodyOrderingDepthFirst);
+
+  // the model was already created depth-first
+  for (unsigned int i = 0; i < model->mBodies.size(); i++) {
+    CHECK_EQUAL (i, permutation.body_new_from_old[i]);
+  }
+}
+
+TEST ( ModelReorderDepthFirstLongChain ) {
+  // the depth-first traversal must not be limited by the call stack
+  Model model;
+  Body body (1., Vector3d (0., 0.5, 0.), Vector3d (0.1, 0.1, 0.1));
+  unsigned int parent_id = 0;
+  for (unsigned int i = 0; i < 20000; i++) {
+    parent_id = model.AddBody (parent_id, Xtrans (Vector3d (0., 1., 0.)),
+        Joint (JointTypeRevoluteZ), body);
+  }
+
+  Model reordered_model;
+  ModelPermutation permutation;
+  ReorderModel (model, reordered_model, permutation, BodyOrderingDepthFirst);
+
+  CHECK_EQUAL (model.mBodies.size(), reordered_model.mBodies.size());
+  for (unsigned int i = 0; i < model.mBodies.size(); i++) {
+    CHECK_EQUAL (i, permutation.body_new_from_old[i]);
+  }
+}
+
+TEST_FIXTURE (ReorderingFixture, ModelCompiledModelRoundTrip) {
+  // a fixed body on the root body
+  model->AddBody (0, Xtrans (Vector3d (0.5, 0., 0.)), Joint (JointTypeFixed),
+      Body (0.7, Vector3d (0., 0.1, 0.), Vector3d (0.1, 0.1, 0.1)),
+      "fixed_to_root");
+
+  std::vector<char> buffer;
+  CHECK (CompiledModelWriteToBuffer (*model, buffer));
+  CHECK_EQUAL (0u, buffer.size() % 8);
+
+  Model compiled_model;
+  CHECK (CompiledModelReadFromMemory (&buffer[0], buffer.size(),
+        &compiled_model));
+
+  CHECK_EQUAL (model->q_size, compiled_model.q_size);
+  CHECK_EQUAL (model->qdot_size, compiled_model.qdot_size);
+  CHECK_EQUAL (model->mBodies.size(), compiled_model.mBodies.size());
+  CHECK_EQUAL (model->mFixedBodies.size(),
+      compiled_model.mFixedBodies.size());
+  CHECK (model->lambda == compiled_model.lambda);
+  CHECK (model->multdof3_w_index == compiled_model.multdof3_w_index);
+  CHECK (model->mBodyNameMap == compiled_model.mBodyNameMap);
+  CHECK_ARRAY_EQUAL (model->gravity.data(), compiled_model.gravity.data(),
+      3);
+
+  for (unsigned int i = 1; i < model->mBodies.size(); i++) {
+    CHECK_EQUAL (model->mJoints[i].mJointType,
+        compiled_model.mJoints[i].mJointType);
+    CHECK_EQUAL (model->mJoints[i].q_index, compiled_model.mJoints[i].q_index);
+    CHECK_EQUAL (model->mBodies[i].mIsVirtual,
+        compiled_model.mBodies[i].mIsVirtual);
+  }
+
+  VectorNd qddot (VectorNd::Zero (model->qdot_size));
+  VectorNd qddot_compiled (VectorNd::Zero (model->qdot_size));
+  ForwardDynamics (*model, q, qdot, tau, qddot);
+  ForwardDynamics (compiled_model, q, qdot, tau, qddot_compiled);
+  CHECK_ARRAY_EQUAL (qddot.data(), qddot_compiled.data(), qddot.size());
+
+  MatrixNd H (MatrixNd::Zero (model->qdot_size, model->qdot_size));
+  MatrixNd H_compiled (MatrixNd::Zero (model->qdot_size, model->qdot_size));
+  CompositeRigidBodyAlgorithm (*model, q, H);
+  CompositeRigidBodyAlgorithm (compiled_model, q, H_compiled);
+  CHECK_ARRAY_EQUAL (H.data(), H_compiled.data(), H.size());
+
+  Vector3d point (0.1, 0.2, 0.3);
+  CHECK_ARRAY_EQUAL (
+      CalcBodyToBaseCoordinates (*model, q, model->GetBodyId ("foot_r"),
+        point).data(),
+      CalcBodyToBaseCoordinates (compiled_model, q,
+        compiled_model.GetBodyId ("foot_r"), point).data(),
+      3);
+
+  // the model has to be empty
+  CHECK (!CompiledModelReadFromMemory (&buffer[0], buffer.size(),
+        &compiled_model));
+
+  // truncated and corrupted data is rejected
+  Model truncated_model;
+  CHECK (!CompiledModelReadFromMemory (&buffer[0], buffer.size() - 8,
+        &truncated_model));
+  CHECK_EQUAL (1u, truncated_model.mBodies.size());
+
+  std::vector<char> corrupted_buffer (buffer);
+  corrupted_buffer[0] = 'X';
+  Model corrupted_model;
+  CHECK (!CompiledModelReadFromMemory (&corrupted_buffer[0],
+        corrupted_buffer.size(), &corrupted_model));
+  CHECK_EQUAL (1u, corrupted_model.mBodies.size());
+}
+
+TEST (ModelAddBodiesBulkConstruction) {
+  Body body (1.1, Vector3d (0.1, 0.2, -0.3), Vector3d (0.3, 0.2, 0.1));
+  Joint joints[5] = {
+    Joint (JointTypeRevoluteZ),
+    Joint (JointTypeSpherical),
+    Joint (JointTypeEulerZYX),
+    Joint (JointTypeFixed),
+    Joint (SpatialVector (1., 0., 0., 0., 0., 0.),
+        SpatialVector (0., 0., 0., 1., 0., 0.))
+  };
+
+  std::vector<Model::BodyDescription> bodies;
+  bodies.push_back (Model::BodyDescription (0, SpatialTransform(),
+        Joint (JointTypeFloatingBase), body, "base"));
+
+  for (unsigned int i = 1; i < 40; i++) {
+    std::ostringstream body_name;
+    body_name << "body_" << i;
+
+    Model::BodyDescription description (0,
+        Xtrans (Vector3d (0.1, 0.05 * i, 0.)), joints[i % 5], body,
+        body_name.str());
+    // chains of up to four bodies that are attached to the base
+    description.parent_index = (i % 4 == 1) ? 0 : i - 1;
+    bodies.push_back (description);
+  }
+
+  Model model;
+  std::vector<unsigned int> body_ids;
+  for (unsigned int i = 0; i < bodies.size(); i++) {
+    unsigned int parent_id = body_ids.size() > 0 ?
+      body_ids[bodies[i].parent_index] : 0;
+    body_ids.push_back (model.AddBody (parent_id, bodies[i].joint_frame,
+          bodies[i].joint, bodies[i].body, bodies[i].body_name));
+  }
+
+  Model bulk_model;
+  std::vector<unsigned int> bulk_body_ids = bulk_model.AddBodies (bodies);
+
+  CHECK (body_ids == bulk_body_ids);
+  CHECK_EQUAL (model.q_size, bulk_model.q_size);
+  CHECK_EQUAL (model.qdot_size, bulk_model.qdot_size);
+  CHECK (model.lambda == bulk_model.lambda);
+  CHECK (model.lambda_q == bulk_model.lambda_q);
+  CHECK (model.mu == bulk_model.mu);
+  CHECK (model.multdof3_w_index == bulk_model.multdof3_w_index);
+  CHECK (model.mJointUpdateOrder == bulk_model.mJointUpdateOrder);
+  CHECK (model.mBodyNameMap == bulk_model.mBodyNameMap);
+  CHECK_EQUAL (model.d.size(), bulk_model.d.size());
+  CHECK_EQUAL (model.q_sin.size(), bulk_model.q_sin.size());
+  CHECK_EQUAL (model.mFixedBodies.size(), bulk_model.mFixedBodies.size());
+
+  VectorNd q (VectorNd::Zero (model.q_size));
+  VectorNd qdot (VectorNd::Zero (model.qdot_size));
+  VectorNd tau (VectorNd::Zero (model.qdot_size));
+  VectorNd qddot (VectorNd::Zero (model.qdot_size));
+  VectorNd qddot_bulk (VectorNd::Zero (model.qdot_size));
+
+  for (unsigned int i = 0; i < model.qdot_size; i++) {
+    q[i] = 0.4 * sin (1.3 * i);
+    qdot[i] = 0.3 * cos (0.7 * i);
+    tau[i] = 0.2 * sin (0.9 * i + 0.5);
+  }
+
+  for (unsigned int i = 1; i < model.mBodies.size(); i++) {
+    if (model.mJoints[i].mJointType == JointTypeSpherical) {
+      model.SetQuaternion (i, Quaternion (0., 0., 0., 1.), q);
+    }
+  }
+
+  ForwardDynamics (model, q, qdot, tau, qddot);
+  ForwardDynamics (bulk_model, q, qdot, tau, qddot_bulk);
+
+  CHECK_ARRAY_EQUAL (qddot.data(), qddot_bulk.data(), qddot.size());
+}
+
+TEST (ModelNameIndex) {
+  NameIndex index;
+
+  CHECK (index.Insert ("a", 3));
+  CHECK (!index.Insert ("a", 4));
+  CHECK (!index.Insert ("b", 3));
+  CHECK (!index.Insert ("c", NameIndex::InvalidHandle));
+  CHECK_EQUAL (1u, index.size());
+
+  // enough entries to grow the hash tables several times
+  for (unsigned int i = 0; i < 1000; i++) {
+    std::stringstream name;
+    name << "body_" << i;
+    CHECK (index.Insert (name.str(), 1000 + 7 * i));
+  }
+
+  CHECK_EQUAL (1001u, index.size());
+  CHECK_EQUAL (3u, index.Find ("a"));
+  CHECK_EQUAL (1000u + 7 * 517, index.Find ("body_517"));
+  CHECK_EQUAL (std::string ("body_517"), index.GetName (1000 + 7 * 517));
+  CHECK_EQUAL (NameIndex::InvalidHandle, index.Find ("body_1000"));
+  CHECK_EQUAL (std::string (""), index.GetName (1001));
+  CHECK (!index.HasHandle (4));
+
+  index.clear();
+  CHECK_EQUAL (0u, index.size());
+  CHECK_EQUAL (NameIndex::InvalidHandle, index.Find ("a"));
+}
+
+TEST_FIXTURE (ReorderingFixture, ModelNameIndices) {
+  unsigned int base_id = model->GetBodyId ("base");
+  unsigned int hip_l_id = model->GetBodyId ("hip_l");
+  unsigned int knee_l_id = model->GetBodyId ("knee_l");
+  unsigned int foot_l_id = model->GetBodyId ("foot_l");
+
+  std::map<std::string, unsigned int>::const_iterator name_iter;
+  for (name_iter = model->mBodyNameMap.begin();
+      name_iter != model->mBodyNameMap.end(); ++name_iter) {
+    CHECK_EQUAL (name_iter->first, model->GetBodyName (name_iter->second));
+  }
+  CHECK (model->IsFixedBodyId (foot_l_id));
+  CHECK_EQUAL (std::numeric_limits<unsigned int>::max(),
+      model->GetBodyId ("unknown"));
+
+  CHECK (model->SetJointName (base_id, "floating_base"));
+  CHECK (model->SetJointName (hip_l_id, "hip_l_joint"));
+  CHECK (model->SetJointName (knee_l_id, "knee_l_joint"));
+  CHECK (model->SetJointName (foot_l_id, "ankle_l_joint"));
+
+  CHECK_EQUAL (base_id, model->GetJointId ("floating_base"));
+  CHECK_EQUAL (foot_l_id, model->GetJointId ("ankle_l_joint"));
+  CHECK_EQUAL (std::string ("knee_l_joint"), model->GetJointName (knee_l_id));
+
+  // the floating base joint consists of a virtual translational body and
+  // the spherical joint of the base body
+  for (unsigned int i = 0; i < 6; i++) {
+    std::stringstream dof_name;
+    dof_name << "floating_base_" << i;
+    CHECK_EQUAL (i, model->GetDoFIndex (dof_name.str().c_str()));
+    CHECK_EQUAL (dof_name.str(), model->GetDoFName (i));
+  }
+  CHECK_EQUAL (model->mJoints[hip_l_id].q_index + 2,
+      model->GetDoFIndex ("hip_l_joint_2"));
+  CHECK_EQUAL (model->mJoints[knee_l_id].q_index,
+      model->GetDoFIndex ("knee_l_joint"));
+  CHECK_EQUAL (10u, model->mDoFNameIndex.size());
+
+  // the names are kept by compiled models
+  std::vector<char> buffer;
+  CHECK (CompiledModelWriteToBuffer (*model, buffer));
+  Model compiled_model;
+  CHECK (CompiledModelReadFromMemory (&buffer[0], buffer.size(),
+        &compiled_model));
+  CHECK_EQUAL (foot_l_id, compiled_model.GetJointId ("ankle_l_joint"));
+  CHECK_EQUAL (std::string ("foot_l"), compiled_model.GetBodyName (foot_l_id));
+  CHECK_EQUAL (model->GetDoFIndex ("hip_l_joint_1"),
+      compiled_model.GetDoFIndex ("hip_l_joint_1"));
+  CHECK_EQUAL (model->mDoFNameIndex.size(),
+      compiled_model.mDoFNameIndex.size());
+
+  // and refer to the renumbered bodies and degrees of freedom of reordered
+  // models
+  Model reordered_model;
+  ModelPermutation permutation;
+  ReorderModel (*model, reordered_model, permutation,
+      BodyOrderingBreadthFirst);
+  CHECK_EQUAL (permutation.GetReorderedBodyId (knee_l_id),
+      reordered_model.GetJointId ("knee_l_joint"));
+  CHECK_EQUAL (permutation.qdot_new_from_old[
+      model->GetDoFIndex ("knee_l_joint")],
+      reordered_model.GetDoFIndex ("knee_l_joint"));
+  CHECK_EQUAL (permutation.qdot_new_from_old[
+      model->GetDoFIndex ("hip_l_joint_0")],
+      reordered_model.GetDoFIndex ("hip_l_joint_0"));
+}
+
+static bool IsInBlock (const SharedModelData &shared_data,
+    const void *pointer) {
+  const char *address = static_cast<const char*>(pointer);
+  return address >= shared_data.GetData()
+    && address < shared_data.GetData() + shared_data.GetSize();
+}
+
+TEST_FIXTURE (ReorderingFixture, ModelSharedModelData) {
+  CHECK (model->SetJointName (model->GetBodyId ("base"), "floating_base"));
+  CHECK (model->SetJointName (model->GetBodyId ("knee_l"), "knee_l_joint"));
+
+  std::vector<char> buffer;
+  CHECK (SharedModelData::WriteToBuffer (*model, buffer));
+
+  SharedModelData shared_data;
+  CHECK (shared_data.Map (&buffer[0], buffer.size()));
+
+  Model shared_model;
+  CHECK (shared_data.CreateModel (&shared_model));
+
+  // the immutable data is used in place
+  CHECK (shared_model.X_T.IsMapped());
+  CHECK (shared_model.I.IsMapped());
+  CHECK (IsInBlock (shared_data, shared_model.X_T.data()));
+  CHECK (IsInBlock (shared_data, shared_model.I.data()));
+  for (unsigned int i = 1; i < shared_model.mJoints.size(); i++) {
+    CHECK (shared_model.mJoints[i].mJointAxesMapped);
+    CHECK (IsInBlock (shared_data, shared_model.mJoints[i].mJointAxes));
+  }
+
+  CHECK_EQUAL (model->mBodies.size(), shared_model.mBodies.size());
+  CHECK_EQUAL (model->q_size, shared_model.q_size);
+  for (unsigned int i = 0; i < model->X_T.size(); i++) {
+    CHECK_ARRAY_EQUAL (model->X_T[i].E.data(), shared_model.X_T[i].E.data(),
+        9);
+    CHECK_ARRAY_EQUAL (model->X_T[i].r.data(), shared_model.X_T[i].r.data(),
+        3);
+  }
+
+  std::map<std::string, unsigned int>::const_iterator name_iter;
+  for (name_iter = model->mBodyNameMap.begin();
+      name_iter != model->mBodyNameMap.end(); ++name_iter) {
+    CHECK_EQUAL (name_iter->second,
+        shared_model.GetBodyId (name_iter->first.c_str()));
+    CHECK_EQUAL (name_iter->first,
+        shared_model.GetBodyName (name_iter->second));
+  }
+  CHECK_EQUAL (model->GetBodyId ("knee_l"),
+      shared_model.GetJointId ("knee_l_joint"));
+  CHECK_EQUAL (std::string ("floating_base"),
+      shared_model.GetJointName (model->GetBodyId ("base")));
+  CHECK_EQUAL (model->GetDoFIndex ("floating_base_4"),
+      shared_model.GetDoFIndex ("floating_base_4"));
+  CHECK_EQUAL (std::string ("knee_l_joint"),
+      shared_model.GetDoFName (model->GetDoFIndex ("knee_l_joint")));
+
+  VectorNd qddot (VectorNd::Zero (model->qdot_size));
+  VectorNd qddot_shared (VectorNd::Zero (model->qdot_size));
+  ForwardDynamics (*model, q, qdot, tau, qddot);
+  ForwardDynamics (shared_model, q, qdot, tau, qddot_shared);
+  CHECK_ARRAY_EQUAL (qddot.data(), qddot_shared.data(), qddot.size());
+
+  // further models and copies refer to the same data
+  Model second_model;
+  CHECK (shared_data.CreateModel (&second_model));
+  CHECK_EQUAL (shared_model.X_T.data(), second_model.X_T.data());
+  CHECK_EQUAL (shared_model.mJoints[1].mJointAxes,
+      second_model.mJoints[1].mJointAxes);
+
+  Model *model_copy = new Model (shared_model);
+  CHECK_EQUAL (shared_model.I.data(), model_copy->I.data());
+  delete model_copy;
+
+  VectorNd qddot_second (VectorNd::Zero (model->qdot_size));
+  ForwardDynamics (second_model, q, qdot, tau, qddot_second);
+  CHECK_ARRAY_EQUAL (qddot.data(), qddot_second.data(), qddot.size());
+
+  // modifications copy the data into the model
+  unsigned int knee_l_id = model->GetBodyId ("knee_l");
+  SpatialTransform knee_frame = Xtrans (Vector3d (0., -0.5, 0.));
+  second_model.SetJointFrame (knee_l_id, knee_frame);
+  CHECK (!second_model.X_T.IsMapped());
+  CHECK_ARRAY_EQUAL (knee_frame.r.data(), second_model.X_T[knee_l_id].r.data(),
+      3);
+  CHECK_ARRAY_EQUAL (model->X_T[knee_l_id].r.data(),
+      shared_model.X_T[knee_l_id].r.data(), 3);
+
+  unsigned int toe_id = second_model.AddBody (knee_l_id, Xtrans (Vector3d (
+          0., -0.4, 0.)), Joint (JointTypeRevoluteZ),
+      Body (0.5, Vector3d (0., -0.1, 0.), Vector3d (0.1, 0.1, 0.1)), "toe");
+  CHECK (!second_model.I.IsMapped());
+  CHECK_EQUAL (toe_id, second_model.GetBodyId ("toe"));
+  CHECK_EQUAL (knee_l_id, second_model.GetBodyId ("knee_l"));
+  CHECK_EQUAL (std::string ("knee_l_joint"),
+      second_model.GetJointName (knee_l_id));
+}
+
+TEST (ModelSharedModelDataFile) {
+  Model model;
+  Body body (1., Vector3d (0., -0.5, 0.), Vector3d (0.1, 0.1, 0.1));
+  unsigned int upper_id = model.AddBody (0, SpatialTransform(),
+      Joint (JointTypeRevoluteZ), body, "upper");
+  model.AddBody (upper_id, Xtrans (Vector3d (0., -1., 0.)),
+      Joint (JointTypeSpherical), body, "lower");
+  model.AddBody (upper_id, Xtrans (Vector3d (0.1, -0.5, 0.)),
+      Joint (JointTypeFixed), body, "sensor");
+
+  const char *filename = "shared_model_data_test.rbdls";
+  CHECK (SharedModelData::WriteToFile (model, filename));
+
+  VectorNd q (VectorNd::Zero (model.q_size));
+  VectorNd qdot (VectorNd::Zero (model.qdot_size));
+  VectorNd tau (VectorNd::Zero (model.qdot_size));
+  VectorNd qddot (VectorNd::Zero (model.qdot_size));
+  VectorNd qddot_shared (VectorNd::Zero (model.qdot_size));
+  q[0] = 0.3;
+  qdot[1] = -0.7;
+  tau[2] = 0.2;
+  Quaternion lower_orientation (0.2, 0.1, -0.3, 0.927);
+  lower_orientation.normalize();
+  model.SetQuaternion (model.GetBodyId ("lower"), lower_orientation, q);
+  ForwardDynamics (model, q, qdot, tau, qddot);
+
+  {
+    SharedModelData shared_data;
+    CHECK (shared_data.MapFile (filename));
+
+    Model shared_model;
+    CHECK (shared_data.CreateModel (&shared_model));
+    CHECK (shared_model.I.IsMapped());
+    CHECK_EQUAL (model.GetBodyId ("sensor"),
+        shared_model.GetBodyId ("sensor"));
+
+    ForwardDynamics (shared_model, q, qdot, tau, qddot_shared);
+    CHECK_ARRAY_EQUAL (qddot.data(), qddot_shared.data(), qddot.size());
+  }
+
+  remove (filename);
+
+  // invalid blocks are rejected
+  std::vector<char> buffer;
+  CHECK (SharedModelData::WriteToBuffer (model, buffer));
+
+  SharedModelData shared_data;
+  CHECK (!shared_data.Map (&buffer[0], buffer.size() - 8));
+  buffer[0] = 'X';
+  CHECK (!shared_data.Map (&buffer[0], buffer.size()));
+  CHECK (!shared_data.IsMapped());
+
+  Model empty_model;
+  CHECK (!shared_data.CreateModel (&empty_model));
+}
+
+TEST (ModelJointNameCollisions) {
+  Model model;
+  Body body (1., Vector3d (0., 0., 0.5), Vector3d (1., 1., 1.));
+  Joint joint_rot_y (SpatialVector (0., 1., 0., 0., 0., 0.));
+  Joint joint_rot_zyx (
+      SpatialVector (0., 0., 1., 0., 0., 0.),
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.)
+      );
+
+  unsigned int arm_0_id = model.AddBody (0, Xtrans (Vector3d (0., 0., 0.)),
+      joint_rot_y, body, "arm_0");
+  unsigned int arm_id = model.AddBody (arm_0_id,
+      Xtrans (Vector3d (0., 0., 1.)), joint_rot_zyx, body, "arm");
+  unsigned int hand_id = model.AddBody (arm_id,
+      Xtrans (Vector3d (0., 0., 1.)), joint_rot_y, body, "hand");
+
+  // the generated name arm_0 of the first degree of freedom of "arm" is
+  // already taken
+  CHECK (model.SetJointName (arm_0_id, "arm_0"));
+  CHECK (!model.SetJointName (arm_id, "arm"));
+  CHECK_EQUAL (arm_id, model.GetJointId ("arm"));
+  CHECK_EQUAL (model.mJoints[arm_0_id].q_index, model.GetDoFIndex ("arm_0"));
+  CHECK_EQUAL (model.mJoints[arm_id].q_index - 1,
+      model.GetDoFIndex ("arm_1"));
+  CHECK_EQUAL (std::string (""),
+      model.GetDoFName (model.mJoints[arm_id].q_index - 2));
+
+  // joint names are unique
+  CHECK (!model.SetJointName (hand_id, "arm"));
+  CHECK_EQUAL (std::numeric_limits<unsigned int>::max(),
+      model.GetDoFIndex ("hand"));
+  CHECK (model.SetJointName (hand_id, "hand"));
+  CHECK_EQUAL (4u, model.mDoFNameIndex.size());
+}
@@ -1053,3 +1053,235 @@ TEST_FIXTURE ( Human36, SolveMInvTimesTauReuse) {
     CHECK_ARRAY_CLOSE (qddot_solve_llt.data(), qddot_minv.data(), model->dof_count, TEST_PREC * qddot_solve_llt.norm());
   }
 }
+
+TEST ( TestMultiDofJointVsEmulated ) {
+  Joint free_flyer (
+      SpatialVector (0., 0., 0., 1., 0., 0.),
+      SpatialVector (0., 0., 0., 0., 1., 0.),
+      SpatialVector (0., 0., 0., 0., 0., 1.),
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.),
+      SpatialVector (0., 0., 1., 0., 0., 0.)
+      );
+  Joint rot_yxz (
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.),
+      SpatialVector (0., 0., 1., 0., 0., 0.)
+      );
+  Joint rot_trans (
+      SpatialVector (0., 0.6, 0.8, 0., 0., 0.),
+      SpatialVector (0., 0., 0., 1., 0., 0.)
+      );
+  Joint rot_y (SpatialVector (0., 1., 0., 0., 0., 0.));
+
+  MultiDofJoint free_flyer_native (free_flyer);
+  MultiDofJoint rot_yxz_native (rot_yxz);
+  MultiDofJoint rot_trans_native (rot_trans);
+
+  Body body (1.3, Vector3d (0.1, 0.2, -0.3), Vector3d (0.4, 0.5, 0.6));
+
+  Model emulated_model;
+  Model native_model;
+  emulated_model.gravity = Vector3d (0., 0., -9.81);
+  native_model.gravity = Vector3d (0., 0., -9.81);
+
+  unsigned int emu_base = emulated_model.AddBody (0, SpatialTransform(),
+      free_flyer, body);
+  emulated_model.AddBody (emu_base, Xtrans (Vector3d (0.2, 0., -0.1)),
+      rot_yxz, body);
+  unsigned int emu_child = emulated_model.AppendBody (
+      Xtrans (Vector3d (0., 0., -0.4)), rot_trans, body);
+  emulated_model.AddBody (emu_base, Xtrans (Vector3d (-0.2, 0., 0.1)),
+      rot_y, body);
+
+  unsigned int native_base = native_model.AddBodyCustomJoint (0,
+      SpatialTransform(), &free_flyer_native, body);
+  native_model.AddBodyCustomJoint (native_base,
+      Xtrans (Vector3d (0.2, 0., -0.1)), &rot_yxz_native, body);
+  unsigned int native_child = native_model.AddBodyCustomJoint (
+      native_model.previously_added_body_id, Xtrans (Vector3d (0., 0., -0.4)),
+      &rot_trans_native, body);
+  native_model.AddBody (native_base, Xtrans (Vector3d (-0.2, 0., 0.1)),
+      rot_y, body);
+
+  CHECK_EQUAL (emulated_model.dof_count, native_model.dof_count);
+  CHECK_EQUAL (5u, native_model.mBodies.size());
+  CHECK_EQUAL (13u, emulated_model.mBodies.size());
+
+  unsigned int n = native_model.dof_count;
+  VectorNd q (n), qdot (n), qddot (n), tau (n);
+  for (unsigned int i = 0; i < n; i++) {
+    q[i] = 0.4 * sin (1.3 * i + 0.1);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    qddot[i] = 0.5 * sin (0.3 * i + 0.2);
+    tau[i] = 0.5 * cos (0.4 * i - 0.1);
+  }
+
+  Vector3d point (0.1, -0.2, 0.3);
+  Vector3d pos_emu = CalcBodyToBaseCoordinates (emulated_model, q, emu_child,
+      point);
+  Vector3d pos_native = CalcBodyToBaseCoordinates (native_model, q,
+      native_child, point);
+  CHECK_ARRAY_CLOSE (pos_emu.data(), pos_native.data(), 3, TEST_PREC);
+
+  Vector3d acc_emu = CalcPointAcceleration (emulated_model, q, qdot, qddot,
+      emu_child, point);
+  Vector3d acc_native = CalcPointAcceleration (native_model, q, qdot, qddot,
+      native_child, point);
+  CHECK_ARRAY_CLOSE (acc_emu.data(), acc_native.data(), 3, 1.0e-10);
+
+  MatrixNd G_emu (MatrixNd::Zero (3, n));
+  MatrixNd G_native (MatrixNd::Zero (3, n));
+  CalcPointJacobian (emulated_model, q, emu_child, point, G_emu);
+  CalcPointJacobian (native_model, q, native_child, point, G_native);
+  CHECK_ARRAY_CLOSE (G_emu.data(), G_native.data(), G_emu.size(), TEST_PREC);
+
+  VectorNd tau_emu (VectorNd::Zero (n));
+  VectorNd tau_native (VectorNd::Zero (n));
+  InverseDynamics (emulated_model, q, qdot, qddot, tau_emu);
+  InverseDynamics (native_model, q, qdot, qddot, tau_native);
+  CHECK_ARRAY_CLOSE (tau_emu.data(), tau_native.data(), n, 1.0e-10);
+
+  VectorNd qddot_emu (VectorNd::Zero (n));
+  VectorNd qddot_native (VectorNd::Zero (n));
+  ForwardDynamics (emulated_model, q, qdot, tau, qddot_emu);
+  ForwardDynamics (native_model, q, qdot, tau, qddot_native);
+  CHECK_ARRAY_CLOSE (qddot_emu.data(), qddot_native.data(), n, 1.0e-10);
+
+  MatrixNd H_emu (MatrixNd::Zero (n, n));
+  MatrixNd H_native (MatrixNd::Zero (n, n));
+  CompositeRigidBodyAlgorithm (emulated_model, q, H_emu);
+  CompositeRigidBodyAlgorithm (native_model, q, H_native);
+  CHECK_ARRAY_CLOSE (H_emu.data(), H_native.data(), H_emu.size(), 1.0e-10);
+
+  // the workspaces of the columns are resized for the second call
+  unsigned int column_counts[2] = { n, 2 };
+  for (unsigned int c = 0; c < 2; c++) {
+    unsigned int k = column_counts[c];
+    MatrixNd B (MatrixNd::Zero (n, k));
+    for (unsigned int i = 0; i < n; i++) {
+      for (unsigned int j = 0; j < k; j++) {
+        B(i,j) = sin (0.7 * i + 1.1 * j);
+      }
+    }
+
+    MatrixNd X_emu (MatrixNd::Zero (n, k));
+    MatrixNd X_native (MatrixNd::Zero (n, k));
+    CalcMInvTimesMatrix (emulated_model, q, B, X_emu);
+    CalcMInvTimesMatrix (native_model, q, B, X_native);
+    CHECK_ARRAY_CLOSE (X_emu.data(), X_native.data(), X_emu.size(), 1.0e-10);
+  }
+}
+
+TEST ( TestAddBodyNativeMultiDofJoints ) {
+  Joint free_flyer (
+      SpatialVector (0., 0., 0., 1., 0., 0.),
+      SpatialVector (0., 0., 0., 0., 1., 0.),
+      SpatialVector (0., 0., 0., 0., 0., 1.),
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.),
+      SpatialVector (0., 0., 1., 0., 0., 0.)
+      );
+  Joint rot_yxz (
+      SpatialVector (0., 1., 0., 0., 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.),
+      SpatialVector (0., 0., 1., 0., 0., 0.)
+      );
+  // helical axes are not supported by MultiDofJoint and remain emulated
+  Joint helical_rot (
+      SpatialVector (0., 0., 1., 0.1, 0., 0.),
+      SpatialVector (1., 0., 0., 0., 0., 0.)
+      );
+
+  Body body (1.3, Vector3d (0.1, 0.2, -0.3), Vector3d (0.4, 0.5, 0.6));
+
+  Model emulated_model;
+  Model *native_model = new Model;
+  emulated_model.gravity = Vector3d (0., 0., -9.81);
+  native_model->gravity = Vector3d (0., 0., -9.81);
+  native_model->mNativeMultiDofJoints = true;
+
+  Model *models[2] = { &emulated_model, native_model };
+  unsigned int child_ids[2];
+  for (unsigned int m = 0; m < 2; m++) {
+    unsigned int base_id = models[m]->AddBody (0, SpatialTransform(),
+        free_flyer, body, "base");
+    models[m]->AddBody (base_id, Xtrans (Vector3d (0.2, 0., -0.1)),
+        rot_yxz, body);
+    child_ids[m] = models[m]->AppendBody (Xtrans (Vector3d (0., 0., -0.4)),
+        helical_rot, body, "child");
+  }
+
+  CHECK_EQUAL (emulated_model.dof_count, native_model->dof_count);
+  CHECK_EQUAL (12u, emulated_model.mBodies.size());
+  CHECK_EQUAL (5u, native_model->mBodies.size());
+  CHECK_EQUAL (2u, native_model->mCustomJoints.size());
+  CHECK_EQUAL (2u, native_model->mOwnedCustomJoints.size());
+  CHECK_EQUAL (0u, emulated_model.mCustomJoints.size());
+  CHECK_EQUAL (1u, native_model->GetBodyId ("base"));
+  CHECK_EQUAL (child_ids[1], native_model->GetBodyId ("child"));
+
+  // copies share the joints and keep them alive
+  Model native_model_copy (*native_model);
+  delete native_model;
+
+  unsigned int n = emulated_model.dof_count;
+  VectorNd q (n), qdot (n), tau (n);
+  for (unsigned int i = 0; i < n; i++) {
+    q[i] = 0.4 * sin (1.3 * i + 0.1);
+    qdot[i] = 0.5 * cos (0.7 * i);
+    tau[i] = 0.5 * cos (0.4 * i - 0.1);
+  }
+
+  Vector3d point (0.1, -0.2, 0.3);
+  Vector3d pos_emu = CalcBodyToBaseCoordinates (emulated_model, q,
+      child_ids[0], point);
+  Vector3d pos_native = CalcBodyToBaseCoordinates (native_model_copy, q,
+      child_ids[1], point);
+  CHECK_ARRAY_CLOSE (pos_emu.data(), pos_native.data(), 3, TEST_PREC);
+
+  VectorNd qddot_emu (VectorNd::Zero (n));
+  VectorNd qddot_native (VectorNd::Zero (n));
+  ForwardDynamics (emulated_model, q, qdot, tau, qddot_emu);
+  ForwardDynamics (native_model_copy, q, qdot, tau, qddot_native);
+  CHECK_ARRAY_CLOSE (qddot_emu.data(), qddot_native.data(), n, 1.0e-10);
+}
+
+TEST_FIXTURE (Human36, TestJcalcSinCosCache) {
+  // angles of all octants, multiples of pi/4 and values beyond the range
+  // of the batch evaluation
+  for (unsigned int i = 0; i < q.size(); i++) {
+    q[i] = 40. * sin (1.3 * i) + 0.25 * M_PI * static_cast<double>(i % 3);
+    qdot[i] = 0.7 * cos (0.9 * i);
+  }
+  q[0] = 0.;
+  q[1] = -0.25 * M_PI;
+  q[2] = 3. * M_PI;
+  q[3] = 2.0e6;
+  q[4] = -1.0e9;
+
+  Model *models[3] = { model, model_emulated, model_3dof };
+
+  for (unsigned int m = 0; m < 3; m++) {
+    Model &test_model = *models[m];
+    jcalc_sincos (test_model, q);
+
+    for (unsigned int i = 0; i < test_model.q_size; i++) {
+      CHECK_CLOSE (sin (q[i]), test_model.q_sin[i], 1.0e-15);
+      CHECK_CLOSE (cos (q[i]), test_model.q_cos[i], 1.0e-15);
+    }
+
+    for (unsigned int i = 1; i < test_model.mBodies.size(); i++) {
+      jcalc (test_model, i, q, qdot);
+      SpatialMatrix X_lambda = test_model.X_lambda[i].toMatrix();
+      SpatialVector v_J = test_model.v_J[i];
+      SpatialVector c_J = test_model.c_J[i];
+
+      jcalc (test_model, i, q, qdot, true);
+      CHECK_ARRAY_CLOSE (X_lambda.data(),
+          test_model.X_lambda[i].toMatrix().data(), 36, 1.0e-14);
+      CHECK_ARRAY_CLOSE (v_J.data(), test_model.v_J[i].data(), 6, 1.0e-14);
+      CHECK_ARRAY_CLOSE (c_J.data(), test_model.c_J[i].data(), 6, 1.0e-14);
+    }
+  }
+}
@@ -566,6 +566,81 @@ TEST(TestSpatialRigidBodyInertiaCreateFromMatrix) {
   CHECK_ARRAY_EQUAL (inertia.data(), rbi_I_matrix.data(), 9);
 }
 
+TEST(TestSpatialTransformApplyTransposeSpatialArticulatedBodyInertia) {
+  SpatialMatrix IA (
+      1.1, 0.5, 0.3, 0.2, -0.4, 0.7,
+      0.5, 1.2, 0.4, 0.1, 0.3, -0.6,
+      0.3, 0.4, 1.3, -0.5, 0.2, 0.4,
+      0.2, 0.1, -0.5, 2.1, 0.3, 0.2,
+      -0.4, 0.3, 0.2, 0.3, 2.2, 0.1,
+      0.7, -0.6, 0.4, 0.2, 0.1, 2.3
+      );
+
+  SpatialTransform X (
+      Xrotz (0.5) *
+      Xroty (0.9) *
+      Xrotx (0.2) *
+      Xtrans (Vector3d (1.1, 1.2, 1.3))
+      );
+
+  SpatialArticulatedBodyInertia abi (IA);
+  CHECK_ARRAY_EQUAL (IA.data(), abi.toMatrix().data(), 36);
+
+  SpatialMatrix IA_transformed = X.toMatrixTranspose() * IA * X.toMatrix();
+
+  CHECK_ARRAY_CLOSE (
+      IA_transformed.data(),
+      X.applyTranspose (abi).toMatrix().data(),
+      36,
+      TEST_PREC
+      );
+
+  SpatialMatrix IA_sum = IA;
+  X.applyTranspose (abi).addToSpatialMatrix (IA_sum);
+  SpatialMatrix IA_sum_ref = IA + IA_transformed;
+
+  CHECK_ARRAY_CLOSE (IA_sum_ref.data(), IA_sum.data(), 36, TEST_PREC);
+
+  SpatialVector v (1.1, -1.2, 1.3, -1.4, 1.5, -1.6);
+  SpatialVector f_ref = IA * v;
+  CHECK_ARRAY_CLOSE (f_ref.data(), SpatialVector (abi * v).data(), 6,
+      TEST_PREC);
+}
+
+TEST(TestSpatialArticulatedBodyInertiaUpdates) {
+  SpatialRigidBodyInertia rbi = SpatialRigidBodyInertia::createFromMassComInertiaC (
+      1.1,
+      Vector3d (1.5, 1.2, 1.3),
+      Matrix3d (
+        8.0, 3.0, 2.0,
+        3.0, 7.0, 1.0,
+        2.0, 1.0, 6.0
+        )
+      );
+
+  SpatialArticulatedBodyInertia abi (rbi);
+  CHECK_ARRAY_EQUAL (rbi.toMatrix().data(), abi.toMatrix().data(), 36);
+
+  Matrix63 S;
+  S << 0.2, 0.1, -0.3,
+    0.5, -0.4, 0.1,
+    -0.1, 0.3, 0.6,
+    1.2, 0.4, -0.2,
+    -0.3, 0.9, 0.5,
+    0.7, -0.8, 1.1;
+
+  Matrix63 U_ref = rbi.toMatrix() * S;
+  Matrix63 U = abi * S;
+  CHECK_ARRAY_CLOSE (U_ref.data(), U.data(), 18, TEST_PREC);
+
+  Matrix3d Dinv = (S.transpose() * U).inverse();
+  Matrix63 UDinv = U * Dinv;
+  SpatialMatrix Ia_ref = rbi.toMatrix() - UDinv * U.transpose();
+
+  abi.subtractSymmetricProduct (UDinv, U, 3);
+  CHECK_ARRAY_CLOSE (Ia_ref.data(), abi.toMatrix().data(), 36, TEST_PREC);
+}
+
 #ifdef USE_SLOW_SPATIAL_ALGEBRA
 TEST(TestSpatialLinSolve) {
   SpatialVector b (1, 2, 0, 1, 1, 1);